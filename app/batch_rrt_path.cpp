@@ -0,0 +1,148 @@
+/**
+ * @file BatchRRTPath.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Plans many start/goal queries on one shared map
+ *
+ * @section DESCRIPTION
+ * The BatchRRTPath class solves a batch of queries on a ThreadPool, with one
+ * reusable RRTPath per worker and one shared copy of the Map.
+ */
+
+#include "../include/batch_rrt_path.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>   // needed for atomic
+#include <memory>   // needed for shared_ptr and unique_ptr
+#include <mutex>    // needed for mutex and lock_guard
+#include <utility>  // needed for pair
+#include <list>     // needed for list
+#include <vector>   // needed for vector
+
+BatchRRTPath::BatchRRTPath(Map map, size_t thread_count)
+    : pool_(thread_count) {
+  BatchRRTPath::map_ = std::make_shared<const Map>(map);
+  BatchRRTPath::planners_.resize(BatchRRTPath::pool_.GetThreadCount());
+  BatchRRTPath::stop_ = false;
+  BatchRRTPath::seed_ = 0;
+  BatchRRTPath::seeded_ = false;
+}
+
+void BatchRRTPath::SetSeed(uint64_t seed) {
+  BatchRRTPath::seed_ = seed;
+  BatchRRTPath::seeded_ = true;
+}
+
+void BatchRRTPath::Cancel() {
+  BatchRRTPath::stop_.store(true);
+}
+
+size_t BatchRRTPath::GetThreadCount() const {
+  return BatchRRTPath::pool_.GetThreadCount();
+}
+
+std::vector<PlanningResult> BatchRRTPath::FindPaths(
+    const std::vector<PathQuery>& queries, const PlanningBudget& budget) {
+  // A query no worker gets to before a Cancel keeps this result
+  PlanningResult cancelled;
+  cancelled.status = kCancelled;
+  cancelled.iterations = 0;
+  std::vector<PlanningResult> results(queries.size(), cancelled);
+  std::atomic<size_t> next(0);
+
+  // Every worker takes the next unsolved query until there are none left,
+  // which keeps the threads busy even when some queries take much longer
+  for (size_t worker = 0; worker < BatchRRTPath::planners_.size(); worker++) {
+    BatchRRTPath::pool_.Submit(
+        [this, worker, &queries, &budget, &next, &results]() {
+          BatchRRTPath::RunWorker(worker, queries, budget, &next, &results);
+        });
+  }
+  BatchRRTPath::pool_.Wait();
+
+  // A Cancel from before the batch started has now been honoured too
+  BatchRRTPath::stop_.store(false);
+  return results;
+}
+
+bool BatchRRTPath::WritePaths(const std::vector<PathQuery>& queries,
+                              const PlanningBudget& budget,
+                              PathWriter* writer) {
+  if (!writer->IsOpen())
+    return false;
+  std::atomic<size_t> next(0);
+  std::atomic<bool> ok(true);
+  std::mutex writer_mutex;
+
+  for (size_t worker = 0; worker < BatchRRTPath::planners_.size(); worker++) {
+    BatchRRTPath::pool_.Submit(
+        [this, worker, &queries, &budget, &next, writer, &writer_mutex,
+         &ok]() {
+          BatchRRTPath::StreamWorker(worker, queries, budget, &next, writer,
+                                     &writer_mutex, &ok);
+        });
+  }
+  BatchRRTPath::pool_.Wait();
+  BatchRRTPath::stop_.store(false);
+  return ok.load();
+}
+
+RRTPath* BatchRRTPath::PreparePlanner(size_t worker, size_t index,
+                                      const PathQuery& query) {
+  std::unique_ptr<RRTPath> &planner = BatchRRTPath::planners_[worker];
+  if (!planner) {
+    planner.reset(new RRTPath(BatchRRTPath::map_, query.start.first,
+                              query.start.second, query.goal.first,
+                              query.goal.second, query.epsilon,
+                              query.goal_radius));
+    planner->SetStopFlag(&stop_);
+  } else {
+    // Reuse the memory the planner grew on earlier queries
+    planner->Reset(query.start.first, query.start.second,
+                   query.goal.first, query.goal.second, query.epsilon,
+                   query.goal_radius);
+  }
+  if (BatchRRTPath::seeded_)
+    planner->SetSeed(BatchRRTPath::seed_ + index * 0x9E3779B97F4A7C15ULL);
+  return planner.get();
+}
+
+void BatchRRTPath::RunWorker(size_t worker,
+                             const std::vector<PathQuery>& queries,
+                             const PlanningBudget& budget,
+                             std::atomic<size_t>* next,
+                             std::vector<PlanningResult>* results) {
+  for (size_t i = next->fetch_add(1); i < queries.size();
+       i = next->fetch_add(1)) {
+    if (BatchRRTPath::stop_.load())
+      return;
+    RRTPath *planner = BatchRRTPath::PreparePlanner(worker, i, queries[i]);
+    // Each query writes only its own slot, so no locking is needed
+    (*results)[i] = planner->FindPath(budget);
+  }
+}
+
+void BatchRRTPath::StreamWorker(
+    size_t worker, const std::vector<PathQuery>& queries,
+    const PlanningBudget& budget, std::atomic<size_t>* next,
+    PathWriter* writer, std::mutex* writer_mutex, std::atomic<bool>* ok) {
+  std::vector<std::pair<int, int>> path;
+  for (size_t i = next->fetch_add(1); i < queries.size();
+       i = next->fetch_add(1)) {
+    if (BatchRRTPath::stop_.load())
+      return;
+    RRTPath *planner = BatchRRTPath::PreparePlanner(worker, i, queries[i]);
+    PlanningStatus status = planner->FindPath(budget, &path);
+    // A query cut short by Cancel has no answer, so it isn't written
+    if (status == kCancelled)
+      return;
+    // Otherwise the vector holds the way to the vertex closest to the goal,
+    // which is not a path to the goal
+    if (status != kSuccess)
+      path.clear();
+    std::lock_guard<std::mutex> lock(*writer_mutex);
+    if (!writer->Write(i, path))
+      ok->store(false);
+  }
+}
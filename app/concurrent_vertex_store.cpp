@@ -0,0 +1,342 @@
+/**
+ * @file ConcurrentVertexStore.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Append-only vertex storage that many threads can grow at once
+ *
+ * @section DESCRIPTION
+ * Implementation of ConcurrentVertexStore. Indices come from an atomic
+ * counter, blocks are installed with a compare and swap, and vertices are
+ * published by raising the flags above their grid cells and pushing them
+ * onto the lists of the cells.
+ */
+
+#include "../include/concurrent_vertex_store.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>    // needed for min and max
+#include <atomic>       // needed for atomic
+#include <cmath>        // needed for sqrt
+#include <limits>       // needed for numeric_limits
+#include <type_traits>  // needed for is_integral
+#include <utility>      // needed for pair
+
+template <int D, typename T>
+const uint32_t BasicConcurrentVertexStore<D, T>::kNoVertex;
+template <int D, typename T>
+const int BasicConcurrentVertexStore<D, T>::kBlockBits;
+template <int D, typename T>
+const uint32_t BasicConcurrentVertexStore<D, T>::kBlockSize;
+template <int D, typename T>
+const size_t BasicConcurrentVertexStore<D, T>::kMaxBlocks;
+template <int D, typename T>
+const int BasicConcurrentVertexStore<D, T>::kMaxLevels;
+template <int D, typename T>
+const int BasicConcurrentVertexStore<D, T>::kChildren;
+
+namespace {
+
+/**
+ * @brief a block of the pyramid waiting to be searched by Nearest
+ */
+template <int D, typename Difference>
+struct PendingBlock {
+  Difference distance_squared;
+  int level;
+  int cell[D];
+};
+
+/**
+ * @brief the squared distance from a point to the nearest point of a range
+ * of coordinates along one axis
+ */
+template <typename Difference>
+Difference AxisDistanceSquared(Difference value, Difference low,
+                               Difference high) {
+  Difference gap = value < low ? low - value
+                               : (value > high ? value - high : 0);
+  return gap * gap;
+}
+
+}  // namespace
+
+template <int D, typename T>
+BasicConcurrentVertexStore<D, T>::BasicConcurrentVertexStore()
+    : blocks_(new std::atomic<Block*>[kMaxBlocks]) {
+  for (size_t i = 0; i < kMaxBlocks; i++)
+    BasicConcurrentVertexStore::blocks_[i].store(nullptr);
+  BasicConcurrentVertexStore::cell_capacity_ = 0;
+  BasicConcurrentVertexStore::flag_capacity_ = 0;
+  Location empty;
+  for (int axis = 0; axis < D; axis++)
+    SetCoordinate(&empty, axis, static_cast<T>(0));
+  BasicConcurrentVertexStore::Reset(empty, 1);
+}
+
+template <int D, typename T>
+BasicConcurrentVertexStore<D, T>::~BasicConcurrentVertexStore() {
+  for (size_t i = 0; i < kMaxBlocks; i++)
+    delete BasicConcurrentVertexStore::blocks_[i].load();
+}
+
+template <int D, typename T>
+void BasicConcurrentVertexStore<D, T>::Reset(const Location& map_size,
+                                             T min_cell_size) {
+  // Integer points on the far edges of the map are valid, hence the extra
+  // one
+  Difference extent = 0;
+  for (int axis = 0; axis < D; axis++) {
+    extent = std::max<Difference>(extent, GetCoordinate(map_size, axis));
+  }
+  if (std::is_integral<T>::value)
+    extent += 1;
+  Difference cell_size = std::is_integral<T>::value
+                             ? std::max<Difference>(min_cell_size, 1)
+                             : min_cell_size;
+  if (cell_size <= 0)
+    cell_size = std::max<Difference>(extent, 1);
+  int levels = 0;
+  while (levels < kMaxLevels &&
+         cell_size * (int64_t(1) << levels) < extent)
+    levels++;
+  // On large maps the cells grow instead of the grid
+  Difference side_width = static_cast<Difference>(int64_t(1) << levels);
+  Difference covering = std::is_integral<T>::value
+                            ? (extent + side_width - 1) / side_width
+                            : extent / side_width;
+  cell_size = std::max(cell_size, covering);
+  BasicConcurrentVertexStore::cell_size_ = static_cast<T>(cell_size);
+  BasicConcurrentVertexStore::levels_ = levels;
+
+  // Keep the cells and flags of a larger grid from an earlier query
+  size_t side = size_t(1) << levels;
+  size_t cell_count = 1;
+  for (int axis = 0; axis < D; axis++)
+    cell_count *= side;
+  if (cell_count > BasicConcurrentVertexStore::cell_capacity_) {
+    BasicConcurrentVertexStore::cells_.reset(
+        new std::atomic<uint32_t>[cell_count]);
+    BasicConcurrentVertexStore::cell_capacity_ = cell_count;
+  }
+  for (size_t i = 0; i < cell_count; i++)
+    BasicConcurrentVertexStore::cells_[i].store(kNoVertex,
+                                                std::memory_order_relaxed);
+  size_t flag_count = 0;
+  for (int level = 1; level <= levels; level++) {
+    BasicConcurrentVertexStore::level_offsets_[level] = flag_count;
+    size_t blocks = 1;
+    for (int axis = 0; axis < D; axis++)
+      blocks *= side >> level;
+    flag_count += blocks;
+  }
+  if (flag_count > BasicConcurrentVertexStore::flag_capacity_) {
+    BasicConcurrentVertexStore::occupied_.reset(
+        new std::atomic<bool>[flag_count]);
+    BasicConcurrentVertexStore::flag_capacity_ = flag_count;
+  }
+  for (size_t i = 0; i < flag_count; i++)
+    BasicConcurrentVertexStore::occupied_[i].store(false,
+                                                   std::memory_order_relaxed);
+  BasicConcurrentVertexStore::size_.store(0);
+}
+
+template <int D, typename T>
+typename BasicConcurrentVertexStore<D, T>::Block*
+BasicConcurrentVertexStore<D, T>::GetOrCreateBlock(uint32_t index) {
+  std::atomic<Block*> &slot =
+      BasicConcurrentVertexStore::blocks_[index >> kBlockBits];
+  Block *block = slot.load(std::memory_order_acquire);
+  if (block != nullptr)
+    return block;
+  // Several threads may race to allocate the block, only one install wins
+  Block *fresh = new Block;
+  if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel,
+                                   std::memory_order_acquire))
+    return fresh;
+  delete fresh;
+  return block;
+}
+
+template <int D, typename T>
+int BasicConcurrentVertexStore<D, T>::GetCell(T coordinate) const {
+  if (coordinate < 0)
+    return 0;
+  Difference cell = static_cast<Difference>(
+      coordinate / BasicConcurrentVertexStore::cell_size_);
+  return static_cast<int>(std::min<Difference>(
+      cell, (1 << BasicConcurrentVertexStore::levels_) - 1));
+}
+
+template <int D, typename T>
+uint32_t BasicConcurrentVertexStore<D, T>::Add(const Location& location,
+                                               uint32_t parent) {
+  uint32_t index = BasicConcurrentVertexStore::size_.fetch_add(
+      1, std::memory_order_relaxed);
+  if (index >= kNoVertex)
+    return kNoVertex;
+  Block *block = BasicConcurrentVertexStore::GetOrCreateBlock(index);
+  uint32_t offset = index & (kBlockSize - 1);
+  int cell[D];
+  for (int axis = 0; axis < D; axis++) {
+    T coordinate = GetCoordinate(location, axis);
+    block->coordinates[axis][offset] = coordinate;
+    cell[axis] = BasicConcurrentVertexStore::GetCell(coordinate);
+  }
+  block->parent[offset] = parent;
+
+  // Raise the flags above the cell, stopping at the first that is already
+  // up, as every flag above it is too. They are raised before the vertex is
+  // published, so a search that could find the vertex will look for it
+  for (int level = 1; level <= BasicConcurrentVertexStore::levels_;
+       level++) {
+    int above[D];
+    for (int axis = 0; axis < D; axis++)
+      above[axis] = cell[axis] >> level;
+    std::atomic<bool> &flag = BasicConcurrentVertexStore::GetFlag(level,
+                                                                  above);
+    if (flag.load(std::memory_order_relaxed))
+      break;
+    flag.store(true, std::memory_order_relaxed);
+  }
+
+  // Publish the vertex. The release makes everything written above visible
+  // to any reader that finds the vertex through its cell
+  std::atomic<uint32_t> &head_link = BasicConcurrentVertexStore::cells_[
+      BasicConcurrentVertexStore::GetCellIndex(cell)];
+  uint32_t head = head_link.load(std::memory_order_relaxed);
+  do {
+    block->next_in_cell[offset] = head;
+  } while (!head_link.compare_exchange_weak(head, index,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+  return index;
+}
+
+template <int D, typename T>
+void BasicConcurrentVertexStore<D, T>::Remove(uint32_t index) {
+  Block *block = BasicConcurrentVertexStore::GetBlock(index);
+  uint32_t offset = index & (kBlockSize - 1);
+  int cell[D];
+  for (int axis = 0; axis < D; axis++) {
+    cell[axis] = BasicConcurrentVertexStore::GetCell(
+        block->coordinates[axis][offset]);
+  }
+
+  // No one else is using the store, so plain loads and stores will do
+  std::atomic<uint32_t> *link = &BasicConcurrentVertexStore::cells_[
+      BasicConcurrentVertexStore::GetCellIndex(cell)];
+  uint32_t vertex = link->load(std::memory_order_relaxed);
+  if (vertex == index) {
+    link->store(block->next_in_cell[offset], std::memory_order_relaxed);
+    return;
+  }
+  while (vertex != kNoVertex) {
+    Block *current = BasicConcurrentVertexStore::GetBlock(vertex);
+    uint32_t &next = current->next_in_cell[vertex & (kBlockSize - 1)];
+    if (next == index) {
+      next = block->next_in_cell[offset];
+      return;
+    }
+    vertex = next;
+  }
+}
+
+template <int D, typename T>
+void BasicConcurrentVertexStore<D, T>::SearchCell(
+    const int* cell, const Location& point, uint32_t* best,
+    Difference* best_distance) const {
+  uint32_t vertex = BasicConcurrentVertexStore::cells_[
+      BasicConcurrentVertexStore::GetCellIndex(cell)].load(
+          std::memory_order_acquire);
+  while (vertex != kNoVertex) {
+    const Block *block = BasicConcurrentVertexStore::GetBlock(vertex);
+    uint32_t offset = vertex & (kBlockSize - 1);
+    Difference distance = 0;
+    for (int axis = 0; axis < D; axis++) {
+      Difference delta =
+          static_cast<Difference>(block->coordinates[axis][offset]) -
+          GetCoordinate(point, axis);
+      distance += delta * delta;
+    }
+    if (distance < *best_distance) {
+      *best_distance = distance;
+      *best = vertex;
+    }
+    vertex = block->next_in_cell[offset];
+  }
+}
+
+template <int D, typename T>
+uint32_t BasicConcurrentVertexStore<D, T>::Nearest(
+    const Location& point) const {
+  uint32_t best = kNoVertex;
+  Difference best_distance = std::numeric_limits<Difference>::max();
+
+  // Depth first from the top of the pyramid, the nearest child first. Each
+  // level pushes at most kChildren blocks, so the stack never holds more
+  // than kChildren - 1 per level plus the kChildren just pushed
+  PendingBlock<D, Difference> stack[(kChildren - 1) * kMaxLevels +
+                                    kChildren];
+  size_t pending = 0;
+  stack[pending].distance_squared = 0;
+  stack[pending].level = BasicConcurrentVertexStore::levels_;
+  for (int axis = 0; axis < D; axis++)
+    stack[pending].cell[axis] = 0;
+  pending++;
+  while (pending > 0) {
+    PendingBlock<D, Difference> current = stack[--pending];
+    // The best may have improved since the block was pushed
+    if (current.distance_squared >= best_distance)
+      continue;
+    if (current.level == 0) {
+      BasicConcurrentVertexStore::SearchCell(current.cell, point, &best,
+                                             &best_distance);
+      continue;
+    }
+
+    // Push the occupied children within reach, farthest first. Integer
+    // cells hold the coordinates up to one less than the next cell's first
+    PendingBlock<D, Difference> children[kChildren];
+    int child_count = 0;
+    int level = current.level - 1;
+    Difference width = static_cast<Difference>(cell_size_) *
+                       (int64_t(1) << level);
+    Difference inside = std::is_integral<T>::value ? 1 : 0;
+    for (int i = 0; i < kChildren; i++) {
+      PendingBlock<D, Difference> child;
+      child.level = level;
+      child.distance_squared = 0;
+      for (int axis = 0; axis < D; axis++) {
+        int block = current.cell[axis] * 2 + ((i >> (D - 1 - axis)) & 1);
+        child.cell[axis] = block;
+        child.distance_squared += AxisDistanceSquared<Difference>(
+            GetCoordinate(point, axis), block * width,
+            (block + 1) * width - inside);
+      }
+      if (level > 0 &&
+          !BasicConcurrentVertexStore::GetFlag(level, child.cell).load(
+              std::memory_order_relaxed))
+        continue;
+      if (child.distance_squared >= best_distance)
+        continue;
+      int j = child_count++;
+      for (; j > 0 &&
+             children[j - 1].distance_squared < child.distance_squared; j--)
+        children[j] = children[j - 1];
+      children[j] = child;
+    }
+    for (int i = 0; i < child_count; i++)
+      stack[pending++] = children[i];
+  }
+  return best;
+}
+
+template <int D, typename T>
+size_t BasicConcurrentVertexStore<D, T>::Size() const {
+  return std::min(
+      BasicConcurrentVertexStore::size_.load(std::memory_order_acquire),
+      kNoVertex);
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicConcurrentVertexStore);
@@ -0,0 +1,373 @@
+/**
+ * @file KdTree.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Incremental k-d tree used for nearest neighbour queries
+ *
+ * @section DESCRIPTION
+ * The KdTree class is a spatial index over points used by RRTPath
+ * to find the vertex closest to a random point without scanning every vertex.
+ * Points are inserted one at a time into leaf buckets, and full buckets are
+ * split at their median so the tree never needs a full rebuild. Build lays
+ * out a balanced tree for a whole batch of points at once.
+ */
+
+#include "../include/kd_tree.h"
+#include "../include/nearest_kernel.h"
+#include <stdint.h>
+#include <algorithm>  // needed for sort, nth_element and partition
+#include <limits>     // needed for numeric_limits
+#include <vector>     // needed for vector
+
+template <int D, typename T>
+const uint32_t BasicKdTree<D, T>::kNoId;
+template <int D, typename T>
+const size_t BasicKdTree<D, T>::kBucketSize;
+
+template <int D, typename T>
+BasicKdTree<D, T>::BasicKdTree() {
+  BasicKdTree::bucket_count_ = 0;
+  BasicKdTree::size_ = 0;
+  BasicKdTree::Clear();
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::Clear() {
+  // Throw away all nodes but keep the bucket vectors so their memory is
+  // reused by the next tree
+  for (size_t i = 0; i < BasicKdTree::bucket_count_; i++) {
+    for (int axis = 0; axis < D; axis++)
+      BasicKdTree::buckets_[i].coordinates[axis].clear();
+    BasicKdTree::buckets_[i].id.clear();
+  }
+  BasicKdTree::bucket_count_ = 0;
+  BasicKdTree::size_ = 0;
+  BasicKdTree::nodes_.clear();
+
+  // The root starts out as an empty leaf
+  Node root = {0, 0, kNoId, kNoId, BasicKdTree::NewBucket()};
+  BasicKdTree::nodes_.push_back(root);
+}
+
+template <int D, typename T>
+size_t BasicKdTree<D, T>::Size() const {
+  return BasicKdTree::size_;
+}
+
+template <int D, typename T>
+uint32_t BasicKdTree<D, T>::NewBucket() {
+  if (BasicKdTree::bucket_count_ == BasicKdTree::buckets_.size())
+    BasicKdTree::buckets_.push_back(Bucket());
+  return static_cast<uint32_t>(BasicKdTree::bucket_count_++);
+}
+
+template <int D, typename T>
+uint32_t BasicKdTree<D, T>::FindLeaf(const T* point) const {
+  uint32_t current = 0;
+  while (BasicKdTree::nodes_[current].bucket == kNoId) {
+    const Node &node = BasicKdTree::nodes_[current];
+    current = point[node.axis] < node.split ? node.left : node.right;
+  }
+  return current;
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::Insert(const Location& location, uint32_t id) {
+  // Walk down to the leaf whose region contains the point
+  T point[D];
+  for (int axis = 0; axis < D; axis++)
+    point[axis] = GetCoordinate(location, axis);
+  uint32_t current = BasicKdTree::FindLeaf(point);
+
+  // Append to the leaf and split it if it has grown too large
+  Bucket &bucket = BasicKdTree::buckets_[BasicKdTree::nodes_[current].bucket];
+  for (int axis = 0; axis < D; axis++)
+    bucket.coordinates[axis].push_back(point[axis]);
+  bucket.id.push_back(id);
+  BasicKdTree::size_++;
+  if (bucket.id.size() > kBucketSize)
+    BasicKdTree::Split(current);
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::Build(const T* const* coordinates,
+                              const std::vector<uint32_t>& ids) {
+  BasicKdTree::Clear();
+  if (ids.empty())
+    return;
+  std::vector<uint32_t> order(ids);
+  BasicKdTree::BuildNode(0, coordinates, order.data(),
+                         order.data() + order.size());
+  BasicKdTree::size_ = ids.size();
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::BuildNode(uint32_t node_index,
+                                  const T* const* coordinates,
+                                  uint32_t* first, uint32_t* last) {
+  // Find the widest axis, as Split does for a single bucket, ties going to
+  // the earlier axis
+  int axis = 0;
+  Difference widest = 0;
+  T min_value = 0, max_value = 0;
+  for (int a = 0; a < D; a++) {
+    const T *values = coordinates[a];
+    T low = values[*first], high = values[*first];
+    for (const uint32_t *id = first + 1; id != last; ++id) {
+      low = std::min(low, values[*id]);
+      high = std::max(high, values[*id]);
+    }
+    Difference spread = static_cast<Difference>(high) - low;
+    if (a == 0 || spread > widest) {
+      axis = a;
+      widest = spread;
+      min_value = low;
+      max_value = high;
+    }
+  }
+
+  // Few enough points, or all in one place, make a leaf. Its points go in
+  // id order, as if they had been inserted one at a time
+  if (static_cast<size_t>(last - first) <= kBucketSize || widest == 0) {
+    if (BasicKdTree::nodes_[node_index].bucket == kNoId)
+      BasicKdTree::nodes_[node_index].bucket = BasicKdTree::NewBucket();
+    std::sort(first, last);
+    Bucket &bucket =
+        BasicKdTree::buckets_[BasicKdTree::nodes_[node_index].bucket];
+    for (const uint32_t *id = first; id != last; ++id) {
+      for (int a = 0; a < D; a++)
+        bucket.coordinates[a].push_back(coordinates[a][*id]);
+      bucket.id.push_back(*id);
+    }
+    return;
+  }
+
+  // Split at the median of the wider axis, moving the split up past the
+  // smallest value if need be so that both sides get a point
+  const T *values = coordinates[axis];
+  uint32_t *middle = first + (last - first) / 2;
+  std::nth_element(first, middle, last, [values](uint32_t a, uint32_t b) {
+    return values[a] < values[b];
+  });
+  T split = values[*middle];
+  if (split == min_value) {
+    T next = max_value;
+    for (const uint32_t *id = first; id != last; ++id) {
+      if (values[*id] > split)
+        next = std::min(next, values[*id]);
+    }
+    split = next;
+  }
+  middle = std::partition(first, last, [values, split](uint32_t id) {
+    return values[id] < split;
+  });
+
+  // The node's bucket, which only the root has, goes to its left child
+  uint32_t left_node = static_cast<uint32_t>(BasicKdTree::nodes_.size());
+  Node left_leaf = {0, 0, kNoId, kNoId,
+                    BasicKdTree::nodes_[node_index].bucket};
+  Node right_leaf = {0, 0, kNoId, kNoId, kNoId};
+  BasicKdTree::nodes_.push_back(left_leaf);
+  BasicKdTree::nodes_.push_back(right_leaf);
+  Node &node = BasicKdTree::nodes_[node_index];
+  node.split = split;
+  node.axis = axis;
+  node.left = left_node;
+  node.right = left_node + 1;
+  node.bucket = kNoId;
+  BasicKdTree::BuildNode(left_node, coordinates, first, middle);
+  BasicKdTree::BuildNode(left_node + 1, coordinates, middle, last);
+}
+
+template <int D, typename T>
+bool BasicKdTree<D, T>::Remove(const Location& location, uint32_t id) {
+  // The point went down the same way when it was inserted, and splits only
+  // ever move points into the leaf their location belongs in
+  T point[D];
+  for (int axis = 0; axis < D; axis++)
+    point[axis] = GetCoordinate(location, axis);
+  uint32_t current = BasicKdTree::FindLeaf(point);
+
+  // Erase rather than swap with the last point, so the ids stay increasing
+  Bucket &bucket = BasicKdTree::buckets_[BasicKdTree::nodes_[current].bucket];
+  for (size_t i = 0; i < bucket.id.size(); i++) {
+    if (bucket.id[i] != id)
+      continue;
+    for (int axis = 0; axis < D; axis++)
+      bucket.coordinates[axis].erase(bucket.coordinates[axis].begin() + i);
+    bucket.id.erase(bucket.id.begin() + i);
+    BasicKdTree::size_--;
+    return true;
+  }
+  return false;
+}
+
+template <int D, typename T>
+bool BasicKdTree<D, T>::Split(uint32_t node_index) {
+  uint32_t bucket_index = BasicKdTree::nodes_[node_index].bucket;
+
+  // Split along whichever axis has the largest spread
+  int axis = 0;
+  Difference widest = 0;
+  {
+    const Bucket &bucket = BasicKdTree::buckets_[bucket_index];
+    for (int a = 0; a < D; a++) {
+      const std::vector<T> &values = bucket.coordinates[a];
+      T low = values[0], high = values[0];
+      for (size_t i = 1; i < values.size(); i++) {
+        low = std::min(low, values[i]);
+        high = std::max(high, values[i]);
+      }
+      Difference spread = static_cast<Difference>(high) - low;
+      if (a == 0 || spread > widest) {
+        axis = a;
+        widest = spread;
+      }
+    }
+  }
+  // All points sit on top of each other, leave the bucket oversized
+  if (widest == 0)
+    return false;
+
+  // Pick the median coordinate as the split value, making sure at least one
+  // point ends up on each side
+  std::vector<T> values = BasicKdTree::buckets_[bucket_index].coordinates[axis];
+  std::sort(values.begin(), values.end());
+  T split = values[values.size() / 2];
+  if (split == values.front())
+    split = *std::upper_bound(values.begin(), values.end(), split);
+
+  // The old leaf becomes an internal node. Its bucket is reused for the
+  // left leaf and the points that belong on the right are moved to a new
+  // bucket, keeping their insertion order on both sides
+  uint32_t right_bucket = BasicKdTree::NewBucket();
+  // NewBucket may have reallocated buckets_, so look the buckets up now
+  Bucket &left = BasicKdTree::buckets_[bucket_index];
+  Bucket &right = BasicKdTree::buckets_[right_bucket];
+  size_t kept = 0;
+  for (size_t i = 0; i < left.id.size(); i++) {
+    if (left.coordinates[axis][i] < split) {
+      for (int a = 0; a < D; a++)
+        left.coordinates[a][kept] = left.coordinates[a][i];
+      left.id[kept] = left.id[i];
+      kept++;
+    } else {
+      for (int a = 0; a < D; a++)
+        right.coordinates[a].push_back(left.coordinates[a][i]);
+      right.id.push_back(left.id[i]);
+    }
+  }
+  for (int a = 0; a < D; a++)
+    left.coordinates[a].resize(kept);
+  left.id.resize(kept);
+
+  uint32_t left_node = static_cast<uint32_t>(BasicKdTree::nodes_.size());
+  Node left_leaf = {0, 0, kNoId, kNoId, bucket_index};
+  Node right_leaf = {0, 0, kNoId, kNoId, right_bucket};
+  BasicKdTree::nodes_.push_back(left_leaf);
+  BasicKdTree::nodes_.push_back(right_leaf);
+  Node &node = BasicKdTree::nodes_[node_index];
+  node.split = split;
+  node.axis = axis;
+  node.left = left_node;
+  node.right = left_node + 1;
+  node.bucket = kNoId;
+  return true;
+}
+
+template <int D, typename T>
+uint32_t BasicKdTree<D, T>::Nearest(const Location& location,
+                                    Difference* distance_squared) const {
+  Candidate best = {std::numeric_limits<Difference>::max(), kNoId};
+  if (BasicKdTree::size_ > 0) {
+    T point[D];
+    for (int axis = 0; axis < D; axis++)
+      point[axis] = GetCoordinate(location, axis);
+    BasicKdTree::Search(0, point, &best);
+  }
+  if (distance_squared != nullptr)
+    *distance_squared = best.distance_squared;
+  return best.id;
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::Search(uint32_t node_index, const T* point,
+                               Candidate* best) const {
+  const Node &node = BasicKdTree::nodes_[node_index];
+
+  // Leaf: scan every point in the bucket with the vectorized kernel. Points
+  // in a bucket are in insertion order, so the kernel's preference for the
+  // last of several equally close points is a preference for the larger id
+  if (node.bucket != kNoId) {
+    const Bucket &bucket = BasicKdTree::buckets_[node.bucket];
+    if (bucket.id.empty())
+      return;
+    const T *coordinates[D];
+    for (int axis = 0; axis < D; axis++)
+      coordinates[axis] = bucket.coordinates[axis].data();
+    Difference d;
+    size_t i = NearestIndex<D, T>(coordinates, bucket.id.size(), point, &d);
+    if (d < best->distance_squared ||
+        (d == best->distance_squared && bucket.id[i] > best->id)) {
+      best->distance_squared = d;
+      best->id = bucket.id[i];
+    }
+    return;
+  }
+
+  // Internal node: search the side containing the point first, then the
+  // other side only if it could hold something at least as close
+  Difference plane = static_cast<Difference>(point[node.axis]) - node.split;
+  uint32_t near_side = plane < 0 ? node.left : node.right;
+  uint32_t far_side = plane < 0 ? node.right : node.left;
+  BasicKdTree::Search(near_side, point, best);
+  if (plane * plane <= best->distance_squared)
+    BasicKdTree::Search(far_side, point, best);
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::Within(const Location& location,
+                               Difference radius_squared,
+                               std::vector<uint32_t>* ids) const {
+  ids->clear();
+  if (BasicKdTree::size_ > 0) {
+    T point[D];
+    for (int axis = 0; axis < D; axis++)
+      point[axis] = GetCoordinate(location, axis);
+    BasicKdTree::SearchWithin(0, point, radius_squared, ids);
+  }
+}
+
+template <int D, typename T>
+void BasicKdTree<D, T>::SearchWithin(uint32_t node_index, const T* point,
+                                     Difference radius_squared,
+                                     std::vector<uint32_t>* ids) const {
+  const Node &node = BasicKdTree::nodes_[node_index];
+
+  // Leaf: keep every point that is close enough
+  if (node.bucket != kNoId) {
+    const Bucket &bucket = BasicKdTree::buckets_[node.bucket];
+    for (size_t i = 0; i < bucket.id.size(); i++) {
+      Difference distance_squared = 0;
+      for (int axis = 0; axis < D; axis++) {
+        Difference delta =
+            static_cast<Difference>(bucket.coordinates[axis][i]) -
+            point[axis];
+        distance_squared += delta * delta;
+      }
+      if (distance_squared <= radius_squared)
+        ids->push_back(bucket.id[i]);
+    }
+    return;
+  }
+
+  // Internal node: only visit a side the circle reaches into
+  Difference plane = static_cast<Difference>(point[node.axis]) - node.split;
+  if (plane < 0 || plane * plane <= radius_squared)
+    BasicKdTree::SearchWithin(node.left, point, radius_squared, ids);
+  if (plane >= 0 || plane * plane <= radius_squared)
+    BasicKdTree::SearchWithin(node.right, point, radius_squared, ids);
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicKdTree);
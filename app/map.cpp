@@ -8,39 +8,604 @@
  * @section DESCRIPTION
  * This is the implementation of a simple grid map with obstacles. It is
  * always rectangular in size, specified either at creation or later using the
- * setSize method.
+ * setSize method. Obstacles live in one contiguous vector, and a uniform grid
+ * of buckets over the map records the indices of the obstacles near each
+ * cell so collision queries stay local.
  *
  * It has a dependent class, Obstacle.
  */
 
 #include "../include/map.h"
+#include <stdint.h>
+#include <algorithm>  // needed for sort, unique, remove and equal
+#include <cstring>    // needed for memcpy
+#include <type_traits>
 #include <utility>
 #include <list>
-Map::Map() {
-  Map::size_.first = 10;
-  Map::size_.second = 10;
+#include <vector>
+
+namespace {
+
+/**
+ * @brief scrambles a 64 bit value, the splitmix64 finalizer
+ */
+uint64_t Mix(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+/**
+ * @brief the 32 bits of a coordinate that go into a fingerprint
+ */
+uint32_t GetBits(int value) {
+  return static_cast<uint32_t>(value);
+}
+
+/**
+ * @brief the 32 bits of a coordinate that go into a fingerprint
+ */
+uint32_t GetBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/**
+ * @brief hashes a location, two coordinates to each 64 bit word
+ */
+template <int D, typename Location>
+uint64_t HashLocation(const Location& location) {
+  uint64_t hash = 0;
+  for (int axis = 0; axis < D; axis += 2) {
+    uint64_t word = static_cast<uint64_t>(
+        GetBits(GetCoordinate(location, axis))) << 32;
+    if (axis + 1 < D)
+      word |= GetBits(GetCoordinate(location, axis + 1));
+    hash = axis == 0 ? word : Mix(hash) ^ word;
+  }
+  return hash;
+}
+
+/**
+ * @brief moves a point to the next integer location of a box, the last
+ * axis varying fastest
+ * @return false once every location has been visited
+ */
+template <int D, typename Location>
+bool NextLocation(const Location& low, const Location& high,
+                  Location* point) {
+  for (int axis = D - 1; axis >= 0; axis--) {
+    if (GetCoordinate(*point, axis) < GetCoordinate(high, axis)) {
+      SetCoordinate(point, axis, GetCoordinate(*point, axis) + 1);
+      return true;
+    }
+    SetCoordinate(point, axis, GetCoordinate(low, axis));
+  }
+  return false;
+}
+
+}  // namespace
+
+template <int D, typename T>
+const int BasicMap<D, T>::kMinGridCellSize;
+template <int D, typename T>
+const int BasicMap<D, T>::kMaxGridCells;
+template <int D, typename T>
+const int BasicMap<D, T>::kFloatGridCells;
+template <int D, typename T>
+const uint32_t BasicMap<D, T>::kNoObstacle;
+
+template <int D, typename T>
+BasicMap<D, T>::BasicMap() {
+  Location size;
+  for (int axis = 0; axis < D; axis++)
+    SetCoordinate(&size, axis, static_cast<T>(10));
+  BasicMap::size_ = size;
+  BasicMap::collision_model_ = kSampledCollision;
+  BasicMap::BuildGrid();
+}
+
+template <int D, typename T>
+BasicMap<D, T>::BasicMap(Location size, std::vector<Obstacle> obstacles) {
+  BasicMap::size_ = size;
+  BasicMap::obstacles_.swap(obstacles);
+  BasicMap::collision_model_ = kSampledCollision;
+  BasicMap::BuildGrid();
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::BuildGrid() {
+  T longest_side = 0;
+  for (int axis = 0; axis < D; axis++)
+    longest_side = std::max(longest_side, GetCoordinate(BasicMap::size_, axis));
+  if (std::is_integral<T>::value) {
+    // Cells are at least kMinGridCellSize wide, and grow on large maps so
+    // the grid never has more than kMaxGridCells cells along a side
+    longest_side += 1;
+    BasicMap::cell_size_ = std::max<T>(kMinGridCellSize,
+                                       (longest_side + kMaxGridCells - 1) /
+                                       kMaxGridCells);
+  } else {
+    BasicMap::cell_size_ = longest_side > 0 ? longest_side / kFloatGridCells
+                                            : 1;
+  }
+  size_t cells = 1;
+  for (int axis = 0; axis < D; axis++) {
+    BasicMap::grid_cells_[axis] = static_cast<int>(
+        std::max<T>(GetCoordinate(BasicMap::size_, axis), 0) /
+        BasicMap::cell_size_) + 1;
+    cells *= static_cast<size_t>(BasicMap::grid_cells_[axis]);
+  }
+  BasicMap::grid_.assign(cells, std::vector<uint32_t>());
+
+  // Register every obstacle in the cells it touches
+  for (size_t i = 0; i < BasicMap::obstacles_.size(); i++)
+    BasicMap::RegisterObstacle(static_cast<uint32_t>(i));
+}
+
+template <int D, typename T>
+bool BasicMap<D, T>::GetCellRange(const Location& min_corner,
+                                  const Location& max_corner,
+                                  int* first_cell, int* last_cell) const {
+  for (int axis = 0; axis < D; axis++) {
+    // Clip the rectangle to the map
+    T low = std::max<T>(GetCoordinate(min_corner, axis), 0);
+    T high = std::min<T>(GetCoordinate(max_corner, axis),
+                         GetCoordinate(BasicMap::size_, axis));
+    if (low > high)
+      return false;
+    first_cell[axis] = static_cast<int>(low / BasicMap::cell_size_);
+    last_cell[axis] = static_cast<int>(high / BasicMap::cell_size_);
+  }
+  return true;
+}
+
+template <int D, typename T>
+bool BasicMap<D, T>::GetCellRange(const Obstacle& obs, int* first_cell,
+                                  int* last_cell) const {
+  // Obstacle::Contains is only true strictly within the radius, so the
+  // bounding square of the obstacle covers every point it contains. The
+  // corners are computed in the wider difference type and clamped, so
+  // obstacles near the limits of T do not overflow
+  typedef typename ScalarTraits<T>::Difference Difference;
+  T radius = obs.GetSize();
+  if (radius <= 0)
+    return false;
+  Location center = obs.GetLocation();
+  for (int axis = 0; axis < D; axis++) {
+    Difference low = static_cast<Difference>(GetCoordinate(center, axis)) -
+                     radius;
+    Difference high = static_cast<Difference>(GetCoordinate(center, axis)) +
+                      radius;
+    Difference size = GetCoordinate(BasicMap::size_, axis);
+    if (high < 0 || low > size)
+      return false;
+    first_cell[axis] = static_cast<int>(
+        static_cast<T>(std::max<Difference>(low, 0)) / BasicMap::cell_size_);
+    last_cell[axis] = static_cast<int>(
+        static_cast<T>(std::min(high, size)) / BasicMap::cell_size_);
+  }
+  return true;
+}
+
+template <int D, typename T>
+const std::vector<uint32_t>& BasicMap<D, T>::GetCell(
+    const Location& point) const {
+  size_t index = 0;
+  for (int axis = 0; axis < D; axis++) {
+    index = index * BasicMap::grid_cells_[axis] +
+            static_cast<size_t>(GetCoordinate(point, axis) /
+                                BasicMap::cell_size_);
+  }
+  return BasicMap::grid_[index];
+}
+
+template <int D, typename T>
+template <typename Visitor>
+bool BasicMap<D, T>::VisitCells(const int* first_cell, const int* last_cell,
+                                Visitor visit) const {
+  int cell[D];
+  for (int axis = 0; axis < D; axis++)
+    cell[axis] = first_cell[axis];
+  while (true) {
+    size_t index = 0;
+    for (int axis = 0; axis < D; axis++)
+      index = index * BasicMap::grid_cells_[axis] + cell[axis];
+    if (!visit(index))
+      return false;
+
+    // Step to the next cell, the last axis fastest
+    int axis = D - 1;
+    while (axis >= 0 && cell[axis] == last_cell[axis]) {
+      cell[axis] = first_cell[axis];
+      axis--;
+    }
+    if (axis < 0)
+      return true;
+    cell[axis]++;
+  }
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::RegisterObstacle(uint32_t index) {
+  int first_cell[D], last_cell[D];
+  if (!BasicMap::GetCellRange(BasicMap::obstacles_[index], first_cell,
+                              last_cell))
+    return;
+  std::vector<std::vector<uint32_t>> &grid = BasicMap::grid_;
+  BasicMap::VisitCells(first_cell, last_cell, [&grid, index](size_t cell) {
+    grid[cell].push_back(index);
+    return true;
+  });
 }
 
-Map::Map(int height, int width, std::list<Obstacle> obstacle_list) {
-  Map::size_.first = height;
-  Map::size_.second = width;
-  Map::obstacle_list_ = obstacle_list;
+template <int D, typename T>
+void BasicMap<D, T>::UnregisterObstacle(uint32_t index) {
+  int first_cell[D], last_cell[D];
+  if (!BasicMap::GetCellRange(BasicMap::obstacles_[index], first_cell,
+                              last_cell))
+    return;
+  std::vector<std::vector<uint32_t>> &grid = BasicMap::grid_;
+  BasicMap::VisitCells(first_cell, last_cell, [&grid, index](size_t cell) {
+    std::vector<uint32_t> &entries = grid[cell];
+    entries.erase(std::remove(entries.begin(), entries.end(), index),
+                  entries.end());
+    return true;
+  });
 }
 
-void Map::AddObstacle(Obstacle obs) {
-  obstacle_list_.push_back(obs);
-  obstacle_list_.sort();
-  obstacle_list_.unique();
+template <int D, typename T>
+uint32_t BasicMap<D, T>::FindObstacle(const Obstacle& obs) const {
+  // An equal obstacle is registered in exactly the same cells, so one of
+  // them is enough
+  int first_cell[D], last_cell[D];
+  if (BasicMap::GetCellRange(obs, first_cell, last_cell)) {
+    size_t cell = 0;
+    for (int axis = 0; axis < D; axis++)
+      cell = cell * BasicMap::grid_cells_[axis] + first_cell[axis];
+    for (uint32_t index : BasicMap::grid_[cell]) {
+      if (BasicMap::obstacles_[index] == obs)
+        return index;
+    }
+    return kNoObstacle;
+  }
+
+  // Obstacles off the map aren't in the grid
+  for (size_t i = 0; i < BasicMap::obstacles_.size(); i++) {
+    if (BasicMap::obstacles_[i] == obs)
+      return static_cast<uint32_t>(i);
+  }
+  return kNoObstacle;
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::AddObstacle(Obstacle obs) {
+  if (BasicMap::FindObstacle(obs) != kNoObstacle)
+    return;
+  BasicMap::obstacles_.push_back(obs);
+  BasicMap::RegisterObstacle(
+      static_cast<uint32_t>(BasicMap::obstacles_.size() - 1));
+  BasicMap::UpdateBitmap(obs);
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::AddObstacles(const std::vector<Obstacle>& obstacles) {
+  BasicMap::obstacles_.insert(BasicMap::obstacles_.end(), obstacles.begin(),
+                              obstacles.end());
+
+  // Sort the indices rather than the obstacles, so that after dropping the
+  // duplicates the rest keep their order
+  std::vector<uint32_t> order(BasicMap::obstacles_.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = static_cast<uint32_t>(i);
+  const std::vector<Obstacle> &all = BasicMap::obstacles_;
+  std::sort(order.begin(), order.end(), [&all](uint32_t a, uint32_t b) {
+    return all[a] < all[b] || (all[a] == all[b] && a < b);
+  });
+  std::vector<bool> duplicate(order.size(), false);
+  for (size_t i = 1; i < order.size(); i++)
+    duplicate[order[i]] = all[order[i]] == all[order[i - 1]];
+  size_t kept = 0;
+  for (size_t i = 0; i < BasicMap::obstacles_.size(); i++) {
+    if (!duplicate[i])
+      BasicMap::obstacles_[kept++] = BasicMap::obstacles_[i];
+  }
+  BasicMap::obstacles_.erase(BasicMap::obstacles_.begin() + kept,
+                             BasicMap::obstacles_.end());
+
+  // Indices have moved, so register everything afresh
+  BasicMap::BuildGrid();
+  if (!BasicMap::bitmap_.IsEmpty())
+    BasicMap::EnableOccupancyBitmap(true);
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::RemoveObstacle(Obstacle obs) {
+  for (uint32_t index = BasicMap::FindObstacle(obs); index != kNoObstacle;
+       index = BasicMap::FindObstacle(obs)) {
+    // Move the last obstacle into the gap, re-registering it at its new index
+    uint32_t last = static_cast<uint32_t>(BasicMap::obstacles_.size() - 1);
+    BasicMap::UnregisterObstacle(index);
+    if (index != last) {
+      BasicMap::UnregisterObstacle(last);
+      BasicMap::obstacles_[index] = BasicMap::obstacles_[last];
+      BasicMap::RegisterObstacle(index);
+    }
+    BasicMap::obstacles_.pop_back();
+  }
+  // The grid no longer has the obstacle, so recomputing its area clears any
+  // bits that no other obstacle covers
+  BasicMap::UpdateBitmap(obs);
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::GetBitmapCell(const Location& point, int* column,
+                                   int* row) const {
+  *column = static_cast<int>(GetCoordinate(point, 0));
+  *row = 0;
+  for (int axis = 1; axis < D; axis++) {
+    *row = *row * (static_cast<int>(GetCoordinate(BasicMap::size_, axis)) +
+                   1) + static_cast<int>(GetCoordinate(point, axis));
+  }
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::EnableOccupancyBitmap(bool enable) {
+  if (!enable || !std::is_integral<T>::value) {
+    BasicMap::bitmap_.Clear();
+    return;
+  }
+  // One column per x location and one row per location of the other axes,
+  // both ends included
+  int rows = 1;
+  for (int axis = 1; axis < D; axis++) {
+    rows *= std::max(static_cast<int>(GetCoordinate(BasicMap::size_, axis)),
+                     -1) + 1;
+  }
+  BasicMap::bitmap_.Reset(
+      std::max(static_cast<int>(GetCoordinate(BasicMap::size_, 0)), -1) + 1,
+      rows);
+  for (const Obstacle &obs : BasicMap::obstacles_) {
+    Location low, high;
+    if (!BasicMap::GetBitmapBox(obs, &low, &high))
+      continue;
+    Location point = low;
+    do {
+      if (obs.Contains(point)) {
+        int column, row;
+        BasicMap::GetBitmapCell(point, &column, &row);
+        BasicMap::bitmap_.Set(column, row, true);
+      }
+    } while (NextLocation<D>(low, high, &point));
+  }
+}
+
+template <int D, typename T>
+bool BasicMap<D, T>::GetBitmapBox(const Obstacle& obs, Location* low,
+                                  Location* high) const {
+  T radius = obs.GetSize();
+  Location center = obs.GetLocation();
+  for (int axis = 0; axis < D; axis++) {
+    T size = GetCoordinate(BasicMap::size_, axis);
+    SetCoordinate(low, axis,
+                  std::max<T>(GetCoordinate(center, axis) - radius, 0));
+    SetCoordinate(high, axis,
+                  std::min<T>(GetCoordinate(center, axis) + radius, size));
+    if (GetCoordinate(*low, axis) > GetCoordinate(*high, axis))
+      return false;
+  }
+  return true;
 }
 
-void Map::RemoveObstacle(Obstacle obs) {
-  obstacle_list_.remove(obs);
+template <int D, typename T>
+bool BasicMap<D, T>::HasOccupancyBitmap() const {
+  return !BasicMap::bitmap_.IsEmpty();
 }
 
-std::pair<int, int> Map::GetSize() {
+template <int D, typename T>
+void BasicMap<D, T>::UpdateBitmap(const Obstacle& obs) {
+  Location low, high;
+  if (BasicMap::bitmap_.IsEmpty() ||
+      !BasicMap::GetBitmapBox(obs, &low, &high))
+    return;
+  Location point = low;
+  do {
+    // Ask the grid, bypassing the bitmap we are rebuilding
+    bool occupied = false;
+    for (uint32_t other : BasicMap::GetCell(point))
+      occupied = occupied || BasicMap::obstacles_[other].Contains(point);
+    int column, row;
+    BasicMap::GetBitmapCell(point, &column, &row);
+    BasicMap::bitmap_.Set(column, row, occupied);
+  } while (NextLocation<D>(low, high, &point));
+}
+
+template <int D, typename T>
+typename BasicMap<D, T>::Location BasicMap<D, T>::GetSize() const {
   return size_;
 }
 
-std::list<Obstacle> Map::GetObstacleList() {
-  return obstacle_list_;
+template <int D, typename T>
+bool BasicMap<D, T>::IsOnMap(const Location& point) const {
+  for (int axis = 0; axis < D; axis++) {
+    if (GetCoordinate(point, axis) < 0 ||
+        GetCoordinate(point, axis) > GetCoordinate(BasicMap::size_, axis))
+      return false;
+  }
+  return true;
+}
+
+template <int D, typename T>
+std::list<typename BasicMap<D, T>::Obstacle> BasicMap<D, T>::GetObstacleList()
+    const {
+  return std::list<Obstacle>(BasicMap::obstacles_.begin(),
+                             BasicMap::obstacles_.end());
+}
+
+template <int D, typename T>
+const std::vector<typename BasicMap<D, T>::Obstacle>&
+BasicMap<D, T>::GetObstacles() const {
+  return BasicMap::obstacles_;
+}
+
+template <int D, typename T>
+bool BasicMap<D, T>::IsOccupied(const Location& point,
+                                uint64_t* examined) const {
+  // Count in a local, and only report the count on the way out
+  size_t tested = 0;
+  bool occupied = false;
+
+  if (!BasicMap::IsOnMap(point)) {
+    // Points outside the map are not covered by the grid
+    for (const Obstacle &obs : BasicMap::obstacles_) {
+      tested++;
+      if (obs.Contains(point)) {
+        occupied = true;
+        break;
+      }
+    }
+  } else if (!BasicMap::bitmap_.IsEmpty()) {
+    // With a bitmap the answer is a single bit
+    int column, row;
+    BasicMap::GetBitmapCell(point, &column, &row);
+    occupied = BasicMap::bitmap_.Test(column, row);
+  } else {
+    // Otherwise only the obstacles registered in this point's cell matter
+    for (uint32_t index : BasicMap::GetCell(point)) {
+      tested++;
+      if (BasicMap::obstacles_[index].Contains(point)) {
+        occupied = true;
+        break;
+      }
+    }
+  }
+
+  if (examined != nullptr)
+    *examined += tested;
+  return occupied;
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::GetObstaclesAlong(
+    const Location& start_point, const Location& end_point,
+    std::vector<const Obstacle*>* obstacles) const {
+  obstacles->clear();
+  Location min_corner, max_corner;
+  for (int axis = 0; axis < D; axis++) {
+    SetCoordinate(&min_corner, axis,
+                  std::min(GetCoordinate(start_point, axis),
+                           GetCoordinate(end_point, axis)));
+    SetCoordinate(&max_corner, axis,
+                  std::max(GetCoordinate(start_point, axis),
+                           GetCoordinate(end_point, axis)));
+  }
+
+  // A segment that leaves the map could hit obstacles that aren't in the grid
+  if (!BasicMap::IsOnMap(min_corner) || !BasicMap::IsOnMap(max_corner)) {
+    for (const Obstacle &obs : BasicMap::obstacles_)
+      obstacles->push_back(&obs);
+    return;
+  }
+
+  // Gather every cell under the bounding box, then drop the duplicates of
+  // obstacles that span several cells
+  int first_cell[D], last_cell[D];
+  BasicMap::GetCellRange(min_corner, max_corner, first_cell, last_cell);
+  const std::vector<std::vector<uint32_t>> &grid = BasicMap::grid_;
+  const std::vector<Obstacle> &all = BasicMap::obstacles_;
+  BasicMap::VisitCells(first_cell, last_cell,
+                       [&grid, &all, obstacles](size_t cell) {
+    for (uint32_t index : grid[cell])
+      obstacles->push_back(&all[index]);
+    return true;
+  });
+  if (!std::equal(first_cell, first_cell + D, last_cell)) {
+    std::sort(obstacles->begin(), obstacles->end());
+    obstacles->erase(std::unique(obstacles->begin(), obstacles->end()),
+                     obstacles->end());
+  }
+}
+
+template <int D, typename T>
+void BasicMap<D, T>::SetCollisionModel(CollisionModel model) {
+  BasicMap::collision_model_ = model;
+}
+
+template <int D, typename T>
+CollisionModel BasicMap<D, T>::GetCollisionModel() const {
+  return BasicMap::collision_model_;
+}
+
+template <int D, typename T>
+uint64_t BasicMap<D, T>::GetFingerprint() const {
+  // Summing the obstacle hashes makes the result independent of their order
+  uint64_t obstacles = 0;
+  for (const Obstacle &obs : BasicMap::obstacles_) {
+    obstacles += Mix(Mix(HashLocation<D>(obs.GetLocation())) ^
+                     GetBits(obs.GetSize()));
+  }
+  return Mix(Mix(Mix(HashLocation<D>(BasicMap::size_)) ^
+                 static_cast<uint64_t>(BasicMap::collision_model_)) ^
+             obstacles);
 }
+
+template <int D, typename T>
+bool BasicMap<D, T>::SegmentCollides(const Location& start_point,
+                                     const Location& end_point,
+                                     uint64_t* examined) const {
+  bool squares = BasicMap::collision_model_ == kSquareCollision;
+  Location min_corner, max_corner;
+  for (int axis = 0; axis < D; axis++) {
+    SetCoordinate(&min_corner, axis,
+                  std::min(GetCoordinate(start_point, axis),
+                           GetCoordinate(end_point, axis)));
+    SetCoordinate(&max_corner, axis,
+                  std::max(GetCoordinate(start_point, axis),
+                           GetCoordinate(end_point, axis)));
+  }
+  size_t tested = 0;
+  bool collides = false;
+
+  if (!BasicMap::IsOnMap(min_corner) || !BasicMap::IsOnMap(max_corner)) {
+    // A segment that leaves the map could hit obstacles that aren't in the
+    // grid
+    for (const Obstacle &obs : BasicMap::obstacles_) {
+      tested++;
+      if (squares ? obs.SegmentIntersectsSquare(start_point, end_point)
+                  : obs.SegmentIntersectsCircle(start_point, end_point)) {
+        collides = true;
+        break;
+      }
+    }
+  } else {
+    // Test the obstacles of every cell under the bounding box. An obstacle
+    // in several cells may be tested more than once, which is cheaper than
+    // gathering and de-duplicating them first
+    int first_cell[D], last_cell[D];
+    BasicMap::GetCellRange(min_corner, max_corner, first_cell, last_cell);
+    const std::vector<std::vector<uint32_t>> &grid = BasicMap::grid_;
+    const std::vector<Obstacle> &all = BasicMap::obstacles_;
+    collides = !BasicMap::VisitCells(
+        first_cell, last_cell,
+        [&grid, &all, &tested, &start_point, &end_point, squares](
+            size_t cell) {
+      for (uint32_t index : grid[cell]) {
+        const Obstacle &obs = all[index];
+        tested++;
+        if (squares ? obs.SegmentIntersectsSquare(start_point, end_point)
+                    : obs.SegmentIntersectsCircle(start_point, end_point))
+          return false;
+      }
+      return true;
+    });
+  }
+
+  if (examined != nullptr)
+    *examined += tested;
+  return collides;
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicMap);
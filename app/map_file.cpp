@@ -0,0 +1,361 @@
+/**
+ * @file MapFile.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Memory mapped binary map files and occupancy image loading
+ *
+ * @section DESCRIPTION
+ * Implementation of MapFile. Files are written with std::ofstream and read
+ * back with mmap, and PGM images are read whole and scanned once.
+ */
+
+#include "../include/map_file.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstring>
+#include <fstream>    // needed for ifstream and ofstream
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = {'R', 'R', 'T', 'M', 'A', 'P', '\r', '\n'};
+
+/**
+ * @brief written as a uint32, reads back differently on the other byte order
+ */
+const uint32_t kByteOrder = 0x01020304;
+
+/**
+ * @brief rounds an offset up to the next 8 byte boundary
+ */
+uint64_t Align(uint64_t offset) {
+  return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+/**
+ * @brief writes zeros up to an offset
+ */
+void Pad(std::ofstream* out, uint64_t from, uint64_t to) {
+  static const char kZeros[8] = {0};
+  out->write(kZeros, static_cast<std::streamsize>(to - from));
+}
+
+/**
+ * @brief reads the next number of a PGM header, skipping whitespace and
+ * comments
+ * @return false if the header ends early or holds something else
+ */
+bool ReadPgmNumber(const std::string& data, size_t* position, int* value) {
+  size_t &i = *position;
+  while (i < data.size()) {
+    if (data[i] == '#') {
+      while (i < data.size() && data[i] != '\n')
+        i++;
+    } else if (std::isspace(static_cast<unsigned char>(data[i]))) {
+      i++;
+    } else {
+      break;
+    }
+  }
+  if (i >= data.size() || !std::isdigit(static_cast<unsigned char>(data[i])))
+    return false;
+  int64_t number = 0;
+  while (i < data.size() &&
+         std::isdigit(static_cast<unsigned char>(data[i]))) {
+    number = number * 10 + (data[i++] - '0');
+    if (number > INT32_MAX)
+      return false;
+  }
+  *value = static_cast<int>(number);
+  return true;
+}
+
+}  // namespace
+
+const uint32_t MapFile::kVersion;
+
+MapFile::MapFile() {
+  MapFile::data_ = nullptr;
+  MapFile::length_ = 0;
+  MapFile::header_ = nullptr;
+  MapFile::obstacles_ = nullptr;
+  MapFile::cell_offsets_ = nullptr;
+  MapFile::entries_ = nullptr;
+}
+
+MapFile::~MapFile() {
+  MapFile::Close();
+}
+
+bool MapFile::Save(const Map& map, const std::string& path) {
+  std::vector<int32_t> obstacles;
+  obstacles.reserve(map.obstacles_.size() * 3);
+  for (const Obstacle &obs : map.obstacles_) {
+    obstacles.push_back(obs.GetLocation().first);
+    obstacles.push_back(obs.GetLocation().second);
+    obstacles.push_back(obs.GetSize());
+  }
+
+  // Flatten the grid into offsets and entries
+  std::vector<uint32_t> cell_offsets;
+  std::vector<uint32_t> entries;
+  cell_offsets.reserve(map.grid_.size() + 1);
+  for (const std::vector<uint32_t> &cell : map.grid_) {
+    cell_offsets.push_back(static_cast<uint32_t>(entries.size()));
+    entries.insert(entries.end(), cell.begin(), cell.end());
+    if (entries.size() > UINT32_MAX)
+      return false;
+  }
+  cell_offsets.push_back(static_cast<uint32_t>(entries.size()));
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.height = map.size_.first;
+  header.width = map.size_.second;
+  header.collision_model = map.collision_model_;
+  header.cell_size = map.cell_size_;
+  header.grid_columns = map.grid_cells_[0];
+  header.grid_rows = map.grid_cells_[1];
+  header.obstacle_count = map.obstacles_.size();
+  header.entry_count = entries.size();
+  header.obstacles_offset = Align(sizeof(Header));
+  header.cell_offsets_offset = Align(header.obstacles_offset +
+                                     obstacles.size() * sizeof(int32_t));
+  header.entries_offset = Align(header.cell_offsets_offset +
+                                cell_offsets.size() * sizeof(uint32_t));
+  header.file_size = header.entries_offset + entries.size() * sizeof(uint32_t);
+
+  std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  Pad(&out, sizeof(header), header.obstacles_offset);
+  out.write(reinterpret_cast<const char*>(obstacles.data()),
+            static_cast<std::streamsize>(obstacles.size() * sizeof(int32_t)));
+  Pad(&out, header.obstacles_offset + obstacles.size() * sizeof(int32_t),
+      header.cell_offsets_offset);
+  out.write(reinterpret_cast<const char*>(cell_offsets.data()),
+            static_cast<std::streamsize>(cell_offsets.size() *
+                                         sizeof(uint32_t)));
+  Pad(&out, header.cell_offsets_offset + cell_offsets.size() * sizeof(uint32_t),
+      header.entries_offset);
+  out.write(reinterpret_cast<const char*>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(uint32_t)));
+  out.close();
+  return !out.fail();
+}
+
+bool MapFile::Open(const std::string& path) {
+  MapFile::Close();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  MapFile::data_ = static_cast<const char*>(data);
+  MapFile::length_ = static_cast<size_t>(info.st_size);
+  if (!MapFile::Validate()) {
+    MapFile::Close();
+    return false;
+  }
+  return true;
+}
+
+bool MapFile::Validate() {
+  const Header *header = reinterpret_cast<const Header*>(MapFile::data_);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion || header->byte_order != kByteOrder ||
+      header->file_size != MapFile::length_)
+    return false;
+  if (header->collision_model < kSampledCollision ||
+      header->collision_model > kSquareCollision ||
+      header->cell_size <= 0 || header->grid_columns <= 0 ||
+      header->grid_rows <= 0)
+    return false;
+
+  // Every section has to fit, in order, inside the file
+  uint64_t cells = static_cast<uint64_t>(header->grid_columns) *
+                   static_cast<uint64_t>(header->grid_rows);
+  if (header->obstacle_count > UINT32_MAX ||
+      header->entry_count > UINT32_MAX || cells >= UINT32_MAX)
+    return false;
+  if (header->obstacles_offset != Align(sizeof(Header)) ||
+      header->cell_offsets_offset !=
+          Align(header->obstacles_offset +
+                header->obstacle_count * 3 * sizeof(int32_t)) ||
+      header->entries_offset !=
+          Align(header->cell_offsets_offset + (cells + 1) * sizeof(uint32_t)) ||
+      header->file_size !=
+          header->entries_offset + header->entry_count * sizeof(uint32_t))
+    return false;
+
+  const int32_t *obstacles = reinterpret_cast<const int32_t*>(
+      MapFile::data_ + header->obstacles_offset);
+  const uint32_t *cell_offsets = reinterpret_cast<const uint32_t*>(
+      MapFile::data_ + header->cell_offsets_offset);
+  const uint32_t *entries = reinterpret_cast<const uint32_t*>(
+      MapFile::data_ + header->entries_offset);
+
+  // Offsets only ever grow and end at the last entry, and every entry names
+  // an obstacle
+  if (cell_offsets[0] != 0 || cell_offsets[cells] != header->entry_count)
+    return false;
+  for (uint64_t i = 0; i < cells; i++) {
+    if (cell_offsets[i] > cell_offsets[i + 1])
+      return false;
+  }
+  for (uint64_t i = 0; i < header->entry_count; i++) {
+    if (entries[i] >= header->obstacle_count)
+      return false;
+  }
+
+  MapFile::header_ = header;
+  MapFile::obstacles_ = obstacles;
+  MapFile::cell_offsets_ = cell_offsets;
+  MapFile::entries_ = entries;
+  return true;
+}
+
+void MapFile::Close() {
+  if (MapFile::data_ != nullptr)
+    munmap(const_cast<char*>(MapFile::data_), MapFile::length_);
+  MapFile::data_ = nullptr;
+  MapFile::length_ = 0;
+  MapFile::header_ = nullptr;
+  MapFile::obstacles_ = nullptr;
+  MapFile::cell_offsets_ = nullptr;
+  MapFile::entries_ = nullptr;
+}
+
+bool MapFile::IsOpen() const {
+  return MapFile::header_ != nullptr;
+}
+
+std::pair<int, int> MapFile::GetSize() const {
+  return std::pair<int, int>(MapFile::header_->height,
+                             MapFile::header_->width);
+}
+
+CollisionModel MapFile::GetCollisionModel() const {
+  return static_cast<CollisionModel>(MapFile::header_->collision_model);
+}
+
+size_t MapFile::GetObstacleCount() const {
+  return static_cast<size_t>(MapFile::header_->obstacle_count);
+}
+
+Obstacle MapFile::GetObstacle(size_t index) const {
+  const int32_t *record = MapFile::obstacles_ + index * 3;
+  return Obstacle(record[0], record[1], record[2]);
+}
+
+bool MapFile::Load(Map* map) const {
+  if (!MapFile::IsOpen())
+    return false;
+
+  // Size an empty grid for the map the way this build would
+  map->size_ = MapFile::GetSize();
+  map->collision_model_ = MapFile::GetCollisionModel();
+  map->bitmap_.Clear();
+  map->obstacles_.clear();
+  map->BuildGrid();
+
+  size_t count = MapFile::GetObstacleCount();
+  map->obstacles_.reserve(count);
+  for (size_t i = 0; i < count; i++)
+    map->obstacles_.push_back(MapFile::GetObstacle(i));
+
+  if (map->cell_size_ != MapFile::header_->cell_size ||
+      map->grid_cells_[0] != MapFile::header_->grid_columns ||
+      map->grid_cells_[1] != MapFile::header_->grid_rows) {
+    // Written with a different grid, so register the obstacles afresh
+    map->BuildGrid();
+    return true;
+  }
+
+  // Otherwise every cell is a straight copy of its entries
+  for (size_t cell = 0; cell < map->grid_.size(); cell++) {
+    map->grid_[cell].assign(
+        MapFile::entries_ + MapFile::cell_offsets_[cell],
+        MapFile::entries_ + MapFile::cell_offsets_[cell + 1]);
+  }
+  return true;
+}
+
+bool MapFile::LoadPgm(const std::string& path, double threshold, Map* map) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in)
+    return false;
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+
+  // P5 is binary, P2 is plain text
+  if (data.size() < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '2'))
+    return false;
+  bool binary = data[1] == '5';
+  size_t position = 2;
+  int columns, rows, maxval;
+  if (!ReadPgmNumber(data, &position, &columns) ||
+      !ReadPgmNumber(data, &position, &rows) ||
+      !ReadPgmNumber(data, &position, &maxval) ||
+      columns <= 0 || rows <= 0 || maxval <= 0 || maxval > 65535)
+    return false;
+  size_t pixels = static_cast<size_t>(columns) * static_cast<size_t>(rows);
+  size_t bytes_per_pixel = maxval < 256 ? 1 : 2;
+  if (binary) {
+    // A single whitespace character separates the header from the raster
+    position++;
+    if (position > data.size() ||
+        (data.size() - position) / bytes_per_pixel < pixels)
+      return false;
+  }
+
+  std::vector<Obstacle> obstacles;
+  double limit = threshold * maxval;
+  for (size_t i = 0; i < pixels; i++) {
+    int value;
+    if (!binary) {
+      if (!ReadPgmNumber(data, &position, &value))
+        return false;
+    } else if (bytes_per_pixel == 1) {
+      value = static_cast<unsigned char>(data[position + i]);
+    } else {
+      // Two byte samples are big endian
+      value = static_cast<unsigned char>(data[position + 2 * i]) << 8 |
+              static_cast<unsigned char>(data[position + 2 * i + 1]);
+    }
+    if (maxval - value > limit) {
+      obstacles.push_back(Obstacle(static_cast<int>(i % columns),
+                                   static_cast<int>(i / columns), 1));
+    }
+  }
+
+  // Build the grid once for the whole image
+  map->size_ = std::pair<int, int>(columns - 1, rows - 1);
+  map->collision_model_ = kSquareCollision;
+  map->bitmap_.Clear();
+  map->obstacles_.swap(obstacles);
+  map->BuildGrid();
+  return true;
+}
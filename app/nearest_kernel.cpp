@@ -0,0 +1,237 @@
+/**
+ * @file NearestKernel.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Vectorized nearest point search over coordinate arrays
+ *
+ * @section DESCRIPTION
+ * Scalar, SSE2 and AVX2 versions of the nearest point search. Each vector
+ * lane keeps its own best distance and index, replacing them whenever a
+ * point is at least as close so that later points win ties. The lanes are
+ * combined at the end, again preferring the larger index on a tie, and any
+ * leftover points are handled by the scalar loop.
+ */
+
+#include "../include/nearest_kernel.h"
+#include <stdint.h>
+#include <cmath>  // needed for INFINITY
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RRT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief scalar search over points [begin, count), continuing from a best
+ * distance and index found so far
+ */
+size_t ScanScalar(const int* xs, const int* ys, size_t begin, size_t count,
+                  int x, int y, size_t best, int64_t* best_distance) {
+  int64_t closest = *best_distance;
+  for (size_t i = begin; i < count; i++) {
+    int64_t dx = static_cast<int64_t>(xs[i]) - x;
+    int64_t dy = static_cast<int64_t>(ys[i]) - y;
+    int64_t d = dx * dx + dy * dy;
+    if (d <= closest) {
+      closest = d;
+      best = i;
+    }
+  }
+  *best_distance = closest;
+  return best;
+}
+
+size_t NearestScalar(const int* xs, const int* ys, size_t count, int x, int y,
+                     int64_t* distance_squared) {
+  *distance_squared = INT64_MAX;
+  return ScanScalar(xs, ys, 0, count, x, y, 0, distance_squared);
+}
+
+/**
+ * @brief combines per lane results, picking the smallest distance and the
+ * largest index among equal distances
+ */
+void ReduceLanes(const double* distances, const double* indices, int lanes,
+                 size_t* best, int64_t* best_distance) {
+  double closest = distances[0];
+  double index = indices[0];
+  for (int lane = 1; lane < lanes; lane++) {
+    if (distances[lane] < closest ||
+        (distances[lane] == closest && indices[lane] > index)) {
+      closest = distances[lane];
+      index = indices[lane];
+    }
+  }
+  *best = static_cast<size_t>(index);
+  *best_distance = static_cast<int64_t>(closest);
+}
+
+#ifdef RRT_X86_KERNELS
+
+__attribute__((target("sse2")))
+size_t NearestSse2(const int* xs, const int* ys, size_t count, int x, int y,
+                   int64_t* distance_squared) {
+  size_t best = 0;
+  *distance_squared = INT64_MAX;
+  size_t blocked = count & ~static_cast<size_t>(3);
+  if (blocked > 0) {
+    const __m128d qx = _mm_set1_pd(x);
+    const __m128d qy = _mm_set1_pd(y);
+    const __m128d step = _mm_set1_pd(4.0);
+    // Two accumulators of two lanes each, covering points i..i+3
+    __m128d best_d0 = _mm_set1_pd(INFINITY);
+    __m128d best_d1 = best_d0;
+    __m128d best_i0 = _mm_set_pd(1.0, 0.0);
+    __m128d best_i1 = _mm_set_pd(3.0, 2.0);
+    __m128d index0 = best_i0;
+    __m128d index1 = best_i1;
+    for (size_t i = 0; i < blocked; i += 4) {
+      __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+      __m128i py = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i));
+      __m128d dx0 = _mm_sub_pd(_mm_cvtepi32_pd(px), qx);
+      __m128d dy0 = _mm_sub_pd(_mm_cvtepi32_pd(py), qy);
+      __m128d dx1 = _mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(px, 8)), qx);
+      __m128d dy1 = _mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(py, 8)), qy);
+      __m128d d0 = _mm_add_pd(_mm_mul_pd(dx0, dx0), _mm_mul_pd(dy0, dy0));
+      __m128d d1 = _mm_add_pd(_mm_mul_pd(dx1, dx1), _mm_mul_pd(dy1, dy1));
+      __m128d take0 = _mm_cmple_pd(d0, best_d0);
+      __m128d take1 = _mm_cmple_pd(d1, best_d1);
+      best_d0 = _mm_or_pd(_mm_and_pd(take0, d0), _mm_andnot_pd(take0, best_d0));
+      best_d1 = _mm_or_pd(_mm_and_pd(take1, d1), _mm_andnot_pd(take1, best_d1));
+      best_i0 = _mm_or_pd(_mm_and_pd(take0, index0),
+                          _mm_andnot_pd(take0, best_i0));
+      best_i1 = _mm_or_pd(_mm_and_pd(take1, index1),
+                          _mm_andnot_pd(take1, best_i1));
+      index0 = _mm_add_pd(index0, step);
+      index1 = _mm_add_pd(index1, step);
+    }
+    double distances[4], indices[4];
+    _mm_storeu_pd(distances, best_d0);
+    _mm_storeu_pd(distances + 2, best_d1);
+    _mm_storeu_pd(indices, best_i0);
+    _mm_storeu_pd(indices + 2, best_i1);
+    ReduceLanes(distances, indices, 4, &best, distance_squared);
+  }
+  // The leftover points come last, so on a tie they win
+  return ScanScalar(xs, ys, blocked, count, x, y, best, distance_squared);
+}
+
+__attribute__((target("avx2")))
+size_t NearestAvx2(const int* xs, const int* ys, size_t count, int x, int y,
+                   int64_t* distance_squared) {
+  size_t best = 0;
+  *distance_squared = INT64_MAX;
+  size_t blocked = count & ~static_cast<size_t>(7);
+  if (blocked > 0) {
+    const __m256d qx = _mm256_set1_pd(x);
+    const __m256d qy = _mm256_set1_pd(y);
+    const __m256d step = _mm256_set1_pd(8.0);
+    // Two accumulators of four lanes each, covering points i..i+7
+    __m256d best_d0 = _mm256_set1_pd(INFINITY);
+    __m256d best_d1 = best_d0;
+    __m256d best_i0 = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    __m256d best_i1 = _mm256_set_pd(7.0, 6.0, 5.0, 4.0);
+    __m256d index0 = best_i0;
+    __m256d index1 = best_i1;
+    for (size_t i = 0; i < blocked; i += 8) {
+      __m256i px = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(xs + i));
+      __m256i py = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(ys + i));
+      __m256d dx0 = _mm256_sub_pd(
+          _mm256_cvtepi32_pd(_mm256_castsi256_si128(px)), qx);
+      __m256d dy0 = _mm256_sub_pd(
+          _mm256_cvtepi32_pd(_mm256_castsi256_si128(py)), qy);
+      __m256d dx1 = _mm256_sub_pd(
+          _mm256_cvtepi32_pd(_mm256_extracti128_si256(px, 1)), qx);
+      __m256d dy1 = _mm256_sub_pd(
+          _mm256_cvtepi32_pd(_mm256_extracti128_si256(py, 1)), qy);
+      __m256d d0 = _mm256_add_pd(_mm256_mul_pd(dx0, dx0),
+                                 _mm256_mul_pd(dy0, dy0));
+      __m256d d1 = _mm256_add_pd(_mm256_mul_pd(dx1, dx1),
+                                 _mm256_mul_pd(dy1, dy1));
+      __m256d take0 = _mm256_cmp_pd(d0, best_d0, _CMP_LE_OQ);
+      __m256d take1 = _mm256_cmp_pd(d1, best_d1, _CMP_LE_OQ);
+      best_d0 = _mm256_blendv_pd(best_d0, d0, take0);
+      best_d1 = _mm256_blendv_pd(best_d1, d1, take1);
+      best_i0 = _mm256_blendv_pd(best_i0, index0, take0);
+      best_i1 = _mm256_blendv_pd(best_i1, index1, take1);
+      index0 = _mm256_add_pd(index0, step);
+      index1 = _mm256_add_pd(index1, step);
+    }
+    double distances[8], indices[8];
+    _mm256_storeu_pd(distances, best_d0);
+    _mm256_storeu_pd(distances + 4, best_d1);
+    _mm256_storeu_pd(indices, best_i0);
+    _mm256_storeu_pd(indices + 4, best_i1);
+    ReduceLanes(distances, indices, 8, &best, distance_squared);
+  }
+  // The leftover points come last, so on a tie they win
+  return ScanScalar(xs, ys, blocked, count, x, y, best, distance_squared);
+}
+
+#endif  // RRT_X86_KERNELS
+
+/**
+ * @brief picks the best kernel the processor supports
+ * @details The SSE2 kernel only converts two lanes at a time to double and
+ * loses to the scalar one in nearest-bench, most of all on the leaf sized
+ * arrays the k-d tree scans, so it is never picked.
+ */
+NearestKernelIsa DetectIsa() {
+  if (IsNearestKernelSupported(kAvx2Kernel))
+    return kAvx2Kernel;
+  return kScalarKernel;
+}
+
+}  // namespace
+
+bool IsNearestKernelSupported(NearestKernelIsa isa) {
+  switch (isa) {
+#ifdef RRT_X86_KERNELS
+    case kAvx2Kernel:
+      return __builtin_cpu_supports("avx2");
+    case kSse2Kernel:
+      return __builtin_cpu_supports("sse2");
+#endif
+    case kScalarKernel:
+      return true;
+    default:
+      return false;
+  }
+}
+
+NearestKernel GetNearestKernel(NearestKernelIsa isa) {
+  switch (isa) {
+#ifdef RRT_X86_KERNELS
+    case kAvx2Kernel:
+      return NearestAvx2;
+    case kSse2Kernel:
+      return NearestSse2;
+#endif
+    default:
+      return NearestScalar;
+  }
+}
+
+NearestKernelIsa GetNearestKernelIsa() {
+  // Detected once; static initialization is thread safe
+  static const NearestKernelIsa isa = DetectIsa();
+  return isa;
+}
+
+size_t NearestIndex(const int* xs, const int* ys, size_t count, int x, int y,
+                    int64_t* distance_squared) {
+  static const NearestKernel kernel = GetNearestKernel(GetNearestKernelIsa());
+  return kernel(xs, ys, count, x, y, distance_squared);
+}
+
+template <>
+size_t NearestIndex<2, int>(const int* const* coordinates, size_t count,
+                            const int* point, int64_t* distance_squared) {
+  return NearestIndex(coordinates[0], coordinates[1], count, point[0],
+                      point[1], distance_squared);
+}
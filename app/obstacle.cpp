@@ -14,18 +14,153 @@
  */
 
 #include "../include/obstacle.h"
+#include <stdint.h>
 #include <utility>
 
-Obstacle::Obstacle(int x_location, int y_location, int size) {
-  Obstacle::location_.first = x_location;
-  Obstacle::location_.second = y_location;
-  Obstacle::obstacle_radius_ = size;
+namespace {
+
+/**
+ * @brief an exact fraction num / den with a positive denominator
+ */
+template <typename T>
+struct Fraction {
+  typename ScalarTraits<T>::Difference num;
+  typename ScalarTraits<T>::Difference den;
+};
+
+/**
+ * @brief returns true if a < b
+ */
+template <typename T>
+bool Less(const Fraction<T>& a, const Fraction<T>& b) {
+  typedef typename ScalarTraits<T>::Product Product;
+  return static_cast<Product>(a.num) * b.den <
+         static_cast<Product>(b.num) * a.den;
+}
+
+/**
+ * @brief narrows the open parameter interval (low, high) to the values of t
+ * for which start + t * delta lies strictly between center - radius and
+ * center + radius
+ * @return false if no value of t does
+ */
+template <typename T>
+bool ClipSlab(typename ScalarTraits<T>::Difference start,
+              typename ScalarTraits<T>::Difference delta,
+              typename ScalarTraits<T>::Difference center,
+              typename ScalarTraits<T>::Difference radius,
+              Fraction<T>* low, Fraction<T>* high) {
+  if (delta == 0) {
+    // Parallel to the slab: either always inside or never
+    return start > center - radius && start < center + radius;
+  }
+  Fraction<T> enter = {center - radius - start, delta};
+  Fraction<T> leave = {center + radius - start, delta};
+  if (delta < 0) {
+    enter.num = -enter.num;
+    enter.den = -delta;
+    leave.num = -leave.num;
+    leave.den = -delta;
+    Fraction<T> swap = enter;
+    enter = leave;
+    leave = swap;
+  }
+  if (Less(*low, enter))
+    *low = enter;
+  if (Less(leave, *high))
+    *high = leave;
+  return true;
+}
+
+}  // namespace
+
+template <int D, typename T>
+BasicObstacle<D, T>::BasicObstacle(Location location, T size) {
+  BasicObstacle::location_ = location;
+  BasicObstacle::obstacle_radius_ = size;
+}
+
+template <int D, typename T>
+typename BasicObstacle<D, T>::Location BasicObstacle<D, T>::GetLocation()
+    const {
+  return BasicObstacle::location_;
 }
 
-std::pair<int, int> Obstacle::GetLocation() {
-  return Obstacle::location_;
+template <int D, typename T>
+T BasicObstacle<D, T>::GetSize() const {
+  return BasicObstacle::obstacle_radius_;
+}
+
+template <int D, typename T>
+bool BasicObstacle<D, T>::SegmentIntersectsCircle(
+    const Location& start_point, const Location& end_point) const {
+  typedef typename ScalarTraits<T>::Difference Difference;
+  typedef typename ScalarTraits<T>::Product Product;
+  Difference radius = BasicObstacle::obstacle_radius_;
+  if (radius <= 0)
+    return false;
+  Product radius_squared = static_cast<Product>(radius) * radius;
+
+  // Direction of the segment, and the center relative to its start and end
+  Product length_squared = 0;
+  Product projection = 0;
+  Product start_squared = 0;
+  Product end_squared = 0;
+  for (int axis = 0; axis < D; axis++) {
+    Difference start = GetCoordinate(start_point, axis);
+    Difference center = GetCoordinate(location_, axis);
+    Difference d = static_cast<Difference>(GetCoordinate(end_point, axis)) -
+                   start;
+    Difference f = center - start;
+    Difference g = center - GetCoordinate(end_point, axis);
+    length_squared += static_cast<Product>(d) * d;
+    projection += static_cast<Product>(f) * d;
+    start_squared += static_cast<Product>(f) * f;
+    end_squared += static_cast<Product>(g) * g;
+  }
+
+  // The closest point of the segment is its start
+  if (length_squared == 0 || projection <= 0)
+    return start_squared < radius_squared;
+
+  // The closest point of the segment is its end
+  if (projection >= length_squared)
+    return end_squared < radius_squared;
+
+  // The closest point is inside the segment, at a squared distance of
+  // (|f|^2 |d|^2 - (f.d)^2) / |d|^2 from the center. The products are
+  // exact while coordinates differ by less than 2^30, as point.h explains
+  return start_squared * length_squared - projection * projection <
+         radius_squared * length_squared;
 }
 
-int Obstacle::GetSize() {
-  return Obstacle::obstacle_radius_;
+template <int D, typename T>
+bool BasicObstacle<D, T>::SegmentIntersectsSquare(
+    const Location& start_point, const Location& end_point) const {
+  typedef typename ScalarTraits<T>::Difference Difference;
+  Difference radius = BasicObstacle::obstacle_radius_;
+  if (radius <= 0)
+    return false;
+
+  // The segment is start + t * (end - start) for t in [0, 1]. Find the open
+  // interval of t inside every slab of the square, then check it overlaps
+  // [0, 1]. Starting from (-1, 2) rather than the whole line is enough for
+  // that check
+  Fraction<T> low = {-1, 1};
+  Fraction<T> high = {2, 1};
+  for (int axis = 0; axis < D; axis++) {
+    Difference start = GetCoordinate(start_point, axis);
+    Difference delta = static_cast<Difference>(GetCoordinate(end_point, axis)) -
+                       start;
+    if (!ClipSlab<T>(start, delta, GetCoordinate(location_, axis), radius,
+                     &low, &high))
+      return false;
+  }
+
+  // (low, high) must be non-empty and overlap the closed interval [0, 1]
+  Fraction<T> zero = {0, 1};
+  Fraction<T> one = {1, 1};
+  return Less(low, high) && Less(low, one) && Less(zero, high);
 }
+
+RRT_INSTANTIATE_POINT_TYPES(BasicObstacle);
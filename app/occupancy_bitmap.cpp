@@ -0,0 +1,42 @@
+/**
+ * @file OccupancyBitmap.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief One bit per cell occupancy grid for Map
+ *
+ * @section DESCRIPTION
+ * The OccupancyBitmap class stores whether each integer x,y location of a
+ * Map is inside an obstacle, using a single bit per location in rows padded
+ * to whole 64-bit words.
+ */
+
+#include "../include/occupancy_bitmap.h"
+#include <stdint.h>
+#include <vector>
+
+OccupancyBitmap::OccupancyBitmap() {
+  OccupancyBitmap::columns_ = 0;
+  OccupancyBitmap::rows_ = 0;
+  OccupancyBitmap::words_per_row_ = 0;
+}
+
+void OccupancyBitmap::Reset(int columns, int rows) {
+  OccupancyBitmap::columns_ = columns;
+  OccupancyBitmap::rows_ = rows;
+  // Round each row up to a whole number of words
+  OccupancyBitmap::words_per_row_ = (static_cast<size_t>(columns) + 63) / 64;
+  OccupancyBitmap::words_.assign(
+      OccupancyBitmap::words_per_row_ * static_cast<size_t>(rows), 0);
+}
+
+void OccupancyBitmap::Clear() {
+  OccupancyBitmap::columns_ = 0;
+  OccupancyBitmap::rows_ = 0;
+  OccupancyBitmap::words_per_row_ = 0;
+  std::vector<uint64_t>().swap(OccupancyBitmap::words_);
+}
+
+size_t OccupancyBitmap::GetMemoryUsage() const {
+  return OccupancyBitmap::words_.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file ParallelRRTPath.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Races several RRTPath searches on a thread pool
+ *
+ * @section DESCRIPTION
+ * The ParallelRRTPath class runs independently seeded RRTPath planners over
+ * one shared Map on a ThreadPool, keeps the first path found and stops the
+ * other planners through a shared flag.
+ */
+
+#include "../include/parallel_rrt_path.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>   // needed for atomic
+#include <memory>   // needed for make_shared
+#include <utility>  // needed for pair
+#include <list>     // needed for list
+
+const int ParallelRRTPath::kNoWinner;
+
+ParallelRRTPath::ParallelRRTPath(Map map, int start_x, int start_y,
+                                 int goal_x, int goal_y, int epsilon,
+                                 int radius, size_t planner_count,
+                                 size_t thread_count)
+    : pool_(thread_count) {
+  ParallelRRTPath::map_ = std::make_shared<const Map>(map);
+  ParallelRRTPath::stop_ = false;
+  ParallelRRTPath::winner_ = kNoWinner;
+
+  // Every planner shares our map and our stop flag. planners_ is never
+  // resized after this, so the planners stay put while threads use them
+  ParallelRRTPath::planners_.reserve(planner_count);
+  for (size_t i = 0; i < planner_count; i++) {
+    ParallelRRTPath::planners_.push_back(RRTPath(ParallelRRTPath::map_,
+                                                 start_x, start_y, goal_x,
+                                                 goal_y, epsilon, radius));
+    ParallelRRTPath::planners_.back().SetStopFlag(&stop_);
+  }
+}
+
+void ParallelRRTPath::SetSeed(uint64_t seed) {
+  // Spread the seeds out with the golden ratio increment used by splitmix64
+  for (size_t i = 0; i < ParallelRRTPath::planners_.size(); i++)
+    ParallelRRTPath::planners_[i].SetSeed(seed + i * 0x9E3779B97F4A7C15ULL);
+}
+
+size_t ParallelRRTPath::GetPlannerCount() const {
+  return ParallelRRTPath::planners_.size();
+}
+
+int ParallelRRTPath::GetWinner() const {
+  return ParallelRRTPath::winner_.load();
+}
+
+int ParallelRRTPath::GetIterationCount() const {
+  int iterations = 0;
+  for (size_t i = 0; i < ParallelRRTPath::planners_.size(); i++)
+    iterations += ParallelRRTPath::planners_[i].GetIterationCount();
+  return iterations;
+}
+
+void ParallelRRTPath::Cancel() {
+  ParallelRRTPath::stop_.store(true);
+}
+
+std::list<std::pair<int, int>> ParallelRRTPath::FindPath() {
+  // Start every planner over
+  for (size_t i = 0; i < ParallelRRTPath::planners_.size(); i++)
+    ParallelRRTPath::planners_[i].Reset();
+  ParallelRRTPath::overall_path_.clear();
+  ParallelRRTPath::winner_ = kNoWinner;
+
+  // Race them and wait for all of them to stop. A Cancel from before the
+  // race is still set, so every planner returns at once
+  for (size_t i = 0; i < ParallelRRTPath::planners_.size(); i++) {
+    int planner = static_cast<int>(i);
+    ParallelRRTPath::pool_.Submit([this, planner]() {
+      ParallelRRTPath::RunPlanner(planner);
+    });
+  }
+  ParallelRRTPath::pool_.Wait();
+
+  // Only now that no planner can see it is the flag cleared for the next race
+  ParallelRRTPath::stop_.store(false);
+  return ParallelRRTPath::overall_path_;
+}
+
+void ParallelRRTPath::RunPlanner(int planner) {
+  // A stopped planner returns an empty path, so only a real path can win
+  std::list<std::pair<int, int>> path =
+      ParallelRRTPath::planners_[planner].FindPath();
+  if (path.empty())
+    return;
+
+  // Only the first planner to finish gets to store its path
+  int expected = kNoWinner;
+  if (ParallelRRTPath::winner_.compare_exchange_strong(expected, planner)) {
+    ParallelRRTPath::overall_path_.swap(path);
+    ParallelRRTPath::stop_.store(true);
+  }
+}
@@ -0,0 +1,238 @@
+/**
+ * @file PathSmoother.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Shortcuts and smooths the paths found by RRTPath
+ *
+ * @section DESCRIPTION
+ * Implementation of PathSmoother: a greedy pass, a budget of random
+ * shortcuts and a second greedy pass, all working on a vector copy of the
+ * path.
+ */
+
+#include "../include/path_smoother.h"
+#include <stdint.h>
+#include <algorithm>  // needed for min and swap
+#include <cmath>      // needed for sqrt, ceil and lround
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief rounds a coordinate computed in double to the nearest integer
+ */
+int ToCoordinate(double value, int /* type */) {
+  return static_cast<int>(std::lround(value));
+}
+
+/**
+ * @brief converts a coordinate computed in double to a float
+ */
+float ToCoordinate(double value, float /* type */) {
+  return static_cast<float>(value);
+}
+
+/**
+ * @brief the point a fraction of the way from one point to another, rounded
+ * to the nearest integer location on integer maps
+ */
+template <int D, typename T, typename Location>
+Location Interpolate(const Location& start_point, const Location& end_point,
+                     double fraction) {
+  Location point;
+  for (int axis = 0; axis < D; axis++) {
+    double start = GetCoordinate(start_point, axis);
+    double end = GetCoordinate(end_point, axis);
+    SetCoordinate(&point, axis,
+                  ToCoordinate(start + fraction * (end - start), T()));
+  }
+  return point;
+}
+
+}  // namespace
+
+template <int D, typename T>
+const int BasicPathSmoother<D, T>::kDefaultIterations;
+template <int D, typename T>
+const size_t BasicPathSmoother<D, T>::kParallelWaypoints;
+
+template <int D, typename T>
+BasicPathSmoother<D, T>::BasicPathSmoother(size_t thread_count) {
+  BasicPathSmoother::iterations_ = kDefaultIterations;
+  if (thread_count != 1)
+    BasicPathSmoother::pool_.reset(new ThreadPool(thread_count));
+}
+
+template <int D, typename T>
+void BasicPathSmoother<D, T>::SetIterations(int iterations) {
+  BasicPathSmoother::iterations_ = iterations;
+}
+
+template <int D, typename T>
+int BasicPathSmoother<D, T>::GetIterations() const {
+  return BasicPathSmoother::iterations_;
+}
+
+template <int D, typename T>
+void BasicPathSmoother<D, T>::SetSeed(uint64_t seed) {
+  BasicPathSmoother::sampler_.Seed(seed);
+}
+
+template <int D, typename T>
+size_t BasicPathSmoother<D, T>::GetThreadCount() const {
+  return BasicPathSmoother::pool_ ? BasicPathSmoother::pool_->GetThreadCount()
+                                  : 1;
+}
+
+template <int D, typename T>
+bool BasicPathSmoother<D, T>::IsClear(const Map& map,
+                                      const Location& start_point,
+                                      const Location& end_point) {
+  if (!map.IsOnMap(start_point) || !map.IsOnMap(end_point))
+    return false;
+  if (map.GetCollisionModel() != kSampledCollision)
+    return !map.SegmentCollides(start_point, end_point);
+
+  // Walk the segment in steps of at most one unit
+  int steps = std::max(1, static_cast<int>(std::ceil(
+      Distance<D, T>(start_point, end_point))));
+  for (int step = 0; step <= steps; step++) {
+    if (map.IsOccupied(Interpolate<D, T>(start_point, end_point,
+                                         static_cast<double>(step) / steps)))
+      return false;
+  }
+  return true;
+}
+
+template <int D, typename T>
+double BasicPathSmoother<D, T>::GetPathLength(
+    const std::list<Location>& path) {
+  double length = 0;
+  typename std::list<Location>::const_iterator previous = path.begin();
+  for (typename std::list<Location>::const_iterator it = path.begin();
+       it != path.end(); previous = it++)
+    length += Distance<D, T>(*previous, *it);
+  return length;
+}
+
+template <int D, typename T>
+std::list<typename BasicPathSmoother<D, T>::Location>
+BasicPathSmoother<D, T>::Smooth(const Map& map,
+                                const std::list<Location>& path) {
+  std::vector<Location> points(path.begin(), path.end());
+  BasicPathSmoother::Smooth(map, &points);
+  return std::list<Location>(points.begin(), points.end());
+}
+
+template <int D, typename T>
+void BasicPathSmoother<D, T>::Smooth(const Map& map,
+                                     std::vector<Location>* path) {
+  if (path->size() > 2) {
+    BasicPathSmoother::GreedyShortcut(map, path);
+    BasicPathSmoother::RandomShortcut(map, path);
+    BasicPathSmoother::GreedyShortcut(map, path);
+  }
+}
+
+template <int D, typename T>
+void BasicPathSmoother<D, T>::GreedyShortcut(const Map& map,
+                                             std::vector<Location>* path) {
+  const std::vector<Location> &points = *path;
+  size_t count = points.size();
+  std::vector<Location> kept(1, points[0]);
+  size_t current = 0;
+  while (current + 1 < count) {
+    // The next waypoint is always reachable, it is the edge we came along
+    size_t next = current + 1;
+    if (BasicPathSmoother::pool_ && count - current > kParallelWaypoints) {
+      // Check every candidate at once, split evenly over the workers
+      BasicPathSmoother::clear_.assign(count, 0);
+      size_t first = current + 2;
+      size_t threads = BasicPathSmoother::pool_->GetThreadCount();
+      size_t chunk = (count - first + threads - 1) / threads;
+      std::vector<char> &clear = BasicPathSmoother::clear_;
+      for (size_t begin = first; begin < count; begin += chunk) {
+        size_t end = std::min(count, begin + chunk);
+        BasicPathSmoother::pool_->Submit([&map, &points, &clear, current,
+                                          begin, end]() {
+          for (size_t candidate = begin; candidate < end; candidate++)
+            clear[candidate] = IsClear(map, points[current],
+                                       points[candidate]);
+        });
+      }
+      BasicPathSmoother::pool_->Wait();
+      for (size_t candidate = count - 1; candidate >= first; candidate--) {
+        if (clear[candidate]) {
+          next = candidate;
+          break;
+        }
+      }
+    } else {
+      // Try the farthest waypoints first
+      for (size_t candidate = count - 1; candidate >= current + 2;
+           candidate--) {
+        if (IsClear(map, points[current], points[candidate])) {
+          next = candidate;
+          break;
+        }
+      }
+    }
+    kept.push_back(points[next]);
+    current = next;
+  }
+  path->swap(kept);
+}
+
+template <int D, typename T>
+void BasicPathSmoother<D, T>::RandomShortcut(const Map& map,
+                                             std::vector<Location>* path) {
+  std::vector<Location> &points = *path;
+  for (int iteration = 0; iteration < BasicPathSmoother::iterations_;
+       iteration++) {
+    if (points.size() < 3)
+      return;
+    // Pick two different segments, the first one starting at waypoint
+    // first and the second one ending at waypoint last
+    uint32_t segments = static_cast<uint32_t>(points.size() - 1);
+    uint32_t first = BasicPathSmoother::sampler_.NextBounded(segments);
+    uint32_t second = BasicPathSmoother::sampler_.NextBounded(segments);
+    if (first == second)
+      continue;
+    if (first > second)
+      std::swap(first, second);
+    uint32_t last = second + 1;
+    Location from = Interpolate<D, T>(points[first], points[first + 1],
+                                      sampler_.NextDouble());
+    Location to = Interpolate<D, T>(points[second], points[last],
+                                    sampler_.NextDouble());
+
+    // Only keep shortcuts that make the path shorter
+    double old_length = 0;
+    for (uint32_t i = first; i < last; i++)
+      old_length += Distance<D, T>(points[i], points[i + 1]);
+    double new_length = Distance<D, T>(points[first], from) +
+                        Distance<D, T>(from, to) +
+                        Distance<D, T>(to, points[last]);
+    if (new_length >= old_length ||
+        !IsClear(map, points[first], from) || !IsClear(map, from, to) ||
+        !IsClear(map, to, points[last]))
+      continue;
+
+    // Replace the waypoints between the two segments with the shortcut,
+    // leaving out points that land on a waypoint we keep
+    std::vector<Location> shortcut;
+    if (from != points[first])
+      shortcut.push_back(from);
+    if (to != points[last] && to != from)
+      shortcut.push_back(to);
+    points.erase(points.begin() + first + 1, points.begin() + last);
+    points.insert(points.begin() + first + 1, shortcut.begin(),
+                  shortcut.end());
+  }
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicPathSmoother);
@@ -0,0 +1,192 @@
+/**
+ * @file PathWriter.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Streams paths to a compact binary or CSV file
+ *
+ * @section DESCRIPTION
+ * Implementation of PathWriter. Numbers are copied or formatted by hand into
+ * the buffer, which only goes through std::ofstream when it is full.
+ */
+
+#include "../include/path_writer.h"
+#include <stdint.h>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = {'R', 'R', 'T', 'P', 'A', 'T', 'H', '\n'};
+
+/**
+ * @brief written as a uint32, reads back differently on the other byte order
+ */
+const uint32_t kByteOrder = 0x01020304;
+
+/**
+ * @brief the longest a formatted number can be: a sign and 20 digits
+ */
+const size_t kMaxNumberLength = 21;
+
+/**
+ * @brief writes a number in decimal
+ * @return one past the last character written
+ */
+char* FormatNumber(int64_t value, char* out) {
+  uint64_t magnitude = static_cast<uint64_t>(value);
+  if (value < 0) {
+    *out++ = '-';
+    magnitude = 0 - magnitude;
+  }
+  // Digits come out last first, so fill a scratch array from its end
+  char digits[20];
+  char *first = digits + sizeof(digits);
+  do {
+    *--first = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  size_t length = static_cast<size_t>(digits + sizeof(digits) - first);
+  std::memcpy(out, first, length);
+  return out + length;
+}
+
+}  // namespace
+
+const uint32_t PathWriter::kVersion;
+const size_t PathWriter::kBufferSize;
+
+PathWriter::PathWriter() {
+  PathWriter::format_ = kBinaryPathFormat;
+  PathWriter::used_ = 0;
+  PathWriter::path_count_ = 0;
+}
+
+PathWriter::~PathWriter() {
+  PathWriter::Close();
+}
+
+bool PathWriter::Open(const std::string& path, PathFormat format) {
+  PathWriter::Close();
+  PathWriter::out_.clear();
+  PathWriter::out_.open(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!PathWriter::out_)
+    return false;
+  PathWriter::format_ = format;
+  PathWriter::buffer_.resize(kBufferSize);
+  PathWriter::used_ = 0;
+  PathWriter::path_count_ = 0;
+
+  if (format == kBinaryPathFormat) {
+    char *out = PathWriter::Reserve(sizeof(kMagic) + 2 * sizeof(uint32_t));
+    std::memcpy(out, kMagic, sizeof(kMagic));
+    std::memcpy(out + sizeof(kMagic), &kVersion, sizeof(uint32_t));
+    std::memcpy(out + sizeof(kMagic) + sizeof(uint32_t), &kByteOrder,
+                sizeof(uint32_t));
+  } else {
+    static const char kHeader[] = "path,x,y\n";
+    std::memcpy(PathWriter::Reserve(sizeof(kHeader) - 1), kHeader,
+                sizeof(kHeader) - 1);
+  }
+  return true;
+}
+
+char* PathWriter::Reserve(size_t size) {
+  if (PathWriter::used_ + size > PathWriter::buffer_.size())
+    PathWriter::Flush();
+  char *out = PathWriter::buffer_.data() + PathWriter::used_;
+  PathWriter::used_ += size;
+  return out;
+}
+
+void PathWriter::Flush() {
+  PathWriter::out_.write(PathWriter::buffer_.data(),
+                         static_cast<std::streamsize>(PathWriter::used_));
+  PathWriter::used_ = 0;
+}
+
+void PathWriter::BeginPath(uint64_t id, size_t count) {
+  if (PathWriter::format_ != kBinaryPathFormat) {
+    // A CSV path is only its waypoint lines, so an empty one needs a line
+    // of its own to show up at all
+    if (count == 0) {
+      char *start = PathWriter::Reserve(kMaxNumberLength + 3);
+      char *out = FormatNumber(static_cast<int64_t>(id), start);
+      *out++ = ',';
+      *out++ = ',';
+      *out++ = '\n';
+      PathWriter::used_ -= kMaxNumberLength + 3 -
+                           static_cast<size_t>(out - start);
+    }
+    return;
+  }
+  uint32_t count32 = static_cast<uint32_t>(count);
+  char *out = PathWriter::Reserve(sizeof(id) + sizeof(count32));
+  std::memcpy(out, &id, sizeof(id));
+  std::memcpy(out + sizeof(id), &count32, sizeof(count32));
+}
+
+void PathWriter::AppendPoint(uint64_t id, std::pair<int, int> point) {
+  if (PathWriter::format_ == kBinaryPathFormat) {
+    int32_t xy[2] = {point.first, point.second};
+    std::memcpy(PathWriter::Reserve(sizeof(xy)), xy, sizeof(xy));
+    return;
+  }
+  // Reserve the longest the line could be and give back what isn't used
+  char *start = PathWriter::Reserve(3 * kMaxNumberLength + 3);
+  char *out = FormatNumber(static_cast<int64_t>(id), start);
+  *out++ = ',';
+  out = FormatNumber(point.first, out);
+  *out++ = ',';
+  out = FormatNumber(point.second, out);
+  *out++ = '\n';
+  PathWriter::used_ -= 3 * kMaxNumberLength + 3 -
+                       static_cast<size_t>(out - start);
+}
+
+bool PathWriter::Write(uint64_t id, const std::pair<int, int>* points,
+                       size_t count) {
+  if (!PathWriter::IsOpen() || !PathWriter::out_ || count > UINT32_MAX)
+    return false;
+  PathWriter::BeginPath(id, count);
+  for (size_t i = 0; i < count; i++)
+    PathWriter::AppendPoint(id, points[i]);
+  PathWriter::path_count_++;
+  return true;
+}
+
+bool PathWriter::Write(uint64_t id,
+                       const std::vector<std::pair<int, int>>& path) {
+  return PathWriter::Write(id, path.data(), path.size());
+}
+
+bool PathWriter::Write(uint64_t id,
+                       const std::list<std::pair<int, int>>& path) {
+  if (!PathWriter::IsOpen() || !PathWriter::out_ || path.size() > UINT32_MAX)
+    return false;
+  PathWriter::BeginPath(id, path.size());
+  for (const std::pair<int, int> &point : path)
+    PathWriter::AppendPoint(id, point);
+  PathWriter::path_count_++;
+  return true;
+}
+
+bool PathWriter::Close() {
+  if (!PathWriter::IsOpen())
+    return true;
+  PathWriter::Flush();
+  PathWriter::out_.close();
+  return !PathWriter::out_.fail();
+}
+
+bool PathWriter::IsOpen() const {
+  return PathWriter::out_.is_open();
+}
+
+uint64_t PathWriter::GetPathCount() const {
+  return PathWriter::path_count_;
+}
@@ -0,0 +1,389 @@
+/**
+ * @file PRMPath.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Multi-query probabilistic roadmap planning on a static Map
+ *
+ * @section DESCRIPTION
+ * Implementation of PRMPath. Build samples the nodes, buckets them in a
+ * grid, checks the edges of ranges of nodes on the thread pool and packs the
+ * clear edges into a CSR graph. FindPath runs A* over that graph.
+ */
+
+#include "../include/prm_path.h"
+#include <stdint.h>
+#include <algorithm>  // needed for sort, unique and the heap functions
+#include <cmath>      // needed for sqrt and ceil
+#include <limits>     // needed for infinity
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../include/path_smoother.h"
+
+namespace {
+
+/**
+ * @brief the squared distance between two points, exactly
+ */
+int64_t SquaredDistance(std::pair<int, int> start_point,
+                        std::pair<int, int> end_point) {
+  int64_t dx = static_cast<int64_t>(end_point.first) - start_point.first;
+  int64_t dy = static_cast<int64_t>(end_point.second) - start_point.second;
+  return dx * dx + dy * dy;
+}
+
+/**
+ * @brief the distance between two points
+ */
+double Distance(std::pair<int, int> start_point,
+                std::pair<int, int> end_point) {
+  return std::sqrt(static_cast<double>(SquaredDistance(start_point,
+                                                       end_point)));
+}
+
+}  // namespace
+
+const size_t PRMPath::kDefaultMaxNeighbors;
+const int PRMPath::kSampleAttempts;
+const uint32_t PRMPath::kNoNode;
+
+PRMPath::PRMPath(Map map, size_t thread_count)
+    : PRMPath(std::make_shared<const Map>(map), thread_count) {}
+
+PRMPath::PRMPath(std::shared_ptr<const Map> map, size_t thread_count) {
+  PRMPath::map_ = map;
+  if (thread_count != 1)
+    PRMPath::pool_.reset(new ThreadPool(thread_count));
+  PRMPath::connection_radius_ = 0;
+  PRMPath::max_neighbors_ = kDefaultMaxNeighbors;
+  PRMPath::search_ = 0;
+  PRMPath::path_cost_ = std::numeric_limits<double>::infinity();
+  // An empty roadmap has no nodes, so no edges
+  PRMPath::edge_offsets_.assign(1, 0);
+  PRMPath::BuildGrid();
+}
+
+void PRMPath::SetSeed(uint64_t seed) {
+  PRMPath::sampler_.Seed(seed);
+}
+
+size_t PRMPath::Build(size_t node_count, double connection_radius,
+                      size_t max_neighbors) {
+  PRMPath::connection_radius_ = connection_radius;
+  PRMPath::max_neighbors_ = max_neighbors;
+
+  // Sample on this thread, so the nodes only depend on the seed
+  std::pair<int, int> size = PRMPath::map_->GetSize();
+  PRMPath::nodes_.clear();
+  PRMPath::nodes_.reserve(node_count);
+  size_t attempts = node_count * kSampleAttempts;
+  for (size_t attempt = 0;
+       attempt < attempts && PRMPath::nodes_.size() < node_count; attempt++) {
+    std::pair<int, int> point(
+        static_cast<int>(PRMPath::sampler_.NextBounded(
+            static_cast<uint32_t>(std::max(0, size.first)) + 1)),
+        static_cast<int>(PRMPath::sampler_.NextBounded(
+            static_cast<uint32_t>(std::max(0, size.second)) + 1)));
+    if (!PRMPath::map_->IsOccupied(point))
+      PRMPath::nodes_.push_back(point);
+  }
+  PRMPath::BuildGrid();
+
+  // Connect ranges of nodes in parallel, each into its own list of edges
+  size_t count = PRMPath::nodes_.size();
+  size_t ranges = PRMPath::pool_ ? PRMPath::pool_->GetThreadCount() * 4 : 1;
+  size_t chunk = std::max<size_t>(1, (count + ranges - 1) / ranges);
+  std::vector<std::vector<Edge>> edges((count + chunk - 1) / chunk);
+  for (size_t range = 0; range < edges.size(); range++) {
+    size_t begin = range * chunk;
+    size_t end = std::min(count, begin + chunk);
+    std::vector<Edge> *found = &edges[range];
+    if (PRMPath::pool_) {
+      PRMPath::pool_->Submit([this, begin, end, found]() {
+        ConnectNodes(begin, end, found);
+      });
+    } else {
+      PRMPath::ConnectNodes(begin, end, found);
+    }
+  }
+  if (PRMPath::pool_)
+    PRMPath::pool_->Wait();
+  PRMPath::BuildGraph(edges);
+
+  // Size the search state once, so queries don't allocate
+  PRMPath::costs_.assign(count, 0);
+  PRMPath::came_from_.assign(count, kNoNode);
+  PRMPath::visited_.assign(count, 0);
+  PRMPath::goal_links_.assign(count, 0);
+  PRMPath::goal_distances_.assign(count, 0);
+  PRMPath::search_ = 0;
+  PRMPath::open_.reserve(PRMPath::edge_targets_.size() + count);
+  return count;
+}
+
+void PRMPath::BuildGrid() {
+  // Cells at least as wide as an edge is long, but not too many of them
+  std::pair<int, int> size = PRMPath::map_->GetSize();
+  int largest = std::max(1, std::max(size.first, size.second));
+  PRMPath::cell_size_ = std::max(
+      1, std::max(static_cast<int>(std::ceil(PRMPath::connection_radius_)),
+                  (largest + Map::kMaxGridCells - 1) / Map::kMaxGridCells));
+  PRMPath::grid_columns_ = std::max(0, size.first) / PRMPath::cell_size_ + 1;
+  PRMPath::grid_rows_ = std::max(0, size.second) / PRMPath::cell_size_ + 1;
+
+  // Count the nodes of every cell, then place them
+  size_t cells = static_cast<size_t>(PRMPath::grid_columns_) *
+                 static_cast<size_t>(PRMPath::grid_rows_);
+  std::vector<uint32_t> cell_of(PRMPath::nodes_.size());
+  PRMPath::cell_offsets_.assign(cells + 1, 0);
+  for (size_t i = 0; i < PRMPath::nodes_.size(); i++) {
+    int column = std::min(PRMPath::grid_columns_ - 1, std::max(
+        0, PRMPath::nodes_[i].first / PRMPath::cell_size_));
+    int row = std::min(PRMPath::grid_rows_ - 1, std::max(
+        0, PRMPath::nodes_[i].second / PRMPath::cell_size_));
+    cell_of[i] = static_cast<uint32_t>(column * PRMPath::grid_rows_ + row);
+    PRMPath::cell_offsets_[cell_of[i] + 1]++;
+  }
+  for (size_t cell = 0; cell < cells; cell++)
+    PRMPath::cell_offsets_[cell + 1] += PRMPath::cell_offsets_[cell];
+  PRMPath::cell_nodes_.resize(PRMPath::nodes_.size());
+  std::vector<uint32_t> next(PRMPath::cell_offsets_.begin(),
+                             PRMPath::cell_offsets_.end() - 1);
+  for (size_t i = 0; i < PRMPath::nodes_.size(); i++)
+    PRMPath::cell_nodes_[next[cell_of[i]]++] = static_cast<uint32_t>(i);
+}
+
+void PRMPath::GetNearbyNodes(
+    std::pair<int, int> point,
+    std::vector<std::pair<int64_t, uint32_t>>* nearby) const {
+  nearby->clear();
+  if (PRMPath::nodes_.empty())
+    return;
+  double radius = PRMPath::connection_radius_;
+  int min_column = std::max(0, static_cast<int>(
+      std::floor((point.first - radius) / PRMPath::cell_size_)));
+  int max_column = std::min(PRMPath::grid_columns_ - 1, static_cast<int>(
+      std::floor((point.first + radius) / PRMPath::cell_size_)));
+  int min_row = std::max(0, static_cast<int>(
+      std::floor((point.second - radius) / PRMPath::cell_size_)));
+  int max_row = std::min(PRMPath::grid_rows_ - 1, static_cast<int>(
+      std::floor((point.second + radius) / PRMPath::cell_size_)));
+  for (int column = min_column; column <= max_column; column++) {
+    for (int row = min_row; row <= max_row; row++) {
+      size_t cell = static_cast<size_t>(column) * PRMPath::grid_rows_ + row;
+      for (uint32_t i = PRMPath::cell_offsets_[cell];
+           i < PRMPath::cell_offsets_[cell + 1]; i++) {
+        uint32_t node = PRMPath::cell_nodes_[i];
+        int64_t distance_squared = SquaredDistance(point,
+                                                   PRMPath::nodes_[node]);
+        if (distance_squared <= radius * radius)
+          nearby->push_back(std::make_pair(distance_squared, node));
+      }
+    }
+  }
+  // Ties go to the lower index, so the order never depends on the grid
+  std::sort(nearby->begin(), nearby->end());
+}
+
+void PRMPath::ConnectNodes(size_t begin, size_t end,
+                           std::vector<Edge>* edges) const {
+  std::vector<std::pair<int64_t, uint32_t>> nearby;
+  for (size_t i = begin; i < end; i++) {
+    std::pair<int, int> location = PRMPath::nodes_[i];
+    PRMPath::GetNearbyNodes(location, &nearby);
+    size_t tried = 0;
+    for (size_t n = 0; n < nearby.size() && tried < PRMPath::max_neighbors_;
+         n++) {
+      uint32_t neighbor = nearby[n].second;
+      if (neighbor == i)
+        continue;
+      tried++;
+      if (PathSmoother::IsClear(*PRMPath::map_, location,
+                                PRMPath::nodes_[neighbor])) {
+        Edge edge;
+        edge.from = static_cast<uint32_t>(i);
+        edge.to = neighbor;
+        edge.length = static_cast<float>(std::sqrt(
+            static_cast<double>(nearby[n].first)));
+        edges->push_back(edge);
+      }
+    }
+  }
+}
+
+void PRMPath::BuildGraph(const std::vector<std::vector<Edge>>& found) {
+  // Both ends may have found the same edge, so keep one copy of each
+  std::vector<Edge> edges;
+  for (const std::vector<Edge> &range : found) {
+    for (Edge edge : range) {
+      if (edge.from > edge.to)
+        std::swap(edge.from, edge.to);
+      edges.push_back(edge);
+    }
+  }
+  std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+    return a.from < b.from || (a.from == b.from && a.to < b.to);
+  });
+  edges.erase(std::unique(edges.begin(), edges.end(),
+                          [](const Edge& a, const Edge& b) {
+                            return a.from == b.from && a.to == b.to;
+                          }),
+              edges.end());
+
+  // Store every edge in both directions, grouped by the node it leaves
+  size_t count = PRMPath::nodes_.size();
+  PRMPath::edge_offsets_.assign(count + 1, 0);
+  for (const Edge &edge : edges) {
+    PRMPath::edge_offsets_[edge.from + 1]++;
+    PRMPath::edge_offsets_[edge.to + 1]++;
+  }
+  for (size_t i = 0; i < count; i++)
+    PRMPath::edge_offsets_[i + 1] += PRMPath::edge_offsets_[i];
+  PRMPath::edge_targets_.resize(edges.size() * 2);
+  PRMPath::edge_lengths_.resize(edges.size() * 2);
+  std::vector<uint32_t> next(PRMPath::edge_offsets_.begin(),
+                             PRMPath::edge_offsets_.end() - 1);
+  for (const Edge &edge : edges) {
+    PRMPath::edge_targets_[next[edge.from]] = edge.to;
+    PRMPath::edge_lengths_[next[edge.from]++] = edge.length;
+    PRMPath::edge_targets_[next[edge.to]] = edge.from;
+    PRMPath::edge_lengths_[next[edge.to]++] = edge.length;
+  }
+}
+
+std::list<std::pair<int, int>> PRMPath::FindPath(int start_x, int start_y,
+                                                 int goal_x, int goal_y) {
+  std::pair<int, int> start(start_x, start_y);
+  std::pair<int, int> goal(goal_x, goal_y);
+  std::list<std::pair<int, int>> path;
+  PRMPath::path_cost_ = std::numeric_limits<double>::infinity();
+
+  // No roadmap is needed between points that can see each other
+  if (PathSmoother::IsClear(*PRMPath::map_, start, goal)) {
+    path.push_back(start);
+    if (goal != start)
+      path.push_back(goal);
+    PRMPath::path_cost_ = Distance(start, goal);
+    return path;
+  }
+
+  // Number this search, clearing the marks when the numbers wrap around
+  if (++PRMPath::search_ == 0) {
+    std::fill(PRMPath::visited_.begin(), PRMPath::visited_.end(), 0);
+    std::fill(PRMPath::goal_links_.begin(), PRMPath::goal_links_.end(), 0);
+    PRMPath::search_ = 1;
+  }
+
+  // Mark the nodes the goal can be reached from
+  size_t linked = 0;
+  PRMPath::GetNearbyNodes(goal, &nearby_);
+  for (size_t n = 0; n < nearby_.size() && linked < max_neighbors_; n++) {
+    uint32_t node = PRMPath::nearby_[n].second;
+    if (PathSmoother::IsClear(*PRMPath::map_, PRMPath::nodes_[node], goal)) {
+      PRMPath::goal_links_[node] = PRMPath::search_;
+      PRMPath::goal_distances_[node] = std::sqrt(
+          static_cast<double>(PRMPath::nearby_[n].first));
+      linked++;
+    }
+  }
+  if (linked == 0)
+    return path;
+
+  // Seed the open list with the nodes the start can reach
+  auto later = [](const OpenEntry& a, const OpenEntry& b) {
+    return a.estimate > b.estimate;
+  };
+  PRMPath::open_.clear();
+  linked = 0;
+  PRMPath::GetNearbyNodes(start, &nearby_);
+  for (size_t n = 0; n < nearby_.size() && linked < max_neighbors_; n++) {
+    uint32_t node = PRMPath::nearby_[n].second;
+    if (PathSmoother::IsClear(*PRMPath::map_, start, PRMPath::nodes_[node])) {
+      OpenEntry entry;
+      entry.cost = std::sqrt(static_cast<double>(PRMPath::nearby_[n].first));
+      entry.estimate = entry.cost + Distance(PRMPath::nodes_[node], goal);
+      entry.node = node;
+      PRMPath::costs_[node] = entry.cost;
+      PRMPath::came_from_[node] = kNoNode;
+      PRMPath::visited_[node] = PRMPath::search_;
+      PRMPath::open_.push_back(entry);
+      std::push_heap(PRMPath::open_.begin(), PRMPath::open_.end(), later);
+      linked++;
+    }
+  }
+
+  // A* over the roadmap, finishing through whichever linked node is best
+  double best_cost = std::numeric_limits<double>::infinity();
+  uint32_t best_node = kNoNode;
+  while (!PRMPath::open_.empty()) {
+    std::pop_heap(PRMPath::open_.begin(), PRMPath::open_.end(), later);
+    OpenEntry entry = PRMPath::open_.back();
+    PRMPath::open_.pop_back();
+    if (entry.estimate >= best_cost)
+      break;
+    // Skip entries for nodes that have since been reached more cheaply
+    if (entry.cost > PRMPath::costs_[entry.node])
+      continue;
+    if (PRMPath::goal_links_[entry.node] == PRMPath::search_ &&
+        entry.cost + PRMPath::goal_distances_[entry.node] < best_cost) {
+      best_cost = entry.cost + PRMPath::goal_distances_[entry.node];
+      best_node = entry.node;
+    }
+    for (uint32_t e = PRMPath::edge_offsets_[entry.node];
+         e < PRMPath::edge_offsets_[entry.node + 1]; e++) {
+      uint32_t neighbor = PRMPath::edge_targets_[e];
+      double cost = entry.cost + PRMPath::edge_lengths_[e];
+      if (PRMPath::visited_[neighbor] == PRMPath::search_ &&
+          cost >= PRMPath::costs_[neighbor])
+        continue;
+      PRMPath::costs_[neighbor] = cost;
+      PRMPath::came_from_[neighbor] = entry.node;
+      PRMPath::visited_[neighbor] = PRMPath::search_;
+      OpenEntry next;
+      next.cost = cost;
+      next.estimate = cost + Distance(PRMPath::nodes_[neighbor], goal);
+      next.node = neighbor;
+      PRMPath::open_.push_back(next);
+      std::push_heap(PRMPath::open_.begin(), PRMPath::open_.end(), later);
+    }
+  }
+  if (best_node == kNoNode)
+    return path;
+
+  // Walk back from the last node to the start
+  path.push_back(goal);
+  for (uint32_t node = best_node; node != kNoNode;
+       node = PRMPath::came_from_[node])
+    path.push_front(PRMPath::nodes_[node]);
+  path.push_front(start);
+  PRMPath::path_cost_ = best_cost;
+  return path;
+}
+
+double PRMPath::GetPathCost() const {
+  return PRMPath::path_cost_;
+}
+
+size_t PRMPath::GetNodeCount() const {
+  return PRMPath::nodes_.size();
+}
+
+size_t PRMPath::GetEdgeCount() const {
+  return PRMPath::edge_targets_.size() / 2;
+}
+
+std::pair<int, int> PRMPath::GetNode(uint32_t index) const {
+  return PRMPath::nodes_[index];
+}
+
+std::vector<uint32_t> PRMPath::GetNeighbors(uint32_t index) const {
+  return std::vector<uint32_t>(
+      PRMPath::edge_targets_.begin() + PRMPath::edge_offsets_[index],
+      PRMPath::edge_targets_.begin() + PRMPath::edge_offsets_[index + 1]);
+}
+
+size_t PRMPath::GetThreadCount() const {
+  return PRMPath::pool_ ? PRMPath::pool_->GetThreadCount() : 1;
+}
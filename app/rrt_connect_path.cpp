@@ -0,0 +1,103 @@
+/**
+ * @file RRTConnectPath.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Bidirectional RRT-Connect path planning
+ *
+ * @section DESCRIPTION
+ * The RRTConnectPath class grows one RRTPath tree from the start and one from
+ * the goal, alternating a random expansion of one tree with a greedy connect
+ * step of the other, until the two trees meet.
+ */
+
+#include "../include/rrt_connect_path.h"
+#include <stdint.h>
+#include <utility>  // needed for pair and swap
+#include <list>     // needed for list
+#include <memory>   // needed for make_shared
+
+RRTConnectPath::RRTConnectPath(Map map, int start_x, int start_y,
+                               int goal_x, int goal_y, int epsilon,
+                               int radius)
+    : start_tree_(std::make_shared<const Map>(map), start_x, start_y, goal_x,
+                  goal_y, epsilon, radius),
+      // Both trees share the one copy of the map
+      goal_tree_(start_tree_.map_, goal_x, goal_y, start_x, start_y, epsilon,
+                 radius) {
+  RRTConnectPath::iterations_ = 0;
+}
+
+void RRTConnectPath::SetSeed(uint64_t seed) {
+  // The trees need different streams of random points
+  RRTConnectPath::start_tree_.SetSeed(seed);
+  RRTConnectPath::goal_tree_.SetSeed(seed ^ 0x5DEECE66DULL);
+}
+
+int RRTConnectPath::GetIterationCount() const {
+  return RRTConnectPath::iterations_;
+}
+
+size_t RRTConnectPath::GetVertexCount() const {
+  return RRTConnectPath::start_tree_.GetVertexCount() +
+         RRTConnectPath::goal_tree_.GetVertexCount();
+}
+
+std::list<std::pair<int, int>> RRTConnectPath::FindPath() {
+  // The tree taking the random step this iteration, and the other one
+  RRTPath *tree = &start_tree_;
+  RRTPath *other = &goal_tree_;
+
+  while (true) {
+    RRTConnectPath::iterations_++;
+
+    // Take a normal RRT step towards a random point
+    std::pair<int, int> random_point = tree->GetRandomPoint();
+    uint32_t closest = tree->GetClosestPoint(random_point);
+    uint32_t new_vertex;
+    if (tree->ExtendTowards(closest, random_point, &new_vertex) !=
+        RRTPath::kTrapped) {
+      std::pair<int, int> target = tree->vertices_.GetLocation(new_vertex);
+
+      // The start tree may get close enough to the goal by itself
+      if (tree == &start_tree_ && tree->ReachedGoal(target))
+        return RRTConnectPath::JoinPaths(new_vertex, VertexStore::kNoParent);
+
+      // Greedily grow the other tree towards the new vertex until it gets
+      // there or is blocked
+      uint32_t other_vertex = other->GetClosestPoint(target);
+      RRTPath::ExtendResult result =
+          other->vertices_.GetLocation(other_vertex) == target
+              ? RRTPath::kReached : RRTPath::kAdvanced;
+      while (result == RRTPath::kAdvanced)
+        result = other->ExtendTowards(other_vertex, target, &other_vertex);
+
+      if (result == RRTPath::kReached) {
+        // The trees have met, work out which vertex belongs to which tree
+        if (tree == &start_tree_)
+          return RRTConnectPath::JoinPaths(new_vertex, other_vertex);
+        return RRTConnectPath::JoinPaths(other_vertex, new_vertex);
+      }
+    }
+
+    // Swap the roles of the trees
+    std::swap(tree, other);
+  }
+}
+
+std::list<std::pair<int, int>> RRTConnectPath::JoinPaths(uint32_t start_vertex,
+                                                         uint32_t goal_vertex) {
+  // Start to the meeting point, built by the start tree as usual
+  std::list<std::pair<int, int>> path =
+      RRTConnectPath::start_tree_.CalculatePath(start_vertex);
+  if (goal_vertex == VertexStore::kNoParent)
+    return path;
+
+  // The goal tree's path runs from the goal to the meeting point, so walk it
+  // backwards. The meeting point is in both paths, so skip it the second time
+  std::list<std::pair<int, int>> goal_path =
+      RRTConnectPath::goal_tree_.CalculatePath(goal_vertex);
+  goal_path.pop_back();
+  path.insert(path.end(), goal_path.rbegin(), goal_path.rend());
+  return path;
+}
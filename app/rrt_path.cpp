@@ -9,201 +9,1414 @@
  * The RRTPath class generates a path between a given starting point and a
  * goal point while avoiding obstacles. Class dependencies are the Vertex
  * class, and the Map class, which has a dependency of the Obstacle class.
- * This class only generates the first path it finds, which may not be the
- * most efficient.
+ * FindPath returns the first path it finds, while FindOptimalPath runs RRT*
+ * with informed sampling to keep improving it.
  */
 
 #include "../include/rrt_path.h"
-#include <random>   // needed for random point generation
-#include <cmath>    // needed for finding closest point
-#include <utility>  // needed for pair
-#include <list>     // needed for list
+#include "../include/nearest_kernel.h"
+#include "../include/planner_stats.h"
+#include "../include/concurrent_vertex_store.h"
+#include <stdint.h>
+#include <algorithm>  // needed for find
+#include <atomic>     // needed for the parallel expansion state
+#include <chrono>     // needed for time budgets
+#include <cmath>      // needed for finding closest point
+#include <limits>     // needed for infinity
+#include <memory>     // needed for shared_ptr
+#include <type_traits>  // needed for is_integral
+#include <utility>    // needed for pair
+#include <list>       // needed for list
+#include <vector>     // needed for the sample buffer
 
-RRTPath::RRTPath(Map map, int start_x, int start_y,
-                 int goal_x, int goal_y, int epsilon,
-                 int radius) {
-  RRTPath::map_ = map;
-  RRTPath::start_location_.first = start_x;
-  RRTPath::start_location_.second = start_y;
-  RRTPath::goal_location_.first = goal_x;
-  RRTPath::goal_location_.second = goal_y;
-  RRTPath::epsilon_ = epsilon;
-  RRTPath::goal_radius_ = radius;
+namespace {
 
-  Vertex *root_node = new Vertex(start_x, start_y, nullptr);
+/**
+ * @brief pi, as M_PI is not part of standard C++
+ */
+const double kPi = 3.14159265358979323846;
+
+/**
+ * @brief the length of the edge between two points, used for path costs
+ */
+template <int D, typename T, typename Location>
+double EdgeLength(const Location& start_point, const Location& end_point) {
+  return Distance<D, T>(start_point, end_point);
+}
+
+/**
+ * @brief converts a coordinate computed in double to an integer one,
+ * rounding towards zero as steps along an edge always have
+ */
+int RoundDown(double value, int) {
+  return static_cast<int>(value);
+}
+
+/**
+ * @brief converts a coordinate computed in double to a float one
+ */
+float RoundDown(double value, float) {
+  return static_cast<float>(value);
+}
+
+/**
+ * @brief converts a coordinate computed in double to the nearest integer
+ */
+int RoundNearest(double value, int) {
+  return static_cast<int>(std::lround(value));
+}
+
+/**
+ * @brief converts a coordinate computed in double to a float one
+ */
+float RoundNearest(double value, float) {
+  return static_cast<float>(value);
+}
+
+/**
+ * @brief the volume of the unit ball in D dimensions
+ */
+double UnitBallVolume(int dimension) {
+  return std::pow(kPi, dimension / 2.0) / std::tgamma(dimension / 2.0 + 1);
+}
+
+/**
+ * @brief the D-th root of a value, taken with sqrt in 2-D
+ */
+template <int D>
+double Root(double value) {
+  return D == 2 ? std::sqrt(value) : std::pow(value, 1.0 / D);
+}
+
+/**
+ * @brief the unit direction from one point towards another
+ * @details In 2-D this is the cosine and sine of the float angle atan2
+ * gives, the way 2-D steps have always been taken, so seeded 2-D trees
+ * stay the same. Otherwise it is the difference divided by its length.
+ * Towards the point itself it is the first axis, as atan2(0, 0) is zero.
+ * @param from the point to move from
+ * @param to the point to move towards
+ * @param direction set to the direction
+ */
+template <int D, typename T, typename Location>
+void UnitDirection(const Location& from, const Location& to,
+                   double* direction) {
+  if (D == 2) {
+    float theta = std::atan2(GetCoordinate(to, 1) - GetCoordinate(from, 1),
+                             GetCoordinate(to, 0) - GetCoordinate(from, 0));
+    direction[0] = std::cos(static_cast<double>(theta));
+    direction[1] = std::sin(static_cast<double>(theta));
+    return;
+  }
+  double length = Distance<D, T>(from, to);
+  for (int axis = 0; axis < D; axis++) {
+    direction[axis] = length > 0
+        ? (GetCoordinate(to, axis) - GetCoordinate(from, axis)) / length
+        : (axis == 0 ? 1 : 0);
+  }
+}
+
+/**
+ * @brief draws a point uniformly from an ellipsoid centred on the origin,
+ * with its axes along the coordinate axes
+ * @details In 2-D a radius and an angle are drawn, so the unit disc takes
+ * exactly two numbers from the sampler. Otherwise the direction comes from
+ * D independent Gaussians, drawn with the Box-Muller transform, and the
+ * radius is stretched so the points spread evenly through the ball.
+ * @param sampler the sampler to draw from
+ * @param radii the radius of the ellipsoid along each axis
+ * @param point set to the point
+ */
+template <int D>
+void SampleEllipsoid(Sampler* sampler, const double* radii, double* point) {
+  if (D == 2) {
+    double r = std::sqrt(sampler->NextDouble());
+    double theta = 2 * kPi * sampler->NextDouble();
+    point[0] = radii[0] * r * std::cos(theta);
+    point[1] = radii[1] * r * std::sin(theta);
+    return;
+  }
+  double length_squared = 0;
+  while (length_squared == 0) {
+    for (int axis = 0; axis < D; axis++) {
+      double r = std::sqrt(-2 * std::log(1 - sampler->NextDouble()));
+      point[axis] = r * std::cos(2 * kPi * sampler->NextDouble());
+      length_squared += point[axis] * point[axis];
+    }
+  }
+  double scale = std::pow(sampler->NextDouble(), 1.0 / D) /
+                 std::sqrt(length_squared);
+  for (int axis = 0; axis < D; axis++)
+    point[axis] *= scale * radii[axis];
+}
+
+/**
+ * @brief rotates a vector by the rotation taking the first axis onto a unit
+ * direction, then moves it to a centre
+ * @details Uses v + Kv + K(Kv) / (1 + c), with K = a e0^T - e0 a^T and c the
+ * first coordinate of the direction a, which turns only within the plane of
+ * the two. In 2-D this is the usual rotation by the angle of the direction.
+ * A direction straight back along the first axis flips the vector instead,
+ * which is the same for the symmetric ellipsoids it is used on.
+ * @param direction the unit direction
+ * @param center the centre to move the rotated vector to
+ * @param vector the vector to rotate
+ * @param rotated set to the rotated vector plus the centre
+ */
+template <int D>
+void RotateFromFirstAxis(const double* direction, const double* center,
+                         const double* vector, double* rotated) {
+  double c = direction[0];
+  if (D == 2) {
+    double s = direction[1];
+    rotated[0] = center[0] + vector[0] * c - vector[1] * s;
+    rotated[1] = center[1] + vector[0] * s + vector[1] * c;
+    return;
+  }
+  if (c <= -1) {
+    for (int axis = 0; axis < D; axis++)
+      rotated[axis] = center[axis] - vector[axis];
+    return;
+  }
+  // K v = a v0 - e0 (a . v), then the same again for K (K v)
+  double dot = 0;
+  for (int axis = 0; axis < D; axis++)
+    dot += direction[axis] * vector[axis];
+  double kv[D];
+  for (int axis = 0; axis < D; axis++)
+    kv[axis] = direction[axis] * vector[0];
+  kv[0] -= dot;
+  double kv_dot = 0;
+  for (int axis = 0; axis < D; axis++)
+    kv_dot += direction[axis] * kv[axis];
+  for (int axis = 0; axis < D; axis++) {
+    double kkv = direction[axis] * kv[0] - (axis == 0 ? kv_dot : 0);
+    rotated[axis] = center[axis] +
+                    (vector[axis] + kv[axis] + kkv / (1 + c));
+  }
+}
+
+}  // namespace
+
+template <int D, typename T>
+BasicRRTPath<D, T>::BasicRRTPath(Map map, Location start, Location goal,
+                                 T epsilon, T radius)
+    : BasicRRTPath(std::make_shared<Map>(map), start, goal, epsilon,
+                   radius) {
+  // The copy is ours alone, so AddObstacle can change it in place
+  BasicRRTPath::owned_map_ =
+      std::const_pointer_cast<Map>(BasicRRTPath::map_);
+}
+
+template <int D, typename T>
+BasicRRTPath<D, T>::BasicRRTPath(std::shared_ptr<const Map> map,
+                                 Location start, Location goal, T epsilon,
+                                 T radius) {
+  BasicRRTPath::map_ = map;
+  BasicRRTPath::stop_flag_ = nullptr;
+  BasicRRTPath::start_location_ = start;
+  BasicRRTPath::goal_location_ = goal;
+  BasicRRTPath::epsilon_ = epsilon;
+  BasicRRTPath::goal_radius_ = radius;
+  BasicRRTPath::nearest_neighbor_method_ = kKdTree;
+  BasicRRTPath::lazy_collision_checking_ = false;
+  BasicRRTPath::sampling_strategy_.reset(new BasicUniformSampling<D, T>());
+  BasicRRTPath::sample_buffer_.resize(kSampleBatchSize);
+  BasicRRTPath::next_sample_ = kSampleBatchSize;
+
+  // Start the tree off with just the root vertex at our starting location
+  BasicRRTPath::Reset();
+}
+
+template <int D, typename T>
+const uint32_t BasicRRTPath<D, T>::kRootIndex;
+template <int D, typename T>
+const size_t BasicRRTPath<D, T>::kSampleBatchSize;
+template <int D, typename T>
+const uint32_t BasicRRTPath<D, T>::kNoVertex;
+template <int D, typename T>
+const int BasicRRTPath<D, T>::kInformedSampleAttempts;
+template <int D, typename T>
+const int BasicRRTPath<D, T>::kNoStatus;
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetNearestNeighborMethod(
+    NearestNeighborMethod method) {
+  BasicRRTPath::nearest_neighbor_method_ = method;
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetSamplingStrategy(const SamplingStrategy& strategy) {
+  // Points already in the buffer came from the old strategy
+  BasicRRTPath::sampling_strategy_.reset(strategy.Clone());
+  BasicRRTPath::next_sample_ = kSampleBatchSize;
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::EnablePathSmoothing(bool enable, int iterations,
+                                             size_t thread_count) {
+  if (!enable) {
+    BasicRRTPath::smoother_.reset();
+    return;
+  }
+  BasicRRTPath::smoother_.reset(new PathSmoother(thread_count));
+  BasicRRTPath::smoother_->SetIterations(iterations);
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetLazyCollisionChecking(bool enable) {
+  BasicRRTPath::lazy_collision_checking_ = enable;
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetExpansionThreads(size_t thread_count) {
+  BasicRRTPath::expansion_pool_.reset();
+  BasicRRTPath::expansion_workers_.clear();
+  if (thread_count == 1)
+    return;
+  BasicRRTPath::expansion_pool_.reset(new ThreadPool(thread_count));
+  BasicRRTPath::expansion_workers_.resize(
+      BasicRRTPath::expansion_pool_->GetThreadCount());
+  for (ExpansionWorker &worker : BasicRRTPath::expansion_workers_)
+    worker.samples.resize(kSampleBatchSize);
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::GetExpansionThreadCount() const {
+  if (!BasicRRTPath::expansion_pool_)
+    return 1;
+  return BasicRRTPath::expansion_pool_->GetThreadCount();
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetStopFlag(const std::atomic<bool>* stop_flag) {
+  BasicRRTPath::stop_flag_ = stop_flag;
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::IsStopped() const {
+  // Relaxed is enough, the flag only asks us to stop and guards no data
+  return BasicRRTPath::stop_flag_ != nullptr &&
+         BasicRRTPath::stop_flag_->load(std::memory_order_relaxed);
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::SetSeed(uint64_t seed) {
+  // Throw away points generated from the old seed
+  BasicRRTPath::sampler_.Seed(seed);
+  if (BasicRRTPath::smoother_)
+    BasicRRTPath::smoother_->SetSeed(seed);
+  BasicRRTPath::sampling_strategy_->Reset();
+  BasicRRTPath::next_sample_ = kSampleBatchSize;
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::Reset() {
+  // Empty the tree without giving its memory back, then add the root
+  BasicRRTPath::vertices_.Reset();
+  BasicRRTPath::kd_tree_.Clear();
+  BasicRRTPath::overall_path_.clear();
+  BasicRRTPath::costs_.clear();
+  BasicRRTPath::edge_checked_.clear();
+  BasicRRTPath::goal_vertices_.clear();
+  BasicRRTPath::removed_vertices_ = 0;
+  BasicRRTPath::shared_tree_size_ = 0;
+  BasicRRTPath::best_goal_vertex_ = kNoVertex;
+  BasicRRTPath::iterations_ = 0;
+  // Start the sampling strategy over, dropping points meant for the old tree
+  BasicRRTPath::sampling_strategy_->Reset();
+  BasicRRTPath::next_sample_ = kSampleBatchSize;
+  BasicRRTPath::AddVertex(BasicRRTPath::start_location_,
+                          VertexStore::kNoParent);
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::Reset(const Location& start, const Location& goal) {
+  BasicRRTPath::start_location_ = start;
+  BasicRRTPath::goal_location_ = goal;
+  BasicRRTPath::Reset();
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::Reset(const Location& start, const Location& goal,
+                               T epsilon, T radius) {
+  BasicRRTPath::epsilon_ = epsilon;
+  BasicRRTPath::goal_radius_ = radius;
+  BasicRRTPath::Reset(start, goal);
+}
+
+template <int D, typename T>
+int BasicRRTPath<D, T>::GetIterationCount() const {
+  return BasicRRTPath::iterations_;
+}
+
+template <int D, typename T>
+const PlannerStats& BasicRRTPath<D, T>::GetStats() const {
+  return BasicRRTPath::stats_;
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::GetVertexCount() const {
+  return BasicRRTPath::vertices_.Size();
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Vertex BasicRRTPath<D, T>::GetVertex(
+    uint32_t index) const {
+  return Vertex(&vertices_, index);
+}
+
+template <int D, typename T>
+uint32_t BasicRRTPath<D, T>::AddVertex(Location location, uint32_t parent) {
+  // The vertex's index in the store doubles as its id in the k-d tree
+  uint32_t index = BasicRRTPath::StoreVertex(location, parent);
+  BasicRRTPath::kd_tree_.Insert(location, index);
+  return index;
+}
+
+template <int D, typename T>
+uint32_t BasicRRTPath<D, T>::StoreVertex(Location location, uint32_t parent) {
+  uint32_t index = BasicRRTPath::vertices_.Add(location, parent);
+  // Callers that skip the edge check mark the edge unchecked themselves
+  BasicRRTPath::edge_checked_.push_back(1);
+
+  // The cost to reach a vertex is the cost of its parent plus the new edge
+  if (parent == VertexStore::kNoParent) {
+    BasicRRTPath::costs_.push_back(0);
+  } else {
+    BasicRRTPath::costs_.push_back(
+        BasicRRTPath::costs_[parent] + EdgeLength<D, T>(
+            BasicRRTPath::vertices_.GetLocation(parent), location));
+  }
+  if (BasicRRTPath::ReachedGoal(location))
+    BasicRRTPath::goal_vertices_.push_back(index);
+
+  // Remember the vertex closest to the goal for partial paths
+  Difference distance_squared = SquaredDistance<D, T>(
+      location, BasicRRTPath::goal_location_);
+  if (index == kRootIndex ||
+      distance_squared < BasicRRTPath::closest_distance_squared_) {
+    BasicRRTPath::closest_to_goal_ = index;
+    BasicRRTPath::closest_distance_squared_ = distance_squared;
+  }
+  return index;
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::RebuildKdTree() {
+  std::vector<uint32_t> ids;
+  ids.reserve(BasicRRTPath::vertices_.Size() -
+              BasicRRTPath::removed_vertices_);
+  for (uint32_t i = 0; i < BasicRRTPath::vertices_.Size(); i++) {
+    if (!BasicRRTPath::vertices_.IsRemoved(i))
+      ids.push_back(i);
+  }
+  const T *coordinates[D];
+  for (int axis = 0; axis < D; axis++)
+    coordinates[axis] = BasicRRTPath::vertices_.Data(axis);
+  BasicRRTPath::kd_tree_.Build(coordinates, ids);
+}
+
+template <int D, typename T>
+double BasicRRTPath<D, T>::GetPathCost() const {
+  if (BasicRRTPath::best_goal_vertex_ == kNoVertex)
+    return std::numeric_limits<double>::infinity();
+  return BasicRRTPath::costs_[BasicRRTPath::best_goal_vertex_];
+}
+
+template <int D, typename T>
+std::list<typename BasicRRTPath<D, T>::Location>
+BasicRRTPath<D, T>::FindOptimalPath(int max_iterations, double max_seconds) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start_time = Clock::now();
+  if (max_iterations <= 0 && max_seconds <= 0)
+    return BasicRRTPath::overall_path_;
+
+  // Pick up any path that FindPath or an earlier call already found
+  BasicRRTPath::UpdateBestGoalVertex();
+  BasicRRTPath::stats_.Clear();
+
+  for (int i = 0; max_iterations <= 0 || i < max_iterations; i++) {
+    if (BasicRRTPath::IsStopped() || (max_seconds > 0 &&
+        std::chrono::duration<double>(Clock::now() - start_time).count() >=
+            max_seconds))
+      break;
+    BasicRRTPath::iterations_++;
+    RRT_STATS_ADD(BasicRRTPath::stats_.iterations, 1);
+
+    // Once we have a path, only sample where a cheaper one could pass
+    Location random_point =
+        BasicRRTPath::best_goal_vertex_ == kNoVertex
+            ? BasicRRTPath::GetRandomPoint()
+            : BasicRRTPath::GetInformedPoint(BasicRRTPath::GetPathCost() +
+                                             BasicRRTPath::goal_radius_);
+
+    // Steer from the closest vertex towards the point, as in ExtendTowards
+    uint32_t closest_vertex = BasicRRTPath::GetClosestPoint(random_point);
+    Location closest_point =
+        BasicRRTPath::vertices_.GetLocation(closest_vertex);
+    Location new_point = BasicRRTPath::Steer(closest_point, random_point);
+    if (new_point == closest_point ||
+        !BasicRRTPath::IsSafe(closest_point, new_point)) {
+      RRT_STATS_ADD(BasicRRTPath::stats_.rejected_expansions, 1);
+      continue;
+    }
+
+    // Gather the neighbours of the new point. The closest vertex is always
+    // one, even if the radius has shrunk below its distance
+    double radius = BasicRRTPath::GetNeighborRadius();
+    BasicRRTPath::kd_tree_.Within(new_point,
+                                  static_cast<Difference>(radius * radius),
+                                  &neighbors_);
+    if (std::find(BasicRRTPath::neighbors_.begin(),
+                  BasicRRTPath::neighbors_.end(),
+                  closest_vertex) == BasicRRTPath::neighbors_.end())
+      BasicRRTPath::neighbors_.push_back(closest_vertex);
+
+    // Connect through whichever neighbour gives the cheapest path. A vertex
+    // already at the new point means there is nothing to add; skipping it
+    // also keeps every edge longer than zero, so rewiring can't form a cycle
+    uint32_t parent = closest_vertex;
+    double cost = BasicRRTPath::costs_[closest_vertex] +
+                  EdgeLength<D, T>(closest_point, new_point);
+    bool duplicate = false;
+    for (size_t n = 0; n < BasicRRTPath::neighbors_.size(); n++) {
+      uint32_t neighbor = BasicRRTPath::neighbors_[n];
+      Location location = BasicRRTPath::vertices_.GetLocation(neighbor);
+      if (location == new_point) {
+        duplicate = true;
+        break;
+      }
+      if (neighbor == closest_vertex)
+        continue;
+      double neighbor_cost = BasicRRTPath::costs_[neighbor] +
+                             EdgeLength<D, T>(location, new_point);
+      if (neighbor_cost < cost && BasicRRTPath::IsSafe(location, new_point)) {
+        parent = neighbor;
+        cost = neighbor_cost;
+      }
+    }
+    if (duplicate)
+      continue;
+    uint32_t new_vertex = BasicRRTPath::AddVertex(new_point, parent);
+    RRT_STATS_ADD(BasicRRTPath::stats_.accepted_expansions, 1);
+
+    // Rewire the neighbours that are cheaper to reach through the new vertex
+    for (size_t n = 0; n < BasicRRTPath::neighbors_.size(); n++) {
+      uint32_t neighbor = BasicRRTPath::neighbors_[n];
+      if (neighbor == parent)
+        continue;
+      Location location = BasicRRTPath::vertices_.GetLocation(neighbor);
+      double rewired_cost = BasicRRTPath::costs_[new_vertex] +
+                            EdgeLength<D, T>(new_point, location);
+      if (rewired_cost < BasicRRTPath::costs_[neighbor] &&
+          BasicRRTPath::IsSafe(new_point, location)) {
+        BasicRRTPath::vertices_.SetParent(neighbor, new_vertex);
+        BasicRRTPath::edge_checked_[neighbor] = 1;
+        BasicRRTPath::UpdateSubtreeCosts(
+            neighbor, rewired_cost - BasicRRTPath::costs_[neighbor]);
+      }
+    }
+    BasicRRTPath::UpdateBestGoalVertex();
+  }
+
+  RRT_STATS_MAX(BasicRRTPath::stats_.peak_vertex_count,
+                BasicRRTPath::vertices_.Size());
+  // Edges from a lazy FindPath or a loaded tree may not have been checked.
+  // Pruning a bad one picks the best remaining goal vertex again
+  while (BasicRRTPath::best_goal_vertex_ != kNoVertex &&
+         !BasicRRTPath::ValidatePath(BasicRRTPath::best_goal_vertex_)) {}
+  if (BasicRRTPath::best_goal_vertex_ != kNoVertex)
+    BasicRRTPath::overall_path_ =
+        GetFinalPath(BasicRRTPath::best_goal_vertex_);
+  else
+    BasicRRTPath::overall_path_.clear();
+  return BasicRRTPath::overall_path_;
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Location BasicRRTPath<D, T>::GetInformedPoint(
+    double max_cost) {
+  // The ellipsoid is centred between the start and goal, with its major axis
+  // along the line joining them
+  double center[D];
+  double direction[D];
+  double min_cost = Distance<D, T>(BasicRRTPath::start_location_,
+                                   BasicRRTPath::goal_location_);
+  for (int axis = 0; axis < D; axis++) {
+    double start = GetCoordinate(BasicRRTPath::start_location_, axis);
+    double delta = GetCoordinate(BasicRRTPath::goal_location_, axis) - start;
+    center[axis] = start + delta / 2;
+    direction[axis] = min_cost > 0 ? delta / min_cost : (axis == 0 ? 1 : 0);
+  }
+  double radii[D];
+  radii[0] = max_cost / 2;
+  for (int axis = 1; axis < D; axis++) {
+    radii[axis] = max_cost > min_cost
+        ? std::sqrt(max_cost * max_cost - min_cost * min_cost) / 2 : 0;
+  }
+
+  for (int attempt = 0; attempt < kInformedSampleAttempts; attempt++) {
+    // Uniform point in the ellipsoid, turned onto the line and centred
+    double point[D];
+    SampleEllipsoid<D>(&sampler_, radii, point);
+    double rotated[D];
+    RotateFromFirstAxis<D>(direction, center, point, rotated);
+    Location location;
+    for (int axis = 0; axis < D; axis++) {
+      SetCoordinate(&location, axis, RoundNearest(rotated[axis], T()));
+    }
+    if (BasicRRTPath::map_->IsOnMap(location))
+      return location;
+  }
+  return BasicRRTPath::GetRandomPoint();
+}
+
+template <int D, typename T>
+double BasicRRTPath<D, T>::GetNeighborRadius() const {
+  // gamma = 2 * (1 + 1/d)^(1/d) * (volume / unit ball volume)^(1/d)
+  Location map_size = BasicRRTPath::map_->GetSize();
+  double volume = 1;
+  for (int axis = 0; axis < D; axis++)
+    volume *= GetCoordinate(map_size, axis);
+  double gamma = 2 * Root<D>(1 + 1.0 / D) *
+                 Root<D>(volume / UnitBallVolume(D));
+  double n = static_cast<double>(BasicRRTPath::vertices_.Size() -
+                                 BasicRRTPath::removed_vertices_);
+  double radius = gamma * Root<D>(std::log(n) / n);
+  return std::min(radius, static_cast<double>(BasicRRTPath::epsilon_));
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::UpdateSubtreeCosts(uint32_t root, double delta) {
+  BasicRRTPath::subtree_stack_.clear();
+  BasicRRTPath::subtree_stack_.push_back(root);
+  while (!BasicRRTPath::subtree_stack_.empty()) {
+    uint32_t current = BasicRRTPath::subtree_stack_.back();
+    BasicRRTPath::subtree_stack_.pop_back();
+    BasicRRTPath::costs_[current] += delta;
+    for (uint32_t child = BasicRRTPath::vertices_.GetFirstChild(current);
+         child != VertexStore::kNoChild;
+         child = BasicRRTPath::vertices_.GetNextSibling(child))
+      BasicRRTPath::subtree_stack_.push_back(child);
+  }
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::UpdateBestGoalVertex() {
+  for (size_t i = 0; i < BasicRRTPath::goal_vertices_.size(); i++) {
+    uint32_t vertex = BasicRRTPath::goal_vertices_[i];
+    if (BasicRRTPath::best_goal_vertex_ == kNoVertex ||
+        BasicRRTPath::costs_[vertex] <
+            BasicRRTPath::costs_[BasicRRTPath::best_goal_vertex_])
+      BasicRRTPath::best_goal_vertex_ = vertex;
+  }
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Map* BasicRRTPath<D, T>::GetMutableMap() {
+  // Other planners may be reading a shared map, so change a copy of it. Once
+  // copied, owned_map_ and map_ are the only references
+  if (BasicRRTPath::owned_map_ == nullptr ||
+      BasicRRTPath::owned_map_.use_count() > 2) {
+    BasicRRTPath::owned_map_ = std::make_shared<Map>(*BasicRRTPath::map_);
+    BasicRRTPath::map_ = BasicRRTPath::owned_map_;
+  }
+  return BasicRRTPath::owned_map_.get();
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::AddObstacle(Obstacle obs) {
+  BasicRRTPath::GetMutableMap()->AddObstacle(obs);
+  return BasicRRTPath::RepairTree(obs);
+}
+
+template <int D, typename T>
+void BasicRRTPath<D, T>::RemoveObstacle(Obstacle obs) {
+  BasicRRTPath::GetMutableMap()->RemoveObstacle(obs);
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::RepairTree(const Obstacle& obs) {
+  // An edge is at most a little over epsilon long, so only vertices within
+  // that distance of the obstacle's bounding box can have a blocked edge
+  Difference reach = static_cast<Difference>(std::ceil(obs.GetSize() *
+                                                       std::sqrt(D))) +
+                     BasicRRTPath::epsilon_ + 2;
+  BasicRRTPath::kd_tree_.Within(obs.GetLocation(), reach * reach,
+                                &neighbors_);
+  std::vector<uint32_t> cut;
+  for (uint32_t vertex : BasicRRTPath::neighbors_) {
+    uint32_t parent = BasicRRTPath::vertices_.GetParent(vertex);
+    if (parent != VertexStore::kNoParent &&
+        !BasicRRTPath::IsSafe(BasicRRTPath::vertices_.GetLocation(parent),
+                              BasicRRTPath::vertices_.GetLocation(vertex)))
+      cut.push_back(vertex);
+  }
+  if (cut.empty())
+    return 0;
+  for (uint32_t vertex : cut)
+    BasicRRTPath::vertices_.SetParent(vertex, VertexStore::kNoParent);
+
+  // Mark everything still hanging off the root
+  size_t count = BasicRRTPath::vertices_.Size();
+  std::vector<bool> connected(count, false);
+  std::vector<uint32_t> &stack = BasicRRTPath::subtree_stack_;
+  stack.assign(1, kRootIndex);
+  while (!stack.empty()) {
+    uint32_t vertex = stack.back();
+    stack.pop_back();
+    connected[vertex] = true;
+    for (uint32_t child = BasicRRTPath::vertices_.GetFirstChild(vertex);
+         child != VertexStore::kNoChild;
+         child = BasicRRTPath::vertices_.GetNextSibling(child))
+      stack.push_back(child);
+  }
+
+  // Reattach the cut subtrees, repeating while that gives the remaining ones
+  // new vertices to attach to
+  std::vector<uint32_t> subtree;
+  std::vector<uint32_t> candidates;
+  Difference epsilon_squared =
+      static_cast<Difference>(BasicRRTPath::epsilon_) *
+      BasicRRTPath::epsilon_;
+  bool attached_any = true;
+  while (attached_any) {
+    attached_any = false;
+    for (uint32_t &top : cut) {
+      if (top == kNoVertex || connected[top])
+        continue;
+      // Gather the subtree in preorder so vertices near its top are tried
+      // first
+      subtree.clear();
+      stack.assign(1, top);
+      while (!stack.empty()) {
+        uint32_t vertex = stack.back();
+        stack.pop_back();
+        subtree.push_back(vertex);
+        for (uint32_t child = BasicRRTPath::vertices_.GetFirstChild(vertex);
+             child != VertexStore::kNoChild;
+             child = BasicRRTPath::vertices_.GetNextSibling(child))
+          stack.push_back(child);
+      }
+
+      for (uint32_t vertex : subtree) {
+        // Join the closest connected vertex with a safe edge
+        Location location = BasicRRTPath::vertices_.GetLocation(vertex);
+        BasicRRTPath::kd_tree_.Within(location, epsilon_squared,
+                                      &candidates);
+        uint32_t anchor = kNoVertex;
+        double anchor_distance = 0;
+        for (uint32_t candidate : candidates) {
+          if (!connected[candidate])
+            continue;
+          Location anchor_location =
+              BasicRRTPath::vertices_.GetLocation(candidate);
+          double distance = EdgeLength<D, T>(anchor_location, location);
+          if ((anchor == kNoVertex || distance < anchor_distance) &&
+              BasicRRTPath::IsSafe(anchor_location, location)) {
+            anchor = candidate;
+            anchor_distance = distance;
+          }
+        }
+        if (anchor == kNoVertex)
+          continue;
+
+        // Re-root the subtree at this vertex by reversing the edges up to
+        // its old top, then hang it off the anchor. Each reversed edge
+        // keeps its checked flag, which moves to the edge's new child
+        uint32_t child = vertex;
+        uint32_t parent = BasicRRTPath::vertices_.GetParent(vertex);
+        char checked = BasicRRTPath::edge_checked_[vertex];
+        BasicRRTPath::vertices_.SetParent(vertex, anchor);
+        BasicRRTPath::edge_checked_[vertex] = 1;
+        while (parent != VertexStore::kNoParent) {
+          uint32_t next = BasicRRTPath::vertices_.GetParent(parent);
+          char next_checked = BasicRRTPath::edge_checked_[parent];
+          BasicRRTPath::vertices_.SetParent(parent, child);
+          BasicRRTPath::edge_checked_[parent] = checked;
+          checked = next_checked;
+          child = parent;
+          parent = next;
+        }
+        for (uint32_t member : subtree)
+          connected[member] = true;
+        attached_any = true;
+        break;
+      }
+      if (connected[top])
+        top = kNoVertex;
+    }
+  }
+
+  // Drop whatever is still cut off and renumber the rest
+  return BasicRRTPath::CompactTree();
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::CompactTree() {
+  // Take the surviving vertices in breadth first order, so every parent is
+  // renumbered before its children
+  std::vector<uint32_t> order(1, kRootIndex);
+  for (size_t i = 0; i < order.size(); i++) {
+    for (uint32_t child = BasicRRTPath::vertices_.GetFirstChild(order[i]);
+         child != VertexStore::kNoChild;
+         child = BasicRRTPath::vertices_.GetNextSibling(child))
+      order.push_back(child);
+  }
+  size_t dropped = BasicRRTPath::vertices_.Size() - order.size() -
+                   BasicRRTPath::removed_vertices_;
+  std::vector<uint32_t> renumbered(BasicRRTPath::vertices_.Size(), kNoVertex);
+  std::vector<Location> locations(order.size());
+  std::vector<uint32_t> parents(order.size());
+  std::vector<char> checked(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    renumbered[order[i]] = static_cast<uint32_t>(i);
+    locations[i] = BasicRRTPath::vertices_.GetLocation(order[i]);
+    checked[i] = BasicRRTPath::edge_checked_[order[i]];
+    uint32_t parent = BasicRRTPath::vertices_.GetParent(order[i]);
+    parents[i] = parent == VertexStore::kNoParent ? VertexStore::kNoParent
+                                                  : renumbered[parent];
+  }
+
+  // Rebuild the tree, which also recomputes costs, goal vertices and the
+  // vertex closest to the goal, then index it all at once. Every index has
+  // changed, so the shared tree starts over too
+  BasicRRTPath::vertices_.Reset();
+  BasicRRTPath::costs_.clear();
+  BasicRRTPath::edge_checked_.clear();
+  BasicRRTPath::goal_vertices_.clear();
+  BasicRRTPath::removed_vertices_ = 0;
+  BasicRRTPath::shared_tree_size_ = 0;
+  for (size_t i = 0; i < order.size(); i++)
+    BasicRRTPath::StoreVertex(locations[i], parents[i]);
+  BasicRRTPath::RebuildKdTree();
+  BasicRRTPath::edge_checked_.swap(checked);
+  BasicRRTPath::best_goal_vertex_ = kNoVertex;
+  BasicRRTPath::UpdateBestGoalVertex();
+  if (BasicRRTPath::best_goal_vertex_ != kNoVertex)
+    BasicRRTPath::overall_path_ =
+        CalculatePath(BasicRRTPath::best_goal_vertex_);
+  else
+    BasicRRTPath::overall_path_.clear();
+  return dropped;
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::ValidatePath(uint32_t vertex) {
+  // Check the whole path before pruning, so one pass finds every bad edge
+  std::vector<uint32_t> cut;
+  uint32_t child = vertex;
+  while (BasicRRTPath::vertices_.GetParent(child) != VertexStore::kNoParent) {
+    uint32_t parent = BasicRRTPath::vertices_.GetParent(child);
+    if (!BasicRRTPath::edge_checked_[child]) {
+      RRT_STATS_ADD(BasicRRTPath::stats_.deferred_edge_checks, 1);
+      if (BasicRRTPath::IsSafe(BasicRRTPath::vertices_.GetLocation(parent),
+                               BasicRRTPath::vertices_.GetLocation(child))) {
+        BasicRRTPath::edge_checked_[child] = 1;
+      } else {
+        BasicRRTPath::vertices_.SetParent(child, VertexStore::kNoParent);
+        cut.push_back(child);
+      }
+    }
+    child = parent;
+  }
+  if (cut.empty())
+    return true;
+
+  // Remove what was cut off where it is, which leaves every other index and
+  // the rest of the k-d tree alone
+  for (uint32_t top : cut) {
+    size_t removed = BasicRRTPath::RemoveSubtree(top);
+    RRT_STATS_ADD(BasicRRTPath::stats_.pruned_vertices, removed);
+    static_cast<void>(removed);
+  }
+  if (BasicRRTPath::removed_vertices_ * 2 >= BasicRRTPath::vertices_.Size()) {
+    BasicRRTPath::CompactTree();
+    return false;
+  }
+
+  // Forget the goal vertices that went with it
+  size_t kept = 0;
+  for (uint32_t goal : BasicRRTPath::goal_vertices_) {
+    if (!BasicRRTPath::vertices_.IsRemoved(goal))
+      BasicRRTPath::goal_vertices_[kept++] = goal;
+  }
+  BasicRRTPath::goal_vertices_.resize(kept);
+  if (BasicRRTPath::best_goal_vertex_ != kNoVertex &&
+      BasicRRTPath::vertices_.IsRemoved(BasicRRTPath::best_goal_vertex_)) {
+    BasicRRTPath::best_goal_vertex_ = kNoVertex;
+    BasicRRTPath::UpdateBestGoalVertex();
+    if (BasicRRTPath::best_goal_vertex_ != kNoVertex)
+      BasicRRTPath::overall_path_ =
+          CalculatePath(BasicRRTPath::best_goal_vertex_);
+    else
+      BasicRRTPath::overall_path_.clear();
+  }
+
+  // The vertex closest to the goal is now the nearest one that is left
+  if (BasicRRTPath::vertices_.IsRemoved(BasicRRTPath::closest_to_goal_)) {
+    BasicRRTPath::closest_to_goal_ =
+        BasicRRTPath::GetClosestPoint(BasicRRTPath::goal_location_);
+    BasicRRTPath::closest_distance_squared_ = SquaredDistance<D, T>(
+        BasicRRTPath::vertices_.GetLocation(BasicRRTPath::closest_to_goal_),
+        BasicRRTPath::goal_location_);
+  }
+  return false;
+}
+
+template <int D, typename T>
+size_t BasicRRTPath<D, T>::RemoveSubtree(uint32_t top) {
+  // Gather the whole subtree before removing any of it, as removing a
+  // vertex forgets its children
+  std::vector<uint32_t> subtree;
+  BasicRRTPath::subtree_stack_.assign(1, top);
+  while (!BasicRRTPath::subtree_stack_.empty()) {
+    uint32_t vertex = BasicRRTPath::subtree_stack_.back();
+    BasicRRTPath::subtree_stack_.pop_back();
+    subtree.push_back(vertex);
+    for (uint32_t child = BasicRRTPath::vertices_.GetFirstChild(vertex);
+         child != VertexStore::kNoChild;
+         child = BasicRRTPath::vertices_.GetNextSibling(child))
+      BasicRRTPath::subtree_stack_.push_back(child);
+  }
+  for (uint32_t vertex : subtree) {
+    BasicRRTPath::kd_tree_.Remove(BasicRRTPath::vertices_.GetLocation(vertex),
+                                  vertex);
+    if (vertex < BasicRRTPath::shared_tree_size_)
+      BasicRRTPath::shared_tree_->Remove(vertex);
+    BasicRRTPath::vertices_.Remove(vertex);
+  }
+  BasicRRTPath::removed_vertices_ += subtree.size();
+  return subtree.size();
+}
+
+template <int D, typename T>
+std::list<typename BasicRRTPath<D, T>::Location>
+BasicRRTPath<D, T>::FindPath() {
+  // Without limits the search only ends on success or when stopped
+  if (BasicRRTPath::FindPath(PlanningBudget()).status != kSuccess)
+    BasicRRTPath::overall_path_.clear();
+  return BasicRRTPath::overall_path_;
+}
+
+template <int D, typename T>
+BasicPlanningResult<D, T> BasicRRTPath<D, T>::FindPath(int max_iterations) {
+  PlanningBudget budget;
+  budget.max_iterations = max_iterations;
+  return BasicRRTPath::FindPath(budget);
+}
+
+template <int D, typename T>
+BasicPlanningResult<D, T> BasicRRTPath<D, T>::FindPath(
+    std::chrono::steady_clock::time_point deadline) {
+  PlanningBudget budget;
+  budget.deadline = deadline;
+  return BasicRRTPath::FindPath(budget);
+}
+
+template <int D, typename T>
+BasicPlanningResult<D, T> BasicRRTPath<D, T>::FindPath(
+    const PlanningBudget& budget) {
+  PlanningResult result;
+  uint32_t vertex;
+  result.status = BasicRRTPath::Search(budget, &result.iterations, &vertex);
+  if (result.status == kSuccess) {
+    BasicRRTPath::overall_path_ = GetFinalPath(vertex);
+    result.path = BasicRRTPath::overall_path_;
+  } else {
+    result.path = CalculatePath(vertex);
+  }
+  return result;
+}
+
+template <int D, typename T>
+PlanningStatus BasicRRTPath<D, T>::FindPath(const PlanningBudget& budget,
+                                            std::vector<Location>* path) {
+  int iterations;
+  uint32_t vertex;
+  PlanningStatus status = BasicRRTPath::Search(budget, &iterations, &vertex);
+  BasicRRTPath::CalculatePath(vertex, path);
+  if (status == kSuccess && BasicRRTPath::smoother_)
+    BasicRRTPath::smoother_->Smooth(*BasicRRTPath::map_, path);
+  return status;
+}
+
+template <int D, typename T>
+PlanningStatus BasicRRTPath<D, T>::Search(const PlanningBudget& budget,
+                                          int* iterations, uint32_t* vertex) {
+  *iterations = 0;
+  BasicRRTPath::stats_.Clear();
+
+  // A tree that already reaches the goal needs no more iterations, once
+  // any unchecked edges on the way there have passed
+  while (!BasicRRTPath::goal_vertices_.empty()) {
+    BasicRRTPath::best_goal_vertex_ = kNoVertex;
+    BasicRRTPath::UpdateBestGoalVertex();
+    if (!BasicRRTPath::ValidatePath(BasicRRTPath::best_goal_vertex_))
+      continue;
+    *vertex = BasicRRTPath::best_goal_vertex_;
+    return kSuccess;
+  }
 
-  RRTPath::root_node_ = root_node;
+  PlanningStatus status = BasicRRTPath::expansion_pool_
+      ? BasicRRTPath::ExpandInParallel(budget, iterations, vertex)
+      : BasicRRTPath::Expand(budget, iterations, vertex);
+  RRT_STATS_MAX(BasicRRTPath::stats_.peak_vertex_count,
+                BasicRRTPath::vertices_.Size());
+  if (status == kSuccess)
+    return status;
 
-  RRTPath::vertex_list_.push_back(RRTPath::root_node_);
+  // Out of budget, so hand back the best we could do
+  while (!BasicRRTPath::ValidatePath(BasicRRTPath::closest_to_goal_)) {}
+  *vertex = BasicRRTPath::closest_to_goal_;
+  return status;
 }
 
-std::list<std::pair<int, int>> RRTPath::FindPath() {
-  bool goal_reached = false;
-  while (!goal_reached) {
+template <int D, typename T>
+PlanningStatus BasicRRTPath<D, T>::Expand(const PlanningBudget& budget,
+                                          int* iterations, uint32_t* vertex) {
+  bool has_deadline =
+      budget.deadline != std::chrono::steady_clock::time_point::max();
+  while (true) {
+    // Check every limit before starting another iteration
+    if (BasicRRTPath::IsStopped())
+      return kCancelled;
+    if ((budget.max_iterations > 0 && *iterations >= budget.max_iterations) ||
+        (budget.max_vertices > 0 &&
+         BasicRRTPath::vertices_.Size() - BasicRRTPath::removed_vertices_ >=
+             budget.max_vertices))
+      return kExhausted;
+    if (has_deadline &&
+        std::chrono::steady_clock::now() >= budget.deadline)
+      return kTimeout;
+    (*iterations)++;
+    BasicRRTPath::iterations_++;
+    RRT_STATS_ADD(BasicRRTPath::stats_.iterations, 1);
+
     // First we get a random point within the map
-    std::pair<int, int> random_point = RRTPath::GetRandomPoint();
+    Location random_point = BasicRRTPath::GetRandomPoint();
 
     // Next we find the closest vertex to that random point
-    Vertex *closest_vertex = RRTPath::GetClosestPoint(random_point);
+    uint32_t closest_vertex = BasicRRTPath::GetClosestPoint(random_point);
 
     // Then we try to make a move towards that point
-    if (RRTPath::MoveTowardsPoint(closest_vertex, random_point)) {
-      // Check if we've reached our goal
-      Vertex *new_vertex = RRTPath::vertex_list_.front();
-      goal_reached = RRTPath::ReachedGoal(new_vertex->get_location());
+    if (BasicRRTPath::MoveTowardsPoint(closest_vertex, random_point)) {
+      RRT_STATS_ADD(BasicRRTPath::stats_.accepted_expansions, 1);
+      // Check if the vertex we just added reached our goal
+      uint32_t new_vertex = static_cast<uint32_t>(vertices_.Size() - 1);
+      // In lazy mode a path with a bad edge is pruned and the search goes on
+      if (BasicRRTPath::ReachedGoal(vertices_.GetLocation(new_vertex)) &&
+          BasicRRTPath::ValidatePath(new_vertex)) {
+        *vertex = new_vertex;
+        return kSuccess;
+      }
+    } else {
+      RRT_STATS_ADD(BasicRRTPath::stats_.rejected_expansions, 1);
     }
   }
-
-  //  Rebuild our path and return
-  RRTPath::overall_path_ = CalculatePath(RRTPath::vertex_list_.front());
-  return RRTPath::overall_path_;
 }
 
-std::pair<int, int> RRTPath::GetRandomPoint() {
-  std::pair<int, int> random_point;
+template <int D, typename T>
+PlanningStatus BasicRRTPath<D, T>::ExpandInParallel(
+    const PlanningBudget& budget, int* iterations, uint32_t* vertex) {
+  if (!BasicRRTPath::shared_tree_)
+    BasicRRTPath::shared_tree_.reset(new ConcurrentVertexStore());
+  ConcurrentVertexStore &shared = *BasicRRTPath::shared_tree_;
+
+  // Every worker draws its own points, from its own seed and strategy
+  for (ExpansionWorker &worker : BasicRRTPath::expansion_workers_) {
+    worker.sampler.Seed(BasicRRTPath::sampler_.Next());
+    worker.strategy.reset(BasicRRTPath::sampling_strategy_->Clone());
+    worker.strategy->Reset();
+    worker.next_sample = kSampleBatchSize;
+  }
+
+  while (true) {
+    // The shared tree keeps our indices, so it only needs the vertices we
+    // added since it was last used, unless ours has been renumbered. It
+    // never follows their parents, so those can be left out
+    if (BasicRRTPath::shared_tree_size_ == 0)
+      shared.Reset(BasicRRTPath::map_->GetSize(), BasicRRTPath::epsilon_);
+    for (uint32_t i = static_cast<uint32_t>(BasicRRTPath::shared_tree_size_);
+         i < BasicRRTPath::vertices_.Size(); i++) {
+      shared.Add(BasicRRTPath::vertices_.GetLocation(i),
+                 ConcurrentVertexStore::kNoVertex);
+      if (BasicRRTPath::vertices_.IsRemoved(i))
+        shared.Remove(i);
+    }
 
-  // Get the size of the map so we know our bounds
-  std::pair<int, int> map_size = RRTPath::map_.GetSize();
+    ExpansionRound round;
+    round.budget = &budget;
+    round.iterations = *iterations;
+    round.goal_vertex = ConcurrentVertexStore::kNoVertex;
+    round.status = kNoStatus;
+    for (size_t i = 0; i < BasicRRTPath::expansion_workers_.size(); i++) {
+      BasicRRTPath::expansion_workers_[i].iterations = 0;
+      BasicRRTPath::expansion_workers_[i].stats.Clear();
+      BasicRRTPath::expansion_pool_->Submit([this, i, &round]() {
+        BasicRRTPath::RunExpansionWorker(i, &round);
+      });
+    }
+    BasicRRTPath::expansion_pool_->Wait();
 
-  // Get a random point within the bounds of our map
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_int_distribution<> x_random(0, map_size.first);
-  std::uniform_int_distribution<> y_random(0, map_size.second);
+    // Parents have smaller indices than their children, so copying in index
+    // order grows the tree, along with its costs and goal vertices. The k-d
+    // tree is then rebuilt once rather than taking one insert per vertex
+    size_t merged = BasicRRTPath::vertices_.Size();
+    for (uint32_t i = static_cast<uint32_t>(merged); i < shared.Size(); i++) {
+      BasicRRTPath::StoreVertex(shared.GetLocation(i), shared.GetParent(i));
+      if (BasicRRTPath::lazy_collision_checking_)
+        BasicRRTPath::edge_checked_.back() = 0;
+    }
+    if (BasicRRTPath::vertices_.Size() > merged)
+      BasicRRTPath::RebuildKdTree();
+    BasicRRTPath::shared_tree_size_ = BasicRRTPath::vertices_.Size();
+    for (ExpansionWorker &worker : BasicRRTPath::expansion_workers_) {
+      *iterations += worker.iterations;
+      BasicRRTPath::iterations_ += worker.iterations;
+      BasicRRTPath::stats_.Merge(worker.stats);
+    }
 
-  // Generate the random point
-  random_point.first = x_random(gen);
-  random_point.second = y_random(gen);
+    // A goal may be reached just as another worker runs out of budget
+    uint32_t goal = round.goal_vertex.load();
+    if (goal == ConcurrentVertexStore::kNoVertex)
+      return static_cast<PlanningStatus>(round.status.load());
+    if (BasicRRTPath::ValidatePath(goal)) {
+      *vertex = goal;
+      return kSuccess;
+    }
+  }
+}
 
-  // Return the random point
-  return random_point;
+template <int D, typename T>
+void BasicRRTPath<D, T>::EndRound(ExpansionRound* round,
+                                  PlanningStatus status) {
+  int running = kNoStatus;
+  round->status.compare_exchange_strong(running, status);
 }
 
-Vertex* RRTPath::GetClosestPoint(std::pair<int, int> random_point) {
-  // Set our closest vertex to our root, since we know it exists
-  Vertex* closest = RRTPath::root_node_;
+template <int D, typename T>
+void BasicRRTPath<D, T>::RunExpansionWorker(size_t index,
+                                            ExpansionRound* round) {
+  ExpansionWorker &worker = BasicRRTPath::expansion_workers_[index];
+  ConcurrentVertexStore &shared = *BasicRRTPath::shared_tree_;
+  const PlanningBudget &budget = *round->budget;
+  bool has_deadline =
+      budget.deadline != std::chrono::steady_clock::time_point::max();
+  Location map_size = BasicRRTPath::map_->GetSize();
+  PlannerStats *stats = &worker.stats;
 
-  // closest distance will keep track of the closest distance we find
-  float closest_distance = INFINITY;
-  // current distance will keep track of the distance of our current vertex
-  float current_distance = INFINITY;
+  // Relaxed is enough, the status only asks the workers to stop
+  while (round->status.load(std::memory_order_relaxed) == kNoStatus) {
+    if (BasicRRTPath::IsStopped()) {
+      BasicRRTPath::EndRound(round, kCancelled);
+      break;
+    }
+    if ((budget.max_iterations > 0 &&
+         round->iterations.fetch_add(1, std::memory_order_relaxed) >=
+             budget.max_iterations) ||
+        (budget.max_vertices > 0 &&
+         shared.Size() - BasicRRTPath::removed_vertices_ >=
+             budget.max_vertices)) {
+      BasicRRTPath::EndRound(round, kExhausted);
+      break;
+    }
+    if (has_deadline &&
+        std::chrono::steady_clock::now() >= budget.deadline) {
+      BasicRRTPath::EndRound(round, kTimeout);
+      break;
+    }
+    worker.iterations++;
+    RRT_STATS_ADD(stats->iterations, 1);
 
-  // iterate through our vertex list to find the closest
-  std::list<Vertex*>::iterator it;
-  for (it = RRTPath::vertex_list_.begin(); it != RRTPath::vertex_list_.end();
-      ++it) {
-    // get the distance between our current vertex (it) and the random point
-    current_distance = RRTPath::GetDistance((*it)->get_location(),
-                                             random_point);
-    // if the current distance is closer than what we have saved as closest
-    // save the current node and update the closest distance
-    if (current_distance < closest_distance) {
-      closest = *it;
-      closest_distance = current_distance;
+    Location random_point;
+    {
+      RRT_STATS_TIMER(stats->get_random_point_ns);
+      if (worker.next_sample == kSampleBatchSize) {
+        worker.strategy->FillPoints(&worker.sampler, worker.samples.data(),
+                                    kSampleBatchSize, map_size,
+                                    BasicRRTPath::goal_location_);
+        worker.next_sample = 0;
+      }
+      random_point = worker.samples[worker.next_sample++];
+    }
+    uint32_t closest_vertex;
+    {
+      RRT_STATS_TIMER(stats->get_closest_point_ns);
+      closest_vertex = shared.Nearest(random_point);
     }
+
+    // Check the step as MoveTowardsPoint does, then publish it
+    Location closest_point = shared.GetLocation(closest_vertex);
+    Location new_point = BasicRRTPath::StepTowards(closest_point,
+                                                   random_point);
+    bool safe = new_point != closest_point &&
+        (BasicRRTPath::lazy_collision_checking_
+             ? BasicRRTPath::IsPointFree(new_point, stats)
+             : BasicRRTPath::IsSafe(closest_point, new_point, stats));
+    if (!safe) {
+      RRT_STATS_ADD(stats->rejected_expansions, 1);
+      continue;
+    }
+    uint32_t new_vertex = shared.Add(new_point, closest_vertex);
+    if (new_vertex == ConcurrentVertexStore::kNoVertex) {
+      BasicRRTPath::EndRound(round, kExhausted);
+      break;
+    }
+    RRT_STATS_ADD(stats->accepted_expansions, 1);
+    if (BasicRRTPath::ReachedGoal(new_point)) {
+      uint32_t none = ConcurrentVertexStore::kNoVertex;
+      round->goal_vertex.compare_exchange_strong(none, new_vertex);
+      BasicRRTPath::EndRound(round, kSuccess);
+      break;
+    }
+  }
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Location BasicRRTPath<D, T>::GetRandomPoint() {
+  RRT_STATS_TIMER(BasicRRTPath::stats_.get_random_point_ns);
+  // Generate a new batch of points when we've used up the last one
+  if (BasicRRTPath::next_sample_ == kSampleBatchSize) {
+    // Get the size of the map so we know our bounds
+    Location map_size = BasicRRTPath::map_->GetSize();
+
+    // Fill the buffer with random points within the bounds of our map
+    BasicRRTPath::sampling_strategy_->FillPoints(
+        &sampler_, BasicRRTPath::sample_buffer_.data(), kSampleBatchSize,
+        map_size, BasicRRTPath::goal_location_);
+    BasicRRTPath::next_sample_ = 0;
   }
 
-  return closest;
+  // Return the next random point
+  return BasicRRTPath::sample_buffer_[BasicRRTPath::next_sample_++];
 }
 
-float RRTPath::GetDistance(std::pair<int, int> start_point,
-                            std::pair<int, int> end_point) {
-  // x,y coords for our starting point
-  int x1 = start_point.first;
-  int y1 = start_point.second;
+template <int D, typename T>
+uint32_t BasicRRTPath<D, T>::GetClosestPoint(Location random_point) {
+  RRT_STATS_TIMER(BasicRRTPath::stats_.get_closest_point_ns);
+  if (BasicRRTPath::nearest_neighbor_method_ == kKdTree)
+    return BasicRRTPath::kd_tree_.Nearest(random_point);
 
-  // x,y coords for our ending point
-  int x2 = end_point.first;
-  int y2 = end_point.second;
+  // Scan the coordinate arrays of our store with the vectorized kernel. It
+  // compares exact squared distances, like the k-d tree, and on a tie keeps
+  // the most recently added (highest index) vertex
+  const T *coordinates[D];
+  T point[D];
+  for (int axis = 0; axis < D; axis++) {
+    coordinates[axis] = BasicRRTPath::vertices_.Data(axis);
+    point[axis] = GetCoordinate(random_point, axis);
+  }
+  Difference closest_distance;
+  return static_cast<uint32_t>(NearestIndex<D, T>(
+      coordinates, BasicRRTPath::vertices_.Size(), point, &closest_distance));
+}
 
+template <int D, typename T>
+float BasicRRTPath<D, T>::GetDistance(Location start_point,
+                                      Location end_point) {
   // euclidean distance formula
-  float distance = sqrt((x1-x2)*(x1-x2)+(y1-y2)*(y1-y2));
-  return distance;
+  return static_cast<float>(Distance<D, T>(start_point, end_point));
 }
 
-bool RRTPath::MoveTowardsPoint(Vertex* closest_vertex,
-                                 std::pair<int, int> random_point) {
+template <int D, typename T>
+bool BasicRRTPath<D, T>::MoveTowardsPoint(uint32_t closest_vertex,
+                                          Location random_point) {
   // Move epsilon distance from our closest point towards our random point
-  std::pair<int, int> closest_point = closest_vertex->get_location();
-  float theta = atan2(random_point.second-closest_point.second,
-                      random_point.first-closest_point.first);
-  float newX = closest_point.first + RRTPath::epsilon_ * cos(theta);
-  float newY = closest_point.second + RRTPath::epsilon_ * sin(theta);
-  // Cast from float to int, should automatically round down which is what we
-  // want
-  std::pair<int, int> new_point(static_cast<int>(newX), static_cast<int>(newY));
+  Location closest_point =
+      BasicRRTPath::vertices_.GetLocation(closest_vertex);
+  Location new_point = BasicRRTPath::StepTowards(closest_point,
+                                                 random_point);
+
+  // Rounding can leave us where we started, which would only add a copy of
+  // the closest vertex
+  if (new_point == closest_point)
+    return false;
+
+  // In lazy mode only the new point is checked now, the edge later
+  if (BasicRRTPath::lazy_collision_checking_) {
+    if (!BasicRRTPath::IsPointFree(new_point))
+      return false;
+    BasicRRTPath::AddVertex(new_point, closest_vertex);
+    BasicRRTPath::edge_checked_.back() = 0;
+    return true;
+  }
 
   // Check if the new path is safe
-  if (RRTPath::IsSafe(closest_point, new_point)) {
-    Vertex *new_vertex = new Vertex(new_point.first, new_point.second,
-                                   closest_vertex);
-    RRTPath::vertex_list_.push_front(new_vertex);
+  if (BasicRRTPath::IsSafe(closest_point, new_point)) {
+    BasicRRTPath::AddVertex(new_point, closest_vertex);
     return true;
   }
   return false;
 }
 
-bool RRTPath::ReachedGoal(std::pair<int, int> new_vertex) {
+template <int D, typename T>
+typename BasicRRTPath<D, T>::ExtendResult BasicRRTPath<D, T>::ExtendTowards(
+    uint32_t from_vertex, Location target, uint32_t* new_vertex) {
+  Location from_point = BasicRRTPath::vertices_.GetLocation(from_vertex);
+  Location new_point = BasicRRTPath::Steer(from_point, target);
+
+  // Rounding can leave us where we started, which would loop forever
+  if (new_point == from_point || !BasicRRTPath::IsSafe(from_point, new_point))
+    return kTrapped;
+  *new_vertex = BasicRRTPath::AddVertex(new_point, from_vertex);
+  return new_point == target ? kReached : kAdvanced;
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Location BasicRRTPath<D, T>::StepTowards(
+    Location from_point, Location target) {
+  double direction[D];
+  UnitDirection<D, T>(from_point, target, direction);
+  Location new_point;
+  for (int axis = 0; axis < D; axis++) {
+    float coordinate = GetCoordinate(from_point, axis) +
+                       BasicRRTPath::epsilon_ * direction[axis];
+    // Cast from float to int, should automatically round down which is what
+    // we want
+    SetCoordinate(&new_point, axis, RoundDown(coordinate, T()));
+  }
+  return new_point;
+}
+
+template <int D, typename T>
+typename BasicRRTPath<D, T>::Location BasicRRTPath<D, T>::Steer(
+    Location from_point, Location target) {
+  // Take a full epsilon step unless the target is closer than that
+  if (BasicRRTPath::GetDistance(from_point, target) <= BasicRRTPath::epsilon_)
+    return target;
+  double direction[D];
+  UnitDirection<D, T>(from_point, target, direction);
+  Location new_point;
+  for (int axis = 0; axis < D; axis++) {
+    SetCoordinate(&new_point, axis,
+                  RoundDown(GetCoordinate(from_point, axis) +
+                            BasicRRTPath::epsilon_ * direction[axis], T()));
+  }
+  return new_point;
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::ReachedGoal(Location new_vertex) {
   // Check to see if our new vertex is within the designated radius of the goal
-  float distance = RRTPath::GetDistance(new_vertex, RRTPath::goal_location_);
-  if (distance <= RRTPath::goal_radius_)
+  float distance = BasicRRTPath::GetDistance(new_vertex,
+                                             BasicRRTPath::goal_location_);
+  if (distance <= BasicRRTPath::goal_radius_)
     return true;
   return false;
 }
 
-std::list<std::pair<int, int> > RRTPath::CalculatePath(Vertex* goal) {
-  // Create an empty list for the path
-  std::list<std::pair<int, int>> path;
+template <int D, typename T>
+std::list<typename BasicRRTPath<D, T>::Location>
+BasicRRTPath<D, T>::GetFinalPath(uint32_t goal) {
+  if (!BasicRRTPath::smoother_)
+    return BasicRRTPath::CalculatePath(goal);
+  return BasicRRTPath::smoother_->Smooth(*BasicRRTPath::map_,
+                                         BasicRRTPath::CalculatePath(goal));
+}
 
-  // Set our current vertex to our end point vertex (goal)
-  Vertex *current = goal;
+template <int D, typename T>
+std::list<typename BasicRRTPath<D, T>::Location>
+BasicRRTPath<D, T>::CalculatePath(uint32_t goal) {
+  RRT_STATS_TIMER(BasicRRTPath::stats_.calculate_path_ns);
+  // Create an empty list for the path
+  std::list<Location> path;
 
-  // So long as our current vertex's parent isn't the nullptr (indicating the
-  // root node) add the location to the beginning of the list, then set the
-  // current vertex to be the parent
-  while (current->get_parent() != nullptr) {
-    path.push_front(current->get_location());
-    current = current->get_parent();
+  // Starting at our end point vertex (goal), add each location to the
+  // beginning of the list and step to its parent, until we step past the
+  // root vertex, whose parent is kNoParent
+  for (uint32_t current = goal; current != VertexStore::kNoParent;
+       current = BasicRRTPath::vertices_.GetParent(current)) {
+    path.push_front(BasicRRTPath::vertices_.GetLocation(current));
   }
-
-  // Add the root node's location to the front of the list
-  path.push_front(root_node_->get_location());
   return path;
 }
 
-bool RRTPath::IsSafe(std::pair<int, int> start_point,
-                      std::pair<int, int> end_point) {
+template <int D, typename T>
+void BasicRRTPath<D, T>::CalculatePath(uint32_t goal,
+                                       std::vector<Location>* path) {
+  RRT_STATS_TIMER(BasicRRTPath::stats_.calculate_path_ns);
+  // Measure the path first, so each waypoint is written once, in place
+  size_t length = 0;
+  for (uint32_t current = goal; current != VertexStore::kNoParent;
+       current = BasicRRTPath::vertices_.GetParent(current))
+    length++;
+  path->resize(length);
+  for (uint32_t current = goal; current != VertexStore::kNoParent;
+       current = BasicRRTPath::vertices_.GetParent(current))
+    (*path)[--length] = BasicRRTPath::vertices_.GetLocation(current);
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::IsPointFree(Location point) {
+  return BasicRRTPath::IsPointFree(point, &stats_);
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::IsPointFree(Location point,
+                                     PlannerStats* stats) const {
+  static_cast<void>(stats);
+  RRT_STATS_TIMER(stats->is_safe_ns);
+  if (!BasicRRTPath::map_->IsOnMap(point))
+    return false;
+  RRT_STATS_ADD(stats->collision_tests, 1);
+  return !BasicRRTPath::map_->IsOccupied(
+      point, RRT_STATS_POINTER(stats->obstacles_examined));
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::IsSafe(Location start_point, Location end_point) {
+  return BasicRRTPath::IsSafe(start_point, end_point, &stats_);
+}
+
+template <int D, typename T>
+bool BasicRRTPath<D, T>::IsSafe(Location start_point,
+                                Location end_point,
+                                PlannerStats* stats) const {
+  static_cast<void>(stats);
+  RRT_STATS_TIMER(stats->is_safe_ns);
   // Check to make sure our endpoint is within bounds of the map
-  if (end_point.first < 0 || end_point.first > RRTPath::map_.GetSize().first ||
-      end_point.second < 0 || end_point.second > RRTPath::map_.GetSize().second)
+  if (!BasicRRTPath::map_->IsOnMap(end_point))
     return false;
 
-  // Check to make sure endpoint isn't inside of an obstacle
-  std::list<Obstacle> obstacles = RRTPath::map_.GetObstacleList();
-  for (Obstacle o : obstacles) {
-    if (RRTPath::GetDistance(end_point, o.GetLocation()) < o.GetSize())
-      return false;
+  // Maps with an exact collision model check the whole edge in closed form
+  if (BasicRRTPath::map_->GetCollisionModel() != kSampledCollision) {
+    RRT_STATS_ADD(stats->collision_tests, 1);
+    return !BasicRRTPath::map_->SegmentCollides(
+        start_point, end_point,
+        RRT_STATS_POINTER(stats->obstacles_examined));
   }
 
+  // Check to make sure endpoint isn't inside of an obstacle. The map only
+  // tests the obstacles registered near the point
+  RRT_STATS_ADD(stats->collision_tests, 1);
+  if (BasicRRTPath::map_->IsOccupied(
+          end_point, RRT_STATS_POINTER(stats->obstacles_examined)))
+    return false;
+
   // Check the path at intervals for a total distance of epsilon for collisions
-  float theta = atan2(end_point.second - start_point.second,
-                      end_point.first - start_point.first);
-  float current_x = start_point.first;
-  float current_y = start_point.second;
-  float step = static_cast<float>(epsilon_)/10;
+  double direction[D];
+  UnitDirection<D, T>(start_point, end_point, direction);
+  float current[D];
+  for (int axis = 0; axis < D; axis++)
+    current[axis] = GetCoordinate(start_point, axis);
+  float step = static_cast<float>(BasicRRTPath::epsilon_) / 10;
   // Move towards our next increment
   for (int i = 0; i < 10; i++) {
-    current_x += step*cos(theta);
-    current_y += step*sin(theta);
-    // Check the next step for obstacles
-
-    for (Obstacle o : obstacles) {
-      if (RRTPath::GetDistance(std::pair<int, int>(static_cast<int>(current_x),
-                                                  static_cast<int>(current_y)),
-                                o.GetLocation()) < o.GetSize())
-        return false;
+    Location point;
+    for (int axis = 0; axis < D; axis++) {
+      current[axis] += step * direction[axis];
+      SetCoordinate(&point, axis, RoundDown(current[axis], T()));
     }
+    // Check the next step for obstacles
+    RRT_STATS_ADD(stats->collision_tests, 1);
+    if (BasicRRTPath::map_->IsOccupied(
+            point, RRT_STATS_POINTER(stats->obstacles_examined)))
+      return false;
   }
 
   return true;
 }
+
+RRT_INSTANTIATE_POINT_TYPES(BasicRRTPath);
@@ -0,0 +1,101 @@
+/**
+ * @file Sampler.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Fast seedable random number generator for RRTPath
+ *
+ * @section DESCRIPTION
+ * The Sampler class generates the random points RRTPath grows its tree
+ * towards using the xoshiro256** generator. The seed is expanded into the
+ * generator state with splitmix64, as recommended by the xoshiro authors.
+ */
+
+#include "../include/sampler.h"
+#include <stdint.h>
+#include <random>   // needed for random_device
+#include <utility>  // needed for pair
+
+namespace {
+
+/**
+ * @brief one step of the splitmix64 generator, used to expand seeds
+ */
+uint64_t SplitMix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t RotateLeft(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+}  // namespace
+
+Sampler::Sampler() {
+  Sampler::SeedFromDevice();
+}
+
+Sampler::Sampler(uint64_t seed) {
+  Sampler::Seed(seed);
+}
+
+void Sampler::Seed(uint64_t seed) {
+  // splitmix64 never produces an all zero state, which xoshiro can't leave
+  for (int i = 0; i < 4; i++)
+    Sampler::state_[i] = SplitMix64(&seed);
+}
+
+void Sampler::SeedFromDevice() {
+  // This is the only place we touch the random device, so it costs one
+  // system call per planner rather than one per sample
+  std::random_device rd;
+  uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+  Sampler::Seed(seed);
+}
+
+uint64_t Sampler::Next() {
+  uint64_t *s = Sampler::state_;
+  uint64_t result = RotateLeft(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = RotateLeft(s[3], 45);
+  return result;
+}
+
+uint32_t Sampler::NextBounded(uint32_t range) {
+  // Lemire's multiply and shift method, rejecting the few values that would
+  // make some results more likely than others
+  uint64_t product = (Sampler::Next() >> 32) * range;
+  uint32_t low = static_cast<uint32_t>(product);
+  if (low < range) {
+    uint32_t threshold = static_cast<uint32_t>(-range) % range;
+    while (low < threshold) {
+      product = (Sampler::Next() >> 32) * range;
+      low = static_cast<uint32_t>(product);
+    }
+  }
+  return static_cast<uint32_t>(product >> 32);
+}
+
+double Sampler::NextDouble() {
+  // The top 53 bits fill the mantissa of a double exactly
+  return (Sampler::Next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void Sampler::FillPoints(std::pair<int, int>* points, size_t count,
+                         int max_x, int max_y) {
+  // The bounds are inclusive, like the bounds of a Map
+  uint32_t x_range = static_cast<uint32_t>(max_x) + 1;
+  uint32_t y_range = static_cast<uint32_t>(max_y) + 1;
+  for (size_t i = 0; i < count; i++) {
+    points[i].first = static_cast<int>(Sampler::NextBounded(x_range));
+    points[i].second = static_cast<int>(Sampler::NextBounded(y_range));
+  }
+}
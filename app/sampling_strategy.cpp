@@ -0,0 +1,266 @@
+/**
+ * @file SamplingStrategy.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Ways of choosing the random points an RRT grows towards
+ *
+ * @section DESCRIPTION
+ * Uniform, goal-biased, Halton and Sobol sampling strategies for RRTPath.
+ */
+
+#include "../include/sampling_strategy.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>    // needed for min
+#include <cmath>        // needed for floor
+#include <type_traits>  // needed for is_integral
+#include <utility>      // needed for pair
+
+namespace {
+
+/**
+ * @brief maps a number in [0, 1) to a coordinate in [0, max]
+ */
+int ToCoordinate(double u, int max) {
+  int coordinate = static_cast<int>(u * (static_cast<double>(max) + 1));
+  return std::min(coordinate, max);
+}
+
+/**
+ * @brief maps a number in [0, 1) to a coordinate in [0, max)
+ */
+float ToCoordinate(double u, float max) {
+  return static_cast<float>(u * max);
+}
+
+/**
+ * @brief draws one uniform coordinate in [0, max], inclusive like the
+ * bounds of a Map
+ */
+int NextCoordinate(Sampler* sampler, int max) {
+  return static_cast<int>(sampler->NextBounded(static_cast<uint32_t>(max) +
+                                               1));
+}
+
+/**
+ * @brief draws one uniform coordinate in [0, max)
+ */
+float NextCoordinate(Sampler* sampler, float max) {
+  return static_cast<float>(sampler->NextDouble() * max);
+}
+
+/**
+ * @brief fills a buffer with uniform points on the map, drawing their
+ * coordinates in order
+ */
+template <int D, typename T, typename Location>
+void FillUniform(Sampler* sampler, Location* points, size_t count,
+                 const Location& map_size) {
+  for (size_t i = 0; i < count; i++) {
+    for (int axis = 0; axis < D; axis++) {
+      SetCoordinate(&points[i], axis,
+                    NextCoordinate(sampler, GetCoordinate(map_size, axis)));
+    }
+  }
+}
+
+/**
+ * @brief adds a shift to a number in [0, 1), wrapping around at 1
+ */
+double Rotate(double u, double shift) {
+  u += shift;
+  return u >= 1 ? u - 1 : u;
+}
+
+/**
+ * @brief the radical inverse of index in the given base, in [0, 1)
+ */
+double RadicalInverse(uint32_t index, uint32_t base) {
+  double inverse = 0;
+  double digit_value = 1.0 / base;
+  while (index > 0) {
+    inverse += (index % base) * digit_value;
+    index /= base;
+    digit_value /= base;
+  }
+  return inverse;
+}
+
+/**
+ * @brief the Halton base of each axis
+ */
+const uint32_t kHaltonBases[] = {2, 3, 5, 7, 11, 13, 17, 19};
+
+/**
+ * @brief the direction numbers of the second to fourth Sobol dimensions
+ * @details From the primitive polynomials x + 1, x^2 + x + 1 and
+ * x^3 + x + 1 with the initial numbers of Joe and Kuo. For x + 1 this is
+ * m_k = 2 * m_(k-1) xor m_(k-1) with m_1 = 1. The first dimension needs no
+ * table, it is the bits of the index reversed.
+ */
+struct SobolDirections {
+  uint32_t v[3][32];
+  SobolDirections() {
+    const int degree[3] = {1, 2, 3};
+    const uint32_t coefficients[3] = {0, 1, 1};
+    const uint32_t initial[3][3] = {{1}, {1, 3}, {1, 3, 1}};
+    for (int d = 0; d < 3; d++) {
+      int s = degree[d];
+      for (int k = 0; k < 32; k++) {
+        if (k < s) {
+          v[d][k] = initial[d][k] << (31 - k);
+          continue;
+        }
+        v[d][k] = v[d][k - s] ^ (v[d][k - s] >> s);
+        for (int j = 1; j < s; j++) {
+          if ((coefficients[d] >> (s - 1 - j)) & 1)
+            v[d][k] ^= v[d][k - j];
+        }
+      }
+    }
+  }
+};
+
+const SobolDirections kSobolDirections;
+
+}  // namespace
+
+template <int D, typename T>
+BasicSamplingStrategy<D, T>* BasicUniformSampling<D, T>::Clone() const {
+  return new BasicUniformSampling(*this);
+}
+
+template <int D, typename T>
+void BasicUniformSampling<D, T>::FillPoints(Sampler* sampler,
+                                            Location* points, size_t count,
+                                            Location map_size,
+                                            Location /* goal */) {
+  FillUniform<D, T>(sampler, points, count, map_size);
+}
+
+template <int D, typename T>
+BasicGoalBiasedSampling<D, T>::BasicGoalBiasedSampling(
+    double goal_probability) {
+  BasicGoalBiasedSampling::goal_probability_ = goal_probability;
+}
+
+template <int D, typename T>
+BasicSamplingStrategy<D, T>* BasicGoalBiasedSampling<D, T>::Clone() const {
+  return new BasicGoalBiasedSampling(*this);
+}
+
+template <int D, typename T>
+void BasicGoalBiasedSampling<D, T>::FillPoints(Sampler* sampler,
+                                               Location* points,
+                                               size_t count,
+                                               Location map_size,
+                                               Location goal) {
+  // Fill the whole batch uniformly, then swap the goal in for some points
+  FillUniform<D, T>(sampler, points, count, map_size);
+  for (size_t i = 0; i < count; i++) {
+    if (sampler->NextDouble() < BasicGoalBiasedSampling::goal_probability_)
+      points[i] = goal;
+  }
+}
+
+template <int D, typename T>
+BasicHaltonSampling<D, T>::BasicHaltonSampling(bool randomized) {
+  static_assert(D <= 8, "Halton bases are only kept for up to eight "
+                "dimensions");
+  BasicHaltonSampling::randomized_ = randomized;
+  for (int axis = 0; axis < D; axis++)
+    BasicHaltonSampling::shift_[axis] = 0;
+  BasicHaltonSampling::Reset();
+}
+
+template <int D, typename T>
+BasicSamplingStrategy<D, T>* BasicHaltonSampling<D, T>::Clone() const {
+  return new BasicHaltonSampling(*this);
+}
+
+template <int D, typename T>
+void BasicHaltonSampling<D, T>::Reset() {
+  // Index 0 is the origin, which is skipped
+  BasicHaltonSampling::index_ = 1;
+  BasicHaltonSampling::shifted_ = false;
+}
+
+template <int D, typename T>
+void BasicHaltonSampling<D, T>::FillPoints(Sampler* sampler,
+                                           Location* points, size_t count,
+                                           Location map_size,
+                                           Location /* goal */) {
+  if (BasicHaltonSampling::randomized_ && !BasicHaltonSampling::shifted_) {
+    for (int axis = 0; axis < D; axis++)
+      BasicHaltonSampling::shift_[axis] = sampler->NextDouble();
+    BasicHaltonSampling::shifted_ = true;
+  }
+  for (size_t i = 0; i < count; i++, BasicHaltonSampling::index_++) {
+    for (int axis = 0; axis < D; axis++) {
+      double u = Rotate(RadicalInverse(BasicHaltonSampling::index_,
+                                       kHaltonBases[axis]),
+                        BasicHaltonSampling::shift_[axis]);
+      SetCoordinate(&points[i], axis,
+                    ToCoordinate(u, GetCoordinate(map_size, axis)));
+    }
+  }
+}
+
+template <int D, typename T>
+BasicSobolSampling<D, T>::BasicSobolSampling(bool randomized) {
+  BasicSobolSampling::randomized_ = randomized;
+  for (int axis = 0; axis < D; axis++)
+    BasicSobolSampling::shift_[axis] = 0;
+  BasicSobolSampling::Reset();
+}
+
+template <int D, typename T>
+BasicSamplingStrategy<D, T>* BasicSobolSampling<D, T>::Clone() const {
+  return new BasicSobolSampling(*this);
+}
+
+template <int D, typename T>
+void BasicSobolSampling<D, T>::Reset() {
+  // The sequence starts at the origin, which is skipped
+  BasicSobolSampling::index_ = 0;
+  for (int axis = 0; axis < D; axis++)
+    BasicSobolSampling::point_[axis] = 0;
+  BasicSobolSampling::shifted_ = false;
+}
+
+template <int D, typename T>
+void BasicSobolSampling<D, T>::FillPoints(Sampler* sampler,
+                                          Location* points, size_t count,
+                                          Location map_size,
+                                          Location /* goal */) {
+  if (BasicSobolSampling::randomized_ && !BasicSobolSampling::shifted_) {
+    for (int axis = 0; axis < D; axis++)
+      BasicSobolSampling::shift_[axis] = sampler->NextDouble();
+    BasicSobolSampling::shifted_ = true;
+  }
+  for (size_t i = 0; i < count; i++) {
+    // Gray code order: each point differs from the last by the direction
+    // number of the lowest zero bit of the index
+    int bit = 0;
+    while (bit < 31 && ((BasicSobolSampling::index_ >> bit) & 1))
+      bit++;
+    BasicSobolSampling::index_++;
+    BasicSobolSampling::point_[0] ^= 1u << (31 - bit);
+    for (int axis = 1; axis < D; axis++)
+      BasicSobolSampling::point_[axis] ^= kSobolDirections.v[axis - 1][bit];
+
+    for (int axis = 0; axis < D; axis++) {
+      double u = Rotate(BasicSobolSampling::point_[axis] / 4294967296.0,
+                        BasicSobolSampling::shift_[axis]);
+      SetCoordinate(&points[i], axis,
+                    ToCoordinate(u, GetCoordinate(map_size, axis)));
+    }
+  }
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicSamplingStrategy);
+RRT_INSTANTIATE_POINT_TYPES(BasicUniformSampling);
+RRT_INSTANTIATE_POINT_TYPES(BasicGoalBiasedSampling);
+RRT_INSTANTIATE_POINT_TYPES(BasicHaltonSampling);
+RRT_INSTANTIATE_POINT_TYPES(BasicSobolSampling);
@@ -0,0 +1,81 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Fixed size pool of worker threads
+ *
+ * @section DESCRIPTION
+ * The ThreadPool class runs submitted tasks on a fixed set of worker threads
+ * that share one queue.
+ */
+
+#include "../include/thread_pool.h"
+#include <functional>  // needed for function
+#include <mutex>       // needed for mutex and unique_lock
+#include <thread>      // needed for thread
+#include <utility>     // needed for move
+
+ThreadPool::ThreadPool(size_t thread_count) {
+  ThreadPool::active_ = 0;
+  ThreadPool::stopping_ = false;
+  if (thread_count == 0)
+    thread_count = std::thread::hardware_concurrency();
+  // hardware_concurrency may not know, in which case it returns 0
+  if (thread_count == 0)
+    thread_count = 1;
+  for (size_t i = 0; i < thread_count; i++)
+    ThreadPool::workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(ThreadPool::mutex_);
+    ThreadPool::stopping_ = true;
+  }
+  ThreadPool::task_ready_.notify_all();
+  for (size_t i = 0; i < ThreadPool::workers_.size(); i++)
+    ThreadPool::workers_[i].join();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(ThreadPool::mutex_);
+    ThreadPool::tasks_.push(std::move(task));
+  }
+  ThreadPool::task_ready_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(ThreadPool::mutex_);
+  while (!ThreadPool::tasks_.empty() || ThreadPool::active_ > 0)
+    ThreadPool::all_done_.wait(lock);
+}
+
+size_t ThreadPool::GetThreadCount() const {
+  return ThreadPool::workers_.size();
+}
+
+void ThreadPool::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(ThreadPool::mutex_);
+  while (true) {
+    // Sleep until there is work, leaving only once the queue is drained
+    while (ThreadPool::tasks_.empty() && !ThreadPool::stopping_)
+      ThreadPool::task_ready_.wait(lock);
+    if (ThreadPool::tasks_.empty())
+      return;
+
+    std::function<void()> task = std::move(ThreadPool::tasks_.front());
+    ThreadPool::tasks_.pop();
+    ThreadPool::active_++;
+
+    // Run the task without holding the lock
+    lock.unlock();
+    task();
+    lock.lock();
+
+    ThreadPool::active_--;
+    if (ThreadPool::tasks_.empty() && ThreadPool::active_ == 0)
+      ThreadPool::all_done_.notify_all();
+  }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file TreeFile.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Saving and reloading the exploration tree of an RRTPath
+ *
+ * @section DESCRIPTION
+ * Implementation of TreeFile. Trees are written with std::ofstream, read
+ * back whole with std::ifstream and checked before the planner is touched.
+ */
+
+#include "../include/tree_file.h"
+#include <stdint.h>
+#include <cstring>
+#include <fstream>    // needed for ifstream and ofstream
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = {'R', 'R', 'T', 'T', 'R', 'E', 'E', '\n'};
+
+/**
+ * @brief written as a uint32, reads back differently on the other byte order
+ */
+const uint32_t kByteOrder = 0x01020304;
+
+}  // namespace
+
+const uint32_t TreeFile::kVersion;
+
+bool TreeFile::Save(const RRTPath& planner, const std::string& path) {
+  // Walk the tree breadth first so parents are written before children
+  const VertexStore &vertices = planner.vertices_;
+  std::vector<uint32_t> order(1, RRTPath::kRootIndex);
+  for (size_t i = 0; i < order.size(); i++) {
+    for (uint32_t child = vertices.GetFirstChild(order[i]);
+         child != VertexStore::kNoChild;
+         child = vertices.GetNextSibling(child))
+      order.push_back(child);
+  }
+  std::vector<uint32_t> renumbered(vertices.Size(), RRTPath::kNoVertex);
+  std::vector<Record> records(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    renumbered[order[i]] = static_cast<uint32_t>(i);
+    uint32_t parent = vertices.GetParent(order[i]);
+    records[i].x = vertices.GetX(order[i]);
+    records[i].y = vertices.GetY(order[i]);
+    records[i].parent = parent == VertexStore::kNoParent
+                            ? VertexStore::kNoParent : renumbered[parent];
+  }
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.map_fingerprint = planner.map_->GetFingerprint();
+  header.start_x = planner.start_location_.first;
+  header.start_y = planner.start_location_.second;
+  header.epsilon = planner.epsilon_;
+  header.vertex_count = records.size();
+
+  std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(Record)));
+  out.close();
+  return !out.fail();
+}
+
+bool TreeFile::Load(const std::string& path, RRTPath* planner) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in)
+    return false;
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  if (data.size() < sizeof(Header))
+    return false;
+  Header header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.byte_order != kByteOrder ||
+      header.vertex_count == 0 || header.vertex_count > UINT32_MAX ||
+      data.size() != sizeof(Header) + header.vertex_count * sizeof(Record))
+    return false;
+
+  // Only a tree grown from the same start, step and map is any use here
+  if (header.map_fingerprint != planner->map_->GetFingerprint() ||
+      header.start_x != planner->start_location_.first ||
+      header.start_y != planner->start_location_.second ||
+      header.epsilon != planner->epsilon_)
+    return false;
+
+  std::vector<Record> records(static_cast<size_t>(header.vertex_count));
+  std::memcpy(records.data(), data.data() + sizeof(Header),
+              records.size() * sizeof(Record));
+  // The root is the start, and every other parent comes before its child
+  if (records[0].x != header.start_x || records[0].y != header.start_y ||
+      records[0].parent != VertexStore::kNoParent)
+    return false;
+  for (size_t i = 1; i < records.size(); i++) {
+    if (records[i].parent >= i)
+      return false;
+  }
+
+  // Rebuild the tree, which also recomputes costs and goal vertices
+  planner->Reset();
+  planner->vertices_.Reserve(records.size());
+  // The file doesn't say which edges were checked, a lazy planner may have
+  // saved edges it never checked, so each is checked again if a path uses it
+  for (size_t i = 1; i < records.size(); i++) {
+    planner->AddVertex(std::pair<int, int>(records[i].x, records[i].y),
+                       records[i].parent);
+    planner->edge_checked_.back() = 0;
+  }
+  planner->UpdateBestGoalVertex();
+  if (planner->best_goal_vertex_ != RRTPath::kNoVertex)
+    planner->overall_path_ = planner->CalculatePath(planner->best_goal_vertex_);
+  return true;
+}
@@ -7,23 +7,40 @@
  *
  * @section DESCRIPTION
  * The Vertex class is a dependency for RRTPath. It specifies a location
- * on the RRTPath's map and the vertex that came before it.
+ * on the RRTPath's map and the vertex that came before it. It is a view of
+ * one entry of a VertexStore.
  */
-#include <math.h>
 #include <vertex.h>
+#include <stdint.h>
 #include <utility>
 
-Vertex::Vertex(int x_start, int y_start, Vertex* parent_vertex) {
-  Vertex::x_ = x_start;
-  Vertex::y_ = y_start;
-  Vertex::parent_ = parent_vertex;
+template <int D, typename T>
+BasicVertex<D, T>::BasicVertex(const BasicVertexStore<D, T>* store,
+                               uint32_t index) {
+  BasicVertex::store_ = store;
+  BasicVertex::index_ = index;
 }
 
-std::pair<int, int> Vertex::get_location() {
-  std::pair<int, int> location(Vertex::x_, Vertex::y_);
-  return location;
+template <int D, typename T>
+typename BasicVertex<D, T>::Location BasicVertex<D, T>::get_location() const {
+  return BasicVertex::store_->GetLocation(BasicVertex::index_);
 }
 
-Vertex* Vertex::get_parent() {
-  return parent_;
+template <int D, typename T>
+uint32_t BasicVertex<D, T>::get_index() const {
+  return BasicVertex::index_;
 }
+
+template <int D, typename T>
+bool BasicVertex<D, T>::has_parent() const {
+  return BasicVertex::store_->GetParent(BasicVertex::index_) !=
+         BasicVertexStore<D, T>::kNoParent;
+}
+
+template <int D, typename T>
+BasicVertex<D, T> BasicVertex<D, T>::get_parent() const {
+  return BasicVertex(BasicVertex::store_,
+                     BasicVertex::store_->GetParent(BasicVertex::index_));
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicVertex);
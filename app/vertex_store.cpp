@@ -0,0 +1,98 @@
+/**
+ * @file VertexStore.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Contiguous storage for the vertices of an RRT
+ *
+ * @section DESCRIPTION
+ * The VertexStore class holds every vertex of an RRTPath tree as a struct of
+ * arrays of coordinates, one per axis, and parent indices.
+ */
+
+#include "../include/vertex_store.h"
+#include <stdint.h>
+#include <vector>
+
+template <int D, typename T>
+const uint32_t BasicVertexStore<D, T>::kNoParent;
+template <int D, typename T>
+const uint32_t BasicVertexStore<D, T>::kNoChild;
+template <int D, typename T>
+const uint32_t BasicVertexStore<D, T>::kRemoved;
+template <int D, typename T>
+constexpr T BasicVertexStore<D, T>::kRemovedCoordinate;
+
+template <int D, typename T>
+uint32_t BasicVertexStore<D, T>::Add(const Location& location,
+                                     uint32_t parent) {
+  uint32_t index = static_cast<uint32_t>(BasicVertexStore::parent_.size());
+  for (int axis = 0; axis < D; axis++) {
+    BasicVertexStore::coordinates_[axis].push_back(
+        ::GetCoordinate(location, axis));
+  }
+  BasicVertexStore::parent_.push_back(parent);
+  BasicVertexStore::first_child_.push_back(kNoChild);
+  // Link the new vertex in as the first child of its parent
+  if (parent != kNoParent) {
+    BasicVertexStore::next_sibling_.push_back(
+        BasicVertexStore::first_child_[parent]);
+    BasicVertexStore::first_child_[parent] = index;
+  } else {
+    BasicVertexStore::next_sibling_.push_back(kNoChild);
+  }
+  return index;
+}
+
+template <int D, typename T>
+void BasicVertexStore<D, T>::SetParent(uint32_t index, uint32_t parent) {
+  // Unlink the vertex from its old parent's children
+  uint32_t old_parent = BasicVertexStore::parent_[index];
+  if (old_parent != kNoParent) {
+    uint32_t *link = &BasicVertexStore::first_child_[old_parent];
+    while (*link != index)
+      link = &BasicVertexStore::next_sibling_[*link];
+    *link = BasicVertexStore::next_sibling_[index];
+  }
+
+  // And link it in as the first child of the new one
+  BasicVertexStore::parent_[index] = parent;
+  if (parent != kNoParent) {
+    BasicVertexStore::next_sibling_[index] =
+        BasicVertexStore::first_child_[parent];
+    BasicVertexStore::first_child_[parent] = index;
+  } else {
+    BasicVertexStore::next_sibling_[index] = kNoChild;
+  }
+}
+
+template <int D, typename T>
+void BasicVertexStore<D, T>::Remove(uint32_t index) {
+  // The parent, if any, is already gone, so there is no link to undo here
+  for (int axis = 0; axis < D; axis++)
+    BasicVertexStore::coordinates_[axis][index] = kRemovedCoordinate;
+  BasicVertexStore::parent_[index] = kRemoved;
+  BasicVertexStore::first_child_[index] = kNoChild;
+  BasicVertexStore::next_sibling_[index] = kNoChild;
+}
+
+template <int D, typename T>
+void BasicVertexStore<D, T>::Reset() {
+  // clear() keeps the capacity of a std::vector, so nothing is freed here
+  for (int axis = 0; axis < D; axis++)
+    BasicVertexStore::coordinates_[axis].clear();
+  BasicVertexStore::parent_.clear();
+  BasicVertexStore::first_child_.clear();
+  BasicVertexStore::next_sibling_.clear();
+}
+
+template <int D, typename T>
+void BasicVertexStore<D, T>::Reserve(size_t capacity) {
+  for (int axis = 0; axis < D; axis++)
+    BasicVertexStore::coordinates_[axis].reserve(capacity);
+  BasicVertexStore::parent_.reserve(capacity);
+  BasicVertexStore::first_child_.reserve(capacity);
+  BasicVertexStore::next_sibling_.reserve(capacity);
+}
+
+RRT_INSTANTIATE_POINT_TYPES(BasicVertexStore);
@@ -0,0 +1,68 @@
+/**
+ * @file nearest_bench.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Micro-benchmark of the nearest point kernels
+ *
+ * @section DESCRIPTION
+ * Times each nearest point kernel this processor supports over arrays of
+ * random vertex coordinates and prints how many vertices per second each one
+ * scans. The arrays range from the size of a k-d tree leaf to a tree too big
+ * to fit in cache.
+ */
+
+#include <stdint.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "../include/nearest_kernel.h"
+#include "../include/sampler.h"
+
+int main() {
+  const char *names[] = {"scalar", "sse2", "avx2"};
+  NearestKernelIsa isas[] = {kScalarKernel, kSse2Kernel, kAvx2Kernel};
+  size_t sizes[] = {32, 1024, 65536, 1048576};
+  Sampler sampler(1);
+
+  std::cout << "kernel used by NearestIndex: "
+            << names[GetNearestKernelIsa()] << std::endl;
+  for (size_t count : sizes) {
+    // Random vertices on a 10000x10000 map
+    std::vector<std::pair<int, int>> points(count);
+    sampler.FillPoints(points.data(), count, 10000, 10000);
+    std::vector<int> xs(count), ys(count);
+    for (size_t i = 0; i < count; i++) {
+      xs[i] = points[i].first;
+      ys[i] = points[i].second;
+    }
+    std::vector<std::pair<int, int>> queries(256);
+    sampler.FillPoints(queries.data(), queries.size(), 10000, 10000);
+
+    // Scan roughly 256M vertices per kernel and size
+    size_t repeats = (static_cast<size_t>(1) << 28) / (count * queries.size())
+                     + 1;
+    for (int k = 0; k < 3; k++) {
+      if (!IsNearestKernelSupported(isas[k]))
+        continue;
+      NearestKernel kernel = GetNearestKernel(isas[k]);
+      size_t checksum = 0;
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (size_t r = 0; r < repeats; r++) {
+        for (const std::pair<int, int> &query : queries) {
+          int64_t distance;
+          checksum += kernel(xs.data(), ys.data(), count, query.first,
+                             query.second, &distance);
+        }
+      }
+      double seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+      double scanned = static_cast<double>(count) * queries.size() * repeats;
+      std::cout << names[k] << " n=" << count << ": "
+                << scanned / seconds / 1e6 << " M vertices/s"
+                << " (checksum " << checksum << ")" << std::endl;
+    }
+  }
+  return 0;
+}
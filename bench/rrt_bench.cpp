@@ -0,0 +1,321 @@
+/**
+ * @file rrt_bench.cpp
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Benchmark suite for the RRTPath planner
+ *
+ * @section DESCRIPTION
+ * Runs RRTPath::FindPath over seeded scenarios and prints the results as
+ * JSON, so runs on different commits can be compared. There are four kinds
+ * of scenario, each on maps from 100x100 to 100000x100000:
+ * empty: no obstacles at all
+ * cluttered: random circular obstacles covering about a fifth of the map,
+ *      up to 100000 of them
+ * narrow: a wall across the middle of the map with one narrow gap in it
+ * maze: several walls across the map with gaps at alternating ends
+ *
+ * Every scenario is built from a fixed seed, and every run is seeded, so the
+ * same commit always grows the same trees. Each run is timed twice. The first
+ * time FindPath runs untouched, giving the time to solution, the iteration
+ * count and the vertices added per second. The second time the same seed is
+ * replayed by a copy of the FindPath loop that times each phase:
+ * GetRandomPoint, GetClosestPoint, IsSafe and MoveTowardsPoint (which
+ * includes its IsSafe call). Reading the clock around every call adds a
+ * little to each phase, so the phase times add up to a bit more than the
+ * untouched run.
+ *
+ * Usage: rrt-bench [--quick] [--runs N] [--max-seconds S] [--threads T]
+ * --quick skips the 100000x100000 maps, --runs sets the number of seeds per
+ * scenario (3 by default) and --max-seconds the deadline of each run (20 by
+ * default). Runs that hit the deadline are reported with a "timeout" status.
+ * --threads grows each tree on T threads with RRTPath::SetExpansionThreads
+ * (1 by default). Only the untouched run uses them; the phase replay is
+ * always single threaded, and replays the iteration count of a parallel run
+ * rather than its tree.
+ */
+
+// The phase timings drive the planner's private steps directly, as the tests
+// do
+#define private public
+#include "../include/rrt_path.h"
+#undef private
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <list>
+#include <vector>
+#include "../include/sampler.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief a map with a start and goal to plan between
+ */
+struct Scenario {
+  std::string name;
+  int size;
+  int epsilon;
+  std::pair<int, int> start;
+  std::pair<int, int> goal;
+  std::list<Obstacle> obstacles;
+  CollisionModel collision_model;
+};
+
+/**
+ * @brief the time spent in one phase of the planner
+ */
+struct Phase {
+  const char *name;
+  uint64_t calls;
+  double seconds;
+};
+
+/**
+ * @brief a run of one scenario with one seed
+ */
+struct RunResult {
+  PlanningStatus status;
+  double seconds;
+  int iterations;
+  size_t vertices;
+  size_t path_vertices;
+  Phase phases[4];
+};
+
+double Seconds(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+const char* StatusName(PlanningStatus status) {
+  switch (status) {
+    case kSuccess: return "success";
+    case kTimeout: return "timeout";
+    case kExhausted: return "exhausted";
+    default: return "cancelled";
+  }
+}
+
+/**
+ * @brief fills in the start, goal and step of a scenario on a map of a size
+ */
+Scenario NewScenario(const std::string& name, int size) {
+  Scenario scenario;
+  scenario.name = name;
+  scenario.size = size;
+  // The step grows more slowly than the map, so bigger maps need bigger
+  // trees
+  scenario.epsilon = std::max(2, static_cast<int>(std::sqrt(size) / 5));
+  scenario.start = std::make_pair(size / 50, size / 50);
+  scenario.goal = std::make_pair(size - size / 50, size - size / 50);
+  scenario.collision_model = kSampledCollision;
+  return scenario;
+}
+
+/**
+ * @brief adds a wall of square obstacles across the map at x, leaving a gap
+ * of the given height starting at gap_start
+ */
+void AddWall(Scenario* scenario, int x, int gap_start, int gap_height) {
+  int half_width = std::max(2, scenario->size / 200);
+  for (int y = 0; y <= scenario->size; y += half_width) {
+    if (y + half_width < gap_start || y - half_width > gap_start + gap_height)
+      scenario->obstacles.push_back(Obstacle(x, y, half_width));
+  }
+}
+
+Scenario EmptyScenario(int size) {
+  return NewScenario("empty", size);
+}
+
+Scenario ClutteredScenario(int size) {
+  Scenario scenario = NewScenario("cluttered", size);
+  // One obstacle per 10000 square units, at most 100000 of them, sized so
+  // that together they cover about a fifth of the map
+  int64_t area = static_cast<int64_t>(size) * size;
+  int count = static_cast<int>(std::min<int64_t>(100000,
+                                                 std::max<int64_t>(20,
+                                                 area / 10000)));
+  int radius = std::max(1, static_cast<int>(
+      size * std::sqrt(0.2 / (3.14159265358979 * count))));
+  Sampler sampler(static_cast<uint64_t>(size));
+  std::vector<std::pair<int, int>> centers(count);
+  sampler.FillPoints(centers.data(), centers.size(), size, size);
+  for (const std::pair<int, int> &center : centers) {
+    // Keep the start and goal clear
+    Obstacle obstacle(center.first, center.second, radius);
+    int64_t clearance = radius + scenario.epsilon;
+    int64_t ds_x = center.first - scenario.start.first;
+    int64_t ds_y = center.second - scenario.start.second;
+    int64_t dg_x = center.first - scenario.goal.first;
+    int64_t dg_y = center.second - scenario.goal.second;
+    if (ds_x * ds_x + ds_y * ds_y > clearance * clearance &&
+        dg_x * dg_x + dg_y * dg_y > clearance * clearance)
+      scenario.obstacles.push_back(obstacle);
+  }
+  return scenario;
+}
+
+Scenario NarrowScenario(int size) {
+  Scenario scenario = NewScenario("narrow", size);
+  AddWall(&scenario, size / 2, size / 2 - size / 40, size / 20);
+  scenario.collision_model = kSquareCollision;
+  return scenario;
+}
+
+Scenario MazeScenario(int size) {
+  Scenario scenario = NewScenario("maze", size);
+  // Four walls, with gaps at the top and bottom in turn
+  int gap = size / 10;
+  for (int wall = 1; wall <= 4; wall++) {
+    int gap_start = wall % 2 == 1 ? size - gap : 0;
+    AddWall(&scenario, wall * size / 5, gap_start, gap);
+  }
+  scenario.collision_model = kSquareCollision;
+  return scenario;
+}
+
+/**
+ * @brief runs one scenario with one seed, untouched and then phase by phase
+ */
+RunResult Run(const Map& map, const Scenario& scenario, uint64_t seed,
+              double max_seconds, size_t threads) {
+  RunResult result;
+  PlanningBudget budget;
+
+  // Time to solution with the planner as it is used in practice
+  RRTPath rrt(map, scenario.start.first, scenario.start.second,
+              scenario.goal.first, scenario.goal.second, scenario.epsilon,
+              scenario.epsilon);
+  rrt.SetExpansionThreads(threads);
+  rrt.SetSeed(seed);
+  Clock::time_point start = Clock::now();
+  budget.deadline = start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(max_seconds));
+  PlanningResult planned = rrt.FindPath(budget);
+  result.seconds = Seconds(start, Clock::now());
+  result.status = planned.status;
+  result.iterations = planned.iterations;
+  result.vertices = rrt.GetVertexCount();
+  result.path_vertices = planned.status == kSuccess ? planned.path.size() : 0;
+
+  // Replay the same iterations one phase at a time. The seed is the same, so
+  // this grows the same tree
+  Phase phases[4] = {{"get_random_point", 0, 0},
+                     {"get_closest_point", 0, 0},
+                     {"is_safe", 0, 0},
+                     {"move_towards_point", 0, 0}};
+  rrt.SetExpansionThreads(1);
+  rrt.SetSeed(seed);
+  rrt.Reset();
+  for (int i = 0; i < result.iterations; i++) {
+    Clock::time_point t0 = Clock::now();
+    std::pair<int, int> random_point = rrt.GetRandomPoint();
+    Clock::time_point t1 = Clock::now();
+    uint32_t closest_vertex = rrt.GetClosestPoint(random_point);
+    Clock::time_point t2 = Clock::now();
+    // MoveTowardsPoint, split up so IsSafe can be timed on its own
+    std::pair<int, int> closest_point =
+        rrt.vertices_.GetLocation(closest_vertex);
+    std::pair<int, int> new_point = rrt.StepTowards(closest_point,
+                                                    random_point);
+    Clock::time_point t3 = Clock::now();
+    bool safe = rrt.IsSafe(closest_point, new_point);
+    Clock::time_point t4 = Clock::now();
+    if (safe)
+      rrt.AddVertex(new_point, closest_vertex);
+    Clock::time_point t5 = Clock::now();
+
+    phases[0].seconds += Seconds(t0, t1);
+    phases[1].seconds += Seconds(t1, t2);
+    phases[2].seconds += Seconds(t3, t4);
+    phases[3].seconds += Seconds(t2, t5);
+    for (Phase &phase : phases)
+      phase.calls++;
+  }
+  for (int p = 0; p < 4; p++)
+    result.phases[p] = phases[p];
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool quick = false;
+  int runs = 3;
+  double max_seconds = 20;
+  size_t threads = 1;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--quick") == 0) {
+      quick = true;
+    } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--max-seconds") == 0 && i + 1 < argc) {
+      max_seconds = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = static_cast<size_t>(std::atoi(argv[++i]));
+    } else {
+      std::cerr << "usage: rrt-bench [--quick] [--runs N] [--max-seconds S]"
+                << " [--threads T]" << std::endl;
+      return 1;
+    }
+  }
+
+  Scenario (*builders[])(int) = {EmptyScenario, ClutteredScenario,
+                                 NarrowScenario, MazeScenario};
+  int sizes[] = {100, 1000, 10000, 100000};
+  bool first = true;
+  std::cout << "{\"benchmark\": \"rrt-bench\", \"threads\": " << threads
+            << ", \"runs\": [";
+  for (int size : sizes) {
+    if (quick && size > 10000)
+      continue;
+    for (Scenario (*builder)(int) : builders) {
+      Scenario scenario = builder(size);
+      Map map(size, size, scenario.obstacles);
+      map.SetCollisionModel(scenario.collision_model);
+      for (int run = 0; run < runs; run++) {
+        uint64_t seed = static_cast<uint64_t>(run) + 1;
+        RunResult result = Run(map, scenario, seed, max_seconds, threads);
+        std::cout << (first ? "\n" : ",\n")
+                  << "  {\"scenario\": \"" << scenario.name << "\""
+                  << ", \"map_size\": " << size
+                  << ", \"obstacles\": " << scenario.obstacles.size()
+                  << ", \"epsilon\": " << scenario.epsilon
+                  << ", \"seed\": " << seed
+                  << ", \"status\": \"" << StatusName(result.status) << "\""
+                  << ", \"time_s\": " << result.seconds
+                  << ", \"iterations\": " << result.iterations
+                  << ", \"vertices\": " << result.vertices
+                  << ", \"vertices_per_s\": "
+                  << (result.seconds > 0 ? result.vertices / result.seconds
+                                         : 0)
+                  << ", \"path_vertices\": " << result.path_vertices
+                  << ", \"phases\": {";
+        for (int p = 0; p < 4; p++) {
+          const Phase &phase = result.phases[p];
+          std::cout << (p == 0 ? "" : ", ") << "\"" << phase.name
+                    << "\": {\"calls\": " << phase.calls
+                    << ", \"total_s\": " << phase.seconds
+                    << ", \"ns_per_call\": "
+                    << (phase.calls > 0 ? phase.seconds * 1e9 / phase.calls
+                                        : 0)
+                    << "}";
+        }
+        std::cout << "}}" << std::flush;
+        first = false;
+      }
+    }
+  }
+  std::cout << "\n]}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file BatchRRTPath.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Plans many start/goal queries on one shared map
+ *
+ * @section DESCRIPTION
+ * The BatchRRTPath class answers many path queries over the same Map. The map
+ * is copied once, when the batch planner is created, so its obstacle grid
+ * (and occupancy bitmap, if enabled) is built once and shared read-only by
+ * every query instead of being copied by each RRTPath. Queries are handed out
+ * to the workers of a ThreadPool one at a time, and each worker keeps a single
+ * RRTPath that it resets for every query, so once the workers have warmed up
+ * solving a query does not allocate. Results are returned in the order of
+ * the queries.
+ *
+ * With SetSeed, every query is seeded from its position in the batch, so a
+ * batch gives the same paths however many threads solve it.
+ *
+ * WritePaths streams the paths to a PathWriter instead of returning them.
+ * Each worker then finds paths into one reusable vector and hands it to the
+ * writer as soon as a query is solved, so no path is kept once written.
+ */
+
+#ifndef INCLUDE_BATCH_RRT_PATH_H_
+#define INCLUDE_BATCH_RRT_PATH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <list>
+#include <mutex>
+#include <vector>
+#include "path_writer.h"
+#include "rrt_path.h"
+#include "thread_pool.h"
+
+/**
+ * @brief one query for BatchRRTPath, with the same meaning as the arguments
+ * of the RRTPath constructor
+ */
+struct PathQuery {
+  std::pair<int, int> start;
+  std::pair<int, int> goal;
+  int epsilon;
+  int goal_radius;
+};
+
+class BatchRRTPath {
+ private:
+  /**
+   * @brief the map shared by every query
+   */
+  std::shared_ptr<const Map> map_;
+
+  /**
+   * @brief the threads the queries are solved on
+   */
+  ThreadPool pool_;
+
+  /**
+   * @brief one planner per worker, created by the first query it solves
+   */
+  std::vector<std::unique_ptr<RRTPath>> planners_;
+
+  /**
+   * @brief set by Cancel to stop the remaining queries
+   */
+  std::atomic<bool> stop_;
+
+  /**
+   * @brief the seed set by SetSeed
+   */
+  uint64_t seed_;
+
+  /**
+   * @brief true once SetSeed has been called
+   */
+  bool seeded_;
+
+  /**
+   * @brief gets a worker's planner ready for a query
+   * @param worker index of the worker, and of its planner in planners_
+   * @param index index of the query in the batch
+   * @param query the query
+   * @return the planner, reset to the query and seeded for it
+   */
+  RRTPath* PreparePlanner(size_t, size_t, const PathQuery&);
+
+  /**
+   * @brief solves queries until none are left or the batch is cancelled
+   * @param worker index of the worker, and of its planner in planners_
+   * @param queries the queries of the batch
+   * @param budget the budget of each query
+   * @param next index of the next query nobody has started
+   * @param results where the result of each query is stored
+   */
+  void RunWorker(size_t, const std::vector<PathQuery>&, const PlanningBudget&,
+                 std::atomic<size_t>*, std::vector<PlanningResult>*);
+
+  /**
+   * @brief solves queries until none are left, writing each path as it is
+   * found
+   * @param worker index of the worker, and of its planner in planners_
+   * @param queries the queries of the batch
+   * @param budget the budget of each query
+   * @param next index of the next query nobody has started
+   * @param writer the writer the paths go to
+   * @param writerMutex held while writing to the writer
+   * @param ok cleared if a write fails
+   */
+  void StreamWorker(size_t, const std::vector<PathQuery>&,
+                    const PlanningBudget&, std::atomic<size_t>*, PathWriter*,
+                    std::mutex*, std::atomic<bool>*);
+
+ public:
+  /**
+   * @brief Constructor for BatchRRTPath
+   * @param map the Map object every query is planned on
+   * @param threadCount how many worker threads to use, 0 for one per
+   * hardware thread
+   */
+  explicit BatchRRTPath(Map, size_t = 0);
+
+  BatchRRTPath(const BatchRRTPath&) = delete;
+  BatchRRTPath& operator=(const BatchRRTPath&) = delete;
+
+  /**
+   * @brief finds a path for every query
+   * @detail Blocks until every query has ended or the batch is cancelled.
+   * Each query is searched with RRTPath::FindPath under the budget, so its
+   * iteration and vertex limits apply to every query on its own, while its
+   * deadline, being a point in time, bounds the whole batch. A budget with
+   * no limits never ends on a query whose goal can't be reached.
+   * @param queries the queries to solve
+   * @param budget the budget of each query
+   * @return the result of every query, in the same order as the queries. A
+   * query not started because of Cancel is kCancelled with an empty path.
+   */
+  std::vector<PlanningResult> FindPaths(const std::vector<PathQuery>&,
+                                        const PlanningBudget&);
+
+  /**
+   * @brief finds a path for every query and writes it to a file
+   * @details Blocks until every query has ended or the batch is cancelled.
+   * Queries are searched under the budget as in FindPaths. Paths are written
+   * in the order they are found, each tagged with the index of its query,
+   * and a query that runs out of budget before reaching its goal is written
+   * with no waypoints. Queries stopped by Cancel aren't written.
+   * @param queries the queries to solve
+   * @param budget the budget of each query
+   * @param writer an open writer to append the paths to
+   * @return false if the writer isn't open or a write failed
+   */
+  bool WritePaths(const std::vector<PathQuery>&, const PlanningBudget&,
+                  PathWriter*);
+
+  /**
+   * @brief stops a FindPaths or WritePaths that is running on another thread
+   * @details If neither is running, the next one to be called stops before
+   * starting any query. The cancel is used up when that call returns.
+   */
+  void Cancel();
+
+  /**
+   * @brief makes the paths found reproducible
+   * @details query i of a batch is seeded with a seed derived from this one
+   * and i
+   * @param seed the seed to use
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief returns the number of worker threads
+   */
+  size_t GetThreadCount() const;
+};
+
+#endif /* INCLUDE_BATCH_RRT_PATH_H_ */
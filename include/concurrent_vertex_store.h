@@ -0,0 +1,318 @@
+/**
+ * @file ConcurrentVertexStore.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Append-only vertex storage that many threads can grow at once
+ *
+ * @section DESCRIPTION
+ * The ConcurrentVertexStore class holds the vertices of a tree that several
+ * threads are growing together. Add may be called from any number of threads
+ * at once, and so may the readers, none of which ever take a lock.
+ *
+ * A new vertex gets its index from an atomic counter. Vertices live in fixed
+ * size blocks that are allocated the first time an index falls into them and
+ * never move, so a vertex can be read while others are being added. Once its
+ * location and parent are written, a vertex is published by pushing it onto
+ * the list of its cell in a uniform grid over the map with a compare and
+ * swap. Nearest only finds vertices through the grid, so it never sees one
+ * that is half written.
+ *
+ * The grid is square, a power of two cells wide, and above it sits a
+ * pyramid of flags: each flag of a level covers two by two flags of the
+ * level below (two along every axis in D dimensions), and is raised the
+ * first time a vertex lands under it. Flags
+ * are never lowered, so they need no lock either. Nearest walks down the
+ * pyramid nearest block first, skipping empty blocks and blocks farther
+ * away than the best vertex so far, so a point far from a young or lopsided
+ * tree doesn't cost a search through every empty cell in between.
+ *
+ * A vertex can only be given a parent that has been published, and the
+ * parent's index was taken before it was published, so every parent has a
+ * smaller index than its children. Walking parents from any vertex therefore
+ * ends at the root, and copying the vertices out in index order always
+ * copies a parent before its children.
+ *
+ * Reset empties the store but keeps its blocks, and Remove unlinks a vertex
+ * from its cell so Nearest no longer finds it. Neither may be called while
+ * other threads are using the store.
+ *
+ * BasicConcurrentVertexStore<D, T> stores vertices with D coordinates of
+ * type T. ConcurrentVertexStore is the 2-D integer instantiation.
+ */
+
+#ifndef INCLUDE_CONCURRENT_VERTEX_STORE_H_
+#define INCLUDE_CONCURRENT_VERTEX_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "point.h"
+
+template <int D, typename T>
+class BasicConcurrentVertexStore {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  /**
+   * @brief the type squared distances are computed in
+   */
+  typedef typename ScalarTraits<T>::Difference Difference;
+
+  /**
+   * @brief index meaning no vertex, returned by Add when the store is full
+   */
+  static const uint32_t kNoVertex = 0xFFFFFFFF;
+
+  /**
+   * @brief log2 of the number of vertices in a block
+   */
+  static const int kBlockBits = 16;
+
+  /**
+   * @brief the number of vertices in a block
+   */
+  static const uint32_t kBlockSize = 1u << kBlockBits;
+
+  /**
+   * @brief the most blocks a store can have, enough for every index
+   */
+  static const size_t kMaxBlocks = (size_t(1) << (32 - kBlockBits));
+
+  /**
+   * @brief the most levels of flags above the grid, which is at most
+   * 2^kMaxLevels cells wide
+   * @details 8 in 2-D, fewer in more dimensions to bound the number of cells
+   */
+  static const int kMaxLevels = 16 / D;
+
+  /**
+   * @brief the number of children of a block of the pyramid
+   */
+  static const int kChildren = 1 << D;
+
+ private:
+  /**
+   * @brief the vertices with indices in one range of kBlockSize
+   */
+  struct Block {
+    T coordinates[D][kBlockSize];
+    uint32_t parent[kBlockSize];
+    uint32_t next_in_cell[kBlockSize];
+  };
+
+  /**
+   * @brief the blocks, nullptr until the first index in them is taken
+   */
+  std::unique_ptr<std::atomic<Block*>[]> blocks_;
+
+  /**
+   * @brief the number of indices taken, which may run past the capacity
+   */
+  std::atomic<uint32_t> size_;
+
+  /**
+   * @brief the most recently published vertex of every grid cell, cells
+   * ordered by column then row, the first axis varying slowest
+   */
+  std::unique_ptr<std::atomic<uint32_t>[]> cells_;
+
+  /**
+   * @brief the flags of every level of the pyramid, level 1 first, each
+   * level ordered by column then row, the first axis varying slowest
+   */
+  std::unique_ptr<std::atomic<bool>[]> occupied_;
+
+  /**
+   * @brief where each level starts in occupied_, indexed by level
+   */
+  size_t level_offsets_[kMaxLevels + 2];
+
+  /**
+   * @brief the number of cells cells_ has room for
+   */
+  size_t cell_capacity_;
+
+  /**
+   * @brief the number of flags occupied_ has room for
+   */
+  size_t flag_capacity_;
+
+  /**
+   * @brief the width of a grid cell
+   */
+  T cell_size_;
+
+  /**
+   * @brief the number of levels of flags, the grid is 2^levels_ cells wide
+   */
+  int levels_;
+
+  /**
+   * @brief returns the block of an index, allocating it if need be
+   */
+  Block* GetOrCreateBlock(uint32_t);
+
+  /**
+   * @brief returns the block of an index that has been published
+   */
+  Block* GetBlock(uint32_t index) const {
+    return blocks_[index >> kBlockBits].load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief returns the grid column or row of a coordinate, clamped to the
+   * grid
+   */
+  int GetCell(T) const;
+
+  /**
+   * @brief returns the index in cells_ of a grid cell
+   * @param cell the column, row and so on of the cell
+   */
+  size_t GetCellIndex(const int* cell) const {
+    size_t index = 0;
+    for (int axis = 0; axis < D; axis++)
+      index = (index << levels_) + cell[axis];
+    return index;
+  }
+
+  /**
+   * @brief returns the flag of a block of the pyramid
+   * @param level the level of the block, from 1 to levels_
+   * @param block the column, row and so on of the block within its level
+   */
+  std::atomic<bool>& GetFlag(int level, const int* block) const {
+    size_t index = 0;
+    for (int axis = 0; axis < D; axis++)
+      index = (index << (levels_ - level)) + block[axis];
+    return occupied_[level_offsets_[level] + index];
+  }
+
+  /**
+   * @brief checks every vertex in one grid cell against the best so far
+   * @param cell the column, row and so on of the cell
+   * @param point the point being searched around
+   * @param best the closest vertex so far, updated
+   * @param bestDistance its squared distance, updated
+   */
+  void SearchCell(const int*, const Location&, uint32_t*, Difference*) const;
+
+ public:
+  /**
+   * @brief constructor for an empty store with a one cell grid
+   */
+  BasicConcurrentVertexStore();
+
+  /**
+   * @brief frees every block
+   */
+  ~BasicConcurrentVertexStore();
+
+  BasicConcurrentVertexStore(const BasicConcurrentVertexStore&) = delete;
+  BasicConcurrentVertexStore& operator=(const BasicConcurrentVertexStore&) =
+      delete;
+
+  /**
+   * @brief empties the store and lays a new grid over the map
+   * @details Cells are at least minCellSize wide, and wider on large maps so
+   * the grid is never more than 2^kMaxLevels cells wide. Not thread safe.
+   * @param mapSize the extent of the map along each axis
+   * @param minCellSize the narrowest a cell may be, such as the step of the
+   * planner
+   */
+  void Reset(const Location&, T);
+
+  /**
+   * @brief adds and publishes a vertex, safe to call from several threads
+   * @param location location of the vertex, on the map given to Reset
+   * @param parent index of a published vertex, or kNoVertex for the root
+   * @return the index of the new vertex, or kNoVertex if the store is full
+   */
+  uint32_t Add(const Location&, uint32_t);
+
+  /**
+   * @brief adds and publishes a 2-D vertex, safe to call from several
+   * threads
+   * @param x x coordinate of the vertex, on the map given to Reset
+   * @param y y coordinate of the vertex, on the map given to Reset
+   * @param parent index of a published vertex, or kNoVertex for the root
+   * @return the index of the new vertex, or kNoVertex if the store is full
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  uint32_t Add(T x, T y, uint32_t parent) {
+    return Add(MakeLocation<D, T>(x, y), parent);
+  }
+
+  /**
+   * @brief stops Nearest from finding a vertex
+   * @details The vertex keeps its index, location and parent, and the flags
+   * above its cell stay raised. Not thread safe.
+   * @param index index of a published vertex
+   */
+  void Remove(uint32_t);
+
+  /**
+   * @brief finds the published vertex closest to a point
+   * @details Walks down the pyramid to the cells that could hold the
+   * closest vertex. Safe to call while vertices are being added, which it
+   * may or may not see.
+   * @param point the point
+   * @return the index of the closest vertex, kNoVertex if there are none
+   */
+  uint32_t Nearest(const Location&) const;
+
+  /**
+   * @brief finds the published vertex closest to a 2-D point
+   * @param x x coordinate of the point
+   * @param y y coordinate of the point
+   * @return the index of the closest vertex, kNoVertex if there are none
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  uint32_t Nearest(T x, T y) const {
+    return Nearest(MakeLocation<D, T>(x, y));
+  }
+
+  /**
+   * @brief returns the number of vertices added
+   * @details Exact once every Add has returned, and may count vertices
+   * still being written while others are adding.
+   */
+  size_t Size() const;
+
+  /**
+   * @brief gets the location of a published vertex
+   * @param index index of the vertex
+   * @return std::pair<x,y>
+   */
+  Location GetLocation(uint32_t index) const {
+    const Block *block = GetBlock(index);
+    uint32_t offset = index & (kBlockSize - 1);
+    Location location;
+    for (int axis = 0; axis < D; axis++)
+      SetCoordinate(&location, axis, block->coordinates[axis][offset]);
+    return location;
+  }
+
+  /**
+   * @brief gets the parent of a published vertex
+   * @param index index of the vertex
+   * @return the index of the parent, kNoVertex for the root
+   */
+  uint32_t GetParent(uint32_t index) const {
+    return GetBlock(index)->parent[index & (kBlockSize - 1)];
+  }
+};
+
+/**
+ * @brief the shared tree of the 2-D integer RRTPath
+ */
+using ConcurrentVertexStore = BasicConcurrentVertexStore<2, int>;
+
+#endif /* INCLUDE_CONCURRENT_VERTEX_STORE_H_ */
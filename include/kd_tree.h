@@ -0,0 +1,283 @@
+/**
+ * @file KdTree.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Incremental k-d tree used for nearest neighbour queries
+ *
+ * @section DESCRIPTION
+ * The KdTree class is a spatial index over integer x,y points used by RRTPath
+ * to find the vertex closest to a random point without scanning every vertex.
+ * Points are inserted one at a time and the tree never needs to be rebuilt:
+ * points collect in small leaf buckets and a bucket is split at its median
+ * along its widest axis once it grows past KdTree::kBucketSize. When many
+ * points arrive at once, Build replaces the whole tree with a balanced one
+ * in a single pass instead.
+ *
+ * Each point carries a 32-bit id. Queries compare exact integer squared
+ * distances, and when two points are equally close the one with the larger id
+ * wins. This matches the RRTPath linear scan, which prefers the most recently
+ * added vertex. Ids must be inserted in increasing order for this to hold, as
+ * leaves are scanned with the vectorized kernels of NearestKernel.h.
+ *
+ * BasicKdTree<D, T> indexes points with D coordinates of type T, splitting
+ * along whichever of the D axes is widest. Integer distances are exact 64
+ * bit integers and floating point ones are doubles. KdTree is the 2-D
+ * integer instantiation.
+ */
+
+#ifndef INCLUDE_KD_TREE_H_
+#define INCLUDE_KD_TREE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+#include "point.h"
+
+template <int D, typename T>
+class BasicKdTree {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  /**
+   * @brief the type squared distances are computed in
+   */
+  typedef typename ScalarTraits<T>::Difference Difference;
+
+  /**
+   * @brief id returned when the tree is empty
+   */
+  static const uint32_t kNoId = 0xFFFFFFFF;
+
+  /**
+   * @brief the largest number of points a leaf holds before it is split
+   */
+  static const size_t kBucketSize = 32;
+
+  /**
+   * @brief constructor for an empty KdTree
+   */
+  BasicKdTree();
+
+  /**
+   * @brief adds a point to the tree
+   * @param location location of the point
+   * @param id the id reported back when this point is the nearest
+   */
+  void Insert(const Location&, uint32_t);
+
+  /**
+   * @brief adds a 2-D point to the tree
+   * @param x x coordinate of the point
+   * @param y y coordinate of the point
+   * @param id the id reported back when this point is the nearest
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  void Insert(T x, T y, uint32_t id) {
+    Insert(MakeLocation<D, T>(x, y), id);
+  }
+
+  /**
+   * @brief takes a point out of the tree
+   * @details Walks down to the leaf holding the location and erases the
+   * point from its bucket, keeping the others in insertion order. Leaves
+   * are never merged, a leaf emptied this way is simply skipped by queries.
+   * @param location the location the point was inserted at
+   * @param id the id the point was inserted with
+   * @return false if there is no such point
+   */
+  bool Remove(const Location&, uint32_t);
+
+  /**
+   * @brief takes a 2-D point out of the tree
+   * @param x x coordinate the point was inserted at
+   * @param y y coordinate the point was inserted at
+   * @param id the id the point was inserted with
+   * @return false if there is no such point
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  bool Remove(T x, T y, uint32_t id) {
+    return Remove(MakeLocation<D, T>(x, y), id);
+  }
+
+  /**
+   * @brief replaces the contents of the tree with a batch of points
+   * @details Splits the points at the median of their widest axis, over and
+   * over, until every leaf fits in a bucket, which takes O(n log n) time
+   * and gives a balanced tree. Points can still be inserted and removed
+   * afterwards.
+   * @param coordinates one array per axis holding that coordinate of every
+   * point, indexed by id
+   * @param ids the ids of the points to add, in increasing order
+   */
+  void Build(const T* const*, const std::vector<uint32_t>&);
+
+  /**
+   * @brief replaces the contents of the tree with a batch of 2-D points
+   * @param xs x coordinate of every point, indexed by id
+   * @param ys y coordinate of every point, indexed by id
+   * @param ids the ids of the points to add, in increasing order
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  void Build(const T* xs, const T* ys, const std::vector<uint32_t>& ids) {
+    const T *coordinates[D] = {xs, ys};
+    Build(coordinates, ids);
+  }
+
+  /**
+   * @brief finds the point closest to the given location
+   * @param location the query location
+   * @param distance_squared if not nullptr, set to the squared distance to
+   * the nearest point
+   * @return the id of the nearest point, or KdTree::kNoId if the tree is empty
+   */
+  uint32_t Nearest(const Location&,
+                   Difference* distance_squared = nullptr) const;
+
+  /**
+   * @brief finds the 2-D point closest to the given location
+   * @param x x coordinate of the query location
+   * @param y y coordinate of the query location
+   * @param distance_squared if not nullptr, set to the squared distance to
+   * the nearest point
+   * @return the id of the nearest point, or KdTree::kNoId if the tree is empty
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  uint32_t Nearest(T x, T y, Difference* distance_squared = nullptr) const {
+    return Nearest(MakeLocation<D, T>(x, y), distance_squared);
+  }
+
+  /**
+   * @brief finds every point within a distance of the given location
+   * @param location the query location
+   * @param radius_squared the squared distance, points at exactly this
+   * distance are included
+   * @param ids cleared, then filled with the ids of the points found
+   */
+  void Within(const Location&, Difference, std::vector<uint32_t>*) const;
+
+  /**
+   * @brief finds every 2-D point within a distance of the given location
+   * @param x x coordinate of the query location
+   * @param y y coordinate of the query location
+   * @param radius_squared the squared distance, points at exactly this
+   * distance are included
+   * @param ids cleared, then filled with the ids of the points found
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  void Within(T x, T y, Difference radius_squared,
+              std::vector<uint32_t>* ids) const {
+    Within(MakeLocation<D, T>(x, y), radius_squared, ids);
+  }
+
+  /**
+   * @brief removes every point while keeping allocated memory
+   */
+  void Clear();
+
+  /**
+   * @brief returns the number of points in the tree
+   */
+  size_t Size() const;
+
+ private:
+  /**
+   * @brief a node of the tree
+   * @details Leaf nodes own a bucket of points. Internal nodes split space at
+   * split along axis: points with a coordinate less than split live in left,
+   * the rest in right.
+   */
+  struct Node {
+    T split;
+    int axis;
+    uint32_t left;
+    uint32_t right;
+    uint32_t bucket;
+  };
+
+  /**
+   * @brief the points held by a leaf, stored as a struct of arrays in the
+   * order they were inserted
+   */
+  struct Bucket {
+    std::vector<T> coordinates[D];
+    std::vector<uint32_t> id;
+  };
+
+  /**
+   * @brief the best point found so far during a query
+   */
+  struct Candidate {
+    Difference distance_squared;
+    uint32_t id;
+  };
+
+  /**
+   * @brief all nodes of the tree, the root is always nodes_[0]
+   */
+  std::vector<Node> nodes_;
+
+  /**
+   * @brief leaf buckets, indexed by Node::bucket
+   */
+  std::vector<Bucket> buckets_;
+
+  /**
+   * @brief number of buckets currently in use
+   * @details buckets_ is never shrunk so that Clear keeps the memory of the
+   * per-bucket vectors around for reuse
+   */
+  size_t bucket_count_;
+
+  /**
+   * @brief number of points in the tree
+   */
+  size_t size_;
+
+  /**
+   * @brief returns a fresh, empty bucket index
+   */
+  uint32_t NewBucket();
+
+  /**
+   * @brief walks down to the leaf whose region contains a location
+   * @return the index of the leaf node
+   */
+  uint32_t FindLeaf(const T*) const;
+
+  /**
+   * @brief builds the subtree for a range of ids at the given node
+   * @details Reorders the range, and on return the node is either a leaf
+   * or an internal node with both children built.
+   */
+  void BuildNode(uint32_t, const T* const*, uint32_t*, uint32_t*);
+
+  /**
+   * @brief splits the leaf at the given node into two children
+   * @return false if every point in the leaf has the same location and the
+   * leaf cannot be split
+   */
+  bool Split(uint32_t);
+
+  /**
+   * @brief recursive nearest neighbour search below the given node
+   */
+  void Search(uint32_t, const T*, Candidate*) const;
+
+  /**
+   * @brief recursive radius search below the given node
+   */
+  void SearchWithin(uint32_t, const T*, Difference,
+                    std::vector<uint32_t>*) const;
+};
+
+/**
+ * @brief the k-d tree of the 2-D integer RRTPath
+ */
+using KdTree = BasicKdTree<2, int>;
+
+#endif /* INCLUDE_KD_TREE_H_ */
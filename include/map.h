@@ -11,61 +11,286 @@
  * obstacles. It is always rectangular in size, specified either at creation or
  * later using the setSize method.
  *
+ * Obstacles are stored contiguously and handed out as a read-only vector,
+ * so iterating over them never copies. To keep collision queries fast the map
+ * also keeps a uniform grid of buckets over its area. Every obstacle is
+ * registered, by index, in the bucket of each cell its bounding square
+ * touches, so a query only has to look at the obstacles registered near the
+ * point or segment being checked.
+ *
+ * Optionally the map can also keep an OccupancyBitmap with one bit for every
+ * integer location, turning a point check into a single bit lookup.
+ *
+ * BasicMap<D, T> is the same map in D dimensions with coordinates of type
+ * T, spanning [0, size] along every axis. Its grid has a cell for every
+ * combination of per-axis cell indices, and the occupancy bitmap is only
+ * available for integer coordinates. Map is the 2-D integer instantiation.
+ *
  * It has a dependent class, Obstacle.
  */
 
 #ifndef INCLUDE_MAP_H_
 #define INCLUDE_MAP_H_
 
+#include <stdint.h>
 #include <list>
+#include <type_traits>
 #include <utility>
+#include <vector>
 #include "obstacle.h"
+#include "occupancy_bitmap.h"
+#include "point.h"
 #include "vertex.h"
 
-class Map {
+/**
+ * @brief how RRTPath checks an edge against the obstacles of a Map
+ * @details kSampledCollision checks ten points along the edge against
+ * circular obstacles, the original behaviour. kCircleCollision and
+ * kSquareCollision test the whole edge in closed form against obstacles
+ * shaped as circles or squares of their radius, so thin obstacles are never
+ * stepped over.
+ */
+enum CollisionModel {
+  kSampledCollision,
+  kCircleCollision,
+  kSquareCollision
+};
+
+template <int D, typename T>
+class BasicMap {
+  // Saves and loads the obstacle grid directly
+  friend class MapFile;
+
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  /**
+   * @brief the type of an obstacle
+   */
+  typedef BasicObstacle<D, T> Obstacle;
+
  private:
   /**
    * @brief size of the grid
    * @param height height of grid
    * @param width width of grid
    */
-  std::pair<int, int> size_;
+  Location size_;
+
+  /**
+   * @brief the obstacles within the map. Obstacles can overlap
+   */
+  std::vector<Obstacle> obstacles_;
+
+  /**
+   * @brief width and height of one bucket of the obstacle grid
+   */
+  T cell_size_;
+
+  /**
+   * @brief number of grid cells along each axis of the map
+   * @details for 2-D maps the columns (x) and then the rows (y)
+   */
+  int grid_cells_[D];
+
+  /**
+   * @brief the obstacle grid
+   * @details Cells are stored in row major order, the first axis varying
+   * slowest, so in 2-D cell (column, row) is at column * grid_cells_[1] + row.
+   * Each holds the index in obstacles_ of every obstacle whose bounding
+   * square overlaps the cell. Obstacles entirely outside the map are not
+   * registered anywhere.
+   */
+  std::vector<std::vector<uint32_t>> grid_;
+
+  /**
+   * @brief one bit per map location, set where the location is inside an
+   * obstacle
+   * @details empty unless EnableOccupancyBitmap has been called
+   */
+  OccupancyBitmap bitmap_;
+
+  /**
+   * @brief how edges are checked against obstacles
+   */
+  CollisionModel collision_model_;
+
+  /**
+   * @brief finds the range of cells covering a rectangle of the map
+   * @details The rectangle is clipped to the map
+   * @param minCorner smallest corner of the rectangle
+   * @param maxCorner largest corner of the rectangle
+   * @param firstCell set to the first cell along each axis
+   * @param lastCell set to the last cell along each axis
+   * @return false if the rectangle does not overlap the map at all
+   */
+  bool GetCellRange(const Location&, const Location&, int*, int*) const;
+
+  /**
+   * @brief finds the range of cells covering an obstacle's bounding square
+   * @return false if the obstacle is empty or entirely off the map
+   */
+  bool GetCellRange(const Obstacle&, int*, int*) const;
+
+  /**
+   * @brief gets the grid cell holding a point on the map
+   */
+  const std::vector<uint32_t>& GetCell(const Location&) const;
+
+  /**
+   * @brief calls visit with the index in grid_ of every cell in a range of
+   * cells, stopping early if it returns false
+   * @param firstCell the first cell along each axis
+   * @param lastCell the last cell along each axis
+   * @param visit called with the index of each cell
+   * @return false if visit stopped the walk
+   */
+  template <typename Visitor>
+  bool VisitCells(const int*, const int*, Visitor) const;
+
+  /**
+   * @brief finds the bit of the occupancy bitmap for a point on the map
+   * @details the column is the x location and the row runs over the other
+   * coordinates, the second varying slowest
+   */
+  void GetBitmapCell(const Location&, int*, int*) const;
+
+  /**
+   * @brief clips an obstacle's bounding square to the map
+   * @param obs the obstacle
+   * @param low set to the smallest corner of the clipped square
+   * @param high set to the largest corner of the clipped square
+   * @return false if nothing of the square is left
+   */
+  bool GetBitmapBox(const Obstacle&, Location*, Location*) const;
+
+  /**
+   * @brief sizes the obstacle grid for the map and registers every obstacle
+   */
+  void BuildGrid();
+
+  /**
+   * @brief adds an obstacle to every grid cell it overlaps
+   * @param index index of the obstacle in obstacles_
+   */
+  void RegisterObstacle(uint32_t);
+
+  /**
+   * @brief removes an obstacle from every grid cell it overlaps
+   * @param index index of the obstacle in obstacles_
+   */
+  void UnregisterObstacle(uint32_t);
 
   /**
-   * @brief the list of obstacles within the map. Obstacles can overlap
+   * @brief finds an obstacle equal to the given one
+   * @details Only the first grid cell the obstacle overlaps is searched, as
+   * an equal obstacle is registered in the same cells. Obstacles that are
+   * not in the grid are searched for among all obstacles.
+   * @param obs the obstacle to look for
+   * @return the index of the obstacle, or Map::kNoObstacle if there is none
    */
-  std::list<Obstacle> obstacle_list_;
+  uint32_t FindObstacle(const Obstacle&) const;
 
+  /**
+   * @brief recomputes the occupancy bits under an obstacle's bounding square
+   * @details Each location is tested against the obstacles registered in
+   * its grid cell, so this works for both added and removed obstacles as long
+   * as the grid is already up to date.
+   * @param obs the obstacle whose area changed
+   */
+  void UpdateBitmap(const Obstacle&);
 
  public:
+  /**
+   * @brief the smallest width of a cell in the obstacle grid
+   * @details large maps use bigger cells so that the grid has at most
+   * Map::kMaxGridCells cells along each side
+   */
+  static const int kMinGridCellSize = 16;
+
+  /**
+   * @brief the largest number of obstacle grid cells along one side
+   * @details 1024 in 2-D, fewer in more dimensions to bound the total
+   */
+  static const int kMaxGridCells = 1 << (20 / D);
+
+  /**
+   * @brief the number of obstacle grid cells along the longest side of a
+   * map with floating point coordinates
+   * @details such maps have no natural unit to size cells by
+   */
+  static const int kFloatGridCells = 1 << (12 / D);
+
+  /**
+   * @brief obstacle index meaning no obstacle
+   */
+  static const uint32_t kNoObstacle = 0xFFFFFFFF;
+
   /**
    * @brief generic constructor for a map object
    * @detail creates a 10x10 map with no obstacles
    */
-  Map();
+  BasicMap();
+
+  /**
+   * @brief constructor for a map object from a vector of obstacles
+   * @details the obstacles are kept as given, duplicates included
+   * @param size the extent of the map along each axis
+   * @param obstacles the obstacles within the map
+   */
+  BasicMap(Location, std::vector<Obstacle>);
 
   /**
    * @brief constructor for a map object
+   * @details the obstacles are kept as given, duplicates included
    * @param height height of the map
    * @param width width of the map
    * @param obstacleList list of Obstacle objects within the map
    */
-  Map(int, int, std::list<Obstacle>);
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  BasicMap(T height, T width, std::list<Obstacle> obstacle_list)
+      : BasicMap(MakeLocation<D, T>(height, width),
+                 std::vector<Obstacle>(obstacle_list.begin(),
+                                       obstacle_list.end())) {}
 
+  /**
+   * @brief constructor for a map object from a vector of obstacles
+   * @details the obstacles are kept as given, duplicates included
+   * @param height height of the map
+   * @param width width of the map
+   * @param obstacles the obstacles within the map
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  BasicMap(T height, T width, std::vector<Obstacle> obstacles)
+      : BasicMap(MakeLocation<D, T>(height, width), std::move(obstacles)) {}
 
   /**
    * @brief Add a new obstacle to the map
-   * @details Adds a new obstacle to the map by adding it to the back of the
-   * obstacleList. The list is then sorted and any duplicate obstacles are
-   * removed.
+   * @details Adds a new obstacle to the back of the map's obstacles, unless
+   * an equal obstacle is already there. Finding a duplicate only searches
+   * the obstacles registered in one grid cell.
    * @param obs the Obstacle to be added
    */
   void AddObstacle(Obstacle);
 
+  /**
+   * @brief adds many obstacles to the map at once
+   * @details The obstacles are appended and then every duplicate on the
+   * map, old or new, is removed in a single sorting pass, keeping the first
+   * of each. The obstacle grid (and the occupancy bitmap, if on) is then
+   * rebuilt once, so loading n obstacles takes O(n log n) time.
+   * @param obstacles the obstacles to add
+   */
+  void AddObstacles(const std::vector<Obstacle>&);
+
   /**
    * @brief Removes an obstacle from the map
-   * @details Removes an obstacle from the obstacleList of the map. If the
-   * obstacle does not exist nothing happens.
+   * @details Removes every obstacle equal to the given one. The last
+   * obstacle takes the place of each one removed. If the obstacle does not
+   * exist nothing happens.
    * @param obs the obstacle to be removed
    */
   void RemoveObstacle(Obstacle);
@@ -76,13 +301,114 @@ class Map {
    * of the pair is the height, the second is the width
    * @return size of the map
    */
-  std::pair<int, int> GetSize();
+  Location GetSize() const;
+
+  /**
+   * @brief checks whether a point lies on the map, edges included
+   */
+  bool IsOnMap(const Location&) const;
 
   /**
-   * @brief returns the list of obstacles in the map
+   * @brief returns a copy of the obstacles in the map as a list
+   * @details copies every obstacle, GetObstacles reads them in place
    * @return list of obstacles
    */
-  std::list<Obstacle> GetObstacleList();
+  std::list<Obstacle> GetObstacleList() const;
+
+  /**
+   * @brief returns the obstacles in the map without copying them
+   * @details the reference stays valid, but its contents change, when
+   * obstacles are added or removed
+   * @return the obstacles, in the order they are stored
+   */
+  const std::vector<Obstacle>& GetObstacles() const;
+
+  /**
+   * @brief checks whether a point is inside any obstacle
+   * @details With the occupancy bitmap on, points on the map are a single bit
+   * lookup. Otherwise only the obstacles registered in the grid cell holding
+   * the point are tested, using Obstacle::Contains. Points outside the map
+   * fall back to testing every obstacle.
+   * @param point the x,y location to check
+   * @param examined if not nullptr, the number of obstacles tested is added
+   * to it
+   * @return true if the point is inside an obstacle
+   */
+  bool IsOccupied(const Location&, uint64_t* examined = nullptr) const;
+
+  /**
+   * @brief collects the obstacles that might touch a segment
+   * @details Gathers every obstacle registered in a grid cell overlapping the
+   * bounding box of the segment, each one once. If the box reaches outside
+   * the map every obstacle is returned.
+   * @param startPoint one end of the segment
+   * @param endPoint the other end of the segment
+   * @param obstacles cleared, then filled with pointers to the obstacles
+   */
+  void GetObstaclesAlong(const Location&, const Location&,
+                         std::vector<const Obstacle*>*) const;
+
+  /**
+   * @brief turns the occupancy bitmap on or off
+   * @details When on, the map rasterizes every obstacle into an
+   * OccupancyBitmap covering [0, height] x [0, width] and keeps it up to date
+   * in AddObstacle and RemoveObstacle. IsOccupied then answers points on the
+   * map with a single bit lookup. Answers are identical either way. Maps
+   * with floating point coordinates have no bitmap and ignore this.
+   * @param enable true to build the bitmap, false to free it
+   */
+  void EnableOccupancyBitmap(bool);
+
+  /**
+   * @brief checks whether the occupancy bitmap is on
+   */
+  bool HasOccupancyBitmap() const;
+
+  /**
+   * @brief chooses how edges are checked against obstacles
+   * @param model the collision model, kSampledCollision by default
+   */
+  void SetCollisionModel(CollisionModel);
+
+  /**
+   * @brief gets the collision model
+   */
+  CollisionModel GetCollisionModel() const;
+
+  /**
+   * @brief returns a 64 bit hash identifying the map
+   * @details Covers the size, the collision model and every obstacle, but
+   * not the order the obstacles are stored in, so the same map built in a
+   * different order, or loaded from a MapFile, has the same fingerprint.
+   * Used to check that a saved tree belongs to a map.
+   */
+  uint64_t GetFingerprint() const;
+
+  /**
+   * @brief checks whether a segment passes through any obstacle
+   * @details Tests the obstacles registered in the grid cells under the
+   * segment's bounding box in closed form, as squares when the collision
+   * model is kSquareCollision and as circles otherwise.
+   * @param startPoint one end of the segment
+   * @param endPoint the other end of the segment
+   * @param examined if not nullptr, the number of obstacles tested is added
+   * to it
+   * @return true if the segment passes through the inside of an obstacle
+   */
+  bool SegmentCollides(const Location&, const Location&,
+                       uint64_t* examined = nullptr) const;
 };
 
+/**
+ * @brief the 2-D integer map used by every planner
+ */
+using Map = BasicMap<2, int>;
+
+/**
+ * @brief maps with continuous or 3-D coordinates
+ */
+using Map2f = BasicMap<2, float>;
+using Map3i = BasicMap<3, int>;
+using Map3f = BasicMap<3, float>;
+
 #endif /* INCLUDE_MAP_H_ */
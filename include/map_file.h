@@ -0,0 +1,199 @@
+/**
+ * @file MapFile.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Memory mapped binary map files and occupancy image loading
+ *
+ * @section DESCRIPTION
+ * The MapFile class saves a Map, obstacle grid included, to a compact binary
+ * file and memory maps it back. The file is laid out the way the map is held
+ * in memory, so opening one is a validation pass over the mapped pages and
+ * loading it into a Map copies the obstacles and grid cells straight across:
+ * nothing is parsed, sorted or registered again.
+ *
+ * The file is a fixed size header followed by three sections, each starting
+ * on an 8 byte boundary:
+ * obstacles: obstacle_count records of three int32 (x, y, radius), in the
+ *      order of Map::GetObstacles
+ * cell offsets: grid_columns * grid_rows + 1 uint32, where the obstacles of
+ *      cell (column, row) are the entries from offset[column * grid_rows +
+ *      row] up to the next offset
+ * entries: uint32 indices into the obstacle records
+ * This is the map's own layout with the grid cells packed end to end.
+ * Numbers are stored in the byte order of the machine that wrote the file,
+ * and the header records that order so a file from a different machine is
+ * rejected rather than misread. The header also holds a version number,
+ * MapFile::kVersion, which changes whenever the layout does.
+ *
+ * MapFile::LoadPgm builds a map from a PGM occupancy image instead, such as
+ * the maps saved by ROS map_server.
+ */
+
+#ifndef INCLUDE_MAP_FILE_H_
+#define INCLUDE_MAP_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include "map.h"
+#include "obstacle.h"
+
+class MapFile {
+ private:
+  /**
+   * @brief the header at the start of every map file
+   */
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int32_t height;
+    int32_t width;
+    int32_t collision_model;
+    int32_t cell_size;
+    int32_t grid_columns;
+    int32_t grid_rows;
+    uint64_t obstacle_count;
+    uint64_t entry_count;
+    uint64_t obstacles_offset;
+    uint64_t cell_offsets_offset;
+    uint64_t entries_offset;
+    uint64_t file_size;
+  };
+
+  /**
+   * @brief the start of the mapped file, nullptr when no file is open
+   */
+  const char *data_;
+
+  /**
+   * @brief the length of the mapped file in bytes
+   */
+  size_t length_;
+
+  /**
+   * @brief the header of the open file, pointing into the mapping
+   */
+  const Header *header_;
+
+  /**
+   * @brief the obstacle records of the open file, three per obstacle
+   */
+  const int32_t *obstacles_;
+
+  /**
+   * @brief the cell offsets of the open file
+   */
+  const uint32_t *cell_offsets_;
+
+  /**
+   * @brief the grid entries of the open file
+   */
+  const uint32_t *entries_;
+
+  /**
+   * @brief checks the header and every section of the mapped file
+   * @return false if the file is not a valid map file of this version
+   */
+  bool Validate();
+
+ public:
+  /**
+   * @brief the version of the file layout written by Save
+   */
+  static const uint32_t kVersion = 1;
+
+  /**
+   * @brief constructor, no file is open
+   */
+  MapFile();
+
+  /**
+   * @brief destructor, unmaps any open file
+   */
+  ~MapFile();
+
+  MapFile(const MapFile&) = delete;
+  MapFile& operator=(const MapFile&) = delete;
+
+  /**
+   * @brief writes a map to a file
+   * @details The occupancy bitmap is not saved, call
+   * Map::EnableOccupancyBitmap after loading if it is wanted.
+   * @param map the map to write
+   * @param path the file to create or overwrite
+   * @return false if the file could not be written
+   */
+  static bool Save(const Map&, const std::string&);
+
+  /**
+   * @brief memory maps a map file and checks it
+   * @details Any previously open file is closed first. Every offset and
+   * index in the file is checked, so a file that opens can be loaded safely.
+   * @param path the file to open
+   * @return false if the file can't be read or isn't a valid map file
+   */
+  bool Open(const std::string&);
+
+  /**
+   * @brief unmaps the open file, if any
+   */
+  void Close();
+
+  /**
+   * @brief checks whether a file is open
+   */
+  bool IsOpen() const;
+
+  /**
+   * @brief gets the size of the map in the open file
+   */
+  std::pair<int, int> GetSize() const;
+
+  /**
+   * @brief gets the collision model of the map in the open file
+   */
+  CollisionModel GetCollisionModel() const;
+
+  /**
+   * @brief gets the number of obstacles in the open file
+   */
+  size_t GetObstacleCount() const;
+
+  /**
+   * @brief reads one obstacle straight from the open file
+   * @param index index of the obstacle, less than GetObstacleCount()
+   */
+  Obstacle GetObstacle(size_t) const;
+
+  /**
+   * @brief replaces a map with the map in the open file
+   * @details The obstacles and grid cells are copied from the mapping as
+   * they are. If this build sizes its obstacle grid differently from the one
+   * that wrote the file, the grid is rebuilt from the obstacles instead.
+   * @param map the map to overwrite
+   * @return false if no file is open
+   */
+  bool Load(Map*) const;
+
+  /**
+   * @brief builds a map from a PGM occupancy image
+   * @details Reads both binary (P5) and plain (P2) PGM images. Pixel
+   * (column, row) becomes map location (column, row), so the map is one less
+   * than the image in each direction. A pixel is occupied when its darkness,
+   * (maxval - value) / maxval, is above the threshold, and each occupied pixel
+   * becomes an obstacle of radius 1, which contains just that location. The
+   * map uses kSquareCollision, so edges cannot slip between neighbouring
+   * pixels.
+   * @param path the image to read
+   * @param threshold darkness above which a pixel is occupied, 0.65 is the
+   * map_server default
+   * @param map the map to overwrite
+   * @return false if the file can't be read or isn't a valid PGM image
+   */
+  static bool LoadPgm(const std::string&, double, Map*);
+};
+
+#endif /* INCLUDE_MAP_FILE_H_ */
@@ -0,0 +1,121 @@
+/**
+ * @file NearestKernel.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Vectorized nearest point search over coordinate arrays
+ *
+ * @section DESCRIPTION
+ * These functions find the point closest to a query location among points
+ * stored as a struct of arrays (one array of x coordinates, one of y
+ * coordinates), as kept by VertexStore and by the leaves of KdTree. They
+ * compare squared distances, so no square root is taken.
+ *
+ * There are scalar, SSE2 and AVX2 versions. NearestIndex uses the AVX2 one
+ * when the processor supports it and the scalar one otherwise; the SSE2 one
+ * is only reachable through GetNearestKernel. Every version returns the same
+ * index: the point with the smallest squared distance, and among equally
+ * close points the one with the largest index. The vector versions compute
+ * in double precision, which is exact as long as the coordinates of points
+ * and query differ by less than 2^26 on each axis.
+ *
+ * The NearestIndex template does the same search over points with D
+ * coordinates of type T, one array per axis, with the same tie breaking. Its
+ * 2-D integer case is the vectorized NearestIndex, the others are scalar
+ * loops the compiler unrolls over the axes.
+ */
+
+#ifndef INCLUDE_NEAREST_KERNEL_H_
+#define INCLUDE_NEAREST_KERNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "point.h"
+
+/**
+ * @brief the instruction sets a nearest point kernel can use
+ */
+enum NearestKernelIsa {
+  kScalarKernel,
+  kSse2Kernel,
+  kAvx2Kernel
+};
+
+/**
+ * @brief signature shared by all nearest point kernels
+ * @param xs x coordinates of the points
+ * @param ys y coordinates of the points
+ * @param count number of points, at least 1
+ * @param x x coordinate of the query location
+ * @param y y coordinate of the query location
+ * @param distanceSquared set to the squared distance to the nearest point
+ * @return index of the nearest point
+ */
+typedef size_t (*NearestKernel)(const int*, const int*, size_t, int, int,
+                                int64_t*);
+
+/**
+ * @brief finds the nearest point with the best kernel for this processor
+ * @details see NearestKernel for the parameters
+ */
+size_t NearestIndex(const int*, const int*, size_t, int, int, int64_t*);
+
+/**
+ * @brief returns the kernel used by NearestIndex
+ */
+NearestKernelIsa GetNearestKernelIsa();
+
+/**
+ * @brief checks whether this processor can run a kernel
+ * @param isa the instruction set to check
+ */
+bool IsNearestKernelSupported(NearestKernelIsa);
+
+/**
+ * @brief returns the kernel for an instruction set
+ * @details the caller must check IsNearestKernelSupported first
+ * @param isa the instruction set to use
+ */
+NearestKernel GetNearestKernel(NearestKernelIsa);
+
+/**
+ * @brief finds the nearest point among points of any dimension
+ * @param coordinates one array per axis holding that coordinate of every
+ * point
+ * @param count number of points, at least 1
+ * @param point the D coordinates of the query location
+ * @param distanceSquared set to the squared distance to the nearest point
+ * @return index of the nearest point
+ */
+template <int D, typename T>
+size_t NearestIndex(const T* const* coordinates, size_t count,
+                    const T* point,
+                    typename ScalarTraits<T>::Difference* distance_squared) {
+  typedef typename ScalarTraits<T>::Difference Difference;
+  size_t best = 0;
+  Difference best_distance = 0;
+  for (size_t i = 0; i < count; i++) {
+    Difference distance = 0;
+    for (int axis = 0; axis < D; axis++) {
+      Difference delta = static_cast<Difference>(coordinates[axis][i]) -
+                         point[axis];
+      distance += delta * delta;
+    }
+    if (i == 0 || distance <= best_distance) {
+      best = i;
+      best_distance = distance;
+    }
+  }
+  *distance_squared = best_distance;
+  return best;
+}
+
+/**
+ * @brief finds the nearest 2-D integer point with the best kernel for this
+ * processor
+ */
+template <>
+size_t NearestIndex<2, int>(const int* const*, size_t, const int*,
+                            int64_t*);
+
+#endif /* INCLUDE_NEAREST_KERNEL_H_ */
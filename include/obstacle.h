@@ -11,30 +11,55 @@
  * Obstacles are square since the map is laid out on a simple integer grid. The
  * "size" of the obstacle is the radius, the distance from the x,y location to
  * the nearest edge of the obstacle.
+ *
+ * BasicObstacle<D, T> is the same obstacle in D dimensions with coordinates
+ * of type T, a cube for the square collision model and a ball for the circle
+ * model. Obstacle is the 2-D integer instantiation.
  */
 
 #ifndef INCLUDE_OBSTACLE_H_
 #define INCLUDE_OBSTACLE_H_
 
+#include <stdint.h>
+#include <cmath>
+#include <type_traits>
 #include <utility>
+#include "point.h"
+
+template <int D, typename T>
+class BasicObstacle {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
 
-class Obstacle {
  private:
   /**
    * @brief the location of the obstacle
    * @details a std::pair<int,int> designating the location of the obstacle.
    * The first of the pair is the x location, the second is the y location
    */
-  std::pair<int, int> location_;
+  Location location_;
 
   /**
    * @brief the size of the obstacle
    * @details the radius of the square obstacle
    */
-  int obstacle_radius_;
+  T obstacle_radius_;
 
 
  public:
+  /**
+   * @brief constructor for the Obstacle class
+   * @details Creates an Obstacle object to be used with the Map class. An
+   * Obstacle consists of a location on the Map and the size of the obstacle.
+   * The size is the radius of the obstacle.
+   * @param location the center of the obstacle
+   * @param size the radius of the obstacle
+   */
+  BasicObstacle(Location, T);
+
   /**
    * @brief constructor for the Obstacle class
    * @details Creates an Obstacle object to be used with the Map class. An
@@ -46,51 +71,104 @@ class Obstacle {
    * @param yLocation int value of the y location of the center of the obstacle
    * @param size the radius of the obstacle
    */
-  Obstacle(int, int, int);
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  BasicObstacle(T x_location, T y_location, T size)
+      : BasicObstacle(MakeLocation<D, T>(x_location, y_location), size) {}
 
   /**
    * @brief gets the location of an Obstacle
    * @return a std::pair<xLocation:int, yLocation:int>
    */
-  std::pair<int, int> GetLocation();
+  Location GetLocation() const;
 
   /**
    * @brief gets the size of an Obstacle
    * @return returns the radius of the obstacle
    */
-  int GetSize();
+  T GetSize() const;
+
+  /**
+   * @brief checks whether a point lies inside the obstacle
+   * @details A point is inside when its Euclidean distance from the center of
+   * the obstacle, computed as a float, is less than the radius. This is the
+   * test RRTPath has always used for collisions, and every collision query
+   * goes through it so they all agree exactly.
+   * @param point the location to check
+   * @return true if the point is inside the obstacle
+   */
+  inline bool Contains(const Location& point) const {
+    float distance = static_cast<float>(std::sqrt(static_cast<double>(
+        SquaredDistance<D, T>(point, location_))));
+    return distance < obstacle_radius_;
+  }
+
+  /**
+   * @brief checks whether a segment passes through the obstacle as a circle
+   * @details Treats the obstacle as an open ball of radius obstacle_radius_,
+   * so a segment that only touches the edge does not intersect it. The test
+   * is done in closed form, with exact integer arithmetic for integer
+   * coordinates, and no trigonometry.
+   * @param startPoint one end of the segment
+   * @param endPoint the other end of the segment
+   * @return true if some point of the segment is strictly inside the circle
+   */
+  bool SegmentIntersectsCircle(const Location&, const Location&) const;
+
+  /**
+   * @brief checks whether a segment passes through the obstacle as a square
+   * @details Treats the obstacle as the open square of half width
+   * obstacle_radius_ around its location, as described at the top of this
+   * file, so a segment running along an edge does not intersect it. The test
+   * is a closed form slab test done with exact fractions.
+   * @param startPoint one end of the segment
+   * @param endPoint the other end of the segment
+   * @return true if some point of the segment is strictly inside the square
+   */
+  bool SegmentIntersectsSquare(const Location&, const Location&) const;
 
   /**
    * @brief overload of < operator
+   * @details orders by radius, then x, then y, so obstacles that are not
+   * less than each other either way are equal
    */
-  inline bool operator < (const Obstacle& o) const {
-    return obstacle_radius_ < o.obstacle_radius_;
+  inline bool operator < (const BasicObstacle& o) const {
+    if (obstacle_radius_ != o.obstacle_radius_)
+      return obstacle_radius_ < o.obstacle_radius_;
+    for (int axis = 0; axis < D; axis++) {
+      T coordinate = GetCoordinate(location_, axis);
+      T other = GetCoordinate(o.location_, axis);
+      if (coordinate != other)
+        return coordinate < other;
+    }
+    return false;
   }
 
   /**
    * @brief overload of > operator
    */
-  inline bool operator > (const Obstacle& o) const {
-    return o.obstacle_radius_ < obstacle_radius_;
+  inline bool operator > (const BasicObstacle& o) const {
+    return o < *this;
   }
 
   /**
    * @brief overload of == operator
    */
-  inline bool operator == (const Obstacle& o) const {
-    return (location_.first == o.location_.first &&
-        location_.second == o.location_.second &&
+  inline bool operator == (const BasicObstacle& o) const {
+    return (location_ == o.location_ &&
         obstacle_radius_ == o.obstacle_radius_);
   }
 
   /**
    * @brief overload of != operator
    */
-  inline bool operator != (const Obstacle& o) const {
-    return (location_.first != o.location_.first ||
-        location_.second != o.location_.second ||
-        obstacle_radius_ != o.obstacle_radius_);
+  inline bool operator != (const BasicObstacle& o) const {
+    return !(*this == o);
   }
 };
 
+/**
+ * @brief the square obstacle of a 2-D integer Map
+ */
+using Obstacle = BasicObstacle<2, int>;
+
 #endif /* INCLUDE_OBSTACLE_H_ */
@@ -0,0 +1,115 @@
+/**
+ * @file OccupancyBitmap.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief One bit per cell occupancy grid for Map
+ *
+ * @section DESCRIPTION
+ * The OccupancyBitmap class stores whether each integer x,y location of a
+ * Map is inside an obstacle, using a single bit per location. Each row of the
+ * bitmap holds one y coordinate and is padded to a whole number of 64-bit
+ * words, so checking a location is a single load and mask. A 10000x10000 map
+ * needs about 12 MB.
+ */
+
+#ifndef INCLUDE_OCCUPANCY_BITMAP_H_
+#define INCLUDE_OCCUPANCY_BITMAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class OccupancyBitmap {
+ private:
+  /**
+   * @brief number of x locations in each row
+   */
+  int columns_;
+
+  /**
+   * @brief number of rows, one per y location
+   */
+  int rows_;
+
+  /**
+   * @brief number of 64-bit words in each padded row
+   */
+  size_t words_per_row_;
+
+  /**
+   * @brief the bits, row after row
+   */
+  std::vector<uint64_t> words_;
+
+ public:
+  /**
+   * @brief constructor for an empty bitmap
+   */
+  OccupancyBitmap();
+
+  /**
+   * @brief resizes the bitmap and marks every location free
+   * @param columns number of x locations
+   * @param rows number of y locations
+   */
+  void Reset(int, int);
+
+  /**
+   * @brief releases the memory of the bitmap
+   */
+  void Clear();
+
+  /**
+   * @brief checks whether the bitmap holds any locations
+   */
+  bool IsEmpty() const {
+    return words_.empty();
+  }
+
+  /**
+   * @brief gets the number of x locations in each row
+   */
+  int GetColumns() const {
+    return columns_;
+  }
+
+  /**
+   * @brief gets the number of rows
+   */
+  int GetRows() const {
+    return rows_;
+  }
+
+  /**
+   * @brief marks a location as occupied or free
+   * @param x x coordinate, in [0, columns)
+   * @param y y coordinate, in [0, rows)
+   * @param occupied the new state of the location
+   */
+  void Set(int x, int y, bool occupied) {
+    uint64_t &word = words_[y * words_per_row_ + (x >> 6)];
+    uint64_t mask = static_cast<uint64_t>(1) << (x & 63);
+    if (occupied)
+      word |= mask;
+    else
+      word &= ~mask;
+  }
+
+  /**
+   * @brief checks whether a location is occupied
+   * @param x x coordinate, in [0, columns)
+   * @param y y coordinate, in [0, rows)
+   * @return true if the location is occupied
+   */
+  bool Test(int x, int y) const {
+    return (words_[y * words_per_row_ + (x >> 6)] >> (x & 63)) & 1;
+  }
+
+  /**
+   * @brief returns the number of bytes used by the bits
+   */
+  size_t GetMemoryUsage() const;
+};
+
+#endif /* INCLUDE_OCCUPANCY_BITMAP_H_ */
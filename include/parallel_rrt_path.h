@@ -0,0 +1,140 @@
+/**
+ * @file ParallelRRTPath.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Races several RRTPath searches on a thread pool
+ *
+ * @section DESCRIPTION
+ * The time RRTPath::FindPath takes varies a lot from one run to the next, and
+ * a few unlucky runs take far longer than the rest. The ParallelRRTPath class
+ * cuts that tail by running several independently seeded RRTPath planners at
+ * once on a ThreadPool and returning the first path any of them finds. All
+ * planners share one read-only copy of the Map. As soon as one planner
+ * succeeds it sets a shared stop flag, which the others check every
+ * iteration, so they return promptly and the pool is free for the next
+ * query. Cancel sets the same flag from any thread.
+ *
+ * The path returned is a path found by one RRTPath, and ParallelRRTPath takes
+ * the same arguments as RRTPath plus the number of planners to race.
+ */
+
+#ifndef INCLUDE_PARALLEL_RRT_PATH_H_
+#define INCLUDE_PARALLEL_RRT_PATH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <list>
+#include <vector>
+#include "rrt_path.h"
+#include "thread_pool.h"
+
+class ParallelRRTPath {
+ public:
+  /**
+   * @brief winner reported before any planner has found a path
+   */
+  static const int kNoWinner = -1;
+
+ private:
+  /**
+   * @brief the map shared by every planner
+   */
+  std::shared_ptr<const Map> map_;
+
+  /**
+   * @brief the planners that are raced, each with its own seed
+   */
+  std::vector<RRTPath> planners_;
+
+  /**
+   * @brief the threads the planners run on
+   */
+  ThreadPool pool_;
+
+  /**
+   * @brief set when a planner finds a path or Cancel is called
+   */
+  std::atomic<bool> stop_;
+
+  /**
+   * @brief index of the planner whose path was returned, or kNoWinner
+   */
+  std::atomic<int> winner_;
+
+  /**
+   * @brief the path found by the winning planner
+   */
+  std::list<std::pair<int, int>> overall_path_;
+
+  /**
+   * @brief runs one planner, and keeps its path if it finishes first
+   * @param planner index of the planner to run
+   */
+  void RunPlanner(int);
+
+ public:
+  /**
+   * @brief Constructor for ParallelRRTPath
+   * @param map the Map object that we will be traversing
+   * @param startXLocation the beginning x coordinate of the map
+   * @param startYLocation the beginning y coordinate of the map
+   * @param goalXLocation the x coordinate of the goal
+   * @param goalYLocation the y coordinate of the goal
+   * @param epsilon the distance the RRT expands when discovering a new point
+   * @param goalRadius how close to the goal is close enough
+   * @param plannerCount how many planners to race
+   * @param threadCount how many threads to run them on, 0 for one per
+   * hardware thread
+   */
+  ParallelRRTPath(Map, int, int, int, int, int, int, size_t, size_t = 0);
+
+  ParallelRRTPath(const ParallelRRTPath&) = delete;
+  ParallelRRTPath& operator=(const ParallelRRTPath&) = delete;
+
+  /**
+   * @brief races every planner from scratch and returns the first path
+   * @detail Each call resets the planners, so every call is a new search.
+   * Planners that haven't started when the winner is found return without
+   * doing any work.
+   * @return the first path found, or an empty path if Cancel was called
+   * before any planner finished
+   */
+  std::list<std::pair<int, int>> FindPath();
+
+  /**
+   * @brief stops a FindPath that is running on another thread
+   * @details If no FindPath is running, the next one returns an empty path
+   * at once. The cancel is used up when that FindPath returns.
+   */
+  void Cancel();
+
+  /**
+   * @brief reseeds every planner
+   * @details The planners get different seeds derived from this one. Which
+   * planner wins still depends on how the threads are scheduled.
+   * @param seed the seed to use
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief returns the number of planners that are raced
+   */
+  size_t GetPlannerCount() const;
+
+  /**
+   * @brief returns the index of the planner that found the last path
+   * @return the planner index, or ParallelRRTPath::kNoWinner
+   */
+  int GetWinner() const;
+
+  /**
+   * @brief returns the iterations run by all planners in the last FindPath
+   */
+  int GetIterationCount() const;
+};
+
+#endif /* INCLUDE_PARALLEL_RRT_PATH_H_ */
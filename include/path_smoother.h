@@ -0,0 +1,176 @@
+/**
+ * @file PathSmoother.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Shortcuts and smooths the paths found by RRTPath
+ *
+ * @section DESCRIPTION
+ * Paths rebuilt from an RRT have a waypoint every epsilon and zig-zag
+ * between them. The PathSmoother class post-processes such a path in three
+ * passes, each of which only accepts segments the Map says are clear:
+ * greedy: from each kept waypoint, jump straight to the farthest later
+ *      waypoint that can be reached in a straight line
+ * random: a budget of random shortcuts, each joining a random point on one
+ *      segment to a random point on a later one, kept if the path gets
+ *      shorter
+ * greedy: once more, to drop the waypoints the random pass made redundant
+ * The start and end of the path never move. The result has far fewer
+ * waypoints and is never longer than the input.
+ *
+ * On paths longer than PathSmoother::kParallelWaypoints the greedy pass
+ * checks the candidate segments from each waypoint on a ThreadPool.
+ *
+ * BasicPathSmoother<D, T> smooths the paths of BasicRRTPath<D, T>.
+ * PathSmoother is the 2-D integer instantiation.
+ */
+
+#ifndef INCLUDE_PATH_SMOOTHER_H_
+#define INCLUDE_PATH_SMOOTHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "map.h"
+#include "point.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+template <int D, typename T>
+class BasicPathSmoother {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  /**
+   * @brief the type of the map paths are smoothed on
+   */
+  typedef BasicMap<D, T> Map;
+
+  /**
+   * @brief the number of random shortcuts tried by default
+   */
+  static const int kDefaultIterations = 100;
+
+  /**
+   * @brief paths with more waypoints than this have their segments checked
+   * in parallel, when the smoother has more than one thread
+   */
+  static const size_t kParallelWaypoints = 256;
+
+ private:
+  /**
+   * @brief the number of random shortcuts to try
+   */
+  int iterations_;
+
+  /**
+   * @brief picks the random shortcuts
+   */
+  Sampler sampler_;
+
+  /**
+   * @brief the threads segment checks run on, nullptr for a single thread
+   */
+  std::unique_ptr<ThreadPool> pool_;
+
+  /**
+   * @brief scratch space for the results of parallel segment checks
+   */
+  std::vector<char> clear_;
+
+  /**
+   * @brief drops every waypoint that can be skipped by a straight line
+   * @param map the map to check against
+   * @param path the path to shorten, changed in place
+   */
+  void GreedyShortcut(const Map&, std::vector<Location>*);
+
+  /**
+   * @brief tries random shortcuts between points on two segments
+   * @param map the map to check against
+   * @param path the path to shorten, changed in place
+   */
+  void RandomShortcut(const Map&, std::vector<Location>*);
+
+ public:
+  /**
+   * @brief constructor
+   * @param threadCount threads for parallel segment checks, 1 (the default)
+   * to check on the calling thread only, 0 for one per hardware thread
+   */
+  explicit BasicPathSmoother(size_t = 1);
+
+  BasicPathSmoother(const BasicPathSmoother&) = delete;
+  BasicPathSmoother& operator=(const BasicPathSmoother&) = delete;
+
+  /**
+   * @brief sets the number of random shortcuts to try
+   * @param iterations the budget, 0 to only run the greedy pass
+   */
+  void SetIterations(int);
+
+  /**
+   * @brief gets the number of random shortcuts tried
+   */
+  int GetIterations() const;
+
+  /**
+   * @brief reseeds the random shortcuts, which are seeded from
+   * std::random_device otherwise
+   * @param seed the seed to use
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief returns the number of threads used for segment checks
+   */
+  size_t GetThreadCount() const;
+
+  /**
+   * @brief shortcuts and smooths a path
+   * @param map the map the path was planned on
+   * @param path the path, from start to goal
+   * @return the smoothed path, with the same first and last points
+   */
+  std::list<Location> Smooth(const Map&, const std::list<Location>&);
+
+  /**
+   * @brief shortcuts and smooths a path held in a vector, in place
+   * @param map the map the path was planned on
+   * @param path the path, from start to goal, replaced by the smoothed path
+   */
+  void Smooth(const Map&, std::vector<Location>*);
+
+  /**
+   * @brief checks whether a straight line between two points is clear
+   * @details With kCircleCollision or kSquareCollision the whole segment is
+   * tested by Map::SegmentCollides. With kSampledCollision, points no more
+   * than one unit apart along the segment are checked with Map::IsOccupied,
+   * as the ten samples RRTPath takes per edge are too sparse for the long
+   * segments of a shortcut. Both ends must be on the map.
+   * @param map the map to check against
+   * @param startPoint one end of the segment
+   * @param endPoint the other end of the segment
+   * @return true if the segment is clear
+   */
+  static bool IsClear(const Map&, const Location&, const Location&);
+
+  /**
+   * @brief returns the total length of a path
+   * @param path the path to measure
+   */
+  static double GetPathLength(const std::list<Location>&);
+};
+
+/**
+ * @brief the path smoother of the 2-D integer RRTPath
+ */
+using PathSmoother = BasicPathSmoother<2, int>;
+
+#endif /* INCLUDE_PATH_SMOOTHER_H_ */
@@ -0,0 +1,167 @@
+/**
+ * @file PathWriter.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Streams paths to a compact binary or CSV file
+ *
+ * @section DESCRIPTION
+ * Exporting millions of paths shouldn't need a container per path on the
+ * way to disk. The PathWriter class appends each path to a file as soon as
+ * it is handed one, formatting it straight into a fixed size buffer that is
+ * written out whenever it fills. Every path is tagged with an id chosen by
+ * the caller, such as the index of its query, so paths can be written in
+ * whatever order they are found.
+ *
+ * Two formats are supported:
+ * kBinaryPathFormat: a header of the 8 byte magic "RRTPATH\n", a uint32
+ *      version (PathWriter::kVersion) and a uint32 byte order mark, then for
+ *      each path a uint64 id, a uint32 waypoint count and that many pairs of
+ *      int32 (x, y). Numbers are in the byte order of the writing machine,
+ *      as in MapFile.
+ * kCsvPathFormat: a "path,x,y" header line, then one "id,x,y" line per
+ *      waypoint, or a single "id,," line for a path with no waypoints.
+ * Waypoints are always written from start to goal.
+ */
+
+#ifndef INCLUDE_PATH_WRITER_H_
+#define INCLUDE_PATH_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief the file formats PathWriter can write
+ */
+enum PathFormat {
+  kBinaryPathFormat,
+  kCsvPathFormat
+};
+
+class PathWriter {
+ public:
+  /**
+   * @brief the version of the binary layout
+   */
+  static const uint32_t kVersion = 1;
+
+  /**
+   * @brief the size of the buffer paths are formatted into, in bytes
+   */
+  static const size_t kBufferSize = 1 << 16;
+
+ private:
+  /**
+   * @brief the file being written
+   */
+  std::ofstream out_;
+
+  /**
+   * @brief the format of the file being written
+   */
+  PathFormat format_;
+
+  /**
+   * @brief formatted bytes not yet written to the file
+   */
+  std::vector<char> buffer_;
+
+  /**
+   * @brief the number of bytes in use at the start of buffer_
+   */
+  size_t used_;
+
+  /**
+   * @brief the number of paths written since the file was opened
+   */
+  uint64_t path_count_;
+
+  /**
+   * @brief makes room for some bytes at the end of the buffer
+   * @param size the number of bytes needed, at most kBufferSize
+   * @return where to put them
+   */
+  char* Reserve(size_t);
+
+  /**
+   * @brief writes the buffer to the file and empties it
+   */
+  void Flush();
+
+  /**
+   * @brief appends a waypoint in the format of the file
+   */
+  void AppendPoint(uint64_t, std::pair<int, int>);
+
+  /**
+   * @brief appends the record header of a path in the format of the file
+   */
+  void BeginPath(uint64_t, size_t);
+
+ public:
+  /**
+   * @brief constructor, no file is open
+   */
+  PathWriter();
+
+  /**
+   * @brief destructor, closes any open file
+   */
+  ~PathWriter();
+
+  PathWriter(const PathWriter&) = delete;
+  PathWriter& operator=(const PathWriter&) = delete;
+
+  /**
+   * @brief creates a file and writes its header
+   * @details Any file already open is closed first.
+   * @param path the file to create or overwrite
+   * @param format the format to write
+   * @return false if the file can't be created
+   */
+  bool Open(const std::string&, PathFormat);
+
+  /**
+   * @brief appends a path held in contiguous memory
+   * @param id the id to tag the path with
+   * @param points the waypoints, from start to goal
+   * @param count the number of waypoints
+   * @return false if no file is open or an earlier write failed
+   */
+  bool Write(uint64_t, const std::pair<int, int>*, size_t);
+
+  /**
+   * @brief appends a path held in a vector
+   * @details takes the same arguments as the overload above
+   */
+  bool Write(uint64_t, const std::vector<std::pair<int, int>>&);
+
+  /**
+   * @brief appends a path as returned by RRTPath::FindPath
+   * @details takes the same arguments as the overload above
+   */
+  bool Write(uint64_t, const std::list<std::pair<int, int>>&);
+
+  /**
+   * @brief writes out anything buffered and closes the file
+   * @return false if any write to the file failed
+   */
+  bool Close();
+
+  /**
+   * @brief checks whether a file is open
+   */
+  bool IsOpen() const;
+
+  /**
+   * @brief returns the number of paths written since the file was opened
+   */
+  uint64_t GetPathCount() const;
+};
+
+#endif /* INCLUDE_PATH_WRITER_H_ */
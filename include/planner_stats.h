@@ -0,0 +1,172 @@
+/**
+ * @file PlannerStats.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Optional counters and timers for RRTPath searches
+ *
+ * @section DESCRIPTION
+ * The PlannerStats struct records where a search spent its time and effort:
+ * iterations, expansions accepted and rejected, collision tests and the
+ * obstacles they examined, the edge checks lazy collision checking put off
+ * and the vertices they pruned, the time spent in each phase of the planner
+ * and the largest the tree grew.
+ *
+ * Statistics are only collected when RRT_PLANNER_STATS is defined, which the
+ * PLANNER_STATS CMake option does. Otherwise the RRT_STATS_* macros below
+ * expand to nothing, so a normal build doesn't even read the clock, and the
+ * stats of every search stay zero.
+ */
+
+#ifndef INCLUDE_PLANNER_STATS_H_
+#define INCLUDE_PLANNER_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+
+struct PlannerStats {
+  /**
+   * @brief number of random points sampled
+   */
+  uint64_t iterations;
+
+  /**
+   * @brief expansions that added a vertex to the tree
+   */
+  uint64_t accepted_expansions;
+
+  /**
+   * @brief expansions that were thrown away because they weren't safe
+   */
+  uint64_t rejected_expansions;
+
+  /**
+   * @brief point and segment queries made to the map
+   */
+  uint64_t collision_tests;
+
+  /**
+   * @brief obstacles tested by those queries
+   */
+  uint64_t obstacles_examined;
+
+  /**
+   * @brief edges fully checked after being added in lazy mode
+   */
+  uint64_t deferred_edge_checks;
+
+  /**
+   * @brief vertices dropped because a deferred edge check failed
+   */
+  uint64_t pruned_vertices;
+
+  /**
+   * @brief time spent in RRTPath::GetRandomPoint, in nanoseconds
+   */
+  uint64_t get_random_point_ns;
+
+  /**
+   * @brief time spent in RRTPath::GetClosestPoint, in nanoseconds
+   */
+  uint64_t get_closest_point_ns;
+
+  /**
+   * @brief time spent in RRTPath::IsSafe, in nanoseconds
+   */
+  uint64_t is_safe_ns;
+
+  /**
+   * @brief time spent in RRTPath::CalculatePath, in nanoseconds
+   */
+  uint64_t calculate_path_ns;
+
+  /**
+   * @brief the most vertices the tree held
+   */
+  size_t peak_vertex_count;
+
+  PlannerStats() {
+    Clear();
+  }
+
+  /**
+   * @brief sets every counter back to zero
+   */
+  void Clear() {
+    iterations = 0;
+    accepted_expansions = 0;
+    rejected_expansions = 0;
+    collision_tests = 0;
+    obstacles_examined = 0;
+    deferred_edge_checks = 0;
+    pruned_vertices = 0;
+    get_random_point_ns = 0;
+    get_closest_point_ns = 0;
+    is_safe_ns = 0;
+    calculate_path_ns = 0;
+    peak_vertex_count = 0;
+  }
+
+  /**
+   * @brief adds the counters of another search, such as one worker's share
+   * of a parallel search, keeping the larger peak
+   */
+  void Merge(const PlannerStats& other) {
+    iterations += other.iterations;
+    accepted_expansions += other.accepted_expansions;
+    rejected_expansions += other.rejected_expansions;
+    collision_tests += other.collision_tests;
+    obstacles_examined += other.obstacles_examined;
+    deferred_edge_checks += other.deferred_edge_checks;
+    pruned_vertices += other.pruned_vertices;
+    get_random_point_ns += other.get_random_point_ns;
+    get_closest_point_ns += other.get_closest_point_ns;
+    is_safe_ns += other.is_safe_ns;
+    calculate_path_ns += other.calculate_path_ns;
+    if (other.peak_vertex_count > peak_vertex_count)
+      peak_vertex_count = other.peak_vertex_count;
+  }
+};
+
+#ifdef RRT_PLANNER_STATS
+
+/**
+ * @brief adds the time from its creation to its destruction to a counter
+ */
+class ScopedStatsTimer {
+ private:
+  uint64_t *nanoseconds_;
+  std::chrono::steady_clock::time_point start_;
+
+ public:
+  explicit ScopedStatsTimer(uint64_t* nanoseconds)
+      : nanoseconds_(nanoseconds), start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedStatsTimer() {
+    *nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+};
+
+// Times the rest of the enclosing scope into a nanosecond counter
+#define RRT_STATS_TIMER(counter) \
+  ScopedStatsTimer rrt_stats_timer_(&(counter))
+// Adds to a counter
+#define RRT_STATS_ADD(counter, amount) ((counter) += (amount))
+// Raises a counter to at least a value
+#define RRT_STATS_MAX(counter, value) \
+  ((counter) = (value) > (counter) ? (value) : (counter))
+// A pointer to a counter, for functions that count for us
+#define RRT_STATS_POINTER(counter) (&(counter))
+
+#else
+
+#define RRT_STATS_TIMER(counter)
+#define RRT_STATS_ADD(counter, amount)
+#define RRT_STATS_MAX(counter, value)
+#define RRT_STATS_POINTER(counter) nullptr
+
+#endif  // RRT_PLANNER_STATS
+
+#endif /* INCLUDE_PLANNER_STATS_H_ */
@@ -0,0 +1,57 @@
+/**
+ * @file PlanningBudget.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Limits on a search and how it ended
+ *
+ * @section DESCRIPTION
+ * PlanningBudget and PlanningStatus are shared by every instantiation of
+ * BasicRRTPath, so planners of any dimension are bounded and report back
+ * the same way.
+ */
+
+#ifndef INCLUDE_PLANNING_BUDGET_H_
+#define INCLUDE_PLANNING_BUDGET_H_
+
+#include <stddef.h>
+#include <chrono>
+
+/**
+ * @brief limits on how much work RRTPath::FindPath may do
+ * @details A limit of 0, or a deadline of time_point::max(), means no limit.
+ * The default budget has no limits at all.
+ */
+struct PlanningBudget {
+  /**
+   * @brief the most iterations to run
+   */
+  int max_iterations;
+
+  /**
+   * @brief the time by which to give up
+   */
+  std::chrono::steady_clock::time_point deadline;
+
+  /**
+   * @brief the most vertices the tree may hold, counting the root
+   */
+  size_t max_vertices;
+
+  PlanningBudget()
+      : max_iterations(0),
+        deadline(std::chrono::steady_clock::time_point::max()),
+        max_vertices(0) {}
+};
+
+/**
+ * @brief how a budgeted RRTPath::FindPath ended
+ */
+enum PlanningStatus {
+  kSuccess,    // a path to the goal was found
+  kTimeout,    // the deadline passed first
+  kExhausted,  // the iteration or vertex limit was reached first
+  kCancelled   // the stop flag was set first
+};
+
+#endif /* INCLUDE_PLANNING_BUDGET_H_ */
@@ -0,0 +1,205 @@
+/**
+ * @file Point.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Fixed size points of any dimension and scalar type
+ *
+ * @section DESCRIPTION
+ * Point<D, T> holds D coordinates of type T in a plain array, so a point is
+ * exactly D * sizeof(T) bytes and is copied and compared like a built-in
+ * type. Every class of the planner core is a template on the same D and T
+ * and stores its locations as PointTraits<D, T>::Location, which is the
+ * familiar std::pair<int, int> for 2-D integer maps and Point<D, T>
+ * otherwise. The accessors below work on both, and every loop in them runs
+ * over the compile-time dimension D, so the compiler unrolls them
+ * completely and a 2-D or 3-D distance is a handful of straight-line
+ * instructions.
+ *
+ * Integer coordinates are differenced and squared in int64_t, and the exact
+ * segment tests multiply sums of those squares in a 128 bit WideInt. In two
+ * or three dimensions both are exact while coordinates differ by less than
+ * 2^30, which keeps squared distances below 2^63 and their products below
+ * 2^127; coordinates spread further apart can overflow them. Floating point
+ * coordinates use double throughout.
+ */
+
+#ifndef INCLUDE_POINT_H_
+#define INCLUDE_POINT_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+template <int D, typename T>
+struct Point {
+  static_assert(D > 0, "a point needs at least one dimension");
+  static_assert(std::is_arithmetic<T>::value,
+                "point coordinates must be numbers");
+
+  /**
+   * @brief the number of coordinates
+   */
+  static const int kDimension = D;
+
+  /**
+   * @brief the coordinates, x first
+   */
+  T coordinates[D];
+
+  /**
+   * @brief gets one coordinate
+   * @param axis index of the coordinate, less than D
+   */
+  T& operator[](int axis) {
+    return coordinates[axis];
+  }
+
+  /**
+   * @brief gets one coordinate
+   * @param axis index of the coordinate, less than D
+   */
+  const T& operator[](int axis) const {
+    return coordinates[axis];
+  }
+
+  /**
+   * @brief overload of == operator
+   */
+  bool operator==(const Point& other) const {
+    for (int axis = 0; axis < D; axis++) {
+      if (coordinates[axis] != other.coordinates[axis])
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief overload of != operator
+   */
+  bool operator!=(const Point& other) const {
+    return !(*this == other);
+  }
+};
+
+template <int D, typename T>
+const int Point<D, T>::kDimension;
+
+/**
+ * @brief a 128 bit signed integer, wide enough for the product of two sums
+ * of squared coordinate differences while the differences are below 2^30
+ */
+__extension__ typedef __int128 WideInt;
+
+/**
+ * @brief the types integer and floating point coordinates are computed in
+ * @details Difference holds the difference of two coordinates and the sum
+ * of their squares, Product the product of two such sums
+ */
+template <typename T, bool Integral = std::is_integral<T>::value>
+struct ScalarTraits {
+  typedef int64_t Difference;
+  typedef WideInt Product;
+};
+
+template <typename T>
+struct ScalarTraits<T, false> {
+  typedef double Difference;
+  typedef double Product;
+};
+
+/**
+ * @brief the location type stored and returned by the planner core
+ */
+template <int D, typename T>
+struct PointTraits {
+  typedef Point<D, T> Location;
+};
+
+template <>
+struct PointTraits<2, int> {
+  typedef std::pair<int, int> Location;
+};
+
+/**
+ * @brief gets one coordinate of a point
+ */
+template <int D, typename T>
+inline T GetCoordinate(const Point<D, T>& point, int axis) {
+  return point[axis];
+}
+
+/**
+ * @brief gets one coordinate of a 2-D integer location
+ */
+inline int GetCoordinate(const std::pair<int, int>& point, int axis) {
+  return axis == 0 ? point.first : point.second;
+}
+
+/**
+ * @brief sets one coordinate of a point
+ */
+template <int D, typename T>
+inline void SetCoordinate(Point<D, T>* point, int axis, T value) {
+  (*point)[axis] = value;
+}
+
+/**
+ * @brief sets one coordinate of a 2-D integer location
+ */
+inline void SetCoordinate(std::pair<int, int>* point, int axis, int value) {
+  if (axis == 0)
+    point->first = value;
+  else
+    point->second = value;
+}
+
+/**
+ * @brief returns a 2-D location from its two coordinates
+ */
+template <int D, typename T>
+inline typename PointTraits<D, T>::Location MakeLocation(T x, T y) {
+  static_assert(D == 2, "only 2-D locations are made from x and y");
+  typename PointTraits<D, T>::Location location;
+  SetCoordinate(&location, 0, x);
+  SetCoordinate(&location, 1, y);
+  return location;
+}
+
+/**
+ * @brief returns the exact squared distance between two locations
+ */
+template <int D, typename T, typename Location>
+inline typename ScalarTraits<T>::Difference SquaredDistance(
+    const Location& a, const Location& b) {
+  typedef typename ScalarTraits<T>::Difference Difference;
+  Difference sum = 0;
+  for (int axis = 0; axis < D; axis++) {
+    Difference delta = static_cast<Difference>(GetCoordinate(b, axis)) -
+                       GetCoordinate(a, axis);
+    sum += delta * delta;
+  }
+  return sum;
+}
+
+/**
+ * @brief returns the distance between two locations
+ */
+template <int D, typename T, typename Location>
+inline double Distance(const Location& a, const Location& b) {
+  return std::sqrt(static_cast<double>(SquaredDistance<D, T>(a, b)));
+}
+
+/**
+ * @brief explicitly instantiates a template of the planner core for every
+ * supported dimension and scalar type
+ * @details used at the end of the .cpp file defining the template
+ */
+#define RRT_INSTANTIATE_POINT_TYPES(Template) \
+  template class Template<2, int>;            \
+  template class Template<2, float>;          \
+  template class Template<3, int>;            \
+  template class Template<3, float>
+
+#endif /* INCLUDE_POINT_H_ */
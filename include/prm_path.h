@@ -0,0 +1,314 @@
+/**
+ * @file PRMPath.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Multi-query probabilistic roadmap planning on a static Map
+ *
+ * @section DESCRIPTION
+ * An RRTPath explores the free space of a map again for every query. On a
+ * map that doesn't change, the PRMPath class does that work once: Build
+ * scatters nodes over the free space and connects every node to its nearest
+ * neighbours within a radius whenever the straight edge between them is
+ * clear, giving a roadmap. FindPath then answers any number of queries by
+ * connecting the start and goal to nearby roadmap nodes and running A* over
+ * the roadmap, which takes microseconds rather than a fresh search.
+ *
+ * The roadmap is stored as a compressed sparse row graph: the neighbours of
+ * node i are edge_targets_[edge_offsets_[i]] up to edge_offsets_[i + 1], with
+ * the edge lengths alongside, so a node's edges are contiguous in memory.
+ * Nodes are also bucketed in a uniform grid so the nodes near a point are
+ * found without a scan. Edges are checked with PathSmoother::IsClear, the
+ * same test the path smoother uses, so they honour the map's collision model.
+ *
+ * Nodes are sampled on the calling thread, which keeps a seeded roadmap the
+ * same whatever the thread count, and the neighbour searches and edge checks,
+ * which are most of the work, are spread over a ThreadPool. FindPath keeps
+ * its search state between calls to avoid allocating, so one PRMPath must
+ * not answer queries from several threads at once.
+ */
+
+#ifndef INCLUDE_PRM_PATH_H_
+#define INCLUDE_PRM_PATH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "map.h"
+#include "sampler.h"
+#include "thread_pool.h"
+
+class PRMPath {
+ public:
+  /**
+   * @brief the most neighbours a node is connected to by default
+   */
+  static const size_t kDefaultMaxNeighbors = 10;
+
+  /**
+   * @brief how many random points Build may try per node it places
+   */
+  static const int kSampleAttempts = 20;
+
+  /**
+   * @brief node index meaning no node
+   */
+  static const uint32_t kNoNode = 0xFFFFFFFF;
+
+ private:
+  /**
+   * @brief an edge found while building, before it goes into the graph
+   */
+  struct Edge {
+    uint32_t from;
+    uint32_t to;
+    float length;
+  };
+
+  /**
+   * @brief an entry of the A* open list
+   */
+  struct OpenEntry {
+    double estimate;
+    double cost;
+    uint32_t node;
+  };
+
+  /**
+   * @brief the map the roadmap covers, never modified
+   */
+  std::shared_ptr<const Map> map_;
+
+  /**
+   * @brief the threads edges are checked on, nullptr for a single thread
+   */
+  std::unique_ptr<ThreadPool> pool_;
+
+  /**
+   * @brief generator for the node locations
+   */
+  Sampler sampler_;
+
+  /**
+   * @brief the longest edge of the roadmap
+   */
+  double connection_radius_;
+
+  /**
+   * @brief the most neighbours each node and query point is connected to
+   */
+  size_t max_neighbors_;
+
+  /**
+   * @brief the location of every node
+   */
+  std::vector<std::pair<int, int>> nodes_;
+
+  /**
+   * @brief where the edges of each node start in edge_targets_, one more
+   * entry than there are nodes
+   */
+  std::vector<uint32_t> edge_offsets_;
+
+  /**
+   * @brief the far node of every edge, grouped by near node
+   */
+  std::vector<uint32_t> edge_targets_;
+
+  /**
+   * @brief the length of every edge, alongside edge_targets_
+   */
+  std::vector<float> edge_lengths_;
+
+  /**
+   * @brief the width of a cell of the node grid
+   */
+  int cell_size_;
+
+  /**
+   * @brief the number of node grid cells along x
+   */
+  int grid_columns_;
+
+  /**
+   * @brief the number of node grid cells along y
+   */
+  int grid_rows_;
+
+  /**
+   * @brief where the nodes of each cell start in cell_nodes_, cells ordered
+   * by column then row, one more entry than there are cells
+   */
+  std::vector<uint32_t> cell_offsets_;
+
+  /**
+   * @brief the nodes of every cell, grouped by cell
+   */
+  std::vector<uint32_t> cell_nodes_;
+
+  /**
+   * @brief the cost of the best known route to each node in this search
+   */
+  std::vector<double> costs_;
+
+  /**
+   * @brief the node each node is reached from, kNoNode for the start
+   */
+  std::vector<uint32_t> came_from_;
+
+  /**
+   * @brief the search in which each node's cost was last set
+   */
+  std::vector<uint32_t> visited_;
+
+  /**
+   * @brief the search in which each node was last linked to the goal
+   */
+  std::vector<uint32_t> goal_links_;
+
+  /**
+   * @brief the distance from each node linked to the goal to the goal
+   */
+  std::vector<double> goal_distances_;
+
+  /**
+   * @brief numbers the searches, so the arrays above never need clearing
+   */
+  uint32_t search_;
+
+  /**
+   * @brief the A* open list, a binary heap
+   */
+  std::vector<OpenEntry> open_;
+
+  /**
+   * @brief scratch space for the nodes near a query point
+   */
+  std::vector<std::pair<int64_t, uint32_t>> nearby_;
+
+  /**
+   * @brief the length of the path the last FindPath returned
+   */
+  double path_cost_;
+
+  /**
+   * @brief buckets the nodes into the node grid
+   */
+  void BuildGrid();
+
+  /**
+   * @brief finds the nodes within the connection radius of a point
+   * @param point the point to search around
+   * @param nearby cleared, then filled with (squared distance, node) pairs,
+   * closest first
+   */
+  void GetNearbyNodes(std::pair<int, int>,
+                      std::vector<std::pair<int64_t, uint32_t>>*) const;
+
+  /**
+   * @brief finds the clear edges from a range of nodes to their neighbours
+   * @param begin the first node
+   * @param end one past the last node
+   * @param edges filled with the clear edges found
+   */
+  void ConnectNodes(size_t, size_t, std::vector<Edge>*) const;
+
+  /**
+   * @brief turns the edges found by ConnectNodes into the CSR graph
+   * @param edges the edges from every range of nodes, each undirected edge
+   * once or twice
+   */
+  void BuildGraph(const std::vector<std::vector<Edge>>&);
+
+ public:
+  /**
+   * @brief constructor, the roadmap is empty until Build is called
+   * @param map the map to plan on
+   * @param threadCount threads to build the roadmap on, 0 (the default) for
+   * one per hardware thread, 1 to build on the calling thread
+   */
+  explicit PRMPath(Map, size_t = 0);
+
+  /**
+   * @brief constructor that shares a map instead of copying it
+   * @details takes the same arguments as the constructor above
+   */
+  explicit PRMPath(std::shared_ptr<const Map>, size_t = 0);
+
+  PRMPath(const PRMPath&) = delete;
+  PRMPath& operator=(const PRMPath&) = delete;
+
+  /**
+   * @brief reseeds the node sampler
+   * @details Two roadmaps built on the same map with the same seed and
+   * settings are identical, whatever their thread counts.
+   * @param seed the seed to use
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief builds the roadmap, replacing any earlier one
+   * @details Samples free locations on the map until nodeCount nodes are
+   * placed or nodeCount * PRMPath::kSampleAttempts points have been tried,
+   * then connects every node to at most maxNeighbors of its nearest nodes
+   * within the radius, keeping each edge that is clear.
+   * @param nodeCount the number of nodes to place
+   * @param connectionRadius the longest edge
+   * @param maxNeighbors the most neighbours a node is connected to
+   * @return the number of nodes placed
+   */
+  size_t Build(size_t, double, size_t = kDefaultMaxNeighbors);
+
+  /**
+   * @brief finds a path over the roadmap
+   * @details A start and goal that can see each other are joined directly.
+   * Otherwise each is linked to at most maxNeighbors of the nearest nodes it
+   * has a clear edge to, and A* with the straight line distance to the goal
+   * as its heuristic finds the shortest route through the roadmap.
+   * @param startXLocation the beginning x coordinate of the path
+   * @param startYLocation the beginning y coordinate of the path
+   * @param goalXLocation the x coordinate of the goal
+   * @param goalYLocation the y coordinate of the goal
+   * @return the path from start to goal, both included, or an empty path if
+   * either is blocked or the roadmap doesn't connect them
+   */
+  std::list<std::pair<int, int>> FindPath(int, int, int, int);
+
+  /**
+   * @brief returns the length of the path the last FindPath returned
+   * @return the length, or infinity if it found no path
+   */
+  double GetPathCost() const;
+
+  /**
+   * @brief returns the number of nodes in the roadmap
+   */
+  size_t GetNodeCount() const;
+
+  /**
+   * @brief returns the number of undirected edges in the roadmap
+   */
+  size_t GetEdgeCount() const;
+
+  /**
+   * @brief gets the location of a node
+   * @param index index of the node, less than GetNodeCount()
+   */
+  std::pair<int, int> GetNode(uint32_t) const;
+
+  /**
+   * @brief gets the nodes a node has an edge to
+   * @param index index of the node, less than GetNodeCount()
+   */
+  std::vector<uint32_t> GetNeighbors(uint32_t) const;
+
+  /**
+   * @brief returns the number of threads the roadmap is built on
+   */
+  size_t GetThreadCount() const;
+};
+
+#endif /* INCLUDE_PRM_PATH_H_ */
@@ -0,0 +1,98 @@
+/**
+ * @file RRTConnectPath.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Bidirectional RRT-Connect path planning
+ *
+ * @section DESCRIPTION
+ * The RRTConnectPath class finds a path between a starting point and a goal
+ * point by growing two RRTPath trees, one rooted at the start and one rooted
+ * at the goal. Each iteration one tree takes a normal RRT step towards a
+ * random point, and the other tree then greedily extends towards the new
+ * vertex until it reaches it or is blocked. The trees swap roles every
+ * iteration. Maps with narrow passages usually need far fewer iterations
+ * than the single tree RRTPath::FindPath.
+ *
+ * The result is the same std::list of x,y pairs returned by RRTPath, so the
+ * two planners can be swapped for one another.
+ */
+
+#ifndef INCLUDE_RRT_CONNECT_PATH_H_
+#define INCLUDE_RRT_CONNECT_PATH_H_
+
+#include <stdint.h>
+#include <utility>
+#include <list>
+#include "rrt_path.h"
+
+class RRTConnectPath {
+ private:
+  /**
+   * @brief the tree rooted at the starting location
+   */
+  RRTPath start_tree_;
+
+  /**
+   * @brief the tree rooted at the goal location
+   */
+  RRTPath goal_tree_;
+
+  /**
+   * @brief number of iterations run by FindPath
+   */
+  int iterations_;
+
+  /**
+   * @brief joins the paths of both trees into one path from start to goal
+   * @param startVertex index of the meeting vertex in the start tree
+   * @param goalVertex index of the meeting vertex in the goal tree, or
+   * VertexStore::kNoParent if the start tree reached the goal on its own
+   * @return the path from start to goal
+   */
+  std::list<std::pair<int, int>> JoinPaths(uint32_t, uint32_t);
+
+ public:
+  /**
+   * @brief Constructor for RRTConnectPath
+   * @details takes the same arguments as RRTPath
+   * @param map the Map object that we will be traversing
+   * @param startXLocation the beginning x coordinate of the map
+   * @param startYLocation the beginning y coordinate of the map
+   * @param goalXLocation the x coordinate of the goal
+   * @param goalYLocation the y coordinate of the goal
+   * @param epsilon the distance the trees expand when discovering a new point
+   * @param goalRadius how close the start tree must get to the goal to stop
+   * before the trees meet
+   */
+  RRTConnectPath(Map, int, int, int, int, int, int);
+
+  /**
+   * @brief runs RRT-Connect until the trees meet
+   * @detail Stops when the trees are joined, or when the start tree gets
+   * within goalRadius of the goal on its own. Like RRTPath::FindPath, it
+   * loops until a path is found.
+   * @return the path as a std::list<std::pair<x, y>>, from start to goal
+   */
+  std::list<std::pair<int, int>> FindPath();
+
+  /**
+   * @brief reseeds the random point generators of both trees
+   * @param seed the seed to use, equal seeds give equal paths
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief returns the number of iterations FindPath ran
+   * @details each iteration samples one random point, so this is directly
+   * comparable with RRTPath::GetIterationCount
+   */
+  int GetIterationCount() const;
+
+  /**
+   * @brief returns the number of vertices in both trees together
+   */
+  size_t GetVertexCount() const;
+};
+
+#endif /* INCLUDE_RRT_CONNECT_PATH_H_ */
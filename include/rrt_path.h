@@ -9,99 +9,563 @@
  * The RRTPath class generates a path between a given starting point and a
  * goal point while avoiding obstacles. Class dependencies are the Vertex
  * class, and the Map class, which has a dependency of the Obstacle class.
- * This class only generates the first path it finds, which may not be the
- * most efficient.
+ * FindPath returns the first path it finds, which may not be the most
+ * efficient. FindOptimalPath runs RRT* instead: every vertex tracks its
+ * cost-to-come, new vertices pick the cheapest parent within a shrinking
+ * radius and rewire their neighbours through themselves, and once a path is
+ * known, points are only sampled from the ellipse of points that could still
+ * improve it. It can be called repeatedly, each call spending a budget of
+ * iterations or time on improving the best path so far.
+ *
+ * With SetExpansionThreads, FindPath grows one tree on several threads at
+ * once. Each worker samples, finds the closest vertex and checks the new
+ * edge on its own, and publishes the vertices it adds into a shared
+ * ConcurrentVertexStore without locking. When the search ends the new
+ * vertices are copied into the planner's own tree in the order they were
+ * added, so every parent comes before its children, and the planner carries
+ * on from that tree exactly as after a single threaded search.
+ *
+ * BasicRRTPath<D, T> plans in D dimensions with coordinates of type T, on a
+ * BasicMap of the same dimension and type. RRTPath is the 2-D integer
+ * instantiation, and RRTPath2f, RRTPath3i and RRTPath3f are the others.
  */
 
 #ifndef INCLUDE_RRT_PATH_H_
 #define INCLUDE_RRT_PATH_H_
 
 #include <vertex.h>
+#include <vertex_store.h>
+#include <concurrent_vertex_store.h>
+#include <kd_tree.h>
+#include <sampler.h>
+#include <sampling_strategy.h>
+#include <planner_stats.h>
+#include <planning_budget.h>
+#include <path_smoother.h>
+#include <thread_pool.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <type_traits>
 #include <utility>
 #include <list>
+#include <vector>
 #include <map.h>
 
-class RRTPath {
+/**
+ * @brief the ways RRTPath can look up the closest vertex to a point
+ * @details kKdTree queries an incremental k-d tree and is the default.
+ * kLinearScan checks every vertex, and is kept as a reference to compare the
+ * k-d tree against. Both return exactly the same vertex.
+ */
+enum NearestNeighborMethod {
+  kLinearScan,
+  kKdTree
+};
+
+/**
+ * @brief the outcome of a budgeted RRTPath::FindPath
+ */
+template <int D, typename T>
+struct BasicPlanningResult {
+  /**
+   * @brief why the search ended
+   */
+  PlanningStatus status;
+
+  /**
+   * @brief the path to the goal on success, otherwise the path to the
+   * vertex closest to the goal
+   */
+  std::list<typename PointTraits<D, T>::Location> path;
+
+  /**
+   * @brief the number of iterations this search ran
+   */
+  int iterations;
+};
+
+/**
+ * @brief the outcome of a budgeted FindPath on a 2-D integer map
+ */
+using PlanningResult = BasicPlanningResult<2, int>;
+
+template <int D, typename T>
+class BasicRRTPath {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  /**
+   * @brief the type squared distances between locations are computed in
+   */
+  typedef typename ScalarTraits<T>::Difference Difference;
+
+  /**
+   * @brief the types of the rest of the core this planner is built from
+   */
+  typedef BasicMap<D, T> Map;
+  typedef BasicObstacle<D, T> Obstacle;
+  typedef BasicVertex<D, T> Vertex;
+  typedef BasicVertexStore<D, T> VertexStore;
+  typedef BasicKdTree<D, T> KdTree;
+  typedef BasicConcurrentVertexStore<D, T> ConcurrentVertexStore;
+  typedef BasicSamplingStrategy<D, T> SamplingStrategy;
+  typedef BasicPathSmoother<D, T> PathSmoother;
+  typedef BasicPlanningResult<D, T> PlanningResult;
+
+  /**
+   * @brief index of the root vertex in the vertex store
+   */
+  static const uint32_t kRootIndex = 0;
+
+  /**
+   * @brief how many random points are generated at a time
+   */
+  static const size_t kSampleBatchSize = 64;
+
+  /**
+   * @brief vertex index meaning no vertex, e.g. before a path is found
+   */
+  static const uint32_t kNoVertex = 0xFFFFFFFF;
+
+  /**
+   * @brief how many informed samples may fall outside the map before
+   * FindOptimalPath falls back to a uniform sample
+   */
+  static const int kInformedSampleAttempts = 8;
+
  private:
+  /**
+   * @brief RRTConnectPath grows two RRTPath trees towards each other using
+   * their private expansion steps
+   */
+  friend class RRTConnectPath;
+
+  /**
+   * @brief TreeFile saves the tree and rebuilds it on load
+   */
+  friend class TreeFile;
+
+  /**
+   * @brief a round of parallel expansion, shared by its workers
+   */
+  struct ExpansionRound {
+    /**
+     * @brief the limits on the search
+     */
+    const PlanningBudget *budget;
+
+    /**
+     * @brief iterations started by this search, only counted when the
+     * budget limits them
+     */
+    std::atomic<int> iterations;
+
+    /**
+     * @brief the first vertex added within reach of the goal, or kNoVertex
+     */
+    std::atomic<uint32_t> goal_vertex;
+
+    /**
+     * @brief why the round ended, set once by the first worker to stop, and
+     * kNoStatus while it is running
+     */
+    std::atomic<int> status;
+  };
+
+  /**
+   * @brief the state each worker of a parallel expansion keeps for itself
+   */
+  struct ExpansionWorker {
+    Sampler sampler;
+    std::unique_ptr<SamplingStrategy> strategy;
+    std::vector<Location> samples;
+    size_t next_sample;
+    int iterations;
+    PlannerStats stats;
+  };
+
+  /**
+   * @brief ExpansionRound::status before any worker has stopped
+   */
+  static const int kNoStatus = -1;
+
+  /**
+   * @brief the outcome of RRTPath::ExtendTowards
+   */
+  enum ExtendResult {
+    kTrapped,   // the step would collide, nothing was added
+    kAdvanced,  // a vertex epsilon closer to the target was added
+    kReached    // a vertex exactly at the target was added
+  };
+
   /**
    * @brief the starting location of the path from start to goal
-   * @return a pair indicating the starting location of the path as
-   * std::pair<startXLocation:int, startYLocation:int>
    */
-  std::pair<int, int> start_location_;
+  Location start_location_;
 
   /**
    * @brief the location of the goal
-   * @return a pair indicating the goal location of the path as
-   * std::pair<goalXLocation:int, goalYLocation:int>
    */
-  std::pair<int, int> goal_location_;
+  Location goal_location_;
 
   /**
    * @brief The radius of the goal
    * @details How close to the goal is close enough to count
    */
-  int goal_radius_;
+  T goal_radius_;
 
   /**
    * @brief the distance moved each step during mapping
    */
-  int epsilon_;
+  T epsilon_;
 
   /**
    * @brief the Map object we are navigating
+   * @details never modified by the planner, so several planners, possibly
+   * on different threads, can share one map
+   */
+  std::shared_ptr<const Map> map_;
+
+  /**
+   * @brief the same map as map_ when this planner holds a private copy that
+   * it may change, nullptr while the map may be shared with others
+   */
+  std::shared_ptr<Map> owned_map_;
+
+  /**
+   * @brief returns the map for changing, copying it first if it is shared
+   */
+  Map* GetMutableMap();
+
+  /**
+   * @brief flag that makes FindPath and FindOptimalPath give up when set,
+   * nullptr if the planner can't be stopped
+   */
+  const std::atomic<bool>* stop_flag_;
+
+  /**
+   * @brief returns true if the stop flag has been set
+   */
+  bool IsStopped() const;
+
+  /**
+   * @brief the locations of the waypoints from start to goal
    */
-  Map map_;
+  std::list<Location> overall_path_;
 
   /**
-   * @brief The root vertex of our tree
-   * @detail This vertex holds the starting location of our path. The previous
-   * vertex has a value of zero, to let us know we've reached the beginning
-   * when we are reconstructing the path
+   * @brief every vertex of the tree
+   * @detail The root vertex, holding the starting location of our path, is
+   * always at index RRTPath::kRootIndex and has no parent, which lets us know
+   * we've reached the beginning when we are reconstructing the path. The
+   * index of a vertex in the store is also its id in kd_tree_.
    */
-  Vertex *root_node_;
+  VertexStore vertices_;
 
   /**
-   * @brief a list of x,y coordinates indicating the path from start to goal
+   * @brief spatial index over the locations of all vertices
    */
-  std::list<std::pair<int, int>> overall_path_;
+  KdTree kd_tree_;
 
   /**
-   * @brief a list of all the vertices in the map
+   * @brief how GetClosestPoint searches for the closest vertex
    */
-  std::list<Vertex*> vertex_list_;
+  NearestNeighborMethod nearest_neighbor_method_;
+
+  /**
+   * @brief the length of the tree path from the root to every vertex
+   */
+  std::vector<double> costs_;
+
+  /**
+   * @brief every vertex within goal_radius_ of the goal
+   */
+  std::vector<uint32_t> goal_vertices_;
+
+  /**
+   * @brief the goal vertex with the cheapest path, RRTPath::kNoVertex if no
+   * vertex has reached the goal yet
+   */
+  uint32_t best_goal_vertex_;
+
+  /**
+   * @brief the vertex closest to the goal, for partial paths
+   */
+  uint32_t closest_to_goal_;
+
+  /**
+   * @brief the squared distance from closest_to_goal_ to the goal
+   */
+  Difference closest_distance_squared_;
+
+  /**
+   * @brief whether FindPath defers edge checks until an edge is on a path
+   */
+  bool lazy_collision_checking_;
+
+  /**
+   * @brief for every vertex, whether the edge from its parent has been
+   * fully checked against the map
+   * @detail Always true for the root. Only edges added by FindPath in lazy
+   * mode, or loaded by TreeFile, start out unchecked.
+   */
+  std::vector<char> edge_checked_;
+
+  /**
+   * @brief the number of vertices removed from the store since it was last
+   * compacted
+   * @detail ValidatePath removes the subtrees it cuts off in place, and
+   * CompactTree only renumbers the store once they make up half of it.
+   */
+  size_t removed_vertices_;
+
+  /**
+   * @brief post-processes the paths FindPath and FindOptimalPath return,
+   * nullptr when smoothing is off
+   */
+  std::unique_ptr<PathSmoother> smoother_;
+
+  /**
+   * @brief statistics of the latest FindPath or FindOptimalPath call
+   */
+  PlannerStats stats_;
+
+  /**
+   * @brief the threads FindPath grows the tree on, nullptr for the calling
+   * thread only
+   */
+  std::unique_ptr<ThreadPool> expansion_pool_;
+
+  /**
+   * @brief the state of each thread of expansion_pool_
+   */
+  std::vector<ExpansionWorker> expansion_workers_;
+
+  /**
+   * @brief the tree the threads of expansion_pool_ grow together, created by
+   * the first parallel search
+   */
+  std::unique_ptr<ConcurrentVertexStore> shared_tree_;
+
+  /**
+   * @brief how many vertices at the front of vertices_ shared_tree_ holds
+   * too, at the same indices
+   * @detail Vertices appended since are copied over at the start of the next
+   * parallel round. Zero when shared_tree_ has to be filled from scratch,
+   * after anything renumbers the tree.
+   */
+  size_t shared_tree_size_;
+
+  /**
+   * @brief scratch space for the neighbours found by FindOptimalPath
+   */
+  std::vector<uint32_t> neighbors_;
+
+  /**
+   * @brief scratch space for walking a subtree in UpdateSubtreeCosts
+   */
+  std::vector<uint32_t> subtree_stack_;
+
+  /**
+   * @brief adds a new vertex to the tree and to the nearest neighbour index
+   * @details also records the cost of the vertex, and remembers it if it has
+   * reached the goal
+   * @param location location of the new vertex
+   * @param parent index of the parent vertex
+   * @return the index of the new vertex
+   */
+  uint32_t AddVertex(Location, uint32_t);
+
+  /**
+   * @brief adds a new vertex to the tree but not to the k-d tree
+   * @details does everything else AddVertex does, for callers that add many
+   * vertices and then rebuild the k-d tree once with RebuildKdTree
+   * @param location location of the new vertex
+   * @param parent index of the parent vertex
+   * @return the index of the new vertex
+   */
+  uint32_t StoreVertex(Location, uint32_t);
+
+  /**
+   * @brief rebuilds kd_tree_ in one pass from every vertex not removed
+   */
+  void RebuildKdTree();
+
+  /**
+   * @brief number of iterations run by FindPath since the last Reset
+   */
+  int iterations_;
+
+  /**
+   * @brief generator for the random points the tree grows towards
+   * @details seeded once, when the planner is created or by SetSeed
+   */
+  Sampler sampler_;
+
+  /**
+   * @brief how the random points are chosen, UniformSampling by default
+   */
+  std::unique_ptr<SamplingStrategy> sampling_strategy_;
+
+  /**
+   * @brief random points that have been generated but not used yet
+   */
+  std::vector<Location> sample_buffer_;
+
+  /**
+   * @brief index of the next unused point in sample_buffer_
+   */
+  size_t next_sample_;
 
   /**
    * @brief returns a random location on the map
-   * @return a random location as a std::pair<xCoord:int, yCoord:int>
+   * @detail Points are handed out from sample_buffer_, which is refilled
+   * with RRTPath::kSampleBatchSize new points from the sampling strategy
+   * whenever it runs out.
+   * @return a random location on the map
+   */
+  Location GetRandomPoint();
+
+  /**
+   * @brief returns a random location that could lie on a cheaper path
+   * @detail Samples uniformly from the ellipse with the start and goal as
+   * foci whose points x satisfy |start - x| + |x - goal| <= maxCost. Samples
+   * that fall outside the map are retried, and after
+   * RRTPath::kInformedSampleAttempts tries a uniform sample is used instead.
+   * @param maxCost the length of the best path so far plus the goal radius
+   * @return a random location on the map
    */
-  std::pair<int, int> GetRandomPoint();
+  Location GetInformedPoint(double);
 
   /**
    * @brief returns the closest Vertex to the given point
-   * @detail Calculates the Euclidean distance between the given point and
-   * all Vertices to determine which Vertex is the closest.
+   * @detail Uses the method chosen by SetNearestNeighborMethod. Distances are
+   * compared as exact squared distances. When several vertices are
+   * equally close the most recently added one is returned.
    * @param randomPoint the point you want to find the nearest vertex to
-   * @return the nearest Vertex to the given point
+   * @return the index of the nearest vertex to the given point
    */
-  Vertex* GetClosestPoint(std::pair<int, int>);
+  uint32_t GetClosestPoint(Location);
 
   /**
    * @brief Expands the RRT between the Vertex and the given point
    * @detail Move epsilon distance from closestVertex towards the given point.
+   * With lazy collision checking on, only the new point itself is checked
+   * against the map here and the edge is left unchecked.
    * Make a call to Map::isSafe to make sure that the path between the vertex
    * and the point does not cause any collisions with obstacles. If the path
    * is safe create a new vertex with the point that is epsilon distance away
    * from the previous vertex, list the previous vertex as the new vertex's
-   * parent, and push the new vertex to the vertexList. Check to see if the
+   * parent, and add the new vertex to the vertex store. Check to see if the
    * new vertex has reached the goal. If so, calculate the path. If not,
    * generate a new random location and repeat.
-   * @param closestVertex The starting point of our expansion
+   * @param closestVertex index of the starting point of our expansion
    * @param randomPoint The point we are moving towards
    * @return true if the expansion was made, false if a collision would have
-   * occurred
+   * occurred or the step rounded back onto the vertex
    */
-  bool MoveTowardsPoint(Vertex*, std::pair<int, int>);
+  bool MoveTowardsPoint(uint32_t, Location);
+
+  /**
+   * @brief Expands the RRT from a vertex towards a point without overshooting
+   * @detail Like MoveTowardsPoint, but when the point is within epsilon of
+   * the vertex the new vertex is placed exactly on the point. Used by the
+   * greedy connect step of RRTConnectPath.
+   * @param fromVertex index of the vertex to expand from
+   * @param target the point we are moving towards
+   * @param newVertex set to the index of the added vertex, if any
+   * @return kTrapped if the step would collide or make no progress,
+   * kReached if the new vertex is on the target, kAdvanced otherwise
+   */
+  ExtendResult ExtendTowards(uint32_t, Location, uint32_t*);
+
+  /**
+   * @brief returns the point epsilon from a point towards a target
+   * @detail Always takes a full step, even past the target, rounding down
+   * for integer coordinates. A step towards the point itself goes along the
+   * first axis. This is the step MoveTowardsPoint takes.
+   * @param fromPoint the point to move from
+   * @param target the point we are moving towards
+   */
+  Location StepTowards(Location, Location);
+
+  /**
+   * @brief returns the point at most epsilon from a point towards a target
+   * @detail The target itself if it is within epsilon, otherwise the point
+   * epsilon along the way, rounded down for integer coordinates
+   * @param fromPoint the point to move from
+   * @param target the point we are moving towards
+   */
+  Location Steer(Location, Location);
+
+  /**
+   * @brief returns the radius RRT* looks for neighbours of a new vertex in
+   * @detail gamma * (log(n) / n)^(1/D) for n vertices, with gamma chosen
+   * from the volume of the map, but never more than epsilon
+   */
+  double GetNeighborRadius() const;
+
+  /**
+   * @brief adds the same amount to the cost of every vertex in a subtree
+   * @param root index of the vertex at the top of the subtree
+   * @param delta the change in cost
+   */
+  void UpdateSubtreeCosts(uint32_t, double);
+
+  /**
+   * @brief picks the cheapest vertex out of goal_vertices_
+   */
+  void UpdateBestGoalVertex();
+
+  /**
+   * @brief cuts the edges a new obstacle blocks and reattaches what it can
+   * @detail Only vertices near the obstacle are checked. Each blocked edge is
+   * cut, and the subtree below it is reattached through whichever of its
+   * vertices first has a safe edge to a connected vertex within epsilon,
+   * re-rooting the subtree at that vertex. Subtrees that can't be reattached
+   * are dropped and the tree is compacted.
+   * @param obs the obstacle that was added to the map
+   * @return the number of vertices dropped from the tree
+   */
+  size_t RepairTree(const Obstacle&);
+
+  /**
+   * @brief fully checks the unchecked edges on the path to a vertex
+   * @detail Walks from the vertex to the root checking every edge not yet
+   * checked with IsSafe. Edges that pass are marked as checked. Edges that
+   * fail are cut, and the subtrees below them are removed in place by
+   * RemoveSubtree, without renumbering the other vertices. The tree is only
+   * compacted once removed vertices make up half of the store.
+   * @param vertex index of the vertex at the end of the path
+   * @return true if every edge on the path is safe, false if any were cut
+   */
+  bool ValidatePath(uint32_t);
+
+  /**
+   * @brief removes a subtree that has been cut off from the tree
+   * @detail Every vertex of the subtree is taken out of the k-d tree and
+   * removed from the store, keeping its index. Goal vertices and the vertex
+   * closest to the goal are not updated here.
+   * @param top index of the vertex at the top of the subtree, which has no
+   * parent
+   * @return the number of vertices removed
+   */
+  size_t RemoveSubtree(uint32_t);
+
+  /**
+   * @brief rebuilds the tree from the vertices still connected to the root
+   * @detail Vertices are renumbered in breadth first order from the root, and
+   * the k-d tree, costs, goal vertices and best path are rebuilt to match.
+   * Vertices removed earlier are dropped too.
+   * @return the number of vertices dropped, not counting those already
+   * removed
+   */
+  size_t CompactTree();
 
   /**
    * @brief determines if we have reached the goal
@@ -110,61 +574,443 @@ class RRTPath {
    * @param the location of the newly created vertex
    * @return true if within goalRadius of goal, false otherwise
    */
-  bool ReachedGoal(std::pair<int, int>);
+  bool ReachedGoal(Location);
 
   /**
    * @brief the path between the start and goal
-   * @detail a std::list of std::pairs of the x,y coordinates of the vertices
+   * @detail a std::list of the locations of the vertices
    * traveled to get between the starting point and the ending point. This
    * function is called once the reachedGoal call returns true. The parameter
-   * vertex, goal, added to the list. Goals' prevVertex location is then
-   * pushed to the front of the list, continued on until we reach the root
-   * vertex, which will be designated by having a 0 instead of a Vertex in
-   * the prevVertex.
+   * vertex, goal, added to the list. The location of its parent is then
+   * pushed to the front of the list, following parent indices until we reach
+   * the root vertex, which has a parent of VertexStore::kNoParent.
+   * @param goal index of the vertex that reached the goal
+   */
+  std::list<Location> CalculatePath(uint32_t);
+
+  /**
+   * @brief the path between the start and a vertex, written into a vector
+   * @detail Like CalculatePath above, but the waypoints are stored in start
+   * to goal order in a vector the caller reuses, so once it has grown no
+   * memory is allocated.
+   * @param goal index of the vertex at the end of the path
+   * @param path resized to the length of the path and overwritten
+   */
+  void CalculatePath(uint32_t, std::vector<Location>*);
+
+  /**
+   * @brief the search loop shared by the budgeted FindPath overloads
+   * @detail Grows the tree until a vertex reaches the goal or the budget
+   * runs out, without building a path.
+   * @param budget the limits on the search
+   * @param iterations set to the number of iterations run
+   * @param vertex set to the vertex that reached the goal on success,
+   * otherwise to the vertex closest to the goal
+   * @return why the search ended
+   */
+  PlanningStatus Search(const PlanningBudget&, int*, uint32_t*);
+
+  /**
+   * @brief grows the tree on the calling thread for Search
+   * @param budget the limits on the search
+   * @param iterations increased by the number of iterations run
+   * @param vertex set to the vertex that reached the goal on success
+   * @return kSuccess, or why the budget ran out
    */
-  std::list<std::pair<int, int>> CalculatePath(Vertex*);
+  PlanningStatus Expand(const PlanningBudget&, int*, uint32_t*);
+
+  /**
+   * @brief grows the tree on the threads of expansion_pool_ for Search
+   * @detail Brings shared_tree_ up to date with the vertices added since the
+   * last round, runs every worker until one reaches the goal or the budget
+   * runs out, then copies the new vertices back with StoreVertex and
+   * rebuilds the k-d tree once. In lazy mode a path to the goal with a bad
+   * edge is pruned, from both trees, and another round is run.
+   * @param budget the limits on the search
+   * @param iterations increased by the number of iterations run
+   * @param vertex set to the vertex that reached the goal on success
+   * @return kSuccess, or why the budget ran out
+   */
+  PlanningStatus ExpandInParallel(const PlanningBudget&, int*, uint32_t*);
+
+  /**
+   * @brief the loop each worker of a parallel expansion runs
+   * @param worker index of the worker in expansion_workers_
+   * @param round the round being run
+   */
+  void RunExpansionWorker(size_t, ExpansionRound*);
+
+  /**
+   * @brief ends a round of parallel expansion, unless it has already ended
+   * @param round the round to end
+   * @param status why it ended
+   */
+  static void EndRound(ExpansionRound*, PlanningStatus);
+
+  /**
+   * @brief the path to a goal vertex as handed to the caller
+   * @detail CalculatePath, run through the path smoother if it is on
+   * @param goal index of the vertex that reached the goal
+   */
+  std::list<Location> GetFinalPath(uint32_t);
 
   /**
    * @brief returns the distance between two points
-   * @param startPoint a pair<int,int> that that indicates the first point
-   * @param endPoint a pair<int,int> that indicates the second point
+   * @param startPoint the first point
+   * @param endPoint the second point
    * @return returns a float of the distance between the two given points
    */
-  float GetDistance(std::pair<int, int>, std::pair<int, int>);
+  float GetDistance(Location, Location);
+
+  /**
+   * @brief the cheap check lazy collision checking makes on a new vertex
+   * @param point the location of the new vertex
+   * @return true if the point is on the map and outside every obstacle
+   */
+  bool IsPointFree(Location);
+
+  /**
+   * @brief IsPointFree, counting into the given statistics
+   * @details only reads the planner, so workers can call it at once
+   */
+  bool IsPointFree(Location, PlannerStats*) const;
 
   /**
    * @brief determines if a path between two points is safe
    * @details Determines if the path between the location of the currentVertex
    * and the point specified by newPoint is safe. Safe is defined as not
-   * passing through any obstacles or beyond the borders of the map.
+   * passing through any obstacles or beyond the borders of the map. With the
+   * default kSampledCollision model of the map, the endpoint and ten steps of
+   * epsilon/10 along the edge are checked. With kCircleCollision or
+   * kSquareCollision the whole edge is checked exactly by
+   * Map::SegmentCollides.
    * @param currentVertex the location to begin the path
    * @param newPoint the location to end the path
    * @return true if path does not collide, false if a collision would occur
    */
-  bool IsSafe(std::pair<int, int>, std::pair<int, int>);
+  bool IsSafe(Location, Location);
+
+  /**
+   * @brief IsSafe, counting into the given statistics
+   * @details only reads the planner, so workers can call it at once
+   */
+  bool IsSafe(Location, Location, PlannerStats*) const;
 
  public:
   /**
    * @brief Constructor for RRTPath
    * @param map the Map object that we will be traversing
+   * @param start the beginning of the path
+   * @param goal the location of the goal
+   * @param epsilon the distance the RRT expands when discovering a new point
+   * @param goalRadius how close to the goal is close enough
+   */
+  BasicRRTPath(Map, Location, Location, T, T);
+
+  /**
+   * @brief Constructor for RRTPath that shares a map instead of copying it
+   * @details takes the same arguments as the constructor above
+   */
+  BasicRRTPath(std::shared_ptr<const Map>, Location, Location, T, T);
+
+  /**
+   * @brief Constructor for RRTPath on a 2-D map
+   * @param map the Map object that we will be traversing
    * @param startXLocation the beginning x coordinate of the map
    * @param startYLocation the beginning y coordinate of the map
    * @param goalXLocation the x coordinate of the goal
    * @param goalYLocation the y coordinate of the goal
    * @param epsilon the distance the RRT expands when discovering a new point
-   * @param delta a subsampling distance to determine if a collision occurs
    * @param goalRadius how close to the goal is close enough
    */
-  RRTPath(Map, int, int, int, int, int, int);
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  BasicRRTPath(Map map, T start_x, T start_y, T goal_x, T goal_y, T epsilon,
+               T radius)
+      : BasicRRTPath(map, MakeLocation<D, T>(start_x, start_y),
+                     MakeLocation<D, T>(goal_x, goal_y), epsilon, radius) {}
+
+  /**
+   * @brief Constructor for RRTPath on a 2-D map that shares the map instead
+   * of copying it
+   * @details takes the same arguments as the constructor above
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  BasicRRTPath(std::shared_ptr<const Map> map, T start_x, T start_y,
+               T goal_x, T goal_y, T epsilon, T radius)
+      : BasicRRTPath(map, MakeLocation<D, T>(start_x, start_y),
+                     MakeLocation<D, T>(goal_x, goal_y), epsilon, radius) {}
 
   /**
    * @brief runs the rrt algorithm and finds the path
    * @detail The behavior is as described in the included activity diagram.
    * Until we reach our goal we continue to generate random points, locate
-   * their closest vertex and draw new, safe paths.
-   * @return returns the path as a std::list<std::pair<x, y>>
+   * their closest vertex and draw new, safe paths. If the stop flag given to
+   * SetStopFlag is set, the search gives up and returns an empty path.
+   * There is no other limit, so if the goal can't be reached this only
+   * returns when stopped; the overloads below take a budget.
+   * @return returns the path as a std::list of locations
    */
-  std::list<std::pair<int, int>> FindPath();
+  std::list<Location> FindPath();
+
+  /**
+   * @brief runs the rrt algorithm until it finds a path or runs out of budget
+   * @detail If the tree already reaches the goal, for example after
+   * AddObstacle repaired a tree that had found a path, that path is returned
+   * without running any iterations. The limits are checked before every
+   * iteration. The iteration
+   * limit counts the iterations of this call only, while the vertex limit is
+   * on the whole tree, including vertices added by earlier calls.
+   * @param budget the limits on the search
+   * @return the status, the iterations run and the path. If no path was
+   * found the path leads to the vertex that got closest to the goal.
+   */
+  PlanningResult FindPath(const PlanningBudget&);
+
+  /**
+   * @brief runs the rrt algorithm, writing the path into a reusable vector
+   * @detail Searches exactly like FindPath(const PlanningBudget&), but the
+   * path is written in start to goal order into the caller's vector instead
+   * of being built as a list and copied. A vector reused across queries
+   * stops allocating once it is long enough for the longest path. Smoothing
+   * applies as for the other overloads.
+   * @param budget the limits on the search
+   * @param path overwritten with the path to the goal on success, otherwise
+   * the path to the vertex closest to the goal
+   * @return why the search ended; GetIterationCount counts the iterations
+   */
+  PlanningStatus FindPath(const PlanningBudget&,
+                          std::vector<Location>*);
+
+  /**
+   * @brief runs the rrt algorithm for at most the given number of iterations
+   * @param maxIterations the most iterations to run, 0 for no limit
+   * @return as for FindPath(const PlanningBudget&)
+   */
+  PlanningResult FindPath(int);
+
+  /**
+   * @brief runs the rrt algorithm until the given deadline at the latest
+   * @param deadline the time by which to give up
+   * @return as for FindPath(const PlanningBudget&)
+   */
+  PlanningResult FindPath(std::chrono::steady_clock::time_point);
+
+  /**
+   * @brief runs RRT* to find a short path, improving on any earlier call
+   * @detail Each iteration samples a point (from the informed ellipse once a
+   * path is known), steers towards it from the closest vertex, connects the
+   * new vertex to whichever safe neighbour gives it the cheapest path and
+   * rewires the neighbours that get cheaper by going through it. Runs until
+   * either budget is spent; a budget of zero or less is no limit, and if
+   * neither budget is set nothing is done.
+   * @param maxIterations the most iterations to run
+   * @param maxSeconds the most time to run for, in seconds
+   * @return the best path found so far, empty if none has been found
+   */
+  std::list<Location> FindOptimalPath(int, double);
+
+  /**
+   * @brief returns the length of the best path found so far
+   * @return the cost of the path, or infinity if no path has been found
+   */
+  double GetPathCost() const;
+
+  /**
+   * @brief chooses how the closest vertex to a random point is found
+   * @param method kKdTree (the default) or kLinearScan
+   */
+  void SetNearestNeighborMethod(NearestNeighborMethod);
+
+  /**
+   * @brief chooses how the random points the tree grows towards are picked
+   * @details The planner keeps its own copy of the strategy, which is
+   * restarted by Reset and SetSeed. The default is UniformSampling.
+   * @param strategy the strategy to copy
+   */
+  void SetSamplingStrategy(const SamplingStrategy&);
+
+  /**
+   * @brief turns shortcutting of the paths found on or off
+   * @details When on, every path to the goal that FindPath or
+   * FindOptimalPath returns is post-processed by a PathSmoother, giving far
+   * fewer waypoints and a shorter path. Partial paths are left as they are.
+   * Off by default. SetSeed also seeds the smoother.
+   * @param enable true to smooth paths
+   * @param iterations the number of random shortcuts to try per path
+   * @param threadCount threads for checking the segments of long paths, 1 to
+   * use the calling thread only
+   */
+  void EnablePathSmoothing(bool, int = PathSmoother::kDefaultIterations,
+                           size_t = 1);
+
+  /**
+   * @brief turns lazy collision checking on or off
+   * @details When on, FindPath adds a new edge after checking only that its
+   * end is on the map and outside every obstacle. Full edge checks are put
+   * off until an edge lies on a path to the goal (or on the partial path
+   * returned when the budget runs out). Edges that fail are cut, the
+   * vertices below them are dropped, and the search carries on. On open
+   * maps, where nearly every edge is safe, this saves most of the collision
+   * checking. Paths returned are checked either way. Off by default, and
+   * FindOptimalPath always checks its edges as it adds them.
+   * @param enable true to defer edge checks
+   */
+  void SetLazyCollisionChecking(bool);
+
+  /**
+   * @brief grows the tree of FindPath on several threads at once
+   * @details With more than one thread, every FindPath overload grows the
+   * same tree on a pool of worker threads, each with its own random points
+   * drawn from a seed taken from this planner's generator. Vertices are
+   * found with a grid over the map rather than the nearest neighbour method
+   * chosen with SetNearestNeighborMethod. The tree grown, and so the path,
+   * then depends on how the threads are scheduled even with a seed. A
+   * vertex limit may be passed by one vertex per thread. Sampling strategies
+   * without any randomness, such as HaltonSampling without its random
+   * shift, give every thread the same points. FindOptimalPath always runs
+   * on the calling thread.
+   * @param threadCount the threads to use, 0 for one per hardware thread,
+   * 1 (the default) to grow the tree on the calling thread
+   */
+  void SetExpansionThreads(size_t);
+
+  /**
+   * @brief returns the number of threads FindPath grows the tree on
+   */
+  size_t GetExpansionThreadCount() const;
+
+  /**
+   * @brief sets a flag that stops FindPath and FindOptimalPath early
+   * @details The flag is checked once per iteration, so another thread can
+   * set it to cancel a search. The flag must outlive the planner, or be
+   * removed by passing nullptr.
+   * @param stopFlag the flag to check, or nullptr for none
+   */
+  void SetStopFlag(const std::atomic<bool>*);
+
+  /**
+   * @brief reseeds the random point generator
+   * @details Planners are seeded from std::random_device when they are
+   * created. Two planners with the same map, settings and seed grow exactly
+   * the same tree and find the same path.
+   * @param seed the seed to use
+   */
+  void SetSeed(uint64_t);
+
+  /**
+   * @brief clears the tree so the planner can answer a new query
+   * @details All vertices except the root are removed, the previous path
+   * is forgotten and the sampling strategy starts over. Memory is kept, so a
+   * planner that is reset and reused for many queries does not need to
+   * allocate once its storage has grown.
+   */
+  void Reset();
+
+  /**
+   * @brief clears the tree and sets a new start and goal
+   * @param start the beginning of the path
+   * @param goal the location of the goal
+   */
+  void Reset(const Location&, const Location&);
+
+  /**
+   * @brief clears the tree and sets a new start, goal, step and goal radius
+   * @param start the beginning of the path
+   * @param goal the location of the goal
+   * @param epsilon the distance the RRT expands when discovering a new point
+   * @param goalRadius how close to the goal is close enough
+   */
+  void Reset(const Location&, const Location&, T, T);
+
+  /**
+   * @brief clears the tree and sets a new start and goal on a 2-D map
+   * @param startXLocation the beginning x coordinate of the path
+   * @param startYLocation the beginning y coordinate of the path
+   * @param goalXLocation the x coordinate of the goal
+   * @param goalYLocation the y coordinate of the goal
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  void Reset(T start_x, T start_y, T goal_x, T goal_y) {
+    Reset(MakeLocation<D, T>(start_x, start_y),
+          MakeLocation<D, T>(goal_x, goal_y));
+  }
+
+  /**
+   * @brief clears the tree and sets a new start, goal, step and goal radius
+   * on a 2-D map
+   * @param startXLocation the beginning x coordinate of the path
+   * @param startYLocation the beginning y coordinate of the path
+   * @param goalXLocation the x coordinate of the goal
+   * @param goalYLocation the y coordinate of the goal
+   * @param epsilon the distance the RRT expands when discovering a new point
+   * @param goalRadius how close to the goal is close enough
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  void Reset(T start_x, T start_y, T goal_x, T goal_y, T epsilon, T radius) {
+    Reset(MakeLocation<D, T>(start_x, start_y),
+          MakeLocation<D, T>(goal_x, goal_y), epsilon, radius);
+  }
+
+  /**
+   * @brief adds an obstacle to the map while keeping the tree
+   * @details Edges blocked by the obstacle are cut and the subtrees below
+   * them reattached where possible, the rest being dropped, so FindPath can
+   * carry on from the repaired tree. The map is copied first if it is shared
+   * with other planners, which keep seeing the old map. Vertex indices and
+   * views are invalidated when vertices are dropped.
+   * @param obs the obstacle to add
+   * @return the number of vertices dropped from the tree
+   */
+  size_t AddObstacle(Obstacle);
+
+  /**
+   * @brief removes an obstacle from the map while keeping the tree
+   * @details Removing an obstacle can't block an edge, so the tree is kept as
+   * it is. As with AddObstacle, a shared map is copied first.
+   * @param obs the obstacle to remove
+   */
+  void RemoveObstacle(Obstacle);
+
+  /**
+   * @brief returns the number of iterations FindPath has run
+   * @details counts every random point sampled since the last Reset,
+   * whether or not the tree grew towards it
+   */
+  int GetIterationCount() const;
+
+  /**
+   * @brief returns the statistics of the latest search
+   * @details Covers the most recent call to FindPath or FindOptimalPath.
+   * Statistics are only collected in builds with RRT_PLANNER_STATS defined
+   * (the PLANNER_STATS CMake option); otherwise every counter stays zero.
+   */
+  const PlannerStats& GetStats() const;
+
+  /**
+   * @brief returns the number of vertices in the tree
+   * @details In lazy mode this includes vertices pruned since the tree was
+   * last compacted, which keep their indices until then
+   */
+  size_t GetVertexCount() const;
+
+  /**
+   * @brief returns a view of one vertex of the tree
+   * @details the view is invalidated by the next call to Reset
+   * @param index index of the vertex, less than GetVertexCount()
+   */
+  Vertex GetVertex(uint32_t) const;
 };
 
+/**
+ * @brief the planner for 2-D integer maps
+ */
+using RRTPath = BasicRRTPath<2, int>;
+
+/**
+ * @brief the planner for the other supported dimensions and scalar types
+ */
+using RRTPath2f = BasicRRTPath<2, float>;
+using RRTPath3i = BasicRRTPath<3, int>;
+using RRTPath3f = BasicRRTPath<3, float>;
+
 #endif /* INCLUDE_RRT_PATH_H_ */
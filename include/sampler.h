@@ -0,0 +1,82 @@
+/**
+ * @file Sampler.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Fast seedable random number generator for RRTPath
+ *
+ * @section DESCRIPTION
+ * The Sampler class generates the random points RRTPath grows its tree
+ * towards. It is seeded once, either with a user supplied seed or from
+ * std::random_device, and then produces numbers with the xoshiro256**
+ * generator, which is much cheaper than reseeding a std::mt19937 for every
+ * point. Points are produced in batches by FillPoints so the per-sample cost
+ * stays small. The same seed always produces the same sequence of numbers.
+ */
+
+#ifndef INCLUDE_SAMPLER_H_
+#define INCLUDE_SAMPLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+class Sampler {
+ private:
+  /**
+   * @brief the 256 bits of xoshiro256** state
+   */
+  uint64_t state_[4];
+
+ public:
+  /**
+   * @brief constructor for a Sampler seeded from std::random_device
+   */
+  Sampler();
+
+  /**
+   * @brief constructor for a Sampler with a fixed seed
+   * @param seed the seed, equal seeds give equal sequences
+   */
+  explicit Sampler(uint64_t);
+
+  /**
+   * @brief restarts the generator from the given seed
+   * @param seed the seed, equal seeds give equal sequences
+   */
+  void Seed(uint64_t);
+
+  /**
+   * @brief restarts the generator from a seed read from std::random_device
+   */
+  void SeedFromDevice();
+
+  /**
+   * @brief returns the next 64 random bits
+   */
+  uint64_t Next();
+
+  /**
+   * @brief returns a uniformly distributed integer in [0, range)
+   * @param range the number of possible values, must be at least 1
+   */
+  uint32_t NextBounded(uint32_t);
+
+  /**
+   * @brief returns a uniformly distributed double in [0, 1)
+   */
+  double NextDouble();
+
+  /**
+   * @brief fills a buffer with uniformly distributed points
+   * @details Each point is in [0, maxX] x [0, maxY], matching the bounds of a
+   * Map of size maxX by maxY.
+   * @param points the buffer to fill
+   * @param count number of points to generate
+   * @param maxX largest x coordinate, at least 0
+   * @param maxY largest y coordinate, at least 0
+   */
+  void FillPoints(std::pair<int, int>*, size_t, int, int);
+};
+
+#endif /* INCLUDE_SAMPLER_H_ */
@@ -0,0 +1,210 @@
+/**
+ * @file SamplingStrategy.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Ways of choosing the random points an RRT grows towards
+ *
+ * @section DESCRIPTION
+ * A SamplingStrategy fills RRTPath's buffer of random points. RRTPath uses
+ * UniformSampling by default, which samples every map location with equal
+ * probability. GoalBiasedSampling returns the goal itself with a fixed
+ * probability, which pulls the tree towards the goal on open maps.
+ * HaltonSampling and SobolSampling use low-discrepancy sequences, which cover
+ * the map more evenly than independent random points.
+ *
+ * Every strategy draws any randomness it needs from the planner's Sampler,
+ * so a seeded planner produces the same points with any strategy. The
+ * low-discrepancy sequences are deterministic; by default they are shifted
+ * by a random offset (a Cranley-Patterson rotation) drawn from the Sampler
+ * whenever they restart, so planners with different seeds still explore
+ * differently. Strategies keep state, so each planner holds its own copy,
+ * made with Clone.
+ *
+ * Every strategy is a template on the dimension D and coordinate type T of
+ * the planner it feeds. SamplingStrategy, UniformSampling and the rest are
+ * the 2-D integer instantiations used by RRTPath.
+ */
+
+#ifndef INCLUDE_SAMPLING_STRATEGY_H_
+#define INCLUDE_SAMPLING_STRATEGY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "point.h"
+#include "sampler.h"
+
+template <int D, typename T>
+class BasicSamplingStrategy {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+  virtual ~BasicSamplingStrategy() {}
+
+  /**
+   * @brief returns a new copy of this strategy, owned by the caller
+   */
+  virtual BasicSamplingStrategy* Clone() const = 0;
+
+  /**
+   * @brief restarts the strategy, called when the planner is reset or
+   * reseeded
+   */
+  virtual void Reset() {}
+
+  /**
+   * @brief fills a buffer with points to grow the tree towards
+   * @param sampler the planner's random number generator
+   * @param points the buffer to fill
+   * @param count number of points to generate
+   * @param mapSize the size of the map, points are in [0, mapSize.first] x
+   * [0, mapSize.second], and likewise along every further axis
+   * @param goal the goal location of the planner
+   */
+  virtual void FillPoints(Sampler*, Location*, size_t, Location,
+                          Location) = 0;
+};
+
+/**
+ * @brief samples every map location with equal probability
+ */
+template <int D, typename T>
+class BasicUniformSampling : public BasicSamplingStrategy<D, T> {
+ public:
+  typedef typename BasicSamplingStrategy<D, T>::Location Location;
+
+  BasicSamplingStrategy<D, T>* Clone() const override;
+  void FillPoints(Sampler*, Location*, size_t, Location, Location) override;
+};
+
+/**
+ * @brief samples the goal with a fixed probability, and the map uniformly
+ * otherwise
+ */
+template <int D, typename T>
+class BasicGoalBiasedSampling : public BasicSamplingStrategy<D, T> {
+ public:
+  typedef typename BasicSamplingStrategy<D, T>::Location Location;
+
+ private:
+  /**
+   * @brief the probability of sampling the goal
+   */
+  double goal_probability_;
+
+ public:
+  /**
+   * @brief constructor for GoalBiasedSampling
+   * @param goalProbability the probability of sampling the goal, in [0, 1]
+   */
+  explicit BasicGoalBiasedSampling(double);
+
+  BasicSamplingStrategy<D, T>* Clone() const override;
+  void FillPoints(Sampler*, Location*, size_t, Location, Location) override;
+};
+
+/**
+ * @brief samples the Halton sequence, with bases 2 and 3 in 2-D and the
+ * next primes for further axes
+ */
+template <int D, typename T>
+class BasicHaltonSampling : public BasicSamplingStrategy<D, T> {
+ public:
+  typedef typename BasicSamplingStrategy<D, T>::Location Location;
+
+ private:
+  /**
+   * @brief index of the next point of the sequence
+   */
+  uint32_t index_;
+
+  /**
+   * @brief whether the sequence is shifted by a random offset
+   */
+  bool randomized_;
+
+  /**
+   * @brief true once the offset for the current run has been drawn
+   */
+  bool shifted_;
+
+  /**
+   * @brief the random offset added to each coordinate, modulo 1
+   */
+  double shift_[D];
+
+ public:
+  /**
+   * @brief constructor for HaltonSampling
+   * @param randomized shift the sequence by a random offset (the default)
+   */
+  explicit BasicHaltonSampling(bool = true);
+
+  BasicSamplingStrategy<D, T>* Clone() const override;
+  void Reset() override;
+  void FillPoints(Sampler*, Location*, size_t, Location, Location) override;
+};
+
+/**
+ * @brief samples the Sobol sequence, in up to four dimensions
+ */
+template <int D, typename T>
+class BasicSobolSampling : public BasicSamplingStrategy<D, T> {
+  static_assert(D <= 4, "Sobol direction numbers are only kept for up to "
+                "four dimensions");
+
+ public:
+  typedef typename BasicSamplingStrategy<D, T>::Location Location;
+
+ private:
+  /**
+   * @brief number of points generated since the sequence started
+   */
+  uint32_t index_;
+
+  /**
+   * @brief the current point, as 32-bit binary fractions
+   */
+  uint32_t point_[D];
+
+  /**
+   * @brief whether the sequence is shifted by a random offset
+   */
+  bool randomized_;
+
+  /**
+   * @brief true once the offset for the current run has been drawn
+   */
+  bool shifted_;
+
+  /**
+   * @brief the random offset added to each coordinate, modulo 1
+   */
+  double shift_[D];
+
+ public:
+  /**
+   * @brief constructor for SobolSampling
+   * @param randomized shift the sequence by a random offset (the default)
+   */
+  explicit BasicSobolSampling(bool = true);
+
+  BasicSamplingStrategy<D, T>* Clone() const override;
+  void Reset() override;
+  void FillPoints(Sampler*, Location*, size_t, Location, Location) override;
+};
+
+/**
+ * @brief the sampling strategies of the 2-D integer RRTPath
+ */
+using SamplingStrategy = BasicSamplingStrategy<2, int>;
+using UniformSampling = BasicUniformSampling<2, int>;
+using GoalBiasedSampling = BasicGoalBiasedSampling<2, int>;
+using HaltonSampling = BasicHaltonSampling<2, int>;
+using SobolSampling = BasicSobolSampling<2, int>;
+
+#endif /* INCLUDE_SAMPLING_STRATEGY_H_ */
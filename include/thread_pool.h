@@ -0,0 +1,101 @@
+/**
+ * @file ThreadPool.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Fixed size pool of worker threads
+ *
+ * @section DESCRIPTION
+ * The ThreadPool class starts a fixed number of worker threads once and hands
+ * them tasks from a shared queue, so planners that run many searches in
+ * parallel don't pay for creating threads on every query. Wait blocks until
+ * every submitted task has finished. The workers are stopped and joined when
+ * the pool is destroyed.
+ */
+
+#ifndef INCLUDE_THREAD_POOL_H_
+#define INCLUDE_THREAD_POOL_H_
+
+#include <stddef.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+ private:
+  /**
+   * @brief the worker threads
+   */
+  std::vector<std::thread> workers_;
+
+  /**
+   * @brief tasks that have been submitted but not started
+   */
+  std::queue<std::function<void()>> tasks_;
+
+  /**
+   * @brief guards tasks_, active_ and stopping_
+   */
+  std::mutex mutex_;
+
+  /**
+   * @brief signalled when a task is queued or the pool is stopping
+   */
+  std::condition_variable task_ready_;
+
+  /**
+   * @brief signalled when the last running task finishes
+   */
+  std::condition_variable all_done_;
+
+  /**
+   * @brief number of tasks currently being run by a worker
+   */
+  size_t active_;
+
+  /**
+   * @brief set by the destructor to make the workers exit
+   */
+  bool stopping_;
+
+  /**
+   * @brief the loop each worker runs, taking tasks until the pool stops
+   */
+  void WorkerLoop();
+
+ public:
+  /**
+   * @brief constructor that starts the worker threads
+   * @param threadCount number of workers, 0 for one per hardware thread
+   */
+  explicit ThreadPool(size_t);
+
+  /**
+   * @brief finishes the queued tasks, then stops and joins the workers
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief queues a task to be run by the next free worker
+   * @param task the task to run
+   */
+  void Submit(std::function<void()>);
+
+  /**
+   * @brief blocks until every submitted task has finished
+   */
+  void Wait();
+
+  /**
+   * @brief returns the number of worker threads
+   */
+  size_t GetThreadCount() const;
+};
+
+#endif /* INCLUDE_THREAD_POOL_H_ */
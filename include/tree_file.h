@@ -0,0 +1,91 @@
+/**
+ * @file TreeFile.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Saving and reloading the exploration tree of an RRTPath
+ *
+ * @section DESCRIPTION
+ * Queries on a static map often start from a handful of fixed locations, and
+ * growing the tree from scratch for each of them repeats the same work. The
+ * TreeFile class saves the tree of an RRTPath to a compact binary file and
+ * loads it back into a planner with the same start, so that FindPath carries
+ * on growing the saved tree and, once the tree covers the map, usually needs
+ * only a few iterations to reach a new goal.
+ *
+ * The file is a fixed size header followed by one record of three 32 bit
+ * numbers (x, y, parent index) per vertex. Vertices are written in breadth
+ * first order from the root, so every parent comes before its children and
+ * the root, at index 0, is the only vertex without a parent. The header
+ * holds the start location, the step size and Map::GetFingerprint of the map
+ * the tree was grown on, and a tree is only loaded into a planner whose
+ * start, step and map all match, as its edges were only checked against
+ * that map. The goal and goal radius are not saved, so the same tree serves
+ * every goal. As with MapFile, numbers are stored in the byte order of the
+ * writing machine, which the header records, and the header holds a version
+ * number, TreeFile::kVersion.
+ */
+
+#ifndef INCLUDE_TREE_FILE_H_
+#define INCLUDE_TREE_FILE_H_
+
+#include <stdint.h>
+#include <string>
+#include "rrt_path.h"
+
+class TreeFile {
+ private:
+  /**
+   * @brief the header at the start of every tree file
+   */
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t map_fingerprint;
+    int32_t start_x;
+    int32_t start_y;
+    int32_t epsilon;
+    uint32_t reserved;
+    uint64_t vertex_count;
+  };
+
+  /**
+   * @brief one vertex of the tree as it is stored in the file
+   */
+  struct Record {
+    int32_t x;
+    int32_t y;
+    uint32_t parent;
+  };
+
+ public:
+  /**
+   * @brief the version of the file layout written by Save
+   */
+  static const uint32_t kVersion = 1;
+
+  /**
+   * @brief writes the tree of a planner to a file
+   * @param planner the planner whose tree to write
+   * @param path the file to create or overwrite
+   * @return false if the file could not be written
+   */
+  static bool Save(const RRTPath&, const std::string&);
+
+  /**
+   * @brief replaces the tree of a planner with a saved tree
+   * @details The planner is reset and then given every vertex of the file,
+   * so costs, the nearest neighbour index and the vertices within the goal
+   * radius are rebuilt for the planner's own goal. If the tree already
+   * reaches that goal, the next FindPath returns a path straight away. The
+   * planner is left as it was if the file can't be loaded.
+   * @param path the file to read
+   * @param planner the planner to load the tree into
+   * @return false if the file can't be read, isn't a valid tree file, or was
+   * saved from a planner with a different start, step or map
+   */
+  static bool Load(const std::string&, RRTPath*);
+};
+
+#endif /* INCLUDE_TREE_FILE_H_ */
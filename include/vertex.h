@@ -8,72 +8,93 @@
  * @section DESCRIPTION
  * The Vertex class is a dependency for RRTPath. It specifies a location
  * on the RRTPath's map and the vertex that came before it.
+ *
+ * A Vertex is a lightweight view of one entry of a VertexStore, made of a
+ * pointer to the store and the index of the vertex within it. The store owns
+ * the data, so a Vertex is cheap to copy and is only valid while its store is
+ * alive and has not been reset. Vertex is the view into a 2-D integer
+ * VertexStore.
  */
 
 #ifndef INCLUDE_VERTEX_H_
 #define INCLUDE_VERTEX_H_
 
+#include <stdint.h>
 #include <utility>
-#include <list>
+#include "point.h"
+#include "vertex_store.h"
 
-class Vertex {
- private:
+template <int D, typename T>
+class BasicVertex {
+ public:
   /**
-   * @brief the x coordinate of the vertex
+   * @brief the type of a location
    */
-  int x_;
+  typedef typename PointTraits<D, T>::Location Location;
 
+ private:
   /**
-   * @brief the y coordinate of the vertex
+   * @brief the store holding the vertex
    */
-  int y_;
+  const BasicVertexStore<D, T>* store_;
 
   /**
-   * @brief the vertex that came before this one
+   * @brief the index of the vertex within the store
    */
-  Vertex* parent_;
-
-
+  uint32_t index_;
 
  public:
   /**
    * @brief constructor for a Vertex
-   * @param x x coordinate of vertex
-   * @param y y coordinate of vertex
-   * @param prevVertex location of the vertex that led to this one, nullptr
-   * if root
+   * @param store the VertexStore holding the vertex
+   * @param index index of the vertex within the store
    */
-  Vertex(int, int, Vertex*);
+  BasicVertex(const BasicVertexStore<D, T>*, uint32_t);
 
   /**
    * @brief gets location of vertex
    * @return returns std::pair<x,y>
    */
-  std::pair<int, int> get_location();
+  Location get_location() const;
+
+  /**
+   * @brief gets the index of the vertex within its store
+   */
+  uint32_t get_index() const;
+
+  /**
+   * @brief checks whether the vertex has a parent
+   * @return false for the root vertex, true otherwise
+   */
+  bool has_parent() const;
 
   /**
    * @brief gets the previous vertex
+   * @details must not be called on the root vertex, see has_parent
    * @return the parent vertex
    */
-  Vertex* get_parent();
+  BasicVertex get_parent() const;
 
   /**
    * @brief overload of == operator
    */
-  bool operator==(const Vertex& v) {
-    return (x_ == v.x_ &&
-        y_ == v.y_ &&
-        parent_ == v.parent_);
+  bool operator==(const BasicVertex& v) const {
+    return (store_ == v.store_ &&
+        index_ == v.index_);
   }
 
   /**
    * @brief overload of != operator
    */
-  bool operator!=(const Vertex&v) {
-    return (x_ != v.x_ ||
-        y_ != v.y_ ||
-        parent_ != v.parent_);
+  bool operator!=(const BasicVertex&v) const {
+    return (store_ != v.store_ ||
+        index_ != v.index_);
   }
 };
 
+/**
+ * @brief a vertex of the 2-D integer RRTPath
+ */
+using Vertex = BasicVertex<2, int>;
+
 #endif /* INCLUDE_VERTEX_H_ */
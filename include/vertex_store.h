@@ -0,0 +1,245 @@
+/**
+ * @file VertexStore.h
+ * @author Jessica Howard
+ * @copyright GNU public license
+ *
+ * @brief Contiguous storage for the vertices of an RRT
+ *
+ * @section DESCRIPTION
+ * The VertexStore class holds every vertex of an RRTPath tree. Vertices are
+ * kept as a struct of arrays: one array per coordinate axis, x first, and
+ * one of parent indices. A vertex is identified by its index
+ * in these arrays, and the root has a parent of VertexStore::kNoParent.
+ * The children of each vertex are also linked together (first child and next
+ * sibling indices) so that subtrees can be walked, and a vertex can be moved
+ * to a new parent with SetParent.
+ *
+ * Remove takes a vertex out of the tree without renumbering the rest. Its
+ * index stays taken, and it is parked at VertexStore::kRemovedCoordinate on
+ * every axis, so far from any map that a nearest point scan over the
+ * coordinate arrays passes over it as long as a single vertex on the map is
+ * left.
+ *
+ * Reset empties the store but keeps its capacity, so a planner that is
+ * reused for many queries stops allocating once its store has grown.
+ *
+ * BasicVertexStore<D, T> stores vertices with D coordinates of type T.
+ * VertexStore is the 2-D integer instantiation.
+ */
+
+#ifndef INCLUDE_VERTEX_STORE_H_
+#define INCLUDE_VERTEX_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "point.h"
+
+template <int D, typename T>
+class BasicVertexStore {
+ public:
+  /**
+   * @brief the type of a location
+   */
+  typedef typename PointTraits<D, T>::Location Location;
+
+ private:
+  /**
+   * @brief every coordinate of every vertex, one array per axis
+   */
+  std::vector<T> coordinates_[D];
+
+  /**
+   * @brief the index of the parent of every vertex
+   */
+  std::vector<uint32_t> parent_;
+
+  /**
+   * @brief the index of the most recently attached child of every vertex
+   */
+  std::vector<uint32_t> first_child_;
+
+  /**
+   * @brief the index of the next child of the same parent, for every vertex
+   */
+  std::vector<uint32_t> next_sibling_;
+
+ public:
+  /**
+   * @brief parent index of the root vertex
+   */
+  static const uint32_t kNoParent = 0xFFFFFFFF;
+
+  /**
+   * @brief child and sibling index meaning there are no more children
+   */
+  static const uint32_t kNoChild = 0xFFFFFFFF;
+
+  /**
+   * @brief parent index of a removed vertex
+   */
+  static const uint32_t kRemoved = 0xFFFFFFFE;
+
+  /**
+   * @brief every coordinate of a removed vertex
+   */
+  static constexpr T kRemovedCoordinate = -(1 << 29);
+
+  /**
+   * @brief adds a vertex to the store
+   * @param location location of the vertex
+   * @param parent index of the parent vertex, VertexStore::kNoParent if root
+   * @return the index of the new vertex
+   */
+  uint32_t Add(const Location&, uint32_t);
+
+  /**
+   * @brief adds a vertex to the store
+   * @param x x coordinate of the vertex
+   * @param y y coordinate of the vertex
+   * @param parent index of the parent vertex, VertexStore::kNoParent if root
+   * @return the index of the new vertex
+   */
+  template <int N = D, typename std::enable_if<N == 2, int>::type = 0>
+  uint32_t Add(T x, T y, uint32_t parent) {
+    return Add(MakeLocation<D, T>(x, y), parent);
+  }
+
+  /**
+   * @brief moves a vertex, along with its subtree, to a new parent
+   * @details the new parent must not be in the subtree of the vertex
+   * @param index index of the vertex to move
+   * @param parent index of the new parent
+   */
+  void SetParent(uint32_t, uint32_t);
+
+  /**
+   * @brief removes one vertex from the tree, keeping its index
+   * @details The vertex must have no parent, or a removed one, and each of
+   * its children must be removed too. Cut a subtree off with SetParent
+   * first, then remove all of it.
+   * @param index index of the vertex to remove
+   */
+  void Remove(uint32_t);
+
+  /**
+   * @brief checks whether a vertex has been removed
+   * @param index index of the vertex
+   */
+  bool IsRemoved(uint32_t index) const {
+    return parent_[index] == kRemoved;
+  }
+
+  /**
+   * @brief removes every vertex while keeping the allocated capacity
+   */
+  void Reset();
+
+  /**
+   * @brief makes room for the given number of vertices
+   * @param capacity number of vertices to make room for
+   */
+  void Reserve(size_t);
+
+  /**
+   * @brief returns the number of vertices in the store
+   */
+  size_t Size() const {
+    return parent_.size();
+  }
+
+  /**
+   * @brief gets one coordinate of a vertex
+   * @param index index of the vertex
+   * @param axis the axis, less than D
+   */
+  T GetCoordinate(uint32_t index, int axis) const {
+    return coordinates_[axis][index];
+  }
+
+  /**
+   * @brief gets the x coordinate of a vertex
+   * @param index index of the vertex
+   */
+  T GetX(uint32_t index) const {
+    return coordinates_[0][index];
+  }
+
+  /**
+   * @brief gets the y coordinate of a vertex
+   * @param index index of the vertex
+   */
+  T GetY(uint32_t index) const {
+    return coordinates_[1][index];
+  }
+
+  /**
+   * @brief gets the location of a vertex
+   * @param index index of the vertex
+   * @return std::pair<x,y>
+   */
+  Location GetLocation(uint32_t index) const {
+    Location location;
+    for (int axis = 0; axis < D; axis++)
+      SetCoordinate(&location, axis, coordinates_[axis][index]);
+    return location;
+  }
+
+  /**
+   * @brief gets the parent of a vertex
+   * @param index index of the vertex
+   * @return the index of the parent, VertexStore::kNoParent for the root
+   */
+  uint32_t GetParent(uint32_t index) const {
+    return parent_[index];
+  }
+
+  /**
+   * @brief gets the first child of a vertex
+   * @param index index of the vertex
+   * @return index of a child, VertexStore::kNoChild if there are none
+   */
+  uint32_t GetFirstChild(uint32_t index) const {
+    return first_child_[index];
+  }
+
+  /**
+   * @brief gets the next child of a vertex's parent
+   * @param index index of the vertex
+   * @return index of the next sibling, VertexStore::kNoChild after the last
+   */
+  uint32_t GetNextSibling(uint32_t index) const {
+    return next_sibling_[index];
+  }
+
+  /**
+   * @brief the contiguous array of coordinates along one axis, Size() long
+   * @param axis the axis, less than D
+   */
+  const T* Data(int axis) const {
+    return coordinates_[axis].data();
+  }
+
+  /**
+   * @brief the contiguous array of x coordinates, Size() long
+   */
+  const T* XData() const {
+    return coordinates_[0].data();
+  }
+
+  /**
+   * @brief the contiguous array of y coordinates, Size() long
+   */
+  const T* YData() const {
+    return coordinates_[1].data();
+  }
+};
+
+/**
+ * @brief the vertex store of the 2-D integer RRTPath
+ */
+using VertexStore = BasicVertexStore<2, int>;
+
+#endif /* INCLUDE_VERTEX_STORE_H_ */
@@ -9,10 +9,38 @@
 #define private public
 #include <rrt_path.h>
 #undef private
+#include <nearest_kernel.h>
+#include <rrt_connect_path.h>
+#include <parallel_rrt_path.h>
+#include <batch_rrt_path.h>
+#include <concurrent_vertex_store.h>
+#include <map_file.h>
+#include <path_smoother.h>
+#include <path_writer.h>
+#include <prm_path.h>
+#include <tree_file.h>
+#include <sampling_strategy.h>
+#include <thread_pool.h>
 
 #include <gtest/gtest.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
 #include <utility>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <vector>
 
 /**
  * @brief tests the location part of the Obstacle class
@@ -57,14 +85,77 @@ TEST(obstacle, overloads) {
   EXPECT_NE(a, c);
 }
 
+/**
+ * @brief tests the closed form segment tests of Obstacle
+ */
+TEST(obstacle, segment_intersection) {
+  Obstacle obs(10, 10, 3);
+  typedef std::pair<int, int> Point;
+
+  // Straight through the middle
+  EXPECT_TRUE(obs.SegmentIntersectsCircle(Point(0, 10), Point(20, 10)));
+  EXPECT_TRUE(obs.SegmentIntersectsSquare(Point(0, 10), Point(20, 10)));
+
+  // Running along the edge of the square and tangent to the circle
+  EXPECT_FALSE(obs.SegmentIntersectsCircle(Point(0, 13), Point(20, 13)));
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(0, 13), Point(20, 13)));
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(7, 0), Point(7, 20)));
+
+  // Through a corner of the square that the circle doesn't cover
+  EXPECT_FALSE(obs.SegmentIntersectsCircle(Point(11, 14), Point(14, 11)));
+  EXPECT_TRUE(obs.SegmentIntersectsSquare(Point(11, 14), Point(14, 11)));
+
+  // Exactly touching a corner of the square
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(12, 14), Point(14, 12)));
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(13, 20), Point(13, 13)));
+
+  // Stopping short, starting inside, and single points
+  EXPECT_FALSE(obs.SegmentIntersectsCircle(Point(0, 10), Point(7, 10)));
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(0, 10), Point(7, 10)));
+  EXPECT_TRUE(obs.SegmentIntersectsCircle(Point(10, 10), Point(30, 30)));
+  EXPECT_TRUE(obs.SegmentIntersectsSquare(Point(30, 30), Point(12, 12)));
+  EXPECT_TRUE(obs.SegmentIntersectsCircle(Point(12, 12), Point(12, 12)));
+  EXPECT_TRUE(obs.SegmentIntersectsSquare(Point(12, 12), Point(12, 12)));
+  EXPECT_FALSE(obs.SegmentIntersectsCircle(Point(13, 10), Point(13, 10)));
+  EXPECT_FALSE(obs.SegmentIntersectsSquare(Point(13, 10), Point(13, 10)));
+
+  // Random segments agree with dense sampling wherever sampling finds a hit
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<> coordinate(0, 20);
+  for (int i = 0; i < 2000; i++) {
+    Point start(coordinate(gen), coordinate(gen));
+    Point end(coordinate(gen), coordinate(gen));
+    bool circle = false, square = false;
+    for (int step = 0; step <= 1000; step++) {
+      double x = start.first + (end.first - start.first) * step / 1000.0;
+      double y = start.second + (end.second - start.second) * step / 1000.0;
+      circle = circle || (x - 10) * (x - 10) + (y - 10) * (y - 10) < 9 - 1e-9;
+      square = square || (std::abs(x - 10) < 3 - 1e-9 &&
+                          std::abs(y - 10) < 3 - 1e-9);
+    }
+    if (circle) {
+      EXPECT_TRUE(obs.SegmentIntersectsCircle(start, end));
+    }
+    if (square) {
+      EXPECT_TRUE(obs.SegmentIntersectsSquare(start, end));
+    }
+    // The circle fits inside the square
+    if (obs.SegmentIntersectsCircle(start, end)) {
+      EXPECT_TRUE(obs.SegmentIntersectsSquare(start, end));
+    }
+  }
+}
+
 /**
  * @brief tests the location of the Vertex class
  */
 TEST(vertex, location) {
   // Create vertex, check location
-  Vertex vertex(5, 7, nullptr);
+  VertexStore store;
+  Vertex vertex(&store, store.Add(5, 7, VertexStore::kNoParent));
   EXPECT_EQ(vertex.get_location().first, 5);
   EXPECT_EQ(vertex.get_location().second, 7);
+  EXPECT_FALSE(vertex.has_parent());
 }
 
 /**
@@ -74,11 +165,385 @@ TEST(vertex, previous_vertex) {
   // Create a root vertex and a child
   // Check that the root is the child's parent
   // Check that the location of the root is correct
-  Vertex *root = new Vertex(5, 7, nullptr);
-  Vertex nextVertex(10, 12, root);
+  VertexStore store;
+  Vertex root(&store, store.Add(5, 7, VertexStore::kNoParent));
+  Vertex nextVertex(&store, store.Add(10, 12, root.get_index()));
+  EXPECT_TRUE(nextVertex.has_parent());
   EXPECT_EQ(root, nextVertex.get_parent());
-  EXPECT_EQ(root->get_location().first, 5);
-  EXPECT_EQ(root->get_location().second, 7);
+  EXPECT_NE(root, nextVertex);
+  EXPECT_EQ(nextVertex.get_parent().get_location().first, 5);
+  EXPECT_EQ(nextVertex.get_parent().get_location().second, 7);
+}
+
+/**
+ * @brief tests that resetting a VertexStore keeps its capacity
+ */
+TEST(vertex, store_reset) {
+  VertexStore store;
+  store.Reserve(1000);
+  const int *xs = store.XData();
+  for (int i = 0; i < 1000; i++)
+    store.Add(i, -i, i == 0 ? VertexStore::kNoParent : i - 1);
+  EXPECT_EQ(store.Size(), 1000u);
+  EXPECT_EQ(store.GetParent(999), 998u);
+  EXPECT_EQ(store.GetY(999), -999);
+
+  // The arrays are reused after a reset rather than reallocated
+  store.Reset();
+  EXPECT_EQ(store.Size(), 0u);
+  store.Add(1, 2, VertexStore::kNoParent);
+  EXPECT_EQ(store.XData(), xs);
+}
+
+/**
+ * @brief tests that children follow SetParent
+ */
+TEST(vertex, store_reparent) {
+  VertexStore store;
+  store.Add(0, 0, VertexStore::kNoParent);
+  store.Add(1, 0, 0);
+  store.Add(2, 0, 0);
+  store.Add(3, 0, 1);
+  EXPECT_EQ(store.GetFirstChild(0), 2u);
+  EXPECT_EQ(store.GetNextSibling(2), 1u);
+  EXPECT_EQ(store.GetNextSibling(1), VertexStore::kNoChild);
+
+  // Moving vertex 1 under vertex 2 takes its child along with it
+  store.SetParent(1, 2);
+  EXPECT_EQ(store.GetParent(1), 2u);
+  EXPECT_EQ(store.GetFirstChild(0), 2u);
+  EXPECT_EQ(store.GetNextSibling(2), VertexStore::kNoChild);
+  EXPECT_EQ(store.GetFirstChild(2), 1u);
+  EXPECT_EQ(store.GetFirstChild(1), 3u);
+}
+
+/**
+ * @brief tests the KdTree against a brute force search
+ */
+TEST(kd_tree, nearest) {
+  // An empty tree has no nearest point
+  KdTree tree;
+  EXPECT_EQ(tree.Nearest(0, 0), KdTree::kNoId);
+
+  // Insert enough clustered points to force plenty of bucket splits
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> coordinate(0, 200);
+  std::vector<std::pair<int, int>> points;
+  for (uint32_t i = 0; i < 3000; i++) {
+    std::pair<int, int> point(coordinate(gen), coordinate(gen) / 4);
+    points.push_back(point);
+    tree.Insert(point.first, point.second, i);
+  }
+  EXPECT_EQ(tree.Size(), points.size());
+
+  // Every query should match a linear scan, including which of several
+  // equally close points is picked (the one with the largest id)
+  for (int q = 0; q < 500; q++) {
+    int x = coordinate(gen) - 20;
+    int y = coordinate(gen) - 20;
+    uint32_t expected = 0;
+    int64_t expected_distance = INT64_MAX;
+    for (uint32_t i = 0; i < points.size(); i++) {
+      int64_t dx = points[i].first - x;
+      int64_t dy = points[i].second - y;
+      if (dx * dx + dy * dy <= expected_distance) {
+        expected_distance = dx * dx + dy * dy;
+        expected = i;
+      }
+    }
+    int64_t distance;
+    EXPECT_EQ(tree.Nearest(x, y, &distance), expected);
+    EXPECT_EQ(distance, expected_distance);
+  }
+
+  // Clearing empties the tree
+  tree.Clear();
+  EXPECT_EQ(tree.Size(), 0u);
+  EXPECT_EQ(tree.Nearest(0, 0), KdTree::kNoId);
+}
+
+/**
+ * @brief tests that many points in one location do not break the KdTree
+ */
+TEST(kd_tree, duplicates) {
+  KdTree tree;
+  for (uint32_t i = 0; i < 100; i++)
+    tree.Insert(3, 3, i);
+  tree.Insert(10, 10, 100);
+  EXPECT_EQ(tree.Nearest(4, 4), 99u);
+  EXPECT_EQ(tree.Nearest(9, 9), 100u);
+}
+
+/**
+ * @brief tests a KdTree built in one pass against a brute force search
+ */
+TEST(kd_tree, build) {
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<> coordinate(0, 300);
+  std::vector<int> xs, ys;
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < 4000; i++) {
+    // Every tenth point sits on the one before it
+    xs.push_back(i % 10 == 9 ? xs.back() : coordinate(gen));
+    ys.push_back(i % 10 == 9 ? ys.back() : coordinate(gen) / 3);
+    if (i % 7 != 0)
+      ids.push_back(i);
+  }
+  KdTree tree;
+  tree.Insert(1, 1, 0);
+  tree.Build(xs.data(), ys.data(), ids);
+  EXPECT_EQ(tree.Size(), ids.size());
+
+  // Points added afterwards are found along with the built ones
+  for (uint32_t i = 4000; i < 4100; i++) {
+    xs.push_back(coordinate(gen));
+    ys.push_back(coordinate(gen));
+    ids.push_back(i);
+    tree.Insert(xs.back(), ys.back(), i);
+  }
+  for (int q = 0; q < 300; q++) {
+    int x = coordinate(gen) - 20;
+    int y = coordinate(gen) - 20;
+    uint32_t expected = 0;
+    int64_t expected_distance = INT64_MAX;
+    for (uint32_t i : ids) {
+      int64_t dx = xs[i] - x;
+      int64_t dy = ys[i] - y;
+      if (dx * dx + dy * dy <= expected_distance) {
+        expected_distance = dx * dx + dy * dy;
+        expected = i;
+      }
+    }
+    EXPECT_EQ(tree.Nearest(x, y), expected);
+  }
+
+  // Building from nothing empties the tree
+  tree.Build(xs.data(), ys.data(), std::vector<uint32_t>());
+  EXPECT_EQ(tree.Size(), 0u);
+  EXPECT_EQ(tree.Nearest(0, 0), KdTree::kNoId);
+}
+
+/**
+ * @brief tests that removed points are never found again
+ */
+TEST(kd_tree, remove) {
+  KdTree tree;
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<> coordinate(0, 100);
+  std::vector<std::pair<int, int>> points;
+  for (uint32_t i = 0; i < 1000; i++) {
+    std::pair<int, int> point(coordinate(gen), coordinate(gen));
+    points.push_back(point);
+    tree.Insert(point.first, point.second, i);
+  }
+  EXPECT_FALSE(tree.Remove(points[5].first, points[5].second, 1000));
+  std::vector<bool> removed(points.size(), false);
+  for (uint32_t i = 0; i < points.size(); i += 3) {
+    EXPECT_TRUE(tree.Remove(points[i].first, points[i].second, i));
+    removed[i] = true;
+  }
+  EXPECT_EQ(tree.Size(), points.size() - 334);
+
+  // The points left are still found with the same tie break
+  for (int q = 0; q < 200; q++) {
+    int x = coordinate(gen);
+    int y = coordinate(gen);
+    uint32_t expected = 0;
+    int64_t expected_distance = INT64_MAX;
+    for (uint32_t i = 0; i < points.size(); i++) {
+      int64_t dx = points[i].first - x;
+      int64_t dy = points[i].second - y;
+      if (!removed[i] && dx * dx + dy * dy <= expected_distance) {
+        expected_distance = dx * dx + dy * dy;
+        expected = i;
+      }
+    }
+    EXPECT_EQ(tree.Nearest(x, y), expected);
+  }
+}
+
+/**
+ * @brief tests the KdTree radius search against a brute force search
+ */
+TEST(kd_tree, within) {
+  KdTree tree;
+  std::vector<uint32_t> ids;
+  tree.Within(0, 0, 100, &ids);
+  EXPECT_TRUE(ids.empty());
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<> coordinate(0, 100);
+  std::vector<std::pair<int, int>> points;
+  for (uint32_t i = 0; i < 2000; i++) {
+    std::pair<int, int> point(coordinate(gen), coordinate(gen));
+    points.push_back(point);
+    tree.Insert(point.first, point.second, i);
+  }
+
+  // Points exactly on the circle count as inside it
+  for (int q = 0; q < 200; q++) {
+    int x = coordinate(gen);
+    int y = coordinate(gen);
+    int64_t radius_squared = q % 50;
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < points.size(); i++) {
+      int64_t dx = points[i].first - x;
+      int64_t dy = points[i].second - y;
+      if (dx * dx + dy * dy <= radius_squared)
+        expected.push_back(i);
+    }
+    tree.Within(x, y, radius_squared, &ids);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, expected);
+  }
+}
+
+/**
+ * @brief tests that a Sampler is reproducible and stays in bounds
+ */
+TEST(sampler, seeded) {
+  // Equal seeds give equal sequences, different seeds do not
+  Sampler a(1234);
+  Sampler b(1234);
+  Sampler c(4321);
+  bool differs = false;
+  for (int i = 0; i < 100; i++) {
+    uint64_t value = a.Next();
+    EXPECT_EQ(value, b.Next());
+    differs = differs || value != c.Next();
+  }
+  EXPECT_TRUE(differs);
+
+  // Reseeding restarts the sequence
+  a.Seed(99);
+  b.Seed(99);
+  EXPECT_EQ(a.Next(), b.Next());
+
+  // Batches of points stay within the inclusive bounds and reach both ends
+  std::vector<std::pair<int, int>> points(5000);
+  a.FillPoints(points.data(), points.size(), 7, 3);
+  int max_x = 0, max_y = 0, min_x = 7, min_y = 3;
+  for (const std::pair<int, int> &point : points) {
+    max_x = std::max(max_x, point.first);
+    max_y = std::max(max_y, point.second);
+    min_x = std::min(min_x, point.first);
+    min_y = std::min(min_y, point.second);
+  }
+  EXPECT_EQ(min_x, 0);
+  EXPECT_EQ(max_x, 7);
+  EXPECT_EQ(min_y, 0);
+  EXPECT_EQ(max_y, 3);
+
+  // Doubles stay in [0, 1)
+  for (int i = 0; i < 1000; i++) {
+    double value = a.NextDouble();
+    EXPECT_GE(value, 0.0);
+    EXPECT_LT(value, 1.0);
+  }
+}
+
+/**
+ * @brief tests the points produced by each SamplingStrategy
+ */
+TEST(sampling, strategies) {
+  Sampler sampler(17);
+  std::pair<int, int> mapSize(100, 100);
+  std::pair<int, int> goal(90, 10);
+  std::vector<std::pair<int, int>> points(4000);
+
+  // The first points of the unshifted sequences are known
+  HaltonSampling halton(false);
+  halton.FillPoints(&sampler, points.data(), 3, mapSize, goal);
+  EXPECT_EQ(points[0], std::make_pair(50, 33));
+  EXPECT_EQ(points[1], std::make_pair(25, 67));
+  EXPECT_EQ(points[2], std::make_pair(75, 11));
+  SobolSampling sobol(false);
+  sobol.FillPoints(&sampler, points.data(), 3, mapSize, goal);
+  EXPECT_EQ(points[0], std::make_pair(50, 50));
+  EXPECT_EQ(points[1], std::make_pair(75, 25));
+  EXPECT_EQ(points[2], std::make_pair(25, 75));
+
+  // Reset restarts a sequence
+  sobol.Reset();
+  sobol.FillPoints(&sampler, points.data(), 1, mapSize, goal);
+  EXPECT_EQ(points[0], std::make_pair(50, 50));
+
+  // Every strategy stays on the map, and the low-discrepancy ones put close
+  // to the same number of points in each quarter of it
+  GoalBiasedSampling biased(0.25);
+  HaltonSampling shiftedHalton;
+  SobolSampling shiftedSobol;
+  SamplingStrategy *strategies[] = {&biased, &shiftedHalton, &shiftedSobol};
+  for (SamplingStrategy *strategy : strategies) {
+    strategy->FillPoints(&sampler, points.data(), points.size(), mapSize,
+                         goal);
+    int atGoal = 0;
+    int quarters[4] = {0, 0, 0, 0};
+    for (const std::pair<int, int> &point : points) {
+      EXPECT_GE(point.first, 0);
+      EXPECT_LE(point.first, 100);
+      EXPECT_GE(point.second, 0);
+      EXPECT_LE(point.second, 100);
+      atGoal += point == goal;
+      quarters[(point.first > 50) * 2 + (point.second > 50)]++;
+    }
+    if (strategy == &biased) {
+      EXPECT_NEAR(atGoal, 1000, 100);
+    } else {
+      for (int quarter : quarters)
+        EXPECT_NEAR(quarter, 1000, 40);
+    }
+  }
+}
+
+/**
+ * @brief tests every supported nearest point kernel against the scalar one
+ */
+TEST(nearest_kernel, matches_scalar) {
+  EXPECT_TRUE(IsNearestKernelSupported(kScalarKernel));
+  EXPECT_TRUE(IsNearestKernelSupported(GetNearestKernelIsa()));
+  NearestKernel scalar = GetNearestKernel(kScalarKernel);
+
+  // A small coordinate range gives lots of equally close points, and the
+  // range of counts covers every leftover size after the vector blocks
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<> coordinate(-6, 6);
+  NearestKernelIsa isas[] = {kScalarKernel, kSse2Kernel, kAvx2Kernel};
+  for (NearestKernelIsa isa : isas) {
+    if (!IsNearestKernelSupported(isa))
+      continue;
+    NearestKernel kernel = GetNearestKernel(isa);
+    for (size_t count = 1; count < 70; count++) {
+      std::vector<int> xs(count), ys(count);
+      for (size_t i = 0; i < count; i++) {
+        xs[i] = coordinate(gen);
+        ys[i] = coordinate(gen);
+      }
+      for (int q = 0; q < 20; q++) {
+        int x = coordinate(gen) * 3;
+        int y = coordinate(gen) * 3;
+        int64_t expected_distance, distance;
+        size_t expected = scalar(xs.data(), ys.data(), count, x, y,
+                                 &expected_distance);
+        EXPECT_EQ(kernel(xs.data(), ys.data(), count, x, y, &distance),
+                  expected);
+        EXPECT_EQ(distance, expected_distance);
+      }
+    }
+  }
+
+  // Large coordinates are still compared exactly
+  std::vector<int> xs = {100000, -100000, 99999, 100000, 5, 6, 7, 8, 100000};
+  std::vector<int> ys = {100000, -100000, 100000, 99999, 5, 6, 7, 8, 99999};
+  int64_t distance;
+  EXPECT_EQ(NearestIndex(xs.data(), ys.data(), xs.size(), 100000, 100000,
+                         &distance), 0u);
+  EXPECT_EQ(distance, 0);
+  EXPECT_EQ(NearestIndex(xs.data(), ys.data(), 8, 100000, 99998, &distance),
+            3u);
+  EXPECT_EQ(distance, 1);
+  EXPECT_EQ(NearestIndex(xs.data(), ys.data(), 9, 100000, 99998, &distance),
+            8u);
 }
 
 /**
@@ -129,6 +594,339 @@ TEST(map, obstacle_tests) {
 
 
 
+/**
+ * @brief checks Map::IsOccupied against testing every obstacle
+ */
+void ExpectMatchesBruteForce(const Map &map,
+                             const std::list<Obstacle> &obstacles) {
+  for (int x = -5; x <= map.GetSize().first + 5; x++) {
+    for (int y = -5; y <= map.GetSize().second + 5; y++) {
+      std::pair<int, int> point(x, y);
+      bool occupied = false;
+      for (const Obstacle &obs : obstacles)
+        occupied = occupied || obs.Contains(point);
+      EXPECT_EQ(map.IsOccupied(point), occupied);
+    }
+  }
+}
+
+/**
+ * @brief tests the obstacle grid used for collision queries
+ */
+TEST(map, obstacle_grid) {
+  // Obstacles of many sizes, some partly or entirely outside the map
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<> coordinate(-20, 120);
+  std::uniform_int_distribution<> radius(0, 25);
+  std::list<Obstacle> obstacles;
+  for (int i = 0; i < 60; i++)
+    obstacles.push_back(Obstacle(coordinate(gen), coordinate(gen),
+                                 radius(gen)));
+  Map specificMap(100, 80, obstacles);
+  ExpectMatchesBruteForce(specificMap, obstacles);
+
+  // Adding and removing obstacles keeps the grid up to date
+  Obstacle extra(40, 40, 10);
+  specificMap.AddObstacle(extra);
+  obstacles.push_back(extra);
+  ExpectMatchesBruteForce(specificMap, obstacles);
+  specificMap.RemoveObstacle(obstacles.front());
+  obstacles.pop_front();
+  ExpectMatchesBruteForce(specificMap, obstacles);
+
+  // Copies get their own grid, unaffected by changes to the original
+  Map copy(specificMap);
+  Map assigned;
+  assigned = specificMap;
+  std::list<Obstacle> before = obstacles;
+  specificMap.RemoveObstacle(extra);
+  ExpectMatchesBruteForce(copy, before);
+  ExpectMatchesBruteForce(assigned, before);
+
+  // Every obstacle that touches a segment is returned by GetObstaclesAlong
+  std::vector<const Obstacle*> nearby;
+  std::uniform_int_distribution<> inside(0, 80);
+  for (int i = 0; i < 200; i++) {
+    std::pair<int, int> start(inside(gen), inside(gen));
+    std::pair<int, int> end(inside(gen), inside(gen));
+    copy.GetObstaclesAlong(start, end, &nearby);
+    for (const Obstacle &obs : before) {
+      bool touches = false;
+      for (int step = 0; step <= 100; step++) {
+        std::pair<int, int> point(
+            start.first + (end.first - start.first) * step / 100,
+            start.second + (end.second - start.second) * step / 100);
+        touches = touches || obs.Contains(point);
+      }
+      if (touches) {
+        bool found = false;
+        for (const Obstacle *candidate : nearby)
+          found = found || *candidate == obs;
+        EXPECT_TRUE(found);
+      }
+    }
+  }
+}
+
+/**
+ * @brief tests bulk adds drop duplicates and keep the grid consistent
+ */
+TEST(map, bulk_add) {
+  // Obstacles compare by radius first, but equal only when they match
+  EXPECT_TRUE(Obstacle(9, 9, 2) < Obstacle(0, 0, 3));
+  EXPECT_TRUE(Obstacle(1, 5, 3) < Obstacle(2, 0, 3));
+  EXPECT_FALSE(Obstacle(2, 0, 3) < Obstacle(2, 0, 3));
+  EXPECT_TRUE(Obstacle(2, 1, 3) > Obstacle(2, 0, 3));
+
+  // Duplicates that are far apart in the input are still found
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<> coordinate(-20, 120);
+  std::uniform_int_distribution<> radius(0, 15);
+  std::vector<Obstacle> obstacles;
+  for (int i = 0; i < 300; i++)
+    obstacles.push_back(Obstacle(coordinate(gen), coordinate(gen),
+                                 radius(gen)));
+  std::vector<Obstacle> repeated(obstacles.begin(), obstacles.begin() + 100);
+  repeated.insert(repeated.end(), obstacles.begin(), obstacles.end());
+  Map bulkMap(100, 80, std::list<Obstacle>());
+  bulkMap.AddObstacles(repeated);
+  std::list<Obstacle> unique;
+  for (const Obstacle &obs : obstacles) {
+    if (std::find(unique.begin(), unique.end(), obs) == unique.end())
+      unique.push_back(obs);
+  }
+  // The first of each survives, in order
+  EXPECT_EQ(bulkMap.GetObstacleList(), unique);
+  ExpectMatchesBruteForce(bulkMap, unique);
+
+  // Single adds skip obstacles the map already has, on or off the map
+  size_t count = bulkMap.GetObstacles().size();
+  bulkMap.AddObstacle(unique.back());
+  bulkMap.AddObstacle(Obstacle(-500, -500, 2));
+  bulkMap.AddObstacle(Obstacle(-500, -500, 2));
+  EXPECT_EQ(bulkMap.GetObstacles().size(), count + 1);
+
+  // Removing moves the last obstacle into the gap without breaking the grid
+  bulkMap.RemoveObstacle(unique.front());
+  bulkMap.RemoveObstacle(Obstacle(-500, -500, 2));
+  unique.pop_front();
+  EXPECT_EQ(bulkMap.GetObstacles().size(), unique.size());
+  ExpectMatchesBruteForce(bulkMap, unique);
+
+  // The bitmap is rebuilt along with the grid
+  bulkMap.EnableOccupancyBitmap(true);
+  bulkMap.AddObstacles(std::vector<Obstacle>(1, Obstacle(50, 50, 12)));
+  unique.push_back(Obstacle(50, 50, 12));
+  ExpectMatchesBruteForce(bulkMap, unique);
+}
+
+/**
+ * @brief tests the occupancy bitmap gives the same answers as the grid
+ */
+TEST(map, occupancy_bitmap) {
+  // The bitmap itself
+  OccupancyBitmap bitmap;
+  EXPECT_TRUE(bitmap.IsEmpty());
+  bitmap.Reset(130, 3);
+  EXPECT_EQ(bitmap.GetMemoryUsage(), 3 * 3 * sizeof(uint64_t));
+  bitmap.Set(129, 2, true);
+  bitmap.Set(64, 0, true);
+  EXPECT_TRUE(bitmap.Test(129, 2));
+  EXPECT_TRUE(bitmap.Test(64, 0));
+  EXPECT_FALSE(bitmap.Test(63, 0));
+  bitmap.Set(64, 0, false);
+  EXPECT_FALSE(bitmap.Test(64, 0));
+
+  // A map with overlapping obstacles, some off the edge of the map
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<> coordinate(-20, 120);
+  std::uniform_int_distribution<> radius(0, 25);
+  std::list<Obstacle> obstacles;
+  for (int i = 0; i < 60; i++)
+    obstacles.push_back(Obstacle(coordinate(gen), coordinate(gen),
+                                 radius(gen)));
+  Map specificMap(100, 80, obstacles);
+  specificMap.EnableOccupancyBitmap(true);
+  EXPECT_TRUE(specificMap.HasOccupancyBitmap());
+  ExpectMatchesBruteForce(specificMap, obstacles);
+
+  // The bitmap follows added and removed obstacles, including removing one
+  // that overlaps others
+  Obstacle extra(40, 40, 10);
+  specificMap.AddObstacle(extra);
+  obstacles.push_back(extra);
+  ExpectMatchesBruteForce(specificMap, obstacles);
+  for (int i = 0; i < 10; i++) {
+    specificMap.RemoveObstacle(obstacles.front());
+    obstacles.pop_front();
+  }
+  ExpectMatchesBruteForce(specificMap, obstacles);
+
+  // Copies keep their bitmap
+  Map copy(specificMap);
+  EXPECT_TRUE(copy.HasOccupancyBitmap());
+  ExpectMatchesBruteForce(copy, obstacles);
+
+  // Turning the bitmap off falls back to the grid
+  specificMap.EnableOccupancyBitmap(false);
+  EXPECT_FALSE(specificMap.HasOccupancyBitmap());
+  ExpectMatchesBruteForce(specificMap, obstacles);
+}
+
+/**
+ * @brief tests Map::SegmentCollides against every obstacle
+ */
+TEST(map, segment_collides) {
+  std::mt19937 gen(13);
+  std::uniform_int_distribution<> coordinate(-10, 110);
+  std::uniform_int_distribution<> radius(0, 8);
+  std::list<Obstacle> obstacles;
+  for (int i = 0; i < 40; i++)
+    obstacles.push_back(Obstacle(coordinate(gen), coordinate(gen),
+                                 radius(gen)));
+  Map specificMap(100, 100, obstacles);
+  EXPECT_EQ(specificMap.GetCollisionModel(), kSampledCollision);
+  CollisionModel models[] = {kCircleCollision, kSquareCollision};
+  for (CollisionModel model : models) {
+    specificMap.SetCollisionModel(model);
+    EXPECT_EQ(Map(specificMap).GetCollisionModel(), model);
+    for (int i = 0; i < 500; i++) {
+      std::pair<int, int> start(coordinate(gen), coordinate(gen));
+      std::pair<int, int> end(coordinate(gen) / 4 + start.first,
+                              coordinate(gen) / 4 + start.second);
+      bool expected = false;
+      for (const Obstacle &obs : obstacles) {
+        expected = expected ||
+            (model == kSquareCollision ? obs.SegmentIntersectsSquare(start, end)
+                                       : obs.SegmentIntersectsCircle(start,
+                                                                     end));
+      }
+      EXPECT_EQ(specificMap.SegmentCollides(start, end), expected);
+    }
+  }
+
+  // The examined counter adds up the obstacles each query tested
+  uint64_t examined = 0;
+  EXPECT_FALSE(Map(100, 100, std::list<Obstacle>()).SegmentCollides(
+      std::make_pair(0, 0), std::make_pair(50, 50), &examined));
+  EXPECT_EQ(examined, 0u);
+  std::list<Obstacle> single(1, Obstacle(20, 20, 3));
+  Map singleMap(100, 100, single);
+  singleMap.SetCollisionModel(kCircleCollision);
+  EXPECT_TRUE(singleMap.SegmentCollides(std::make_pair(0, 0),
+                                        std::make_pair(50, 50), &examined));
+  EXPECT_TRUE(singleMap.IsOccupied(std::make_pair(20, 20), &examined));
+  EXPECT_EQ(examined, 2u);
+}
+
+/**
+ * @brief tests MapFile
+ */
+TEST(map_file, save_and_open) {
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<> coordinate(-10, 210);
+  std::uniform_int_distribution<> radius(0, 12);
+  std::list<Obstacle> obstacles;
+  for (int i = 0; i < 300; i++)
+    obstacles.push_back(Obstacle(coordinate(gen), coordinate(gen),
+                                 radius(gen)));
+  Map original(200, 150, obstacles);
+  original.SetCollisionModel(kCircleCollision);
+  const std::string path = "map_file_test.rrtmap";
+  ASSERT_TRUE(MapFile::Save(original, path));
+
+  MapFile file;
+  ASSERT_TRUE(file.Open(path));
+  EXPECT_EQ(file.GetSize(), std::make_pair(200, 150));
+  EXPECT_EQ(file.GetCollisionModel(), kCircleCollision);
+  ASSERT_EQ(file.GetObstacleCount(), obstacles.size());
+  EXPECT_TRUE(file.GetObstacle(0) == obstacles.front());
+
+  // The loaded map has the same obstacles and answers every query the same
+  Map loaded;
+  ASSERT_TRUE(file.Load(&loaded));
+  EXPECT_EQ(loaded.GetObstacleList(), original.GetObstacleList());
+  EXPECT_EQ(loaded.grid_.size(), original.grid_.size());
+  for (int i = 0; i < 2000; i++) {
+    std::pair<int, int> start(coordinate(gen), coordinate(gen));
+    std::pair<int, int> end(coordinate(gen), coordinate(gen));
+    EXPECT_EQ(loaded.IsOccupied(start), original.IsOccupied(start));
+    EXPECT_EQ(loaded.SegmentCollides(start, end),
+              original.SegmentCollides(start, end));
+  }
+  file.Close();
+  EXPECT_FALSE(file.IsOpen());
+
+  // Truncated or damaged files are rejected
+  std::string contents;
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  std::string damaged[] = {contents.substr(0, contents.size() - 4),
+                           "XX" + contents.substr(2), contents};
+  // Point the last grid entry at an obstacle that doesn't exist
+  damaged[2][damaged[2].size() - 1] = '\xff';
+  for (const std::string &bad : damaged) {
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    out << bad;
+    out.close();
+    EXPECT_FALSE(file.Open(path));
+    EXPECT_FALSE(file.Load(&loaded));
+  }
+  EXPECT_FALSE(file.Open("no_such_map_file.rrtmap"));
+  std::remove(path.c_str());
+}
+
+TEST(map_file, load_pgm) {
+  // A 4x3 plain image with a dark column and one light grey pixel
+  const std::string path = "map_file_test.pgm";
+  {
+    std::ofstream out(path.c_str());
+    out << "P2\n# occupancy\n4 3\n255\n"
+        << "255 0 255 255\n"
+        << "255 0 200 255\n"
+        << "255 0 255 255\n";
+  }
+  Map map;
+  ASSERT_TRUE(MapFile::LoadPgm(path, 0.65, &map));
+  EXPECT_EQ(map.GetSize(), std::make_pair(3, 2));
+  EXPECT_EQ(map.GetCollisionModel(), kSquareCollision);
+  EXPECT_EQ(map.GetObstacleList().size(), 3u);
+  for (int y = 0; y <= 2; y++) {
+    EXPECT_TRUE(map.IsOccupied(std::make_pair(1, y)));
+    EXPECT_FALSE(map.IsOccupied(std::make_pair(2, y)));
+  }
+  EXPECT_TRUE(map.SegmentCollides(std::make_pair(0, 0), std::make_pair(3, 2)));
+  // A lower threshold counts the grey pixel as well
+  ASSERT_TRUE(MapFile::LoadPgm(path, 0.1, &map));
+  EXPECT_EQ(map.GetObstacleList().size(), 4u);
+
+  // The same image in binary form
+  {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    const unsigned char pixels[] = {255, 0, 255, 255, 255, 0, 200, 255,
+                                    255, 0, 255, 255};
+    out << "P5 4 3 255\n";
+    out.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+  }
+  Map binaryMap;
+  ASSERT_TRUE(MapFile::LoadPgm(path, 0.65, &binaryMap));
+  std::list<Obstacle> column = {Obstacle(1, 0, 1), Obstacle(1, 1, 1),
+                                Obstacle(1, 2, 1)};
+  EXPECT_EQ(binaryMap.GetObstacleList(), column);
+
+  // Images with missing pixels are rejected
+  {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << "P5 4 3 255\n";
+    out.write("\0\0\0", 3);
+  }
+  EXPECT_FALSE(MapFile::LoadPgm(path, 0.65, &map));
+  std::remove(path.c_str());
+}
+
 /**
  * @brief tests RRTPath
  */
@@ -141,10 +939,11 @@ TEST(path, constructor) {
   RRTPath rrt(specificMap, 0, 0, 15, 15, 5, 5);
 
   // Check the getters and setters
-  EXPECT_EQ(rrt.map_.GetSize().first, 15);
-  EXPECT_EQ(rrt.map_.GetSize().second, 20);
-  EXPECT_EQ(rrt.root_node_->get_location().first, 0);
-  EXPECT_EQ(rrt.root_node_->get_location().second, 0);
+  EXPECT_EQ(rrt.map_->GetSize().first, 15);
+  EXPECT_EQ(rrt.map_->GetSize().second, 20);
+  EXPECT_EQ(rrt.GetVertex(RRTPath::kRootIndex).get_location().first, 0);
+  EXPECT_EQ(rrt.GetVertex(RRTPath::kRootIndex).get_location().second, 0);
+  EXPECT_FALSE(rrt.GetVertex(RRTPath::kRootIndex).has_parent());
   EXPECT_EQ(rrt.goal_location_.first, 15);
   EXPECT_EQ(rrt.goal_location_.second, 15);
   EXPECT_EQ(rrt.epsilon_, 5);
@@ -228,6 +1027,42 @@ TEST(path, safety_test) {
   EXPECT_FALSE(rrt.IsSafe(v, p));
 }
 
+/**
+ * @brief tests that exact collision models catch thin obstacles
+ */
+TEST(path, exact_safety_test) {
+  // A thin obstacle half way along a long edge falls between the ten
+  // sampled steps of the default model
+  std::list<Obstacle> obsList;
+  Map specificMap(100, 100, obsList);
+  specificMap.AddObstacle(Obstacle(55, 0, 1));
+  RRTPath sampled(specificMap, 0, 0, 90, 90, 100, 5);
+  EXPECT_TRUE(sampled.IsSafe(std::pair<int, int>(0, 0),
+                             std::pair<int, int>(100, 0)));
+
+  specificMap.SetCollisionModel(kCircleCollision);
+  RRTPath circles(specificMap, 0, 0, 90, 90, 100, 5);
+  EXPECT_FALSE(circles.IsSafe(std::pair<int, int>(0, 0),
+                              std::pair<int, int>(100, 0)));
+  EXPECT_TRUE(circles.IsSafe(std::pair<int, int>(0, 1),
+                             std::pair<int, int>(100, 1)));
+  EXPECT_FALSE(circles.IsSafe(std::pair<int, int>(0, 1),
+                              std::pair<int, int>(101, 1)));
+
+  specificMap.SetCollisionModel(kSquareCollision);
+  RRTPath squares(specificMap, 0, 0, 90, 90, 100, 5);
+  EXPECT_FALSE(squares.IsSafe(std::pair<int, int>(0, 0),
+                              std::pair<int, int>(100, 0)));
+  EXPECT_FALSE(squares.IsSafe(std::pair<int, int>(54, 10),
+                              std::pair<int, int>(56, 0)));
+  EXPECT_TRUE(squares.IsSafe(std::pair<int, int>(0, 1),
+                             std::pair<int, int>(100, 1)));
+
+  // The planner still finds paths with an exact model
+  std::list<std::pair<int, int>> path = squares.FindPath();
+  EXPECT_EQ(path.front(), std::make_pair(0, 0));
+}
+
 TEST(path, algorithm_test) {
   // Create an RRTPath
   Obstacle obs(15, 15, 3);
@@ -239,46 +1074,45 @@ TEST(path, algorithm_test) {
 
   // testing moving towards the point, closest vertex should be the root
   // shouldn't be any obstacles in the way of moving from 0,0 to 3,3
-  Vertex* closest = rrt.GetClosestPoint(std::pair<int, int>(10, 10));
-  EXPECT_EQ(closest->x_, rrt.root_node_->x_);
-  EXPECT_EQ(closest->y_, rrt.root_node_->y_);
-  EXPECT_TRUE(rrt.vertex_list_.size() == 1);
+  uint32_t closest = rrt.GetClosestPoint(std::pair<int, int>(10, 10));
+  EXPECT_EQ(closest, RRTPath::kRootIndex);
+  EXPECT_TRUE(rrt.GetVertexCount() == 1);
   EXPECT_TRUE(rrt.MoveTowardsPoint(closest, std::pair<int, int>(10, 10)));
-  EXPECT_TRUE(rrt.vertex_list_.size() == 2);
+  EXPECT_TRUE(rrt.GetVertexCount() == 2);
 
   // Check to make sure that the closest node is now at 3,3 rather than root
   // should be able to move from 3,3 to 6,6
   closest = rrt.GetClosestPoint(std::pair<int, int>(10, 10));
-  EXPECT_EQ(closest->x_, 3);
-  EXPECT_EQ(closest->y_, 3);
+  EXPECT_EQ(rrt.vertices_.GetX(closest), 3);
+  EXPECT_EQ(rrt.vertices_.GetY(closest), 3);
   EXPECT_TRUE(rrt.MoveTowardsPoint(closest, std::pair<int, int>(10, 10)));
-  EXPECT_TRUE(rrt.vertex_list_.size() == 3);
+  EXPECT_TRUE(rrt.GetVertexCount() == 3);
 
   // Check to make sure closest node is now at 6,6
   // should be able to get from 6,6 to 9,9
   closest = rrt.GetClosestPoint(std::pair<int, int>(15, 15));
-  EXPECT_EQ(closest->x_, 6);
-  EXPECT_EQ(closest->y_, 6);
+  EXPECT_EQ(rrt.vertices_.GetX(closest), 6);
+  EXPECT_EQ(rrt.vertices_.GetY(closest), 6);
   EXPECT_TRUE(rrt.MoveTowardsPoint(closest, std::pair<int, int>(15, 15)));
-  EXPECT_TRUE(rrt.vertex_list_.size() == 4);
+  EXPECT_TRUE(rrt.GetVertexCount() == 4);
 
   // Check to make sure closest node is now at 9,9
   // should be able to get from 9,9 to 12,12
   closest = rrt.GetClosestPoint(std::pair<int, int>(15, 15));
-  EXPECT_EQ(closest->x_, 9);
-  EXPECT_EQ(closest->y_, 9);
+  EXPECT_EQ(rrt.vertices_.GetX(closest), 9);
+  EXPECT_EQ(rrt.vertices_.GetY(closest), 9);
   EXPECT_TRUE(rrt.MoveTowardsPoint(closest, std::pair<int, int>(15, 15)));
-  EXPECT_TRUE(rrt.vertex_list_.size() == 5);
+  EXPECT_TRUE(rrt.GetVertexCount() == 5);
 
   // should not be able to move to 15,15 because of an obstacle
   // but should be within range of the goal
   closest = rrt.GetClosestPoint(std::pair<int, int>(15, 15));
   EXPECT_FALSE(rrt.MoveTowardsPoint(closest, std::pair<int, int>(15, 15)));
-  EXPECT_TRUE(rrt.vertex_list_.size() == 5);
-  EXPECT_TRUE(rrt.ReachedGoal(closest->get_location()));
+  EXPECT_TRUE(rrt.GetVertexCount() == 5);
+  EXPECT_TRUE(rrt.ReachedGoal(rrt.GetVertex(closest).get_location()));
 
   // rebuild the path
-  path = rrt.CalculatePath(rrt.vertex_list_.front());
+  path = rrt.CalculatePath(closest);
   // path should be of size 5: 0,0; 3,3; 6,6; 9,9; 12,12
   EXPECT_TRUE(path.size() == 5);
   std::list<std::pair<int, int>>::iterator it;
@@ -305,3 +1139,1254 @@ TEST(path, find_path) {
   // therefore the size of our rebuilt list should be greater than 3
   EXPECT_TRUE(path.size() > 3);
 }
+
+TEST(path, nearest_neighbor_methods) {
+  // Grow a tree, then check the k-d tree and the linear scan agree
+  std::list<Obstacle> obsList;
+  Map specificMap(200, 200, obsList);
+  specificMap.AddObstacle(Obstacle(100, 100, 20));
+  RRTPath rrt(specificMap, 0, 0, 300, 300, 3, 1);
+  for (int i = 0; i < 2000; i++) {
+    std::pair<int, int> randomPoint = rrt.GetRandomPoint();
+    rrt.MoveTowardsPoint(rrt.GetClosestPoint(randomPoint), randomPoint);
+  }
+  EXPECT_GT(rrt.GetVertexCount(), 100u);
+
+  for (int i = 0; i < 200; i++) {
+    std::pair<int, int> randomPoint = rrt.GetRandomPoint();
+    rrt.SetNearestNeighborMethod(kKdTree);
+    uint32_t fromTree = rrt.GetClosestPoint(randomPoint);
+    rrt.SetNearestNeighborMethod(kLinearScan);
+    uint32_t fromScan = rrt.GetClosestPoint(randomPoint);
+    EXPECT_EQ(fromTree, fromScan);
+  }
+}
+
+TEST(path, reset) {
+  // Solve one query, then reuse the same planner for a second one
+  std::list<Obstacle> obsList;
+  Map specificMap(30, 30, obsList);
+  RRTPath rrt(specificMap, 0, 0, 25, 25, 3, 3);
+  std::list<std::pair<int, int>> path = rrt.FindPath();
+  EXPECT_EQ(path.front(), std::make_pair(0, 0));
+  EXPECT_GT(rrt.GetVertexCount(), 1u);
+
+  // After a reset only the root is left, at the new start location
+  rrt.Reset(20, 5, 5, 25);
+  EXPECT_EQ(rrt.GetVertexCount(), 1u);
+  EXPECT_EQ(rrt.GetVertex(RRTPath::kRootIndex).get_location(),
+            std::make_pair(20, 5));
+  path = rrt.FindPath();
+  EXPECT_EQ(path.front(), std::make_pair(20, 5));
+  EXPECT_LE(rrt.GetDistance(path.back(), std::make_pair(5, 25)), 3);
+}
+
+TEST(path, seeded) {
+  // Two planners with the same seed grow the same tree and path
+  std::list<Obstacle> obsList;
+  Map specificMap(50, 50, obsList);
+  specificMap.AddObstacle(Obstacle(25, 25, 8));
+  RRTPath first(specificMap, 0, 0, 45, 45, 3, 3);
+  RRTPath second(specificMap, 0, 0, 45, 45, 3, 3);
+  first.SetSeed(2017);
+  second.SetSeed(2017);
+  std::list<std::pair<int, int>> firstPath = first.FindPath();
+  std::list<std::pair<int, int>> secondPath = second.FindPath();
+  EXPECT_EQ(firstPath, secondPath);
+  EXPECT_EQ(first.GetVertexCount(), second.GetVertexCount());
+
+  // Reseeding and resetting replays the same run
+  first.SetSeed(2017);
+  first.Reset();
+  EXPECT_EQ(first.FindPath(), firstPath);
+}
+
+TEST(path, occupancy_bitmap) {
+  // The bitmap doesn't change the tree a seeded planner grows
+  std::list<Obstacle> obsList;
+  Map specificMap(60, 60, obsList);
+  specificMap.AddObstacle(Obstacle(30, 30, 12));
+  specificMap.AddObstacle(Obstacle(10, 45, 6));
+  Map bitmapMap(specificMap);
+  bitmapMap.EnableOccupancyBitmap(true);
+  RRTPath plain(specificMap, 0, 0, 55, 55, 4, 3);
+  RRTPath withBitmap(bitmapMap, 0, 0, 55, 55, 4, 3);
+  plain.SetSeed(5);
+  withBitmap.SetSeed(5);
+  EXPECT_EQ(plain.FindPath(), withBitmap.FindPath());
+  EXPECT_EQ(plain.GetVertexCount(), withBitmap.GetVertexCount());
+}
+
+TEST(path, stop_flag) {
+  // A goal inside an obstacle can never be reached, but a set stop flag
+  // still ends the search
+  std::list<Obstacle> obsList;
+  Map blockedMap(40, 40, obsList);
+  blockedMap.AddObstacle(Obstacle(30, 30, 8));
+  RRTPath rrt(blockedMap, 0, 0, 30, 30, 3, 1);
+  std::atomic<bool> stop(true);
+  rrt.SetStopFlag(&stop);
+  EXPECT_TRUE(rrt.FindPath().empty());
+  EXPECT_EQ(rrt.GetIterationCount(), 0);
+
+  // Stopping from another thread
+  stop = false;
+  std::thread canceller([&stop]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    stop = true;
+  });
+  EXPECT_TRUE(rrt.FindPath().empty());
+  canceller.join();
+  EXPECT_GT(rrt.GetIterationCount(), 0);
+}
+
+/**
+ * @brief builds a map with a wall across the middle and a narrow gap in it
+ */
+Map NarrowPassageMap() {
+  std::list<Obstacle> obsList;
+  Map narrowMap(100, 100, obsList);
+  for (int y = 0; y <= 100; y += 2) {
+    if (y < 46 || y > 54)
+      narrowMap.AddObstacle(Obstacle(50, y, 2));
+  }
+  narrowMap.SetCollisionModel(kSquareCollision);
+  return narrowMap;
+}
+
+/**
+ * @brief checks a path starts and ends in the right place and that every
+ * edge of it is collision free
+ */
+void ExpectValidPath(const Map &map, const std::list<std::pair<int, int>> &path,
+                     std::pair<int, int> start, std::pair<int, int> goal,
+                     float goalRadius) {
+  ASSERT_FALSE(path.empty());
+  EXPECT_EQ(path.front(), start);
+  float dx = path.back().first - goal.first;
+  float dy = path.back().second - goal.second;
+  EXPECT_LE(std::sqrt(dx * dx + dy * dy), goalRadius);
+  std::list<std::pair<int, int>>::const_iterator it = path.begin();
+  for (std::list<std::pair<int, int>>::const_iterator next = ++path.begin();
+       next != path.end(); ++it, ++next) {
+    EXPECT_FALSE(map.SegmentCollides(*it, *next));
+  }
+}
+
+TEST(path, budgets) {
+  // The goal is walled in, so no budget can be enough
+  std::list<Obstacle> obsList;
+  Map blockedMap(60, 60, obsList);
+  for (int x = 30; x <= 60; x += 2)
+    blockedMap.AddObstacle(Obstacle(x, 30, 2));
+  for (int y = 30; y <= 60; y += 2)
+    blockedMap.AddObstacle(Obstacle(30, y, 2));
+  blockedMap.SetCollisionModel(kSquareCollision);
+  RRTPath rrt(blockedMap, 0, 0, 50, 50, 3, 2);
+  rrt.SetSeed(4);
+
+  // Running out of iterations returns the path to the closest vertex
+  PlanningResult result = rrt.FindPath(300);
+  EXPECT_EQ(result.status, kExhausted);
+  EXPECT_EQ(result.iterations, 300);
+  ASSERT_FALSE(result.path.empty());
+  EXPECT_EQ(result.path.front(), std::make_pair(0, 0));
+  for (uint32_t i = 0; i < rrt.GetVertexCount(); i++) {
+    EXPECT_LE(rrt.GetDistance(result.path.back(), std::make_pair(50, 50)),
+              rrt.GetDistance(rrt.GetVertex(i).get_location(),
+                              std::make_pair(50, 50)));
+  }
+
+  // The vertex limit covers the whole tree
+  PlanningBudget budget;
+  budget.max_vertices = rrt.GetVertexCount() + 10;
+  result = rrt.FindPath(budget);
+  EXPECT_EQ(result.status, kExhausted);
+  EXPECT_EQ(rrt.GetVertexCount(), budget.max_vertices);
+
+  // A deadline ends the search soon after it passes
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  result = rrt.FindPath(start + std::chrono::milliseconds(30));
+  EXPECT_EQ(result.status, kTimeout);
+  EXPECT_GT(result.iterations, 0);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds(1));
+
+  // A stop flag takes priority over everything else
+  std::atomic<bool> stop(true);
+  rrt.SetStopFlag(&stop);
+  EXPECT_EQ(rrt.FindPath(budget).status, kCancelled);
+
+  // A reachable goal within budget succeeds
+  RRTPath open(blockedMap, 0, 0, 20, 50, 3, 2);
+  open.SetSeed(4);
+  result = open.FindPath(100000);
+  EXPECT_EQ(result.status, kSuccess);
+  ExpectValidPath(blockedMap, result.path, std::make_pair(0, 0),
+                  std::make_pair(20, 50), 2);
+  EXPECT_EQ(result.iterations, open.GetIterationCount());
+}
+
+TEST(path, stats) {
+  Map narrowMap = NarrowPassageMap();
+  RRTPath rrt(narrowMap, 5, 50, 95, 50, 3, 3);
+  rrt.SetSeed(8);
+  PlanningResult result = rrt.FindPath(100000);
+  ASSERT_EQ(result.status, kSuccess);
+  const PlannerStats &stats = rrt.GetStats();
+#ifdef RRT_PLANNER_STATS
+  EXPECT_EQ(stats.iterations, static_cast<uint64_t>(result.iterations));
+  EXPECT_EQ(stats.accepted_expansions + stats.rejected_expansions,
+            stats.iterations);
+  EXPECT_EQ(stats.peak_vertex_count, rrt.GetVertexCount());
+  EXPECT_GE(stats.collision_tests, stats.iterations);
+  EXPECT_GT(stats.obstacles_examined, 0u);
+  EXPECT_GT(stats.get_random_point_ns, 0u);
+  EXPECT_GT(stats.get_closest_point_ns, 0u);
+  EXPECT_GT(stats.is_safe_ns, 0u);
+  EXPECT_GT(stats.calculate_path_ns, 0u);
+
+  // Each call starts counting from zero
+  rrt.SetSeed(8);
+  rrt.Reset();
+  PlanningResult again = rrt.FindPath(10);
+  EXPECT_EQ(rrt.GetStats().iterations, static_cast<uint64_t>(
+      again.iterations));
+#else
+  // Without the flag nothing is collected
+  EXPECT_EQ(stats.iterations, 0u);
+  EXPECT_EQ(stats.accepted_expansions, 0u);
+  EXPECT_EQ(stats.collision_tests, 0u);
+  EXPECT_EQ(stats.is_safe_ns, 0u);
+  EXPECT_EQ(stats.peak_vertex_count, 0u);
+#endif
+}
+
+TEST(path, replan) {
+  // Two planners share one empty map
+  std::shared_ptr<Map> emptyMap = std::make_shared<Map>(
+      100, 100, std::list<Obstacle>());
+  emptyMap->SetCollisionModel(kSquareCollision);
+  std::shared_ptr<const Map> sharedMap = emptyMap;
+  RRTPath rrt(sharedMap, 5, 50, 95, 50, 3, 3);
+  rrt.SetSeed(21);
+  std::list<std::pair<int, int>> path = rrt.FindPath();
+  ASSERT_FALSE(path.empty());
+  size_t before = rrt.GetVertexCount();
+
+  // An obstacle away from the tree keeps the path, and FindPath returns it
+  // straight away
+  EXPECT_EQ(rrt.AddObstacle(Obstacle(-50, -50, 3)), 0u);
+  EXPECT_EQ(rrt.GetVertexCount(), before);
+  PlanningResult result = rrt.FindPath(1000);
+  EXPECT_EQ(result.status, kSuccess);
+  EXPECT_EQ(result.iterations, 0);
+
+  // Block the middle of the path
+  std::list<std::pair<int, int>>::const_iterator middle = path.begin();
+  std::advance(middle, path.size() / 2);
+  Obstacle block(middle->first, middle->second, 8);
+  size_t dropped = rrt.AddObstacle(block);
+  EXPECT_EQ(rrt.GetVertexCount(), before - dropped);
+  EXPECT_LT(dropped, before / 2);
+
+  // The other planner still sees the old map, this one has its own copy
+  EXPECT_TRUE(sharedMap->GetObstacles().empty());
+  EXPECT_NE(rrt.map_, sharedMap);
+  EXPECT_EQ(rrt.map_->GetObstacles().size(), 2u);
+
+  // Every edge left in the tree is clear of the new obstacle, and every
+  // parent comes before its children
+  for (uint32_t i = 1; i < rrt.GetVertexCount(); i++) {
+    uint32_t parent = rrt.vertices_.GetParent(i);
+    ASSERT_LT(parent, i);
+    EXPECT_TRUE(rrt.IsSafe(rrt.vertices_.GetLocation(parent),
+                           rrt.vertices_.GetLocation(i)));
+    EXPECT_NEAR(rrt.costs_[i], rrt.costs_[parent] +
+                rrt.GetDistance(rrt.vertices_.GetLocation(parent),
+                                rrt.vertices_.GetLocation(i)), 1e-3);
+  }
+
+  // Planning carries on from the repaired tree
+  result = rrt.FindPath(100000);
+  ASSERT_EQ(result.status, kSuccess);
+  ExpectValidPath(*rrt.map_, result.path, std::make_pair(5, 50),
+                  std::make_pair(95, 50), 3);
+
+  // Removing an obstacle keeps the whole tree
+  size_t grown = rrt.GetVertexCount();
+  rrt.RemoveObstacle(block);
+  EXPECT_EQ(rrt.GetVertexCount(), grown);
+  EXPECT_EQ(rrt.map_->GetObstacles().size(), 1u);
+}
+
+/**
+ * @brief tests PathSmoother
+ */
+TEST(smoother, shortcut) {
+  Map narrowMap = NarrowPassageMap();
+  RRTPath rrt(narrowMap, 5, 50, 95, 50, 3, 3);
+  rrt.SetSeed(5);
+  std::list<std::pair<int, int>> path = rrt.FindPath();
+  ASSERT_FALSE(path.empty());
+
+  PathSmoother smoother;
+  smoother.SetSeed(5);
+  std::list<std::pair<int, int>> smoothed = smoother.Smooth(narrowMap, path);
+  ExpectValidPath(narrowMap, smoothed, path.front(), path.back(), 0);
+  EXPECT_LT(smoothed.size(), path.size() / 4);
+  EXPECT_LE(PathSmoother::GetPathLength(smoothed),
+            PathSmoother::GetPathLength(path));
+
+  // The same path through a planner that smooths its own paths
+  rrt.Reset();
+  rrt.SetSeed(5);
+  rrt.EnablePathSmoothing(true, 50);
+  std::list<std::pair<int, int>> planned = rrt.FindPath();
+  ExpectValidPath(narrowMap, planned, std::make_pair(5, 50), path.back(), 0);
+  EXPECT_LT(planned.size(), path.size() / 4);
+
+  // Short paths are left alone
+  std::list<std::pair<int, int>> edge = {{5, 5}, {8, 8}};
+  EXPECT_EQ(smoother.Smooth(narrowMap, edge), edge);
+}
+
+TEST(smoother, parallel_and_sampled) {
+  // A long zig-zag across an empty map becomes a single segment, whether
+  // the segments are checked on one thread or several
+  Map wideMap(1000, 10, std::list<Obstacle>());
+  std::list<std::pair<int, int>> zigzag;
+  for (int x = 0; x <= 999; x++)
+    zigzag.push_back(std::make_pair(x, x % 2 == 0 ? 2 : 6));
+  PathSmoother serial;
+  PathSmoother parallel(4);
+  EXPECT_EQ(parallel.GetThreadCount(), 4u);
+  serial.SetSeed(9);
+  parallel.SetSeed(9);
+  std::list<std::pair<int, int>> smoothed = parallel.Smooth(wideMap, zigzag);
+  EXPECT_EQ(smoothed, serial.Smooth(wideMap, zigzag));
+  std::list<std::pair<int, int>> line = {{0, 2}, {999, 6}};
+  EXPECT_EQ(smoothed, line);
+
+  // With sampled collisions the whole segment is walked, so even an
+  // obstacle holding a single point blocks it
+  wideMap.AddObstacle(Obstacle(500, 4, 1));
+  EXPECT_FALSE(PathSmoother::IsClear(wideMap, std::make_pair(0, 4),
+                                     std::make_pair(999, 4)));
+  EXPECT_TRUE(PathSmoother::IsClear(wideMap, std::make_pair(0, 5),
+                                    std::make_pair(999, 5)));
+  EXPECT_FALSE(PathSmoother::IsClear(wideMap, std::make_pair(0, 5),
+                                     std::make_pair(1001, 5)));
+  smoothed = parallel.Smooth(wideMap, zigzag);
+  EXPECT_GT(smoothed.size(), 2u);
+  std::list<std::pair<int, int>>::const_iterator it = smoothed.begin();
+  for (std::list<std::pair<int, int>>::const_iterator next = ++smoothed.begin();
+       next != smoothed.end(); ++it, ++next)
+    EXPECT_TRUE(PathSmoother::IsClear(wideMap, *it, *next));
+}
+
+TEST(connect, find_path) {
+  // Through the narrow gap from one side of the wall to the other
+  Map narrowMap = NarrowPassageMap();
+  RRTConnectPath connect(narrowMap, 5, 90, 95, 85, 3, 2);
+  connect.SetSeed(8);
+  std::list<std::pair<int, int>> path = connect.FindPath();
+  // The trees meet exactly, so the path ends on the goal
+  ExpectValidPath(narrowMap, path, std::make_pair(5, 90),
+                  std::make_pair(95, 85), 0);
+  EXPECT_GT(connect.GetIterationCount(), 0);
+  EXPECT_GE(connect.GetVertexCount(), path.size());
+
+  // The same seed gives the same path
+  RRTConnectPath again(narrowMap, 5, 90, 95, 85, 3, 2);
+  again.SetSeed(8);
+  EXPECT_EQ(again.FindPath(), path);
+  EXPECT_EQ(again.GetIterationCount(), connect.GetIterationCount());
+
+  // Report the speedup over the single tree planner
+  RRTPath single(narrowMap, 5, 90, 95, 85, 3, 2);
+  single.SetSeed(8);
+  ExpectValidPath(narrowMap, single.FindPath(), std::make_pair(5, 90),
+                  std::make_pair(95, 85), 2);
+  std::cout << "RRT iterations: " << single.GetIterationCount()
+            << ", RRT-Connect iterations: " << connect.GetIterationCount()
+            << std::endl;
+}
+
+TEST(connect, open_map) {
+  // With nothing in the way the start tree may reach the goal radius by
+  // itself, or the trees meet
+  std::list<Obstacle> obsList;
+  Map openMap(40, 40, obsList);
+  openMap.SetCollisionModel(kCircleCollision);
+  for (uint64_t seed = 0; seed < 20; seed++) {
+    RRTConnectPath connect(openMap, 0, 0, 40, 40, 5, 4);
+    connect.SetSeed(seed);
+    ExpectValidPath(openMap, connect.FindPath(), std::make_pair(0, 0),
+                    std::make_pair(40, 40), 4);
+  }
+}
+
+/**
+ * @brief adds up the length of every edge of a path
+ */
+double PathLength(const std::list<std::pair<int, int>> &path) {
+  double length = 0;
+  std::list<std::pair<int, int>>::const_iterator it = path.begin();
+  for (std::list<std::pair<int, int>>::const_iterator next = ++path.begin();
+       next != path.end(); ++it, ++next) {
+    double dx = next->first - it->first;
+    double dy = next->second - it->second;
+    length += std::sqrt(dx * dx + dy * dy);
+  }
+  return length;
+}
+
+TEST(star, improves_path) {
+  // Around an obstacle sitting on the straight line from start to goal
+  std::list<Obstacle> obsList;
+  Map starMap(100, 100, obsList);
+  starMap.AddObstacle(Obstacle(50, 50, 15));
+  starMap.SetCollisionModel(kCircleCollision);
+  RRTPath rrt(starMap, 5, 5, 95, 95, 5, 3);
+  rrt.SetSeed(11);
+  EXPECT_TRUE(std::isinf(rrt.GetPathCost()));
+  EXPECT_TRUE(rrt.FindOptimalPath(0, 0).empty());
+
+  // Each call continues from the last and never makes the path longer
+  std::list<std::pair<int, int>> path = rrt.FindOptimalPath(1000, 0);
+  ExpectValidPath(starMap, path, std::make_pair(5, 5),
+                  std::make_pair(95, 95), 3);
+  double firstCost = rrt.GetPathCost();
+  EXPECT_NEAR(PathLength(path), firstCost, 1e-6);
+  path = rrt.FindOptimalPath(4000, 0);
+  ExpectValidPath(starMap, path, std::make_pair(5, 5),
+                  std::make_pair(95, 95), 3);
+  EXPECT_LE(rrt.GetPathCost(), firstCost);
+  EXPECT_NEAR(PathLength(path), rrt.GetPathCost(), 1e-6);
+  EXPECT_EQ(rrt.GetIterationCount(), 5000);
+
+  // The straight line through the obstacle is about 127 long; the first
+  // path found by FindPath is usually much longer
+  RRTPath first(starMap, 5, 5, 95, 95, 5, 3);
+  first.SetSeed(11);
+  std::cout << "RRT path length: " << PathLength(first.FindPath())
+            << ", RRT* path length: " << rrt.GetPathCost() << std::endl;
+  EXPECT_LT(rrt.GetPathCost(), 145);
+}
+
+TEST(star, time_budget) {
+  // With only a time budget the search stops on its own
+  std::list<Obstacle> obsList;
+  Map openMap(60, 60, obsList);
+  RRTPath rrt(openMap, 0, 0, 60, 60, 4, 3);
+  rrt.SetSeed(3);
+  ExpectValidPath(openMap, rrt.FindPath(), std::make_pair(0, 0),
+                  std::make_pair(60, 60), 3);
+  std::list<std::pair<int, int>> path = rrt.FindOptimalPath(0, 0.05);
+  EXPECT_FALSE(path.empty());
+  EXPECT_EQ(path.front(), std::make_pair(0, 0));
+  EXPECT_GT(rrt.GetIterationCount(), 0);
+}
+
+TEST(thread_pool, runs_every_task) {
+  ThreadPool pool(3);
+  EXPECT_EQ(pool.GetThreadCount(), 3u);
+  std::atomic<int> total(0);
+  for (int i = 1; i <= 100; i++)
+    pool.Submit([&total, i]() { total += i; });
+  pool.Wait();
+  EXPECT_EQ(total.load(), 5050);
+
+  // The pool can be reused after a Wait
+  pool.Submit([&total]() { total = 0; });
+  pool.Wait();
+  EXPECT_EQ(total.load(), 0);
+}
+
+TEST(parallel, find_path) {
+  Map narrowMap = NarrowPassageMap();
+  ParallelRRTPath parallel(narrowMap, 5, 90, 95, 85, 3, 2, 4, 2);
+  parallel.SetSeed(8);
+  EXPECT_EQ(parallel.GetPlannerCount(), 4u);
+  EXPECT_EQ(parallel.GetWinner(), ParallelRRTPath::kNoWinner);
+  for (int query = 0; query < 3; query++) {
+    ExpectValidPath(narrowMap, parallel.FindPath(), std::make_pair(5, 90),
+                    std::make_pair(95, 85), 2);
+    EXPECT_GE(parallel.GetWinner(), 0);
+    EXPECT_LT(parallel.GetWinner(), 4);
+    EXPECT_GT(parallel.GetIterationCount(), 0);
+  }
+}
+
+TEST(parallel, cancel) {
+  // The goal is unreachable, so only Cancel ends the search
+  std::list<Obstacle> obsList;
+  Map blockedMap(40, 40, obsList);
+  blockedMap.AddObstacle(Obstacle(30, 30, 8));
+  ParallelRRTPath parallel(blockedMap, 0, 0, 30, 30, 3, 1, 3);
+  std::thread canceller([&parallel]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    parallel.Cancel();
+  });
+  EXPECT_TRUE(parallel.FindPath().empty());
+  canceller.join();
+  EXPECT_EQ(parallel.GetWinner(), ParallelRRTPath::kNoWinner);
+}
+
+TEST(parallel, cancel_before_find_path) {
+  // A cancel that comes first stops the next race before it does any work
+  std::list<Obstacle> obsList;
+  Map openMap(40, 40, obsList);
+  ParallelRRTPath parallel(openMap, 0, 0, 30, 30, 3, 1, 3, 2);
+  parallel.SetSeed(4);
+  parallel.Cancel();
+  EXPECT_TRUE(parallel.FindPath().empty());
+  EXPECT_EQ(parallel.GetWinner(), ParallelRRTPath::kNoWinner);
+  EXPECT_EQ(parallel.GetIterationCount(), 0);
+
+  // The cancel is used up, so the race after it runs as normal
+  ExpectValidPath(openMap, parallel.FindPath(), std::make_pair(0, 0),
+                  std::make_pair(30, 30), 1);
+  EXPECT_GE(parallel.GetWinner(), 0);
+}
+
+TEST(batch, find_paths) {
+  std::list<Obstacle> obsList;
+  Map batchMap(60, 60, obsList);
+  batchMap.AddObstacle(Obstacle(30, 30, 10));
+  batchMap.AddObstacle(Obstacle(10, 45, 5));
+  batchMap.SetCollisionModel(kCircleCollision);
+  std::vector<PathQuery> queries;
+  for (int i = 0; i < 12; i++) {
+    PathQuery query = {std::make_pair(i * 5, 0), std::make_pair(55 - i, 58),
+                       2 + i % 3, 2};
+    queries.push_back(query);
+  }
+
+  // Results come back in query order, whatever thread solved them
+  BatchRRTPath batch(batchMap, 3);
+  batch.SetSeed(21);
+  EXPECT_EQ(batch.GetThreadCount(), 3u);
+  PlanningBudget budget;
+  budget.max_iterations = 100000;
+  std::vector<PlanningResult> results = batch.FindPaths(queries, budget);
+  ASSERT_EQ(results.size(), queries.size());
+  std::vector<std::list<std::pair<int, int>>> paths;
+  for (size_t i = 0; i < queries.size(); i++) {
+    EXPECT_EQ(results[i].status, kSuccess);
+    ExpectValidPath(batchMap, results[i].path, queries[i].start,
+                    queries[i].goal, 2);
+    paths.push_back(results[i].path);
+  }
+
+  // A seeded batch gives the same paths on any number of threads, and when
+  // run again on planners that have been reused
+  BatchRRTPath single(batchMap, 1);
+  single.SetSeed(21);
+  std::vector<PlanningResult> singleResults = single.FindPaths(queries, budget);
+  std::vector<PlanningResult> again = batch.FindPaths(queries, budget);
+  for (size_t i = 0; i < queries.size(); i++) {
+    EXPECT_EQ(singleResults[i].path, paths[i]);
+    EXPECT_EQ(again[i].path, paths[i]);
+  }
+  EXPECT_TRUE(batch.FindPaths(std::vector<PathQuery>(), budget).empty());
+}
+
+TEST(batch, budget_and_cancel) {
+  // An unreachable goal uses up its own budget without holding up the rest
+  std::list<Obstacle> obsList;
+  Map batchMap(60, 60, obsList);
+  batchMap.AddObstacle(Obstacle(45, 45, 8));
+  std::vector<PathQuery> queries;
+  for (int i = 0; i < 6; i++) {
+    PathQuery query = {std::make_pair(i, 0), std::make_pair(10, 50 - i), 3, 2};
+    queries.push_back(query);
+  }
+  PathQuery blocked = {std::make_pair(0, 0), std::make_pair(45, 45), 3, 1};
+  queries[2] = blocked;
+  BatchRRTPath batch(batchMap, 2);
+  batch.SetSeed(5);
+  PlanningBudget budget;
+  budget.max_iterations = 2000;
+  std::vector<PlanningResult> results = batch.FindPaths(queries, budget);
+  ASSERT_EQ(results.size(), queries.size());
+  for (size_t i = 0; i < queries.size(); i++)
+    EXPECT_EQ(results[i].status, i == 2 ? kExhausted : kSuccess);
+  EXPECT_EQ(results[2].iterations, 2000);
+
+  // A cancel that comes first stops the whole next batch, and only that one
+  batch.Cancel();
+  results = batch.FindPaths(queries, budget);
+  for (const PlanningResult &result : results) {
+    EXPECT_EQ(result.status, kCancelled);
+    EXPECT_TRUE(result.path.empty());
+  }
+  results = batch.FindPaths(queries, budget);
+  EXPECT_EQ(results[0].status, kSuccess);
+}
+
+TEST(path, sampling_strategies) {
+  std::list<Obstacle> obsList;
+  Map openMap(500, 500, obsList);
+  openMap.AddObstacle(Obstacle(250, 250, 40));
+
+  // Seeded planners repeat themselves with every strategy
+  GoalBiasedSampling biased(0.1);
+  HaltonSampling halton;
+  SobolSampling sobol;
+  UniformSampling uniform;
+  const SamplingStrategy *strategies[] = {&uniform, &biased, &halton, &sobol};
+  const char *names[] = {"uniform", "goal biased", "Halton", "Sobol"};
+  int totals[4] = {0, 0, 0, 0};
+  for (int s = 0; s < 4; s++) {
+    RRTPath first(openMap, 10, 10, 480, 470, 10, 10);
+    RRTPath second(openMap, 10, 10, 480, 470, 10, 10);
+    first.SetSamplingStrategy(*strategies[s]);
+    second.SetSamplingStrategy(*strategies[s]);
+    first.SetSeed(99);
+    second.SetSeed(99);
+    EXPECT_EQ(first.FindPath(), second.FindPath());
+    EXPECT_EQ(first.GetIterationCount(), second.GetIterationCount());
+
+    for (uint64_t seed = 0; seed < 10; seed++) {
+      first.SetSeed(seed);
+      first.Reset();
+      EXPECT_FALSE(first.FindPath().empty());
+      totals[s] += first.GetIterationCount();
+    }
+    std::cout << names[s] << " sampling: " << totals[s] / 10
+              << " iterations on average" << std::endl;
+  }
+
+  // Pulling towards the goal pays off on an open map
+  EXPECT_LT(totals[1], totals[0]);
+}
+
+TEST(point, geometry) {
+  Point<3, float> a = {{0, 0, 0}};
+  Point<3, float> b = {{3, 4, 12}};
+  EXPECT_EQ((Point<3, float>::kDimension), 3);
+  EXPECT_EQ(sizeof(a), 3 * sizeof(float));
+  EXPECT_DOUBLE_EQ((SquaredDistance<3, float>(a, b)), 169);
+  EXPECT_DOUBLE_EQ((Distance<3, float>(a, b)), 13);
+
+  // Integer squared distances are exact far past the range of int
+  Point<3, int> origin = {{0, 0, 0}};
+  Point<3, int> corner = {{1 << 30, 1 << 30, 1 << 30}};
+  EXPECT_EQ((SquaredDistance<3, int>(origin, corner)),
+            3 * (int64_t(1) << 60));
+
+  // Segments that pass by, end short of or go through a ball and a cube
+  BasicObstacle<3, int> ball(Point<3, int>{{5, 5, 5}}, 2);
+  Point<3, int> to = {{10, 10, 10}};
+  EXPECT_TRUE(ball.Contains(Point<3, int>{{6, 6, 6}}));
+  EXPECT_FALSE(ball.Contains(Point<3, int>{{7, 5, 5}}));
+  EXPECT_TRUE(ball.SegmentIntersectsCircle(origin, to));
+  EXPECT_FALSE(ball.SegmentIntersectsCircle(origin,
+                                            Point<3, int>{{10, 0, 0}}));
+  EXPECT_FALSE(ball.SegmentIntersectsCircle(origin,
+                                            Point<3, int>{{2, 2, 2}}));
+  EXPECT_TRUE(ball.SegmentIntersectsSquare(origin, to));
+  EXPECT_TRUE(ball.SegmentIntersectsSquare(Point<3, int>{{0, 6, 6}},
+                                           Point<3, int>{{10, 6, 6}}));
+  EXPECT_FALSE(ball.SegmentIntersectsSquare(Point<3, int>{{0, 7, 5}},
+                                            Point<3, int>{{10, 7, 5}}));
+
+  Map3i map(Point<3, int>{{20, 20, 20}}, {ball});
+  map.SetCollisionModel(kCircleCollision);
+  EXPECT_TRUE(map.SegmentCollides(origin, to));
+  EXPECT_FALSE(map.SegmentCollides(origin, Point<3, int>{{10, 0, 0}}));
+  EXPECT_FALSE(map.IsOnMap(Point<3, int>{{0, 21, 0}}));
+}
+
+TEST(path, three_dimensions) {
+  Point<3, float> start = {{10, 10, 10}};
+  Point<3, float> goal = {{90, 90, 90}};
+  Map3f floatMap(Point<3, float>{{100, 100, 100}},
+                 {BasicObstacle<3, float>(Point<3, float>{{50, 50, 50}}, 20)});
+  floatMap.SetCollisionModel(kCircleCollision);
+  RRTPath3f floatPlanner(floatMap, start, goal, 5, 5);
+  floatPlanner.SetSeed(5);
+  std::list<Point<3, float>> floatPath = floatPlanner.FindPath();
+  ASSERT_FALSE(floatPath.empty());
+  EXPECT_EQ(floatPath.front(), start);
+  EXPECT_LE((Distance<3, float>(floatPath.back(), goal)), 5);
+  for (auto it = std::next(floatPath.begin()); it != floatPath.end(); ++it) {
+    EXPECT_LE((Distance<3, float>(*std::prev(it), *it)), 5 + 1e-3);
+    EXPECT_FALSE(floatMap.SegmentCollides(*std::prev(it), *it));
+  }
+
+  // RRT* with informed sampling in 3-D only ever shortens the path
+  double firstCost = floatPlanner.GetPathCost();
+  floatPlanner.FindOptimalPath(2000, 0);
+  EXPECT_LE(floatPlanner.GetPathCost(), firstCost);
+
+  Map3i intMap(Point<3, int>{{100, 100, 100}},
+               {BasicObstacle<3, int>(Point<3, int>{{50, 50, 50}}, 20)});
+  intMap.SetCollisionModel(kSquareCollision);
+  RRTPath3i intPlanner(intMap, Point<3, int>{{10, 10, 10}},
+                       Point<3, int>{{90, 90, 90}}, 5, 5);
+  intPlanner.SetSeed(5);
+  intPlanner.SetLazyCollisionChecking(true);
+  std::list<Point<3, int>> intPath = intPlanner.FindPath();
+  ASSERT_FALSE(intPath.empty());
+  for (auto it = std::next(intPath.begin()); it != intPath.end(); ++it)
+    EXPECT_FALSE(intMap.SegmentCollides(*std::prev(it), *it));
+
+  // Equal seeds grow equal trees, whichever way the closest vertex is found
+  RRTPath3i again(intMap, Point<3, int>{{10, 10, 10}},
+                  Point<3, int>{{90, 90, 90}}, 5, 5);
+  again.SetSeed(5);
+  again.SetLazyCollisionChecking(true);
+  again.SetNearestNeighborMethod(kLinearScan);
+  EXPECT_TRUE(again.FindPath() == intPath);
+  EXPECT_EQ(again.GetVertexCount(), intPlanner.GetVertexCount());
+}
+
+TEST(path, float_budget) {
+  // The goal is walled in, so the search can only run out of budget
+  Point<2, float> goal = {{90, 90}};
+  Map2f walledMap(Point<2, float>{{100, 100}},
+                  {BasicObstacle<2, float>(goal, 15)});
+  RRTPath2f planner(walledMap, 10, 10, 90, 90, 5, 2);
+  planner.SetSeed(1);
+  PlanningBudget budget;
+  budget.max_iterations = 500;
+  std::vector<Point<2, float>> path;
+  EXPECT_EQ(planner.FindPath(budget, &path), kExhausted);
+  EXPECT_EQ(planner.GetIterationCount(), 500);
+  ASSERT_FALSE(path.empty());
+  EXPECT_LT((Distance<2, float>(path.back(), goal)),
+            (Distance<2, float>(path.front(), goal)));
+  EXPECT_FALSE(planner.GetVertex(0).has_parent());
+
+  std::atomic<bool> stop(true);
+  planner.SetStopFlag(&stop);
+  EXPECT_EQ(planner.FindPath(budget, &path), kCancelled);
+  planner.Reset();
+  EXPECT_EQ(planner.GetVertexCount(), 1u);
+}
+
+TEST(path, small_integer_step) {
+  // A diagonal step of one unit rounds back onto its start
+  std::list<Obstacle> obsList;
+  Map specificMap(15, 15, obsList);
+  RRTPath rrt(specificMap, 0, 0, 12, 12, 1, 1);
+  EXPECT_EQ(rrt.StepTowards(std::make_pair(0, 0), std::make_pair(10, 10)),
+            std::make_pair(0, 0));
+  EXPECT_FALSE(rrt.MoveTowardsPoint(RRTPath::kRootIndex,
+                                    std::make_pair(10, 10)));
+  EXPECT_EQ(rrt.GetVertexCount(), 1u);
+
+  // A step towards the vertex itself goes along the first axis
+  EXPECT_TRUE(rrt.MoveTowardsPoint(RRTPath::kRootIndex,
+                                   std::make_pair(0, 0)));
+  EXPECT_EQ(rrt.GetVertex(1).get_location(), std::make_pair(1, 0));
+
+  // No path repeats a waypoint, on one thread or several
+  for (size_t threads : {1, 2}) {
+    RRTPath planner(specificMap, 2, 2, 12, 12, 1, 1);
+    planner.SetSeed(1);
+    planner.SetExpansionThreads(threads);
+    PlanningBudget budget;
+    budget.max_iterations = 20000;
+    std::vector<std::pair<int, int>> path;
+    planner.FindPath(budget, &path);
+    ASSERT_FALSE(path.empty());
+    for (size_t i = 1; i < path.size(); i++)
+      EXPECT_NE(path[i - 1], path[i]);
+  }
+}
+
+TEST(tree_file, warm_start) {
+  // Grow a large tree from a docking location, towards a goal off the map,
+  // and save it
+  Map narrowMap = NarrowPassageMap();
+  std::shared_ptr<const Map> shared = std::make_shared<Map>(narrowMap);
+  RRTPath cold(shared, 10, 50, -50, -50, 3, 3);
+  cold.SetSeed(4);
+  ASSERT_EQ(cold.FindPath(4000).status, kExhausted);
+  const std::string path = "tree_file_test.rrttree";
+  ASSERT_TRUE(TreeFile::Save(cold, path));
+
+  // A planner from the same start to a goal the tree already reaches
+  // answers without running a single iteration
+  RRTPath warm(shared, 10, 50, 90, 80, 3, 5);
+  ASSERT_TRUE(TreeFile::Load(path, &warm));
+  EXPECT_EQ(warm.GetVertexCount(), cold.GetVertexCount());
+  PlanningResult result = warm.FindPath(PlanningBudget());
+  EXPECT_EQ(result.status, kSuccess);
+  EXPECT_EQ(result.iterations, 0);
+  ExpectValidPath(narrowMap, result.path, std::make_pair(10, 50),
+                  std::make_pair(90, 80), 5);
+
+  // Every saved edge is kept, parents before children
+  for (uint32_t i = 1; i < warm.GetVertexCount(); i++) {
+    uint32_t parent = warm.vertices_.GetParent(i);
+    ASSERT_LT(parent, i);
+    EXPECT_FALSE(narrowMap.SegmentCollides(warm.vertices_.GetLocation(parent),
+                                           warm.vertices_.GetLocation(i)));
+  }
+
+  // A different start, step or map is refused and leaves the planner as is
+  RRTPath otherStart(shared, 12, 50, 90, 80, 3, 3);
+  EXPECT_FALSE(TreeFile::Load(path, &otherStart));
+  EXPECT_EQ(otherStart.GetVertexCount(), 1u);
+  RRTPath otherStep(shared, 10, 50, 90, 80, 4, 3);
+  EXPECT_FALSE(TreeFile::Load(path, &otherStep));
+  Map changedMap = NarrowPassageMap();
+  changedMap.AddObstacle(Obstacle(20, 20, 5));
+  RRTPath otherMap(changedMap, 10, 50, 90, 80, 3, 3);
+  EXPECT_FALSE(TreeFile::Load(path, &otherMap));
+
+  // As is a truncated file
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size() - 4));
+  }
+  EXPECT_FALSE(TreeFile::Load(path, &warm));
+  EXPECT_EQ(warm.GetVertexCount(), cold.GetVertexCount());
+  std::remove(path.c_str());
+}
+
+TEST(map, fingerprint) {
+  std::list<Obstacle> obsList;
+  obsList.push_back(Obstacle(10, 10, 3));
+  obsList.push_back(Obstacle(30, 40, 5));
+  Map first(100, 100, obsList);
+  obsList.reverse();
+  Map second(100, 100, obsList);
+  // The order of the obstacles doesn't matter, anything else does
+  EXPECT_EQ(first.GetFingerprint(), second.GetFingerprint());
+  second.SetCollisionModel(kCircleCollision);
+  EXPECT_NE(first.GetFingerprint(), second.GetFingerprint());
+  Map third(100, 100, obsList);
+  third.AddObstacle(Obstacle(50, 50, 1));
+  EXPECT_NE(first.GetFingerprint(), third.GetFingerprint());
+  third.RemoveObstacle(Obstacle(50, 50, 1));
+  EXPECT_EQ(first.GetFingerprint(), third.GetFingerprint());
+  EXPECT_NE(first.GetFingerprint(), Map(100, 99, obsList).GetFingerprint());
+}
+
+TEST(prm, build_and_query) {
+  Map narrowMap = NarrowPassageMap();
+  std::shared_ptr<const Map> shared = std::make_shared<Map>(narrowMap);
+  PRMPath roadmap(shared, 4);
+  roadmap.SetSeed(8);
+  EXPECT_EQ(roadmap.Build(800, 12), 800u);
+  EXPECT_GT(roadmap.GetEdgeCount(), 0u);
+
+  // Every edge is clear, listed from both ends and within the radius
+  for (uint32_t i = 0; i < roadmap.GetNodeCount(); i++) {
+    std::vector<uint32_t> neighbors = roadmap.GetNeighbors(i);
+    for (uint32_t j : neighbors) {
+      std::vector<uint32_t> back = roadmap.GetNeighbors(j);
+      EXPECT_NE(std::find(back.begin(), back.end(), i), back.end());
+      EXPECT_TRUE(PathSmoother::IsClear(narrowMap, roadmap.GetNode(i),
+                                        roadmap.GetNode(j)));
+    }
+  }
+
+  // Queries through the gap, many times over the same roadmap
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<> y(5, 95);
+  for (int query = 0; query < 50; query++) {
+    std::pair<int, int> start(10, y(gen));
+    std::pair<int, int> goal(90, y(gen));
+    std::list<std::pair<int, int>> path = roadmap.FindPath(
+        start.first, start.second, goal.first, goal.second);
+    ExpectValidPath(narrowMap, path, start, goal, 0);
+    EXPECT_NEAR(roadmap.GetPathCost(), PathSmoother::GetPathLength(path),
+                1e-3);
+  }
+
+  // Points that see each other are joined directly
+  std::list<std::pair<int, int>> direct = roadmap.FindPath(10, 10, 40, 90);
+  EXPECT_EQ(direct.size(), 2u);
+
+  // A goal inside an obstacle can't be reached
+  EXPECT_TRUE(roadmap.FindPath(10, 10, 50, 10).empty());
+  EXPECT_TRUE(std::isinf(roadmap.GetPathCost()));
+}
+
+TEST(prm, thread_count_does_not_change_roadmap) {
+  Map narrowMap = NarrowPassageMap();
+  PRMPath serial(narrowMap, 1);
+  PRMPath parallel(narrowMap, 3);
+  EXPECT_EQ(serial.GetThreadCount(), 1u);
+  EXPECT_EQ(parallel.GetThreadCount(), 3u);
+  serial.SetSeed(21);
+  parallel.SetSeed(21);
+  serial.Build(500, 15, 8);
+  parallel.Build(500, 15, 8);
+  ASSERT_EQ(serial.GetEdgeCount(), parallel.GetEdgeCount());
+  for (uint32_t i = 0; i < serial.GetNodeCount(); i++) {
+    EXPECT_EQ(serial.GetNode(i), parallel.GetNode(i));
+    EXPECT_EQ(serial.GetNeighbors(i), parallel.GetNeighbors(i));
+  }
+  EXPECT_EQ(serial.FindPath(5, 5, 95, 95), parallel.FindPath(5, 5, 95, 95));
+}
+
+TEST(path, lazy_collision_checking) {
+  // On an open map most edges are never fully checked
+  std::list<Obstacle> obsList;
+  Map openMap(500, 500, obsList);
+  openMap.AddObstacle(Obstacle(250, 250, 40));
+  openMap.SetCollisionModel(kCircleCollision);
+  RRTPath openPlanner(openMap, 10, 10, 480, 470, 10, 10);
+  openPlanner.SetLazyCollisionChecking(true);
+  openPlanner.SetSeed(6);
+  std::list<std::pair<int, int>> openPath = openPlanner.FindPath();
+  ExpectValidPath(openMap, openPath, std::make_pair(10, 10),
+                  std::make_pair(480, 470), 10);
+  size_t unchecked = std::count(openPlanner.edge_checked_.begin(),
+                                openPlanner.edge_checked_.end(), 0);
+  EXPECT_GT(unchecked, openPlanner.GetVertexCount() / 2);
+
+  // Steps longer than the wall is thick land on both sides of it, so lazy
+  // edges cross the wall and have to be pruned before a path is returned
+  Map narrowMap = NarrowPassageMap();
+  for (uint64_t seed = 0; seed < 10; seed++) {
+    RRTPath planner(narrowMap, 10, 50, 90, 50, 8, 4);
+    planner.SetLazyCollisionChecking(true);
+    planner.SetSeed(seed);
+    PlanningResult result = planner.FindPath(20000);
+    ASSERT_EQ(result.status, kSuccess);
+    ExpectValidPath(narrowMap, result.path, std::make_pair(10, 50),
+                    std::make_pair(90, 50), 4);
+    // Every vertex left in the tree is outside the obstacles
+    for (uint32_t i = 0; i < planner.GetVertexCount(); i++)
+      EXPECT_FALSE(narrowMap.IsOccupied(planner.vertices_.GetLocation(i)));
+
+    // Pruned vertices are removed in place, and only compacted away once
+    // they fill half of the store
+    EXPECT_LT(planner.removed_vertices_ * 2, planner.GetVertexCount());
+    EXPECT_EQ(planner.kd_tree_.Size(),
+              planner.GetVertexCount() - planner.removed_vertices_);
+    size_t removed = 0;
+    for (uint32_t i = 1; i < planner.GetVertexCount(); i++) {
+      if (planner.vertices_.IsRemoved(i))
+        removed++;
+      else
+        EXPECT_FALSE(planner.vertices_.IsRemoved(
+            planner.vertices_.GetParent(i)));
+    }
+    EXPECT_EQ(removed, planner.removed_vertices_);
+  }
+
+  // Partial paths are checked too
+  RRTPath partial(narrowMap, 10, 50, 90, 50, 8, 4);
+  partial.SetLazyCollisionChecking(true);
+  partial.SetSeed(2);
+  PlanningResult result = partial.FindPath(30);
+  EXPECT_EQ(result.status, kExhausted);
+  std::list<std::pair<int, int>>::const_iterator it = result.path.begin();
+  for (std::list<std::pair<int, int>>::const_iterator next =
+           ++result.path.begin();
+       next != result.path.end(); ++it, ++next)
+    EXPECT_FALSE(narrowMap.SegmentCollides(*it, *next));
+}
+
+TEST(path, vector_output) {
+  // The same seed gives the same path as a vector as it does as a list
+  Map narrowMap = NarrowPassageMap();
+  RRTPath listPlanner(narrowMap, 10, 50, 90, 50, 3, 3);
+  listPlanner.SetSeed(8);
+  PlanningResult expected = listPlanner.FindPath(PlanningBudget());
+  ASSERT_EQ(expected.status, kSuccess);
+  RRTPath vectorPlanner(narrowMap, 10, 50, 90, 50, 3, 3);
+  vectorPlanner.SetSeed(8);
+  std::vector<std::pair<int, int>> path(1000, std::make_pair(-1, -1));
+  const std::pair<int, int> *memory = path.data();
+  EXPECT_EQ(vectorPlanner.FindPath(PlanningBudget(), &path), kSuccess);
+  std::list<std::pair<int, int>> pathList(path.begin(), path.end());
+  EXPECT_EQ(pathList, expected.path);
+
+  // Reusing the vector for another query doesn't reallocate it
+  vectorPlanner.Reset(10, 50, 90, 80, 3, 3);
+  vectorPlanner.SetSeed(9);
+  EXPECT_EQ(vectorPlanner.FindPath(PlanningBudget(), &path), kSuccess);
+  EXPECT_EQ(path.data(), memory);
+  ExpectValidPath(narrowMap, std::list<std::pair<int, int>>(path.begin(),
+                                                            path.end()),
+                  std::make_pair(10, 50), std::make_pair(90, 80), 3);
+
+  // Out of budget it holds the path to the vertex closest to the goal
+  vectorPlanner.Reset(10, 50, 90, 50, 3, 3);
+  PlanningBudget budget;
+  budget.max_iterations = 5;
+  EXPECT_EQ(vectorPlanner.FindPath(budget, &path), kExhausted);
+  ASSERT_FALSE(path.empty());
+  EXPECT_EQ(path.front(), (std::make_pair(10, 50)));
+
+  // Smoothing applies as it does to lists
+  vectorPlanner.Reset(10, 50, 90, 50, 3, 3);
+  vectorPlanner.SetSeed(8);
+  vectorPlanner.EnablePathSmoothing(true);
+  EXPECT_EQ(vectorPlanner.FindPath(PlanningBudget(), &path), kSuccess);
+  EXPECT_LT(path.size(), expected.path.size());
+  ExpectValidPath(narrowMap, std::list<std::pair<int, int>>(path.begin(),
+                                                            path.end()),
+                  std::make_pair(10, 50), std::make_pair(90, 50), 3);
+}
+
+TEST(path_writer, formats) {
+  std::vector<std::pair<int, int>> first;
+  first.push_back(std::make_pair(0, 0));
+  first.push_back(std::make_pair(-12, 345));
+  std::list<std::pair<int, int>> second;
+  second.push_back(std::make_pair(7, 8));
+  const std::string binaryPath = "path_writer_test.bin";
+  const std::string csvPath = "path_writer_test.csv";
+
+  PathWriter writer;
+  EXPECT_FALSE(writer.Write(0, first));
+  ASSERT_TRUE(writer.Open(binaryPath, kBinaryPathFormat));
+  EXPECT_TRUE(writer.Write(3, first));
+  EXPECT_TRUE(writer.Write(uint64_t(1) << 40, second));
+  EXPECT_TRUE(writer.Write(5, std::vector<std::pair<int, int>>()));
+  EXPECT_EQ(writer.GetPathCount(), 3u);
+  ASSERT_TRUE(writer.Open(csvPath, kCsvPathFormat));
+  EXPECT_TRUE(writer.Write(3, first));
+  EXPECT_TRUE(writer.Write(uint64_t(1) << 40, second));
+  EXPECT_TRUE(writer.Write(5, std::vector<std::pair<int, int>>()));
+  EXPECT_EQ(writer.GetPathCount(), 3u);
+  EXPECT_TRUE(writer.Close());
+  EXPECT_FALSE(writer.IsOpen());
+
+  std::ifstream csv(csvPath.c_str());
+  std::string csvData((std::istreambuf_iterator<char>(csv)),
+                      std::istreambuf_iterator<char>());
+  EXPECT_EQ(csvData,
+            "path,x,y\n3,0,0\n3,-12,345\n1099511627776,7,8\n5,,\n");
+
+  std::ifstream binary(binaryPath.c_str(), std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(binary)),
+                   std::istreambuf_iterator<char>());
+  ASSERT_EQ(data.size(), 16u + 3 * 12u + 3 * 8u);
+  EXPECT_EQ(data.substr(0, 8), "RRTPATH\n");
+  uint32_t version;
+  std::memcpy(&version, data.data() + 8, sizeof(version));
+  EXPECT_EQ(version, PathWriter::kVersion);
+  uint64_t id;
+  uint32_t count;
+  int32_t xy[2];
+  std::memcpy(&id, data.data() + 16, sizeof(id));
+  std::memcpy(&count, data.data() + 24, sizeof(count));
+  std::memcpy(xy, data.data() + 36, sizeof(xy));
+  EXPECT_EQ(id, 3u);
+  EXPECT_EQ(count, 2u);
+  EXPECT_EQ(xy[0], -12);
+  EXPECT_EQ(xy[1], 345);
+  std::memcpy(&id, data.data() + 44, sizeof(id));
+  EXPECT_EQ(id, uint64_t(1) << 40);
+  std::memcpy(&id, data.data() + 64, sizeof(id));
+  std::memcpy(&count, data.data() + 72, sizeof(count));
+  EXPECT_EQ(id, 5u);
+  EXPECT_EQ(count, 0u);
+  std::remove(binaryPath.c_str());
+  std::remove(csvPath.c_str());
+}
+
+TEST(batch, write_paths) {
+  // Paths come out in any order but the file holds every query's path
+  std::list<Obstacle> obsList;
+  Map batchMap(60, 60, obsList);
+  batchMap.AddObstacle(Obstacle(30, 30, 10));
+  batchMap.SetCollisionModel(kCircleCollision);
+  std::vector<PathQuery> queries;
+  for (int i = 0; i < 40; i++) {
+    PathQuery query = {std::make_pair(i, 0), std::make_pair(59 - i, 58), 3, 2};
+    queries.push_back(query);
+  }
+  // A goal inside the obstacle runs out of budget and is written empty
+  PathQuery blocked = {std::make_pair(0, 0), std::make_pair(30, 30), 3, 1};
+  queries[7] = blocked;
+  PlanningBudget budget;
+  budget.max_iterations = 3000;
+  BatchRRTPath batch(batchMap, 4);
+  batch.SetSeed(3);
+  std::vector<std::list<std::pair<int, int>>> expected;
+  for (PlanningResult &result : batch.FindPaths(queries, budget)) {
+    if (result.status != kSuccess)
+      result.path.clear();
+    expected.push_back(result.path);
+  }
+  EXPECT_TRUE(expected[7].empty());
+
+  const std::string path = "batch_write_paths_test.csv";
+  PathWriter writer;
+  EXPECT_FALSE(batch.WritePaths(queries, budget, &writer));
+  ASSERT_TRUE(writer.Open(path, kCsvPathFormat));
+  EXPECT_TRUE(batch.WritePaths(queries, budget, &writer));
+  EXPECT_EQ(writer.GetPathCount(), queries.size());
+  ASSERT_TRUE(writer.Close());
+
+  std::vector<std::list<std::pair<int, int>>> written(queries.size());
+  std::vector<int> emptyLines(queries.size(), 0);
+  std::ifstream in(path.c_str());
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ(line, "path,x,y");
+  while (std::getline(in, line)) {
+    size_t id;
+    int x, y;
+    if (std::sscanf(line.c_str(), "%zu,%d,%d", &id, &x, &y) == 3) {
+      ASSERT_LT(id, queries.size());
+      written[id].push_back(std::make_pair(x, y));
+    } else {
+      ASSERT_EQ(std::sscanf(line.c_str(), "%zu,,", &id), 1);
+      ASSERT_LT(id, queries.size());
+      emptyLines[id]++;
+    }
+  }
+  EXPECT_EQ(written, expected);
+  for (size_t i = 0; i < queries.size(); i++)
+    EXPECT_EQ(emptyLines[i], expected[i].empty() ? 1 : 0);
+
+  // A cancel that comes first means nothing is written, and is used up
+  ASSERT_TRUE(writer.Open(path, kCsvPathFormat));
+  batch.Cancel();
+  EXPECT_TRUE(batch.WritePaths(queries, budget, &writer));
+  EXPECT_EQ(writer.GetPathCount(), 0u);
+  EXPECT_TRUE(batch.WritePaths(queries, budget, &writer));
+  EXPECT_EQ(writer.GetPathCount(), queries.size());
+  ASSERT_TRUE(writer.Close());
+  std::remove(path.c_str());
+}
+
+TEST(concurrent_store, add_and_nearest) {
+  // Threads grow one tree at once, each linking to the nearest vertex
+  ConcurrentVertexStore store;
+  store.Reset(std::make_pair(1000, 600), 7);
+  EXPECT_EQ(store.Nearest(5, 5), ConcurrentVertexStore::kNoVertex);
+  ASSERT_EQ(store.Add(500, 300, ConcurrentVertexStore::kNoVertex), 0u);
+  const int kThreads = 4;
+  const int kAdds = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.push_back(std::thread([&store, t]() {
+      Sampler sampler;
+      sampler.Seed(t);
+      for (int i = 0; i < kAdds; i++) {
+        int x = static_cast<int>(sampler.NextBounded(1001));
+        int y = static_cast<int>(sampler.NextBounded(601));
+        store.Add(x, y, store.Nearest(x, y));
+      }
+    }));
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Every parent was published before its child took an index
+  ASSERT_EQ(store.Size(), size_t(kThreads) * kAdds + 1);
+  EXPECT_EQ(store.GetParent(0), ConcurrentVertexStore::kNoVertex);
+  for (uint32_t i = 1; i < store.Size(); i++)
+    ASSERT_LT(store.GetParent(i), i);
+
+  // Nearest is exact, anywhere on the map and off it
+  Sampler sampler;
+  sampler.Seed(99);
+  for (int q = 0; q < 200; q++) {
+    int x = static_cast<int>(sampler.NextBounded(1200)) - 100;
+    int y = static_cast<int>(sampler.NextBounded(800)) - 100;
+    int64_t best = INT64_MAX;
+    for (uint32_t i = 0; i < store.Size(); i++) {
+      int64_t dx = store.GetLocation(i).first - x;
+      int64_t dy = store.GetLocation(i).second - y;
+      best = std::min(best, dx * dx + dy * dy);
+    }
+    std::pair<int, int> found = store.GetLocation(store.Nearest(x, y));
+    int64_t dx = found.first - x;
+    int64_t dy = found.second - y;
+    EXPECT_EQ(dx * dx + dy * dy, best);
+  }
+
+  // Reset keeps the blocks but forgets the vertices
+  store.Reset(std::make_pair(50, 50), 5);
+  EXPECT_EQ(store.Size(), 0u);
+  EXPECT_EQ(store.Nearest(5, 5), ConcurrentVertexStore::kNoVertex);
+}
+
+TEST(path, parallel_expansion) {
+  Map narrowMap = NarrowPassageMap();
+  RRTPath planner(narrowMap, 10, 50, 90, 50, 3, 3);
+  EXPECT_EQ(planner.GetExpansionThreadCount(), 1u);
+  planner.SetExpansionThreads(4);
+  EXPECT_EQ(planner.GetExpansionThreadCount(), 4u);
+  planner.SetSeed(12);
+  std::list<std::pair<int, int>> path = planner.FindPath();
+  ExpectValidPath(narrowMap, path, std::make_pair(10, 50),
+                  std::make_pair(90, 50), 3);
+
+  // The merged tree is a proper tree, indexed by the k-d tree as usual, and
+  // the shared tree is left holding the same vertices for the next search
+  EXPECT_EQ(planner.kd_tree_.Size(), planner.GetVertexCount());
+  EXPECT_EQ(planner.shared_tree_size_, planner.GetVertexCount());
+  EXPECT_EQ(planner.shared_tree_->Size(), planner.GetVertexCount());
+  for (uint32_t i = 1; i < planner.GetVertexCount(); i++) {
+    uint32_t parent = planner.vertices_.GetParent(i);
+    ASSERT_LT(parent, i);
+    EXPECT_FALSE(narrowMap.SegmentCollides(
+        planner.vertices_.GetLocation(parent),
+        planner.vertices_.GetLocation(i)));
+  }
+  EXPECT_GT(planner.GetIterationCount(), 0);
+
+  // The iteration limit is shared by the threads
+  RRTPath offMap(narrowMap, 10, 50, -50, -50, 3, 3);
+  offMap.SetExpansionThreads(3);
+  PlanningResult limited = offMap.FindPath(500);
+  EXPECT_EQ(limited.status, kExhausted);
+  EXPECT_EQ(limited.iterations, 500);
+  EXPECT_EQ(offMap.GetIterationCount(), 500);
+  ASSERT_FALSE(limited.path.empty());
+  EXPECT_EQ(limited.path.front(), (std::make_pair(10, 50)));
+
+  // A later search picks up where the shared tree left off, including
+  // vertices grown on one thread in between
+  offMap.SetExpansionThreads(1);
+  offMap.FindPath(100);
+  offMap.SetExpansionThreads(2);
+  offMap.FindPath(100);
+  ASSERT_EQ(offMap.shared_tree_->Size(), offMap.GetVertexCount());
+  for (uint32_t i = 0; i < offMap.GetVertexCount(); i++)
+    EXPECT_EQ(offMap.shared_tree_->GetLocation(i),
+              offMap.vertices_.GetLocation(i));
+
+  // As is the stop flag
+  std::atomic<bool> stop(true);
+  offMap.SetStopFlag(&stop);
+  EXPECT_EQ(offMap.FindPath(PlanningBudget()).status, kCancelled);
+
+  // Lazy mode prunes the bad edges the threads added before returning
+  for (uint64_t seed = 0; seed < 5; seed++) {
+    RRTPath lazy(narrowMap, 10, 50, 90, 50, 8, 4);
+    lazy.SetExpansionThreads(2);
+    lazy.SetLazyCollisionChecking(true);
+    lazy.SetSeed(seed);
+    std::vector<std::pair<int, int>> lazyPath;
+    ASSERT_EQ(lazy.FindPath(PlanningBudget(), &lazyPath), kSuccess);
+    ExpectValidPath(narrowMap,
+                    std::list<std::pair<int, int>>(lazyPath.begin(),
+                                                   lazyPath.end()),
+                    std::make_pair(10, 50), std::make_pair(90, 50), 4);
+    // Pruned vertices are gone from the shared tree as well
+    for (int q = 0; q < 100; q++) {
+      uint32_t nearest = lazy.shared_tree_->Nearest(q, 100 - q);
+      EXPECT_FALSE(lazy.vertices_.IsRemoved(nearest));
+    }
+  }
+
+  // RRT* carries on from the tree the threads grew
+  double firstCost = planner.GetPathCost();
+  std::list<std::pair<int, int>> optimal = planner.FindOptimalPath(2000, 0);
+  ExpectValidPath(narrowMap, optimal, std::make_pair(10, 50),
+                  std::make_pair(90, 50), 3);
+  EXPECT_LE(planner.GetPathCost(), firstCost);
+}